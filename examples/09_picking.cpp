@@ -87,7 +87,13 @@ public:
         }
         sceneRenderPass.finish();
 
-        auto pixelValues = sceneRenderPass.readPixels(mouseX, mouseY);           // read pixel values from framebuffer
+        if (pixelRead.valid() && pixelRead.wait_for(std::chrono::seconds(0)) == std::future_status::ready){
+            auto pixelValues = pixelRead.get();                                 // result of a previous frame's read
+            pixelValue = Color(pixelValues[0].r/255.0f, pixelValues[0].g/255.0f, pixelValues[0].b/255.0f, pixelValues[0].a/255.0f);
+        }
+        if (!pixelRead.valid()){
+            pixelRead = sceneRenderPass.readPixelsAsync(mouseX, mouseY);        // read pixel values from framebuffer without waiting for the GPU
+        }
 
         // render gui to framebuffer
         auto guiRenderPass = RenderPass::create()
@@ -103,8 +109,6 @@ public:
         }
 
         guiRenderPass.finish();
-
-        pixelValue = pixelValues[0];
     }
 
     void drawTopTextAndColor(sre::Color color){
@@ -125,6 +129,7 @@ private:
     std::shared_ptr<Material> mat[4];
     std::shared_ptr<Mesh> mesh[4];
     Color pixelValue;
+    std::future<std::vector<glm::u8vec4>> pixelRead;
     int i=0;
     int mouseX;
     int mouseY;
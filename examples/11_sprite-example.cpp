@@ -58,7 +58,8 @@ public:
         ImGui::Checkbox("RenderWorld", &demoWorld );
         if (demoWorld ){
             if (world == nullptr){
-                auto worldBuilder = SpriteBatch::create();
+                auto worldBuilder = SpriteBatch::create()
+                        .withChunks({404,150});                     // only chunks inside the view are drawn
 
                 glm::ivec2 blockSize(101,50);
 
@@ -92,7 +93,7 @@ public:
 
             ImGui::Combo("Sprite", &selected,namesPtr,names.size());
 
-            auto sprite = atlas->get(names.at(selected));
+            auto sprite = atlas->get(selected);                 // the index in getNames() is the sprite handle
             static glm::vec4 color (1,1,1,1);
             static glm::vec2 scale(1,1);
             static glm::vec2 position(200,100);
@@ -112,9 +113,13 @@ public:
             sprite.setRotation(rotation);
             sprite.setFlip(flip);
 
-            auto sb = SpriteBatch::create()
-                    .addSprite(sprite).build();
-            renderPass.draw(sb);
+            // the sprite changes every frame, so the sprite batch is updated in place
+            if (preview == nullptr){
+                preview = SpriteBatch::create().addSprite(sprite).build();
+            } else {
+                preview->update().addSprite(sprite).build();
+            }
+            renderPass.draw(preview);
 
             std::vector<glm::vec3> lines;
             auto spriteCorners = sprite.getTrimmedCorners();
@@ -136,6 +141,7 @@ private:
     SDLRenderer r;
     Camera camera;
     std::shared_ptr<SpriteBatch> world;
+    std::shared_ptr<SpriteBatch> preview;
     bool showInspector = false;
 };
 
@@ -9,9 +9,11 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <sre/SDLRenderer.hpp>
+#include <sre/ShadowMap.hpp>
 #include <sre/impl/GL.hpp>
 #include <sre/Inspector.hpp>
 #include <sre/ModelImporter.hpp>
+#include <imgui.h>
 
 using namespace sre;
 
@@ -24,48 +26,37 @@ public:
 
         mesh = sre::ModelImporter::importObj("examples_data/", "suzanne.obj", materials_unused);
 
-        meshPlane = Mesh::create().withQuad(2).build();
+        meshPlane = Mesh::create().withQuad(20).build();
+        meshCube = Mesh::create().withCube(0.5f).build();
 
         worldLights.setAmbientLight(glm::vec3{0.02f});
         lightDirection = glm::normalize(glm::vec3{1,1,1});
         worldLights.addLight(Light::create().withDirectionalLight(lightDirection).withColor(Color(1,1,1),7).build());
 
         camera.setPerspectiveProjection(fieldOfViewY,near,far);
-        camera.lookAt(eye,at,{0,1,0});
 
-        mat = Shader::getStandardPBR()->createMaterial({{"S_SHADOW","true"}});
-        mat->setName("PBR material");
+        shadowMap = ShadowMap::create()
+                .withSize(1024)
+                .withCascades(3)
+                .withShadowDistance(30)
+                .build();
+
+        if (shadowMap){
+            mat = Shader::getStandardPBR()->createMaterial(shadowMap->getSpecializationConstants());
 
-        shadowMapMat = Shader::getShadow()->createMaterial();
-        mat->setName("Shadow material");
-
-        if (!sre::renderInfo().supportFBODepthAttachment){         // if not support for depth textures
-            shadowMapTexture = Texture::create()
-                    .withName("ShadowMapTex")
-                    .withGenerateMipmaps(false)
-                    .withFilterSampling(false)                     // filtering not supported, since packing depth in RGBA
-                    .withRGBAData(nullptr,shadowMapSize,shadowMapSize)
-                    .build();
-
-            shadowMap = Framebuffer::create()
-                    .withName("ShadowMap")
-                    .withColorTexture(shadowMapTexture)
-                    .build();
+            // the ground and the cubes are rendered into the shadow map cache once
+            shadowMap->addStaticCaster(meshPlane, planeTransform());
+            for (int i=0;i<cubeCount;i++){
+                shadowMap->addStaticCaster(meshCube, cubeTransform(i));
+            }
         } else {
-            shadowMapTexture = Texture::create()
-                    .withName("ShadowMapTex")
-                    .withGenerateMipmaps(false)
-                    .withFilterSampling(true)
-                    .withWrapUV(Texture::Wrap::ClampToBorder)
-                    .withDepth(shadowMapSize,shadowMapSize, Texture::DepthPrecision::I24)
-                    .build();
-
-            shadowMap = Framebuffer::create()
-                    .withName("ShadowMap")
-                    .withDepthTexture(shadowMapTexture)
-                    .build();
+            mat = Shader::getStandardPBR()->createMaterial();
         }
+        mat->setName("PBR material");
 
+        r.frameUpdate = [&](float deltaTime){
+            time += deltaTime;
+        };
         r.frameRender = [&](){
             render();
         };
@@ -82,58 +73,48 @@ public:
         r.startEventLoop();
     }
 
-    // updates the shadow map
-    static void updataShadowmapViewProjection(Camera* shadowmapCamera,
-                                              glm::vec3 lightDirection,
-                                              float fieldOfViewYDegrees,
-                                              float near,
-                                              float far,
-                                              glm::vec3 eye,
-                                              glm::vec3 at,
-                                              float shadowMapFraction = 1.0 // amount of view frustum with shadowmap
-                                              )
-    {
-        glm::vec3 viewDirection = glm::normalize(at - eye);
-        glm::vec3 lightEye = eye + viewDirection * ((far-near)*shadowMapFraction/2 + near);
-        glm::vec3 lightAt = lightEye - lightDirection;
-
-        shadowmapCamera->setOrthographicProjection(4,-4,4);
-        shadowmapCamera->lookAt(lightEye,lightAt, abs(lightDirection.x)<0.5? glm::vec3(1,0,0) : glm::vec3(0,0,1));
+    glm::mat4 planeTransform(){
+        return glm::translate(glm::vec3{0,-1.2f,0})*glm::rotate(glm::radians(-90.0f), glm::vec3(1,0,0));
     }
 
-    void renderWorld(RenderPass& rp,std::shared_ptr<Material> mat){
-        rp.draw(mesh, glm::rotate(rotateX, glm::vec3(1,0,0))*glm::rotate(rotateY, glm::vec3(0,1,0)),mat);
-        rp.draw(meshPlane, glm::translate(glm::vec3{0,-1.2f,0})*glm::rotate(glm::radians(-90.0f), glm::vec3(1,0,0)),mat);
+    glm::mat4 cubeTransform(int i){
+        return glm::translate(glm::vec3{(i%2)*4.0f-2,-0.7f,-i*2.0f});
     }
 
-    void render(){
-        // shadow pass - build shadow map - render shadow casters with shadow material
-        updataShadowmapViewProjection(&shadowmapCamera, lightDirection, fieldOfViewY, near, far, eye, at);
-        auto rp = RenderPass::create()
-                .withFramebuffer(shadowMap)
-                .withCamera(shadowmapCamera)
-                .withWorldLights(&worldLights)
-                .withClearColor(true,{1,1,1,1})
-                .withGUI(false)
-                .build();
-
-        renderWorld(rp, shadowMapMat);
+    glm::mat4 meshTransform(){
+        return glm::rotate(rotateX, glm::vec3(1,0,0))*glm::rotate(rotateY, glm::vec3(0,1,0));
+    }
 
-        rp.finish();
+    void render(){
+        // the camera moves back and forth - cascades are only re-rendered when they have moved
+        glm::vec3 eye = glm::vec3{std::sin(time*0.3f)*2,1,3.5f+std::sin(time*0.2f)*3};
+        camera.lookAt(eye,eye+glm::vec3{0,-0.3f,-1},{0,1,0});
+
+        // shadow pass - renders invalid cascades of the static casters and the dynamic casters
+        if (shadowMap){
+            shadowMap->drawDynamic(mesh, meshTransform());
+            shadowMap->update(camera, lightDirection);
+            shadowMap->setUniforms(mat);
+        }
 
         // render pass - render world with shadow lookup
-        auto rp2 = RenderPass::create()
+        auto rp = RenderPass::create()
                 .withCamera(camera)
                 .withClearColor(true,{0,0,0,1})
                 .withWorldLights(&worldLights)
                 .build();
 
-        mat->set("shadowMap", shadowMapTexture);
-        static glm::mat4 offset = glm::translate(glm::vec3(0.5f)) * glm::scale(glm::vec3(0.5f));
-        glm::mat4 shadowViewProjOffset = offset * shadowmapCamera.getProjectionTransform({shadowMapSize,shadowMapSize}) * shadowmapCamera.getViewTransform();
-        mat->set("shadowViewProjOffset", shadowViewProjOffset);
+        rp.draw(mesh, meshTransform(), mat);
+        rp.draw(meshPlane, planeTransform(), mat);
+        for (int i=0;i<cubeCount;i++){
+            rp.draw(meshCube, cubeTransform(i), mat);
+        }
 
-        renderWorld(rp2, mat);
+        if (shadowMap){
+            ImGui::LabelText("Cascades rendered", "%i / %i", shadowMap->getCascadesRendered(), shadowMap->getCascadeCount());
+        } else {
+            ImGui::LabelText("Shadows", "Not supported");
+        }
 
         static Inspector inspector;
         inspector.update();
@@ -144,23 +125,19 @@ public:
 private:
     float fieldOfViewY = 45;
     float near = 0.1;
-    float far = 10;
-    unsigned int shadowMapSize = 1024;
-    glm::vec3 eye = {0,0,3.5};
-    glm::vec3 at = {0,0,0};
+    float far = 50;
+    static constexpr int cubeCount = 10;
     glm::vec3 lightDirection;
     SDLRenderer r;
-    Camera shadowmapCamera;
     Camera camera;
     std::shared_ptr<Mesh> mesh;
     std::shared_ptr<Mesh> meshPlane;
+    std::shared_ptr<Mesh> meshCube;
     std::shared_ptr<Material> mat;
-    std::shared_ptr<Material> shadowMapMat;
-    std::shared_ptr<Framebuffer> shadowMap;
-    std::shared_ptr<Texture> shadowMapTexture;
+    std::shared_ptr<ShadowMap> shadowMap;
     float rotateX = 0;
     float rotateY = 0;
-    int texture = 0;
+    float time = 0;
     bool showInspector = false;
     WorldLights worldLights;
 };
@@ -169,4 +146,3 @@ int main() {
     std::make_unique<ShadowExample>();
     return 0;
 }
-
@@ -12,6 +12,8 @@
 #include <sre/impl/GL.hpp>
 #include <sre/Inspector.hpp>
 #include <sre/ModelImporter.hpp>
+#include <sre/DeferredRenderer.hpp>
+#include <random>
 
 using namespace sre;
 
@@ -22,9 +24,25 @@ public:
 
         mesh = sre::ModelImporter::importObj("examples_data/sponza/", "sponza.obj", materials);
 
+        // replace the imported materials with materials writing to the G-buffer
+        for (auto & material : materials){
+            auto gbufferMaterial = Shader::getStandardPBR()->createMaterial({{"S_GBUFFER","1"}});
+            gbufferMaterial->setColor(material->getColor());
+            gbufferMaterial->setTexture(material->getTexture());
+            gbufferMaterial->setMetallicRoughness({0.0f,0.8f});
+            material = gbufferMaterial;
+        }
+        deferredRenderer = DeferredRenderer::create().build();
+
         worldLights.setAmbientLight(glm::vec3{0.02f});
         lightDirection = glm::normalize(glm::vec3{1,1,1});
         worldLights.addLight(Light::create().withDirectionalLight(lightDirection).withColor(Color(1,1,1),7).build());
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> unit(0,1);
+        for (int i=0;i<256;i++){
+            glm::vec3 position(unit(random)*36-18, unit(random)*12, unit(random)*14-7);
+            worldLights.addLight(Light::create().withPointLight(position).withColor(Color(unit(random),unit(random),unit(random)),2).withRange(3).build());
+        }
 
         camera.setPerspectiveProjection(fieldOfViewY,near,far);
         camera.lookAt(eye,at,{0,1,0});
@@ -49,15 +67,17 @@ public:
     }
 
     void render(){
-        // render pass - render world with shadow lookup
-        auto rp = RenderPass::create()
+        // geometry pass - render surface properties to the G-buffer
+        auto geometryPass = deferredRenderer->geometryPass(RenderPass::create()
+                .withCamera(camera));
+        geometryPass.draw(mesh, glm::mat4(1),materials);
+        geometryPass.finish();
+
+        // light pass - shade the G-buffer using all lights
+        auto lightPass = deferredRenderer->lightPass(RenderPass::create()
                 .withCamera(camera)
                 .withClearColor(true,{0,0,0,1})
-                .withWorldLights(&worldLights)
-                .build();
-
-        rp.draw(mesh, glm::mat4(1),materials);
-
+                .withWorldLights(&worldLights));
 
         static Inspector inspector;
         inspector.update();
@@ -66,33 +86,15 @@ public:
         }
     }
 private:
-    void initFramebufferObject(int width, int height){
-        positionTexture = Texture::create().withRGBData(nullptr, width, height).withName("position").build();
-        depthTexture = Texture::create().withDepth(width, height).withName("depth").build();
-        normalTexture = Texture::create().withRGBData(nullptr, width, height).withName("normal").build();
-        colorTexture = Texture::create().withRGBAData(nullptr, width, height).withName("color").build();
-        framebuffer = Framebuffer::create()
-                .withColorTexture(positionTexture)
-                .withDepthTexture(depthTexture)
-                .withColorTexture(normalTexture)
-                .withColorTexture(colorTexture)
-                .build();
-    }
-    std::shared_ptr<Framebuffer> framebuffer;
-    std::shared_ptr<Texture> positionTexture;
-    std::shared_ptr<Texture> depthTexture;
-    std::shared_ptr<Texture> normalTexture;
-    std::shared_ptr<Texture> colorTexture;
     float fieldOfViewY = 45;
     float near = 0.1;
     float far = 100;
-    unsigned int shadowMapSize = 1024;
     glm::vec3 eye = {0,1.8,0};
     glm::vec3 at = {0,1.8,1};
     glm::vec3 lightDirection;
     SDLRenderer r;
-    Camera shadowmapCamera;
     Camera camera;
+    std::shared_ptr<DeferredRenderer> deferredRenderer;
     std::vector<std::shared_ptr<Material>> materials;
     std::shared_ptr<Mesh> mesh;
     float rotateX = 0;
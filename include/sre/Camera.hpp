@@ -118,6 +118,7 @@ namespace sre {
 
         friend class RenderPass;
         friend class Inspector;
+        friend class ShadowMap;
 
     };
 
@@ -0,0 +1,93 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include "glm/glm.hpp"
+#include "sre/RenderPass.hpp"
+#include "sre/impl/Export.hpp"
+
+namespace sre {
+    class Framebuffer;
+    class Texture;
+    class Material;
+    class Mesh;
+
+    /**
+     * Deferred shading on top of Framebuffer and RenderPass.
+     *
+     * Opaque objects are rendered into a G-buffer in the geometry pass using materials created from
+     * Shader::getStandardPBR() with the S_GBUFFER specialization. The G-buffer contains base color and occlusion,
+     * packed normal and metallic, emissive and roughness (see gbuffer_incl.glsl) and depth (the world space
+     * position is reconstructed from depth).
+     *
+     * The light pass shades the G-buffer with a single full viewport draw, where the lights are culled per view frustum
+     * cluster (see S_CLUSTERED_LIGHTS), so all lights in WorldLights are used. The light pass also writes the G-buffer depth,
+     * so other objects (such as transparent objects) can be rendered forward on top afterwards.
+     * The light pass must use the same camera as the geometry pass and a target with the size of the G-buffer.
+     *
+     * Example:
+     *   auto geometryPass = deferredRenderer->geometryPass(RenderPass::create().withCamera(camera));
+     *   geometryPass.draw(mesh, transform, gbufferMaterial);
+     *   geometryPass.finish();
+     *   auto lightPass = deferredRenderer->lightPass(RenderPass::create().withCamera(camera).withWorldLights(&worldLights));
+     *   lightPass.draw(transparentMesh, transform, transparentMaterial);
+     *
+     * Requires OpenGL 3.3 / OpenGL ES 3.0 (see isSupported()).
+     */
+    class DllExport DeferredRenderer {
+    public:
+        class DllExport DeferredRendererBuilder {
+        public:
+            DeferredRendererBuilder& withSize(glm::ivec2 size);     // Size of the G-buffer. Default: the drawable size (resized when the drawable size changes)
+            DeferredRendererBuilder& withName(const std::string& name);
+            std::shared_ptr<DeferredRenderer> build();              // Returns nullptr if deferred shading is not supported
+        private:
+            DeferredRendererBuilder() = default;
+            DeferredRendererBuilder(const DeferredRendererBuilder&) = default;
+            glm::ivec2 size = {0,0};
+            std::string name;
+            friend class DeferredRenderer;
+        };
+
+        static DeferredRendererBuilder create();
+
+        static bool isSupported();                                  // G-buffer requires three color attachments and depth textures
+
+        RenderPass geometryPass(RenderPass::RenderPassBuilder& builder);    // Build a renderpass rendering into the G-buffer (clears the G-buffer).
+                                                                            // Only opaque objects using S_GBUFFER materials should be drawn.
+
+        RenderPass lightPass(RenderPass::RenderPassBuilder& builder);        // Build a renderpass shading the G-buffer using the camera and world lights
+                                                                            // of the builder. Objects drawn in the renderpass are rendered forward after
+                                                                            // the G-buffer has been shaded.
+
+        glm::ivec2 getSize();
+
+        std::shared_ptr<Texture> getColorOcclusionTexture();
+        std::shared_ptr<Texture> getNormalMetallicTexture();
+        std::shared_ptr<Texture> getEmissiveRoughnessTexture();
+        std::shared_ptr<Texture> getDepthTexture();
+
+        const std::string& getName();
+    private:
+        DeferredRenderer(const std::string& name, glm::ivec2 size);
+        void resize(glm::ivec2 size);
+
+        std::string name;
+        glm::ivec2 size = {0,0};
+        bool autoSize;
+        std::shared_ptr<Texture> colorOcclusion;
+        std::shared_ptr<Texture> normalMetallic;
+        std::shared_ptr<Texture> emissiveRoughness;
+        std::shared_ptr<Texture> depth;
+        std::shared_ptr<Framebuffer> framebuffer;
+        std::shared_ptr<Material> lightMaterial;
+        std::shared_ptr<Mesh> quad;
+    };
+}
@@ -146,6 +146,15 @@ namespace sre {
         void updateIndexBuffers();
         std::vector<float> getInterleavedData();
 
+        // replace the GPU data without changing the vertex layout (the vertex attributes kept on the CPU are not updated).
+        // Dynamic data orphans the buffer storage and grows it geometrically, so the buffers can be rewritten every frame.
+        void setVertexData(const void* interleavedData, int vertexCount, bool dynamic);    // data must use the interleaved layout of the mesh
+        void setIndexData(const void* indices, int indexCount, bool indices32Bit, bool dynamic); // replace index sets with a single index set
+        void setIndexRanges(const std::vector<glm::ivec2>& ranges);                         // index sets rendered as (first index, index count) of the index data
+        int vertexBufferCapacity = 0;
+        int elementBufferCapacity = 0;
+        bool instanced = false;                                                             // each vertex is an instance of a quad drawn as a triangle strip (requires OpenGL 3.3 / ES 3.0)
+
         int totalBytesPerVertex = 0;
         static uint16_t meshIdCount;
         uint16_t meshId;
@@ -179,6 +188,9 @@ namespace sre {
 
         friend class RenderPass;
         friend class Inspector;
+        friend class SpriteBatch;
+        friend class ParticleSystem;
+        friend class GPUParticles;
 
         bool hasAttribute(std::string name);
     };
@@ -0,0 +1,159 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+#include "sre/impl/Export.hpp"
+
+namespace sre {
+    class Mesh;
+    class GPUParticles;
+
+    /**
+     * Particle system simulated on the CPU and rendered as points using Shader::getStandardParticles().
+     *
+     * The particles are stored as a structure of arrays and simulated four at a time using SSE (when available). Each
+     * update() integrates the live particles (gravity, drag, velocity and rotation), removes particles which have
+     * exceeded their lifetime, emits new particles and interpolates color and size over the lifetime of each particle.
+     * Large systems are simulated and emitted across multiple threads.
+     *
+     * The vertices are written to a dynamic vertex buffer of a single mesh, which is reused every frame:
+     *    particleSystem->update(deltaTime);
+     *    renderPass.draw(particleSystem->getMesh(), glm::mat4(1), particleMaterial);
+     *
+     * When built withGPUSimulation() (and compute shaders are supported) the particles are instead emitted, simulated
+     * and optionally depth sorted by compute shaders, which write the vertices and indices of the mesh directly. The
+     * mesh is rendered in the same way, but update() must be called outside a RenderPass.
+     */
+    class DllExport ParticleSystem {
+    public:
+        struct Emitter {
+            glm::vec3 position = {0,0,0};
+            glm::vec3 positionSpread = {0,0,0};             // particles are emitted uniformly in position +/- positionSpread
+            glm::vec3 velocity = {0,1,0};
+            glm::vec3 velocitySpread = {0,0,0};             // initial velocity is uniformly in velocity +/- velocitySpread
+            glm::vec2 lifetime = {1,1};                     // min and max lifetime in seconds
+            glm::vec2 rotation = {0,0};                     // min and max initial rotation in radians
+            glm::vec2 angularVelocity = {0,0};              // min and max angular velocity in radians per second
+            float rate = 100;                               // particles emitted per second
+            bool enabled = true;
+        };
+
+        class DllExport ParticleSystemBuilder {
+        public:
+            ParticleSystemBuilder& withMaxParticles(int maxParticles);           // Max number of live particles (default 10000)
+            ParticleSystemBuilder& withGravity(glm::vec3 gravity);              // Acceleration of particles (default (0,-9.8,0))
+            ParticleSystemBuilder& withDrag(float drag);                        // Fraction of velocity lost per second (default 0)
+            ParticleSystemBuilder& withColor(glm::vec4 start, glm::vec4 end);   // Linear color at birth and at end of lifetime
+                                                                                // (default (1,1,1,1) and (1,1,1,0))
+            ParticleSystemBuilder& withSize(float start, float end);            // Particle size at birth and at end of lifetime (default 10)
+            ParticleSystemBuilder& withUV(glm::vec4 uv);                        // Texture rect (xy is lower left corner, z is size) (default (0,0,1))
+            ParticleSystemBuilder& withGPUSimulation(bool enabled = true);      // Simulate using compute shaders (requires OpenGL 4.3).
+                                                                                // Falls back to the CPU when unsupported (default false)
+            ParticleSystemBuilder& withDepthSort(bool enabled = true);          // Render back to front (GPU simulation only) (default false)
+            ParticleSystemBuilder& withName(const std::string& name);
+            std::shared_ptr<ParticleSystem> build();
+        private:
+            ParticleSystemBuilder() = default;
+            ParticleSystemBuilder(const ParticleSystemBuilder&) = default;
+            int maxParticles = 10000;
+            glm::vec3 gravity = {0,-9.8f,0};
+            float drag = 0;
+            glm::vec4 colorStart = {1,1,1,1};
+            glm::vec4 colorEnd = {1,1,1,0};
+            float sizeStart = 10;
+            float sizeEnd = 10;
+            glm::vec4 uv = {0,0,1,0};
+            bool gpuSimulation = false;
+            bool depthSort = false;
+            std::string name;
+            friend class ParticleSystem;
+        };
+
+        static ParticleSystemBuilder create();
+        ~ParticleSystem();
+
+        int addEmitter(const Emitter& emitter);                 // Returns id of the emitter
+        Emitter& getEmitter(int id);                            // Emitters are changed using the reference (or disabled)
+        int getEmitterCount();
+
+        void emit(const Emitter& emitter, int count);           // Emits count particles in the next update() (ignores rate)
+
+        void update(float deltaTime, const glm::mat4& modelView = glm::mat4(1));
+                                                                // Simulate, emit and write vertices. modelView (view * model
+                                                                // transform) is only used for the depth sort
+        void clear();                                           // Remove all particles
+
+        std::shared_ptr<Mesh> getMesh();                        // Points with the live particles of the last update()
+        int getParticleCount();                                 // Upper bound when simulated on the GPU
+        int getMaxParticles();
+        float getUpdateTime();                                  // CPU time in milliseconds used by the last update()
+        bool isGPUSimulated();
+        const std::string& getName();
+    private:
+        enum Attribute {
+            PositionX, PositionY, PositionZ,
+            VelocityX, VelocityY, VelocityZ,
+            Age, InvLifetime,
+            Rotation, AngularVelocity,
+            AttributeCount
+        };
+        struct EmitterState {
+            Emitter emitter;
+            float accumulated = 0;                              // fraction of particle not yet emitted
+        };
+        struct Emission {
+            const Emitter* emitter;
+            int first;
+            int count;
+            uint32_t seed;
+        };
+
+        explicit ParticleSystem(const ParticleSystemBuilder& builder);
+        void moveParticles(int from, int to, int count);
+        int simulate(int first, int count, float deltaTime);   // returns the number of live particles moved to first
+        void emitRange(const Emission& emission);
+        void writeVertices(int first, int count, glm::vec4* dst, glm::vec3& boundsMin, glm::vec3& boundsMax);
+        void countEmissions(float deltaTime);                  // particles to emit per emitter (including bursts)
+        void updateGPU(float deltaTime, const glm::mat4& modelView);
+
+        std::string name;
+        int maxParticles;
+        glm::vec3 gravity;
+        float drag;
+        glm::vec4 colorStart;
+        glm::vec4 colorEnd;
+        float sizeStart;
+        float sizeEnd;
+        glm::vec4 uv;
+        bool depthSort;
+
+        std::array<std::vector<float>, AttributeCount> particles;
+        int particleCount = 0;
+        std::vector<EmitterState> emitters;
+        std::vector<std::pair<Emitter, int>> bursts;
+        std::vector<std::pair<const Emitter*, int>> emissionCounts;
+        uint32_t frame = 0;
+        float updateTime = 0;
+
+        std::shared_ptr<Mesh> mesh;
+        std::vector<glm::vec4> vertexScratch;
+
+        std::unique_ptr<GPUParticles> gpu;
+        std::vector<std::pair<float, int>> gpuEmissions;     // expire time and count of the particles emitted on the GPU
+        float gpuTime = 0;
+        int gpuSlotsUsed = 0;
+
+        friend class GPUParticles;
+    };
+}
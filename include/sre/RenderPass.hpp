@@ -14,6 +14,10 @@
 #include "sre/WorldLights.hpp"
 #include <string>
 #include <functional>
+#include <map>
+#include <vector>
+#include <future>
+#include <glm/gtc/type_precision.hpp>
 
 #include "sre/impl/Export.hpp"
 #include "SpriteBatch.hpp"
@@ -26,6 +30,8 @@ namespace sre {
     class Material;
     class RenderStats;
     class Framebuffer;
+    class TextureStreamer;
+    class LightClusters;
 
     // A render pass encapsulates some render states and allows adding draw-calls.
     // Materials and shaders are assumed not to be modified during a renderpass.
@@ -53,6 +59,11 @@ namespace sre {
                                                                                                    // calls ImGui::Render() in the end of the renderpass
 
             RenderPassBuilder& withFramebuffer(std::shared_ptr<Framebuffer> framebuffer);
+
+            RenderPassBuilder& withLightSelection(bool enabled = true);                            // When the world lights exceed Renderer::getMaxSceneLights()
+                                                                                                   // select the most influential lights for each draw (based on
+                                                                                                   // light range and the world bounds of the mesh).
+                                                                                                   // Default: enabled. If disabled the first lights are used.
             RenderPass build();
         private:
             RenderPassBuilder() = default;
@@ -74,6 +85,7 @@ namespace sre {
             std::shared_ptr<Skybox> skybox;
 
             bool gui = true;
+            bool lightSelection = true;
 
             explicit RenderPassBuilder(RenderStats* renderStats);
             friend class RenderPass;
@@ -116,6 +128,22 @@ namespace sre {
                                           unsigned int width = 1,       // This function must be called after finish has been explicit called on the renderPass
                                           unsigned int height = 1);
 
+        std::future<std::vector<glm::u8vec4>> readPixelsAsync(unsigned int x,  // Reads RGBA8 pixel(s) without stalling the GPU.
+                                          unsigned int y,               // The future is resolved when the GPU has finished the read,
+                                          unsigned int width = 1,       // (at the latest in a following Renderer::swapWindow()).
+                                          unsigned int height = 1);     // Do not block on the future on the render thread before swapWindow() is called.
+                                                                        // Must be called after finish.
+
+        std::future<std::vector<glm::vec4>> readPixelsFloatAsync(unsigned int x,// Reads pixel(s) as float RGBA (such as from float framebuffers).
+                                          unsigned int y,               // See readPixelsAsync()
+                                          unsigned int width = 1,
+                                          unsigned int height = 1);
+
+        std::future<std::vector<float>> readDepthAsync(unsigned int x,  // Reads depth value(s) in the range [0.0;1.0]. Not supported on OpenGL ES.
+                                          unsigned int y,               // See readPixelsAsync()
+                                          unsigned int width = 1,
+                                          unsigned int height = 1);
+
         void finishGPUCommandBuffer();                                  // GPU command buffer (must be called when
                                                                         // profiling GPU time - should not be called
                                                                         // when not profiling)
@@ -137,6 +165,7 @@ namespace sre {
             glm::mat4 modelTransform;
             std::shared_ptr<Material> material;
             int subMesh = 0;
+            int lightSet = -1;                                          // index in lightSets (-1 uses the first lights)
         };
         struct GlobalUniforms{
             glm::mat4* g_view;
@@ -150,6 +179,13 @@ namespace sre {
         std::vector<RenderQueueObj> renderQueue;
 
         void drawInstance(RenderQueueObj& rqObj);                       // perform the actual rendering
+        void selectLights();                                            // assign lightSets to the render queue objects
+        void setupLights(const GlobalUniforms& globalUniforms, const std::vector<int>* lightIndices);
+        void bindLightSet(Shader* shader, int lightSet);
+        void recordTextureUsage(TextureStreamer* textureStreamer);       // estimate on screen size of streaming textures
+        glm::vec2 getTargetSize();                                      // size of the framebuffer (or drawable) rendered to
+        template<typename T>
+        std::future<std::vector<T>> readAsync(unsigned int x, unsigned int y, unsigned int width, unsigned int height, uint32_t format, uint32_t type);
 
         RenderPass::RenderPassBuilder builder;
         explicit RenderPass(RenderPass::RenderPassBuilder& builder);
@@ -162,6 +198,11 @@ namespace sre {
         Shader* lastBoundShader = nullptr;
         Material* lastBoundMaterial = nullptr;
         int64_t lastBoundMeshId = -1;
+        LightClusters* lightClusters = nullptr;                         // set if any shader uses S_CLUSTERED_LIGHTS
+        std::vector<std::vector<int>> lightSets;                        // unique per-draw light selections
+        int lightSetStride = 0;                                         // offset between light sets in the global uniform buffer
+        int lastBoundLightSet = -1;
+        std::map<Shader*, int> shaderLightSet;                          // light set uploaded to each shader (without uniform buffer)
 
         glm::mat4 projection;
         glm::uvec2 viewportOffset;
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include "sre/impl/Export.hpp"
 
 namespace sre {
@@ -18,13 +19,21 @@ namespace sre {
         int meshBytesAllocated=0;                             // Size of allocated meshes in bytes this frame
         int meshBytesDeallocated=0;                           // Size of deallocated meshes in bytes this frame
         int textureCount=0;                                   // Number of allocated textures
-        int textureBytes=0;                                   // Size of allocated textures in bytes
-        int textureBytesAllocated=0;                          // Size of allocated textures in bytes this frame
-        int textureBytesDeallocated=0;                        // Size of deallocated textures in bytes this frame
+        int64_t textureBytes=0;                               // Size of allocated textures in bytes
+        int64_t textureBytesAllocated=0;                      // Size of allocated textures in bytes this frame
+        int64_t textureBytesDeallocated=0;                    // Size of deallocated textures in bytes this frame
         int shaderCount=0;                                    // Number of allocated shaders
+        int shaderCacheHits=0;                                // Number of shaders loaded from program binary cache
+        int shaderCacheMisses=0;                              // Number of shaders compiled while program binary cache was enabled
+        float shaderBuildTime=0;                              // CPU time in milliseconds used to build shaders
         int drawCalls=0;                                      // Number of drawCalls per frame
         int stateChangesShader=0;                             // Number of state changes for shaders
         int stateChangesMaterial=0;                           // Number of state changes for materials
         int stateChangesMesh=0;                               // Number of state changes for meshes
+        int textureCacheHits=0;                               // Number of texture loads served by TextureCache
+        int textureCacheMisses=0;                             // Number of texture loads not found in TextureCache
+        int64_t textureCacheBytesSaved=0;                     // Size of textures in bytes not loaded again due to TextureCache
+        int textureMipLoads=0;                                // Number of streaming textures loading mip levels this frame
+        int textureMipEvictions=0;                            // Number of streaming textures evicting mip levels this frame
     };
 }
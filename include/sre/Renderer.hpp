@@ -27,11 +27,24 @@ namespace sre {
     class Shader;
     class Shader;
 	class VR;
+    class TextureLoader;
+    class TextureStreamer;
+    class PixelReadback;
+    class ProgramBinaryCache;
+    class ShaderCompiler;
+    class ShaderPreprocessor;
+    class LightClusters;
+    class LightSelection;
 
     struct RenderInfo{
         bool useFramebufferSRGB = false;
         bool supportTextureSamplerSRGB = false;
         bool supportFBODepthAttachment = false;
+        bool supportTextureCompressionS3TC = false;    // BC1-BC3 (DXT1-DXT5)
+        bool supportTextureCompressionBPTC = false;    // BC7
+        bool supportTextureCompressionETC2 = false;    // ETC1/ETC2/EAC
+        bool supportParallelShaderCompile = false;     // shader compile status can be polled without blocking
+        bool supportComputeShader = false;             // compute shaders and shader storage buffers (OpenGL 4.3)
         int graphicsAPIVersionMajor;            // For WebGL uses OpenGL ES api version (WebGL 1.0 = OpenGL ES 2.0)
         int graphicsAPIVersionMinor;
         bool graphicsAPIVersionES;
@@ -88,7 +101,36 @@ namespace sre {
         static Renderer* instance;                          // Singleton reference to the engine after initialization.
 
         int getMaxSceneLights();                            // Get maximum amout of scenelights per object
+
+        void setTextureUploadBudget(int bytesPerFrame);     // Maximum bytes uploaded each frame by asynchronously loaded textures (default 4 MB)
+        int getTextureUploadBudget();
+
+        void setTextureMemoryBudget(int64_t bytes);         // GPU memory budget for streaming textures (see TextureBuilder::withStreaming()).
+        int64_t getTextureMemoryBudget();                   // When exceeded mip levels of least recently used textures are evicted. 0 = unlimited (default)
+
+        void setShaderCacheDirectory(const std::string& directory); // Store linked shader programs as program binaries in an existing directory.
+        const std::string& getShaderCacheDirectory();       // Shaders are loaded from the cache instead of compiled on the next start. Empty = disabled (default)
     private:
+        TextureLoader* getTextureLoader();                  // created on first use
+        std::unique_ptr<TextureLoader> textureLoader;
+        int textureUploadBudget = 4*1024*1024;
+        TextureStreamer* getTextureStreamer();              // created on first use
+        std::unique_ptr<TextureStreamer> textureStreamer;
+        int64_t textureMemoryBudget = 0;
+        PixelReadback* getPixelReadback();                  // created on first use
+        std::unique_ptr<PixelReadback> pixelReadback;
+        ProgramBinaryCache* getProgramBinaryCache();        // null if no cache directory is set
+        std::unique_ptr<ProgramBinaryCache> programBinaryCache;
+        ShaderCompiler* getShaderCompiler();                // created on first use
+        std::unique_ptr<ShaderCompiler> shaderCompiler;
+        ShaderPreprocessor* getShaderPreprocessor();        // created on first use
+        std::unique_ptr<ShaderPreprocessor> shaderPreprocessor;
+        LightClusters* getLightClusters();                  // created on first use
+        std::unique_ptr<LightClusters> lightClusters;
+        LightSelection* getLightSelection();                // created on first use
+        std::unique_ptr<LightSelection> lightSelection;
+        std::string shaderCacheDirectory;
+
         int maxSceneLights = 4;                             // Maximum of scene lights
         SDL_Window *window;
         SDL_GLContext glcontext;
@@ -116,6 +158,8 @@ namespace sre {
         friend class Shader;
         friend class Material;
         friend class Texture;
+        friend class TextureCache;
+        friend class TextureStreamer;
         friend class Framebuffer;
         friend class RenderPass;
         friend class Inspector;
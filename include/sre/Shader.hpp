@@ -20,6 +20,7 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <unordered_map>
 
 
 namespace sre {
@@ -130,6 +131,9 @@ namespace sre {
      *    - color (vec4) (vertex attribute)
      *    - Parameters:
      *      - tex (shared_ptr<Texture>) (default white texture)
+     * - Shader::getUnlitSpriteInstanced()
+     *    - Similar to getUnlitSprite() but each sprite is an instance expanded to a quad in the vertex shader
+     *    - Requires OpenGL 3.3 / OpenGL ES 3.0 (used by SpriteBatch::SpriteBatchBuilder::withInstancing())
      * - Shader::getStandardParticles()
      *    - Similar to getUnlitSprite() but with no depth write
      *    - Parameters:
@@ -181,6 +185,21 @@ namespace sre {
             Shader *updateShader = nullptr;
             BlendType blend = BlendType::Disabled;
             Stencil stencil = {};
+            bool async = false;
+            friend class Shader;
+        };
+
+        class DllExport SpecializationKey {                    // Canonical (length prefixed) key of specialization constants, hashed once.
+        public:                                                // Keep it to avoid rebuilding the key when creating materials repeatedly.
+            const std::map<std::string,std::string>& getSpecializationConstants() const;
+            const std::string& getKey() const;
+            bool operator==(const SpecializationKey& other) const;
+            size_t getHash() const;
+        private:
+            SpecializationKey(std::map<std::string,std::string> specializationConstants, std::string key, size_t hash);
+            std::map<std::string,std::string> specializationConstants;
+            std::string key;
+            size_t hash;
             friend class Shader;
         };
 
@@ -208,6 +227,18 @@ namespace sre {
                                                                //   Adds VertexAttribute "color" vec4 defined in linear space.
                                                                // S_TWO_SIDED
                                                                //   Disables face culling and flips normal on backface
+                                                               // S_CLUSTERED_LIGHTS
+                                                               //   Uses all lights in WorldLights (not limited by maxSceneLights). Point lights
+                                                               //   with range are culled per view frustum cluster. Requires OpenGL 3.3 / ES 3.0
+                                                               // S_GBUFFER
+                                                               //   Writes the surface properties to a G-buffer instead of shading (see DeferredRenderer).
+                                                               //   Requires OpenGL 3.3 / ES 3.0
+                                                               // S_SHADOW
+                                                               //   Adds Uniforms "shadowMap" (Texture) and "shadowViewProjOffset" (mat4). Shadow of the
+                                                               //   first light (directional)
+                                                               // S_SHADOW_CASCADES
+                                                               //   Used with S_SHADOW. Number of shadow cascades. Replaces "shadowViewProjOffset" with
+                                                               //   "shadowViewProjOffsets" (mat4 array) and "shadowCascadeSplits" (vec4) (see ShadowMap)
 
 
         static std::shared_ptr<Shader> getStandardBlinnPhong(); // Blinn-Phong Light Model. Uses light objects and ambient light set in Renderer.
@@ -228,6 +259,8 @@ namespace sre {
                                                                 //   Adds VertexAttribute "tangent" vec4. Used for normal maps. Otherwise compute using
                                                                 // S_NORMALMAP
                                                                 //   Adds Uniforms "normalTex" (Texture) and "normalScale" (float)
+                                                                // S_CLUSTERED_LIGHTS
+                                                                //   Uses all lights in WorldLights (see getStandardPBR())
 
 
         static std::shared_ptr<Shader> getStandardPhong();      // Similar to Blinn-Phong, but with more accurate specular highlights
@@ -260,6 +293,14 @@ namespace sre {
                                                                //   "color" vec4 (default (1,1,1,1))
                                                                //   "tex" shared_ptr<Texture> (default white texture)
 
+        static std::shared_ptr<Shader> getUnlitSpriteInstanced(); // UnlitSpriteInstanced = UnlitSprite rendered as one instance per sprite
+                                                               // Uniforms
+                                                               //   "tex" shared_ptr<Texture> (default white texture)
+                                                               // VertexAttributes (per instance)
+                                                               //   "instance_axes" vec4 (xy is sprite x edge, zw is sprite y edge)
+                                                               //   "instance_uv" vec4 (xy is uv of first corner, zw is uv of opposite corner)
+                                                               //   "instance_data" ivec4 (xy is float bits of first corner, z is RGBA8 color, w is texture array layer)
+
         static std::shared_ptr<Shader> getStandardParticles(); // StandardParticles
                                                                // Uniforms
                                                                //   "tex" shared_ptr<Texture> (default alpha sphere texture)
@@ -284,7 +325,22 @@ namespace sre {
 
         ~Shader();
 
+        static SpecializationKey getSpecializationKey(std::map<std::string,std::string> specializationConstants); // Key for createMaterial (reuse for repeated lookups)
+
         std::shared_ptr<Material> createMaterial(std::map<std::string,std::string> specializationConstants = {});
+        std::shared_ptr<Material> createMaterial(const SpecializationKey& specializationKey);
+        std::shared_ptr<Material> createMaterialAsync(std::map<std::string,std::string> specializationConstants = {}); // Like createMaterial, but a missing specialization is compiled
+                                                               // in the background. Until it is ready the material renders using the
+                                                               // unspecialized shader (and is updated once compiled).
+        std::shared_ptr<Material> createMaterialAsync(const SpecializationKey& specializationKey);
+        void warmup(const std::vector<std::map<std::string,std::string>>& specializations); // Start compiling the specializations in the background
+                                                               // (e.g. during loading). The shader keeps the specializations until releaseWarmup().
+        void releaseWarmup();                                  // Release the specializations kept by warmup() (those used by materials stay alive).
+                                                               // Must be called before releasing a shader that has been warmed up.
+
+        bool isCompiling();                                    // True while the shader is compiled in the background
+        static int getCompilingCount();                        // Number of shaders compiled in the background
+        float getBuildTime();                                  // CPU time in milliseconds used by the last build of the shader
 
         Uniform getUniform(const std::string &name);
 
@@ -316,23 +372,37 @@ namespace sre {
         std::map<std::string,std::string> getCurrentSpecializationConstants();
 
         std::set<std::string> getAllSpecializationConstants();
+
+        int getSpecializationCount();                          // Number of live specializations of the (unspecialized) shader
     private:
-        std::string precompile(std::string source, std::vector<std::string>& errors, uint32_t shaderType);
+        std::string precompile(const std::string& resource, std::vector<std::string>& errors, uint32_t shaderType);
         std::string insertPreprocessorDefines(std::string source,
                                               std::map<std::string, std::string> &specializationConstants,
                                               uint32_t shaderType);
 
-        bool setLights(WorldLights* worldLights);
+        bool setLights(WorldLights* worldLights, const std::vector<int>* lightIndices = nullptr);   // lightIndices selects the lights used (default the first lights)
 
         Shader();
 
         std::map<std::string,std::string> specializationConstants = {};
 
         std::shared_ptr<Shader> parent = nullptr;
-        std::vector<std::weak_ptr<Shader>> specializations;
+        struct SpecializationKeyHash {
+            size_t operator()(const SpecializationKey& key) const { return key.getHash(); }
+        };
+        std::unique_ptr<SpecializationKey> specializationKey;  // key in the specializations of the parent
+        std::unordered_map<SpecializationKey, std::weak_ptr<Shader>, SpecializationKeyHash> specializations;
+        std::vector<std::shared_ptr<Shader>> warmedUp;        // specializations kept alive by warmup()
+
+        std::shared_ptr<Shader> findSpecialization(const SpecializationKey& specializationKey);
+        void removeSpecialization(Shader* shader);
+        void pruneSpecializations();                           // remove expired specializations
+        std::shared_ptr<Shader> createSpecialization(const SpecializationKey& specializationKey, bool async);
 
         bool build(std::map<ShaderType,std::string> shaderSources, std::vector<std::string>& errors);
-        bool compileShader(std::string& resource, GLenum type, GLuint& shader, std::vector<std::string>& errors);
+        void beginBuild(std::map<ShaderType,std::string> shaderSources, std::vector<std::string>& errors);  // issue compile and link
+        bool isBuildComplete();                                // false while the driver compiles in parallel (GL_KHR_parallel_shader_compile)
+        bool endBuild(std::vector<std::string>& errors);       // check status and swap in the new program
         void bind();
 
         unsigned int shaderProgramId = 0;
@@ -348,6 +418,18 @@ namespace sre {
 
         std::map<ShaderType, std::string> shaderSources;
 
+        struct PendingStage {
+            unsigned int shader;
+            uint32_t type;
+            std::string resource;
+            std::string source;
+        };
+        std::vector<PendingStage> pendingStages;
+        unsigned int pendingProgramId = 0;
+        uint64_t pendingCacheKey = 0;
+        bool compiling = false;
+        float buildTime = 0;                                   // CPU time of last build in milliseconds
+
         std::shared_ptr<std::vector<Uniform>> uniforms;
 
         struct ShaderAttribute {
@@ -363,6 +445,8 @@ namespace sre {
         friend class Material;
         friend class RenderPass;
         friend class Inspector;
+        friend class ShaderCompiler;
+        friend class LightClusters;
 
         int uniformLocationModel;
         int uniformLocationView;
@@ -374,6 +458,11 @@ namespace sre {
         int uniformLocationLightPosType;
         int uniformLocationLightColorRange;
         int uniformLocationCameraPosition;
+        int uniformLocationClusterLights;
+        int uniformLocationClusterGrid;
+        int uniformLocationClusterLightIndices;
+        int uniformLocationClusterSize;
+        int uniformLocationClusterDepth;
 
     public:
         static std::string translateToGLSLES(std::string source, bool vertexShader, int version = 100);
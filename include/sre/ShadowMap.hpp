@@ -0,0 +1,127 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+#include "sre/impl/Export.hpp"
+
+namespace sre {
+    class Camera;
+    class Framebuffer;
+    class Material;
+    class Mesh;
+    class Texture;
+
+    /**
+     * Cascaded shadow map for a directional light.
+     *
+     * The view frustum of the camera is split into 2-4 cascades, each rendered into its own region of the shadow map
+     * texture. Each cascade is fitted to the bounding sphere of its frustum slice and snapped to a grid in light space,
+     * which keeps the shadow edges stable when the camera moves and allows the cascade to be cached.
+     *
+     * Static shadow casters are registered once and rendered into a cache, which is only re-rendered for a cascade when
+     * the cascade moves, the light direction changes or a static caster overlapping the cascade is added, moved or removed.
+     * Dynamic shadow casters are drawn each frame and rendered on top of a copy of the cache.
+     *
+     * The shadow map is used by materials created with getSpecializationConstants() (such as
+     * Shader::getStandardPBR()->createMaterial(shadowMap->getSpecializationConstants())) after calling setUniforms().
+     * The shadow is applied to the first light in WorldLights, which must be the directional light.
+     *
+     * Requires OpenGL 3.3 / OpenGL ES 3.0.
+     */
+    class DllExport ShadowMap {
+    public:
+        class DllExport ShadowMapBuilder {
+        public:
+            ShadowMapBuilder& withSize(int size);                   // Resolution of each cascade (default 1024)
+            ShadowMapBuilder& withCascades(int cascades);           // Number of cascades between 2 and 4 (default 3)
+            ShadowMapBuilder& withSplitLambda(float lambda);        // Blend between uniform (0.0) and logarithmic (1.0) cascade splits (default 0.8)
+            ShadowMapBuilder& withShadowDistance(float distance);   // Max distance from the camera which receives shadows (default: far plane)
+            ShadowMapBuilder& withCasterDistance(float distance);   // Distance towards the light in front of a cascade where casters are
+                                                                    // included (default 50)
+            ShadowMapBuilder& withName(const std::string& name);
+            std::shared_ptr<ShadowMap> build();                     // Returns nullptr if not supported
+        private:
+            ShadowMapBuilder() = default;
+            ShadowMapBuilder(const ShadowMapBuilder&) = default;
+            int size = 1024;
+            int cascades = 3;
+            float splitLambda = 0.8f;
+            float shadowDistance = 0;
+            float casterDistance = 50;
+            std::string name;
+            friend class ShadowMap;
+        };
+
+        ~ShadowMap();
+
+        static ShadowMapBuilder create();
+
+        int addStaticCaster(std::shared_ptr<Mesh> mesh, glm::mat4 modelTransform);     // Returns id of the static caster
+        void setStaticCasterTransform(int id, glm::mat4 modelTransform);
+        void removeStaticCaster(int id);
+
+        void drawDynamic(std::shared_ptr<Mesh> mesh, glm::mat4 modelTransform);         // Caster rendered in the next update() only
+
+        void update(Camera& camera,                             // Fit the cascades to the camera and render the invalid cascades.
+                    glm::vec3 lightDirection);                  // lightDirection is the direction towards the light (as in Light).
+                                                                // The camera is assumed to render to the window.
+
+        void setUniforms(const std::shared_ptr<Material>& material);   // Set shadowMap, shadowViewProjOffsets and shadowCascadeSplits
+
+        std::map<std::string,std::string> getSpecializationConstants(); // S_SHADOW and S_SHADOW_CASCADES
+
+        std::shared_ptr<Texture> getTexture();                  // Shadow map used in the last update (the cascades side by side)
+        int getCascadeCount();
+        float getCascadeSplit(int cascade);                     // View space far distance of cascade
+        int getCascadesRendered();                              // Number of static cascades rendered in the last update (not found in cache)
+        const std::string& getName();
+    private:
+        struct Caster {
+            std::shared_ptr<Mesh> mesh;
+            glm::mat4 modelTransform;
+            glm::vec3 boundsMin;                                // world space bounds
+            glm::vec3 boundsMax;
+        };
+        struct Cascade {
+            glm::mat4 view;
+            glm::mat4 projection;
+            float split = 0;
+            bool valid = false;                                 // static casters in cache are up to date
+        };
+
+        explicit ShadowMap(const ShadowMapBuilder& builder);
+        Caster createCaster(std::shared_ptr<Mesh> mesh, glm::mat4 modelTransform);
+        void invalidate(const Caster& caster);
+        bool overlaps(const Cascade& cascade, const Caster& caster);
+        void render(int cascade, std::vector<Caster*>& casters, std::shared_ptr<Framebuffer>& framebuffer, bool clear);
+
+        std::string name;
+        int size;
+        float splitLambda;
+        float shadowDistance;
+        float casterDistance;
+        std::vector<Cascade> cascades;
+        std::map<int, Caster> staticCasters;
+        int nextCasterId = 0;
+        std::vector<Caster> dynamicCasters;
+        int cascadesRendered = 0;
+
+        std::shared_ptr<Texture> staticTexture;
+        std::shared_ptr<Framebuffer> staticFramebuffer;
+        std::shared_ptr<Texture> dynamicTexture;
+        std::shared_ptr<Framebuffer> dynamicFramebuffer;
+        std::shared_ptr<Texture> texture;                       // texture used in the last update
+        std::shared_ptr<Material> casterMaterial;
+        std::shared_ptr<std::vector<glm::mat4>> viewProjOffsets;
+    };
+}
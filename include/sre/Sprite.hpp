@@ -46,13 +46,15 @@ public:
 
     const glm::vec2 &getSpriteAnchor() const;   // anchor (relative to spriteSize)
 
+    int getLayer() const;                       // layer in texture array (0 if texture is not a texture array)
+
     std::array<glm::vec2,4> getTrimmedCorners();       // return the position of the trimmed sprite
 
     std::array<glm::vec2,4> getUVs();
 
 private:
     Sprite(glm::ivec2 spritePos, glm::ivec2 spriteSize,glm::ivec2 spriteSourcePos,
-        glm::ivec2 spriteSourceSize, glm::vec2  spriteAnchor, Texture* texture);
+        glm::ivec2 spriteSourceSize, glm::vec2  spriteAnchor, Texture* texture, int layer = 0);
 
     float rotation    = 0;
     glm::vec2 position= {0.0f,0.0f};
@@ -61,8 +63,8 @@ private:
     union {
         uint64_t globalOrder;
 		PACK(struct {
-            uint16_t drawOrder;    // lowest priority
-            uint32_t texture;
+            uint32_t drawOrder;    // lowest priority
+            uint16_t texture;      // low bits of texture id (groups sprites by texture)
             uint16_t orderInBatch; // highest priority
         } ) details;
     }  order;
@@ -74,8 +76,10 @@ private:
     glm::ivec2 spriteSourceSize;
     glm::vec2  spriteAnchor;
     Texture* texture;
+    int layer = 0;
     friend class SpriteAtlas;
     friend class SpriteBatch;
+    friend class SpriteVertices;
     friend class Inspector;
 };
 
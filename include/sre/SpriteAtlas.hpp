@@ -10,7 +10,9 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <unordered_map>
 #include "sre/Sprite.hpp"
+#include "sre/Texture.hpp"
 
 //
 // Sprite atlases owns sprite definitions using a single texture.
@@ -45,6 +47,15 @@
 // }]
 // }
 //
+// The json file is parsed as a stream (no document tree is built). Unknown properties are ignored.
+//
+// Sprites used every frame (e.g. animations) should be looked up once using find(), which returns a handle that is
+// valid for the lifetime of the sprite atlas. get(handle) returns the sprite without any lookup.
+//
+// Alternatively sprite atlases can be packed at runtime from individual images (see createPacked()). The images are
+// packed into the layers of a texture array, which allows sprites from different images to be rendered in a single
+// draw call by SpriteBatch.
+//
 namespace sre{
 class SpriteAtlas {
 public:
@@ -63,9 +74,25 @@ public:
                                                            glm::ivec2 pos = {0,0},
                                                            glm::ivec2 size = {0,0} );
 
-    Sprite get(std::string name);                           // Return a copy of a Sprite object.
+    static std::shared_ptr<SpriteAtlas> createPacked(std::vector<std::string> imageFiles,  // Create sprite atlas by packing images into the layers of a texture array.
+                                                     std::string atlasName,                 // Sprites are named by the filename (without path). If all images
+                                                     int pageSize = 2048,                   // has the same size each image is a layer, otherwise images are
+                                                     int padding = 1);                      // packed into pages of pageSize x pageSize pixels
+
+    static std::shared_ptr<SpriteAtlas> createPacked(std::map<std::string,                 // Create sprite atlas by packing named images decoded with
+                                                              Texture::DecodedImage> images, // Texture::decodeFile() into the layers of a texture array
+                                                     std::string atlasName,
+                                                     int pageSize = 2048,
+                                                     int padding = 1);
+
+    Sprite get(const std::string& name);                    // Return a copy of a Sprite object.
+
+    int find(const std::string& name);                      // Return handle of sprite (hashed lookup) or -1 if not found.
+                                                            // Handles are stable for the lifetime of the SpriteAtlas.
+    const Sprite& get(int handle);                          // Return sprite using handle from find() (no lookup).
 
     std::vector<std::string> getNames();                    // Returns a list of sprite names in the SpriteAtlas container
+                                                            // (sorted by name - the index of a name is its handle)
 
     std::string getAtlasName();
 
@@ -73,7 +100,9 @@ public:
 private:
     SpriteAtlas(std::map<std::string, Sprite>&& sprites, std::shared_ptr<Texture> texture, std::string atlasName);
     std::string atlasName;
-    std::map<std::string, Sprite> sprites;
+    std::vector<Sprite> sprites;                            // indexed by handle
+    std::vector<std::string> names;
+    std::unordered_map<std::string, int> handles;
     std::shared_ptr<Texture> texture;
 };
 }
@@ -10,23 +10,46 @@
 #include "sre/Sprite.hpp"
 #include "Mesh.hpp"
 #include "Log.hpp"
+#include "sre/impl/SpriteVertices.hpp"
 
 /// Sprite batch batches multiple sprites into few draw calls. It is possible to reuse SpriteBatches over multiple
 /// frames when the sprites are not changed (e.g. for rendering static level or background geometry).
 ///
+/// Sprites changing every frame should be rendered by updating the same SpriteBatch using update(). The meshes, materials
+/// and scratch memory of the sprite batch are reused, and the vertex data is rewritten in place (using buffer orphaning).
+///    spriteBatch = spriteBatch->update().addSprites(sprites.begin(), sprites.end()).build();
+///
 /// Note that sprites are rendered in the following order (the sprite batch is sorted before rendering):
 ///    sprite.orderInBatch (high values will be rendered on top of sprites with lower values)
 ///    sprite.texture (textures will be batched together)
 ///    sprite.drawOrder (sprites added later will be rendered on top of other sprites with same texture and orderInBatch)
+///
+/// There is no limit on the number of sprites in a batch. Meshes with more than 65536 vertices use 32 bit indices
+/// (on OpenGL ES 2.0 the sprites are split into multiple meshes instead).
+///
+/// With instancing enabled (OpenGL 3.3 / OpenGL ES 3.0) each sprite is uploaded as a single 48 byte instance, which is
+/// expanded into a quad in the vertex shader (instead of 4 vertices of 48 bytes and 6 indices); the instance colors are
+/// stored with 8 bits per channel. The default shader is replaced by Shader::getUnlitSpriteInstanced(); custom shaders
+/// must use the same instance attributes.
+///    spriteBatch = SpriteBatch::create().withInstancing().addSprites(sprites.begin(), sprites.end()).build();
+///
+/// Large static worlds (such as tile maps) should be built with chunks. Sprites are bucketed into chunks of chunkSize by
+/// their position, and when rendered with an orthographic camera only the chunks intersecting the view are drawn.
+/// Within a chunk the render order is unchanged, but sprites with the same orderInBatch and texture in different chunks
+/// are rendered chunk by chunk (use orderInBatch for sprites overlapping neighbour chunks). Chunks are not supported
+/// with instancing.
+///    level = SpriteBatch::create().withChunks({512,512}).addSprites(tiles.begin(), tiles.end()).build();
 namespace sre{
 
 class Shader;
 
-class SpriteBatch {
+class SpriteBatch : public std::enable_shared_from_this<SpriteBatch> {
 public:
     class SpriteBatchBuilder {
     public:
         SpriteBatchBuilder& withShader(std::shared_ptr<Shader> shader);
+        SpriteBatchBuilder& withInstancing(bool enabled = true);   // Render one instance per sprite (ignored if not supported)
+        SpriteBatchBuilder& withChunks(glm::vec2 chunkSize);       // Bucket sprites into chunks culled against the view ({0,0} disables chunks)
         SpriteBatchBuilder& addSprite(Sprite sprite);
         template< class InputIt >
         SpriteBatchBuilder& addSprites(InputIt first, InputIt last);
@@ -35,15 +58,43 @@ public:
         SpriteBatchBuilder();
         std::shared_ptr<Shader> shader;
         std::vector<Sprite> sprites;
+        bool instancing = false;
+        glm::vec2 chunkSize{0,0};
+        SpriteBatch* updateSpriteBatch = nullptr;
         friend class SpriteBatch;
     };
 
-    static SpriteBatchBuilder create();
+    static SpriteBatchBuilder create();             // Create SpriteBatch using the builder pattern. (Must end with build()).
+    SpriteBatchBuilder update();                    // Replace the sprites using the builder pattern. (Must end with build()).
+                                                    // The sprite batch is updated in place (no GL objects are created in steady state).
 
+    int getSpriteCount();
+    int getMeshCount();                             // Number of draw calls
+    bool isInstanced();                             // True if sprites are rendered as instances
+    bool isChunked();                               // True if chunks are culled when rendered
+    int getChunkCount();                            // Number of non-empty chunks (each texture in a chunk counts as one)
 private:
-    SpriteBatch(std::shared_ptr<Shader> shader, std::vector<Sprite>& sprites);
+    SpriteBatch(std::shared_ptr<Shader> shader, std::vector<Sprite>& sprites, bool instanced, glm::vec2 chunkSize);
+    void updateMeshes(std::shared_ptr<Shader> shader, std::vector<Sprite>& sprites, bool instanced, glm::vec2 chunkSize, bool dynamic);
+    void updateMesh(int index, int firstRun, int lastRun, bool dynamic);
+    std::shared_ptr<Shader> shader;
     std::vector<std::shared_ptr<Material>> materials;
     std::vector<std::shared_ptr<Mesh>> spriteMeshes;
+    int meshCount = 0;                              // meshes in use (the remaining meshes are kept for reuse)
+    int spriteCount = 0;
+    bool instanced = false;
+    glm::vec2 chunkSize{0,0};
+    std::vector<int> indexCapacity;                 // sprites covered by the index buffer of each mesh
+    std::vector<Sprite> spriteScratch;              // reused by the builder returned from update()
+    std::vector<uint32_t> order;                    // sprite indices in render order
+    std::vector<uint32_t> orderKeys;
+    std::vector<uint32_t> orderScratch;
+    std::vector<SpriteVertices::Run> runs;          // one run per texture and chunk (index set of mesh)
+    std::vector<int> meshFirstRun;                  // runs of mesh i are [meshFirstRun[i], meshFirstRun[i+1])
+    std::vector<uint32_t> chunkKeys;
+    std::vector<glm::ivec2> indexRanges;
+    std::vector<glm::vec4> vertexScratch;
+    std::vector<SpriteVertices::Task> expandTasks;
     friend class RenderPass;
 };
 
@@ -52,16 +103,10 @@ private:
         auto size = sprites.size();
         auto start = sprites.insert(sprites.end(), first, last);
         while (start != sprites.end()){
-            (*start).order.details.drawOrder = static_cast<uint16_t>(size);
+            (*start).order.details.drawOrder = static_cast<uint32_t>(size);
             size ++;
             start ++;
         }
-
-        if (size >= USHRT_MAX){
-            LOG_ERROR("More than %i sprites in a batch ", USHRT_MAX);
-            sprites.resize(USHRT_MAX);
-            return *this;
-        }
         return *this;
     }
 
@@ -11,6 +11,9 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
+#include <functional>
+#include <future>
 
 #include "sre/impl/Export.hpp"
 #include "sre/Framebuffer.hpp"
@@ -74,14 +77,41 @@ public:
         Mirror
     };
 
+    enum class MipmapFilter {
+        GPU,                // glGenerateMipmap (driver dependent box filter). Default
+        Box,                // 2x2 average computed on the CPU in linear space
+        Kaiser,             // Kaiser windowed sinc computed on the CPU in linear space (sharper than box)
+        Lanczos             // Lanczos-3 computed on the CPU in linear space (sharpest, may ring on hard edges)
+    };
+
+    struct DecodedImage {                                                                   // Image file decoded to CPU memory (see Texture::decodeFile())
+        std::string filename;
+        std::vector<char> data;
+        int width = -1;
+        int height = -1;
+        int bytesPerPixel = 0;
+        bool transparent = false;
+        uint32_t format = 0;                                                                // GL format (GL compressed internal format if compressed)
+        bool compressed = false;                                                            // data contains GPU compressed blocks
+        std::vector<std::vector<char>> mipmaps;                                             // precomputed mipmap levels (level 1 and up)
+        bool valid() const { return !data.empty(); }
+    };
+
     class DllExport TextureBuilder {
     public:
         ~TextureBuilder();
         TextureBuilder& withGenerateMipmaps(bool enable);
+        TextureBuilder& withMipmapFilter(MipmapFilter filter);                              // Filter used when generating mipmaps (default GPU). CPU filters are computed when the image is decoded
         TextureBuilder& withFilterSampling(bool enable);                                    // if true texture sampling is filtered (bi-linear or tri-linear sampling) otherwise use point sampling.
         TextureBuilder& withWrapUV(Wrap wrap);                                              // Define how texture coordinates are sampled outside the [0.0,1.0] range
         TextureBuilder& withFileCubemap(std::string filename, CubemapSide side);            // Must define a cubemap for each side
-        TextureBuilder& withFile(std::string filename);                                     // Currently only PNG files supported
+        TextureBuilder& withFile(std::string filename);                                     // PNG, JPEG or compressed KTX/KTX2/DDS (BC1-3, BC7, ETC2). Decoded on build (unless found in TextureCache)
+        TextureBuilder& withDecodedImage(DecodedImage image);                               // Use image decoded with Texture::decodeFile()
+        TextureBuilder& withArrayLayers(std::vector<std::string> filenames);                // Texture array (GL_TEXTURE_2D_ARRAY) with one layer per file. Layers must have the same size.
+                                                                                            // Sampled using sampler2DArray (requires OpenGL 3.x / OpenGL ES 3.0)
+        TextureBuilder& withArrayLayers(std::vector<DecodedImage> layers);                  // Texture array using images decoded with Texture::decodeFile() as layers
+        TextureBuilder& withFileAsync(std::string filename,                                 // Decode file on a worker thread and upload it over the following frames.
+                   std::function<void(std::shared_ptr<Texture>)> onLoaded = {});            // build() returns a white placeholder until loaded. onLoaded is invoked on the render thread
         TextureBuilder& withRGBData(const char* data, int width, int height);               // data may be null (for a uninitialized texture)
         TextureBuilder& withRGBAData(const char* data, int width, int height);              // data may be null (for a uninitialized texture)
         TextureBuilder& withWhiteData(int width=2, int height=2);
@@ -90,6 +120,10 @@ public:
         TextureBuilder& withDepth(int width, int height, DepthPrecision precision=DepthPrecision::I16); // Creates a depth texture.
         TextureBuilder& withName(const std::string& name);
         TextureBuilder& withDumpDebug();                                                    // Output debug info on build
+        TextureBuilder& withCache(bool enable);                                             // Reuse texture loaded from same file with same settings (default true). See TextureCache
+                                                                                            // A reused texture keeps the name it was first built with
+        TextureBuilder& withStreaming(bool enable);                                         // Only keep the mip levels needed on screen on the GPU (see Renderer::setTextureMemoryBudget()).
+                                                                                            // Requires mipmaps. The decoded mip chain is kept in system memory
         std::shared_ptr<Texture> build();
     private:
         TextureBuilder();
@@ -103,15 +137,24 @@ public:
             uint32_t format;
             std::string resourcename;
             std::vector<char> data;
+            bool compressed = false;
+            std::vector<std::vector<char>> mipmaps;
             void dumpDebug();
         };
         DepthPrecision depthPrecision = DepthPrecision::None;
         std::string name;
 		bool transparent;
         bool generateMipmaps = false;
+        MipmapFilter mipmapFilter = MipmapFilter::GPU;
         bool filterSampling = true;                                                         // true = linear/trilinear sampling, false = point sampling
         Wrap wrapUV = Wrap::Repeat;
         bool dumpDebug = false;
+        std::string fileToLoad;
+        std::string asyncFilename;
+        bool useCache = true;
+        bool streaming = false;
+        std::function<void(std::shared_ptr<Texture>)> onLoaded;
+        std::vector<DecodedImage> arrayLayers;
         SamplerColorspace samplerColorspace = SamplerColorspace::Linear;
         uint32_t target = 0;
         unsigned int textureId = 0;
@@ -131,33 +174,69 @@ public:
     static std::shared_ptr<Texture> getSphereTexture();
     static std::shared_ptr<Texture> getDefaultCubemapTexture();
 
+    static std::shared_ptr<Texture> createAsync(const std::string& filename,              // Load texture asynchronously (see TextureBuilder::withFileAsync())
+                   std::function<void(std::shared_ptr<Texture>)> onLoaded = {});
+    static DecodedImage decodeFile(const std::string& filename, bool invertY = true);      // Decode image file without touching the GPU. Thread safe (may be called from worker threads)
+    static void generateMipmaps(DecodedImage& image, MipmapFilter filter,                  // Compute image.mipmaps on the CPU (filtered in linear space if srgb). Thread safe.
+                   bool srgb = true, bool wrap = true);                                     // Compressed, non power-of-two or already mipmapped images are left unchanged
+
     int getWidth();
     int getHeight();
 
     bool isFilterSampling();                                                                // returns true if texture sampling is filtered when sampling (bi-linear or tri-linear sampling).
     Wrap getWrapUV();
     bool isCubemap();                                                                       // is cubemap texture
+    bool isTextureArray();                                                                  // is texture array (see TextureBuilder::withArrayLayers())
+    int getLayerCount();                                                                    // number of layers in texture array (1 if not a texture array)
     bool isMipmapped();                                                                     // has texture mipmapped enabled
+    MipmapFilter getMipmapFilter();                                                         // filter used when mipmaps was generated
 	bool isTransparent();																	// Does texture has alpha channel
     SamplerColorspace getSamplerColorSpace();
     const std::string& getName();                                                           // name of the string
 
-    int getDataSize();                                                                      // get size of the texture in bytes on GPU
+    int64_t getDataSize();                                                                  // get size of the texture in bytes on GPU
+    bool isCompressed();                                                                    // texture uses a GPU compressed format
     bool isDepthTexture();
+    bool isLoading();                                                                       // true while an asynchronous load is in progress (texture contains placeholder)
+    bool isStreaming();                                                                     // mip levels are loaded and evicted on demand
+    int getMipLevelCount();                                                                 // number of mip levels (1 if not mipmapped)
+    int getResidentMipLevel();                                                              // highest resolution mip level on the GPU (0 = full resolution)
+    int getRequiredMipLevel();                                                              // highest resolution mip level recently needed on screen (streaming textures only)
     DepthPrecision getDepthPrecision();
 
     std::vector<char> getRawImage();                                                        // Read RGBA texture data from texture (GPU to CPU). Not supported in OpenGL ES
+                                                                                            // Streaming textures returns the resident mip level
+    std::future<std::vector<char>> getRawImageAsync();                                      // Read RGBA texture data without stalling the GPU. See RenderPass::readPixelsAsync()
     void* getNativeTexturePtr();                                                            // get texture id
 private:
     Texture(unsigned int textureId, int width, int height, uint32_t target, std::string string);
     void updateTextureSampler(bool filterSampling, Wrap wrapTextureCoordinates);
     void invokeGenerateMipmap();
-    static GLenum getFormat(SDL_Surface *image);
+    void replaceStorage(unsigned int newTextureId, DecodedImage& image);
+    static void uploadLevels(uint32_t target, int internalFormat, int width, int height, uint32_t format, bool compressed,
+                             const std::vector<char>& data, const std::vector<std::vector<char>>& mipmaps, int firstLevel = 0);
+    static void uploadLevel(uint32_t target, int internalFormat, int width, int height, uint32_t format, bool compressed,
+                            const std::vector<char>& levelData, int level, int glLevel);
+    static int64_t compressedSize(const std::vector<char>& data, const std::vector<std::vector<char>>& mipmaps);
+    int getInternalFormat(uint32_t format, int bytesPerPixel, bool compressed);
+    void initStreaming(DecodedImage&& image);                                               // keep mip chain in system memory and register in TextureStreamer
+    void setResidentMipLevel(int level);                                                    // upload or release levels and move the base level to level
+    int getResidentGLLevel();                                                               // GL level of the resident mip level
+    int64_t getDataSize(int residentLevel);
     static std::vector<char> loadFileFromMemory(const char* data, int dataSize, GLenum& format, bool & alpha,int& width, int& height, int& bytesPerPixel, bool invertY = true);
     int width;
     int height;
     uint32_t target;
-    bool generateMipmap;
+    int layers = 1;
+    bool generateMipmap = false;
+    bool precomputedMipmaps = false;
+    MipmapFilter mipmapFilter = MipmapFilter::GPU;
+    int64_t compressedDataSize = 0;                                                         // exact size of compressed data (0 if not compressed)
+    std::shared_ptr<DecodedImage> streamingSource;                                          // full mip chain (streaming textures only)
+    int residentMipLevel = 0;
+    int requiredMipLevel = 0;                                                               // updated by TextureStreamer
+    int lastUsedFrame = -1;
+    bool streamingRequested = false;                                                        // streaming enabled once an asynchronous load completes
 	bool transparent;
     DepthPrecision depthPrecision = DepthPrecision::None;
     std::string name;
@@ -165,6 +244,7 @@ private:
     bool filterSampling = true; // true = linear/trilinear sampling, false = point sampling
     Wrap wrapUV;
     unsigned int textureId;
+    bool loading = false;
     friend class Shader;
     friend class Material;
     friend class Framebuffer;
@@ -174,6 +254,9 @@ private:
     friend class VR;
     friend class Sprite;
     friend class UniformSet;
+    friend class TextureLoader;
+    friend class TextureStreamer;
+    friend class DeferredRenderer;
 };
 
 
@@ -0,0 +1,50 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "sre/Texture.hpp"
+#include "sre/impl/Export.hpp"
+
+namespace sre {
+    /**
+     * Caches textures loaded from files (see TextureBuilder::withCache()) using weak references. A cache hit returns
+     * the existing texture as is, so the name given by withName() is ignored. Cleared when the Renderer is destroyed.
+     */
+    class DllExport TextureCache {
+    public:
+        struct DllExport Key {
+            explicit Key(std::string filename,
+                         bool generateMipmaps = false,
+                         bool filterSampling = true,
+                         Texture::Wrap wrapUV = Texture::Wrap::Repeat,
+                         Texture::SamplerColorspace samplerColorspace = Texture::SamplerColorspace::Linear,
+                         Texture::MipmapFilter mipmapFilter = Texture::MipmapFilter::GPU,
+                         bool streaming = false);
+            std::string filename;
+            bool generateMipmaps;
+            bool filterSampling;
+            Texture::Wrap wrapUV;
+            Texture::SamplerColorspace samplerColorspace;   // always Gamma when sRGB sampling is unsupported
+            Texture::MipmapFilter mipmapFilter;
+            bool streaming;
+
+            bool operator<(const Key& other) const;
+        };
+
+        static std::shared_ptr<Texture> find(const Key& key);              // Returns cached texture or nullptr. Updates cache hit/miss stats
+        static void insert(const Key& key, std::shared_ptr<Texture> texture);
+        static void clear();                                                // Forget all cached textures (textures in use are not released)
+        static int size();                                                  // Number of live textures in the cache
+    private:
+        static std::map<Key, std::weak_ptr<Texture>>& entries();
+    };
+}
@@ -0,0 +1,51 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sre {
+    // Internal support for block compressed textures stored in KTX, KTX2 or DDS containers.
+    // Supported block formats are BC1 (DXT1), BC2 (DXT3), BC3 (DXT5), BC7, ETC1 and ETC2 (RGB8 and RGBA8/EAC).
+    // Images are used in the stored orientation (no y-flip); author files with a lower-left origin
+    // (e.g. toktx --lower_left_maps_to_s0t0 or texconv -vflip).
+    namespace compressed {
+        enum class BlockFormat {
+            None,
+            BC1,                // RGB, 8 bytes per 4x4 block
+            BC1A,               // RGB with 1 bit alpha, 8 bytes per 4x4 block
+            BC2,                // RGBA (explicit alpha), 16 bytes per 4x4 block
+            BC3,                // RGBA (interpolated alpha), 16 bytes per 4x4 block
+            BC7,                // RGBA, 16 bytes per 4x4 block
+            ETC2_RGB8,          // RGB (also used for ETC1), 8 bytes per 4x4 block
+            ETC2_RGBA8          // RGBA (EAC alpha), 16 bytes per 4x4 block
+        };
+
+        struct Image {
+            BlockFormat format = BlockFormat::None;
+            int width = 0;
+            int height = 0;
+            std::vector<std::vector<char>> levels;      // mipmap levels (level 0 first)
+        };
+
+        bool isContainer(const char* data, size_t size);                     // true if data starts with a KTX, KTX2 or DDS signature
+        bool parse(const char* data, size_t size, Image& image);            // parse container (logs error and returns false if not supported or larger than 16384x16384)
+
+        int blockSize(BlockFormat format);                                  // bytes per 4x4 block
+        size_t levelSize(BlockFormat format, int width, int height);        // bytes used by a single mip level
+        bool hasAlpha(BlockFormat format);
+        uint32_t glFormat(BlockFormat format, bool srgb);                   // GL internal format used with glCompressedTexImage2D
+        uint32_t glFormatSRGB(uint32_t glFormat);                           // sRGB variant of GL compressed format
+        bool isSupportedByGPU(BlockFormat format);                          // uses flags from renderInfo()
+        bool canDecode(BlockFormat format);                                 // CPU decoder exists for format
+
+        std::vector<char> decode(BlockFormat format, const char* data, int width, int height);   // decode level to RGBA8 (row-major, four bytes per pixel)
+    }
+}
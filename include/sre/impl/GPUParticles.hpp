@@ -0,0 +1,49 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "glm/glm.hpp"
+#include "sre/ParticleSystem.hpp"
+
+namespace sre {
+    /**
+     * Emits, simulates and depth sorts the particles of a ParticleSystem using compute shaders (OpenGL 4.3).
+     * update() must be called outside a RenderPass.
+     */
+    class GPUParticles {
+    public:
+        static bool isSupported();
+
+        explicit GPUParticles(ParticleSystem& particleSystem);
+        ~GPUParticles();
+
+        bool isValid();                                 // false if the compute shaders could not be compiled
+
+        void update(float deltaTime, const std::vector<std::pair<const ParticleSystem::Emitter*, int>>& emissions,
+                    const glm::mat4& modelView, int drawCount);   // draws the first drawCount indices
+        void clear();                                   // mark all slots as unused
+    private:
+        unsigned int compile(const char* sourceName);
+
+        ParticleSystem& particleSystem;
+        unsigned int emitProgram = 0;
+        unsigned int simulateProgram = 0;
+        unsigned int sortProgram = 0;
+        unsigned int indicesProgram = 0;
+        int sortK = -1;
+        int sortJ = -1;
+        unsigned int particleBuffer = 0;
+        unsigned int sortBuffer = 0;
+        int sortSize = 0;                               // power of two when depth sorting
+        int ringStart = 0;                              // slot of the next emitted particle
+        uint32_t frame = 0;
+    };
+}
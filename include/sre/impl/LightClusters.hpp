@@ -0,0 +1,71 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+namespace sre {
+    class Shader;
+    class WorldLights;
+
+    /**
+     * Assigns point lights to view frustum clusters for shaders specialized with S_CLUSTERED_LIGHTS.
+     */
+    class LightClusters {
+    public:
+        LightClusters();
+        ~LightClusters();
+
+        void update(WorldLights* worldLights, const glm::mat4& view, const glm::mat4& projection);
+
+        void bind(Shader* shader);                      // bind textures and set cluster uniforms of shader
+
+        int getLightCount();                            // lights (clustered and unclustered) in last update
+        int getLightIndexCount();                       // total length of the cluster light lists
+        glm::ivec3 getClusterSize();
+        float getUpdateTime();                          // CPU time in milliseconds used by last update
+    private:
+        struct ClusteredLight {
+            glm::vec3 center;                           // view space
+            float range;
+        };
+        struct Bounds {
+            glm::vec3 min;
+            glm::vec3 max;
+        };
+
+        void updateClusterBounds(const glm::mat4& projection);
+        void assignLights(int slice);
+        void upload(unsigned int texture, int& allocatedRows, uint32_t internalFormat, uint32_t format, uint32_t type, const void* data, int texels, int texelSize);
+
+        std::vector<glm::vec4> lightData;
+        std::vector<ClusteredLight> clusteredLights;
+        int unclusteredLights = 0;
+
+        glm::mat4 projection = glm::mat4(0);
+        bool orthographic = false;
+        std::vector<float> sliceDepth;                  // depth of slice boundaries
+        glm::vec2 sliceScaleBias;
+        std::vector<Bounds> clusterBounds;              // view space bounds of each cluster
+        std::vector<std::vector<uint32_t>> clusterLights;
+
+        std::vector<glm::uvec2> grid;
+        std::vector<uint32_t> lightIndices;
+
+        unsigned int lightTexture = 0;
+        unsigned int gridTexture = 0;
+        unsigned int indexTexture = 0;
+        int lightTextureRows = 0;
+        int gridTextureRows = 0;
+        int indexTextureRows = 0;
+
+        float updateTime = 0;
+    };
+}
@@ -0,0 +1,45 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "glm/glm.hpp"
+
+namespace sre {
+    class WorldLights;
+
+    /**
+     * Selects the most influential lights for each draw when there are more lights than Renderer::getMaxSceneLights().
+     */
+    class LightSelection {
+    public:
+        void build(WorldLights* worldLights);
+
+        // Returns the indices (in WorldLights) of the at most maxLights most influential lights sorted by index
+        void select(const glm::vec3& boundsMin, const glm::vec3& boundsMax, int maxLights, std::vector<int>& res);
+    private:
+        struct Candidate {
+            float score;
+            int index;
+        };
+        glm::ivec3 cell(const glm::vec3& position);
+        static int64_t key(const glm::ivec3& cell);
+        void score(int index, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+        WorldLights* worldLights = nullptr;
+        float cellSize = 1;
+        std::unordered_map<int64_t, std::vector<int>> grid;
+        std::vector<int> unbounded;                     // directional lights, point lights without range and very large lights
+        std::vector<int> boundedLights;                 // point lights with range
+        std::vector<int> queryStamp;                    // last query each light was scored in
+        int query = 0;
+        std::vector<Candidate> candidates;
+    };
+}
@@ -0,0 +1,26 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <vector>
+
+namespace sre {
+    namespace mipmap {
+        enum class Filter {
+            Box,                // 2x2 average
+            Kaiser,             // Kaiser windowed sinc (alpha = 4, 3 lobes)
+            Lanczos             // Lanczos-3
+        };
+
+        // Computes the mip chain (level 1 and up) of an 8 bit per channel image (3 or 4 channels).
+        // Filtering is done in linear space (color channels of sRGB images are converted to linear before filtering),
+        // using SSE when available and splitting large levels across the WorkerPool. Safe to call from any thread.
+        std::vector<std::vector<char>> generate(const char* data, int width, int height, int channels, Filter filter,
+                                                bool srgb, bool wrap);
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace sre {
+    /**
+     * Reads pixels asynchronously using a ring of pixel pack buffers and fences (synchronous on OpenGL ES 2.0 / WebGL).
+     */
+    class PixelReadback {
+    public:
+        PixelReadback();
+        ~PixelReadback();
+
+        template<typename T>
+        std::future<std::vector<T>> readPixels(int x, int y, int width, int height, uint32_t format, uint32_t type);   // read from the bound framebuffer
+
+        std::future<std::vector<char>> readTexture(unsigned int textureId, int width, int height, int level = 0);       // read a level of a 2D texture as RGBA8
+
+        void update(bool wait = false);                 // resolve completed reads (or all reads if wait is true)
+
+        int getPendingCount();
+    private:
+        using Complete = std::function<void(const char* data)>;
+
+        struct Buffer {
+            unsigned int id = 0;
+            int size = 0;
+            bool busy = false;
+        };
+        struct Request {
+            int buffer;
+            void* fence;                                // GLsync
+            Complete complete;
+        };
+
+        void read(int x, int y, int width, int height, uint32_t format, uint32_t type, int size, Complete complete);
+        int acquireBuffer(int size);
+        void resolve(Request& request, bool wait);
+
+        bool asyncSupported = false;
+        std::vector<Buffer> buffers;
+        int nextBuffer = 0;
+        std::deque<Request> pending;
+    };
+
+    template<typename T>
+    std::future<std::vector<T>> PixelReadback::readPixels(int x, int y, int width, int height, uint32_t format, uint32_t type) {
+        auto promise = std::make_shared<std::promise<std::vector<T>>>();
+        auto future = promise->get_future();
+        size_t count = (size_t)width * height;
+        read(x, y, width, height, format, type, (int)(count * sizeof(T)), [promise, count](const char* data){
+            std::vector<T> res(count);
+            if (data){
+                memcpy(res.data(), data, count * sizeof(T));
+            }
+            promise->set_value(std::move(res));
+        });
+        return future;
+    }
+}
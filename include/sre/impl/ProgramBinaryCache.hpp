@@ -0,0 +1,41 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace sre {
+    /**
+     * Stores linked shader programs on disk (see Renderer::setShaderCacheDirectory()).
+     */
+    class ProgramBinaryCache {
+    public:
+        explicit ProgramBinaryCache(std::string directory);
+
+        bool isSupported();                                     // program binaries supported by driver
+
+        uint64_t computeKey(const std::map<uint32_t, std::string>& preprocessedSources,     // sources per shader type
+                            const std::map<std::string, std::string>& specializationConstants);
+
+        unsigned int load(uint64_t key);                        // returns linked program (or 0 if not cached or rejected)
+
+        void prepare(unsigned int program);                     // must be called before linking a program to store
+
+        void store(uint64_t key, unsigned int program);
+
+        const std::string& getDirectory();
+    private:
+        std::string getFilename(uint64_t key);
+
+        std::string directory;
+        std::string driver;
+        bool supported = false;
+    };
+}
@@ -0,0 +1,41 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+namespace sre {
+    /**
+     * Internal class used by SpriteAtlas::createPacked().
+     * Packs rectangles into a page of fixed size using the skyline bottom-left heuristic: the top edge of the packed
+     * area is stored as a list of horizontal segments and each rectangle is placed where its top edge becomes lowest
+     * (ties are broken by the narrowest segment). Rectangles should be inserted sorted by decreasing height.
+     */
+    class RectPacker {
+    public:
+        RectPacker(int width, int height);
+
+        bool insert(glm::ivec2 size, glm::ivec2& pos);          // returns false if the rectangle does not fit
+
+        float getOccupancy();                                   // fraction of the page used
+    private:
+        struct Segment {
+            int x;
+            int y;
+            int width;
+        };
+        int fit(int index, glm::ivec2 size);                    // returns y position if placed at segment (or -1)
+
+        int width;
+        int height;
+        int64_t usedArea = 0;
+        std::vector<Segment> skyline;
+    };
+}
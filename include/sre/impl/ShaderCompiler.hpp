@@ -0,0 +1,41 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+namespace sre {
+    class Shader;
+    class Material;
+
+    /**
+     * Finishes shaders compiled in the background by Shader::createMaterialAsync() and Shader::warmup().
+     */
+    class ShaderCompiler {
+    public:
+        void add(std::shared_ptr<Shader> shader);
+        void addMaterial(Shader* shader, std::shared_ptr<Material> material);  // switch material to shader when compiled
+
+        bool finish(Shader* shader);                    // block until the shader is compiled. Returns false if compilation failed
+
+        void update();                                  // finish the compiled jobs (called once per frame)
+
+        int getCompilingCount();
+    private:
+        struct Job {
+            std::shared_ptr<Shader> shader;
+            std::vector<std::weak_ptr<Material>> materials;
+            int frame;
+        };
+
+        bool complete(Job& job);
+
+        std::vector<Job> jobs;                          // each job keeps its shader alive until compiled
+    };
+}
@@ -0,0 +1,50 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sre {
+    /**
+     * Caches resource texts, expanded includes and preprocessed shader sources. Cleared by Shader::update().
+     * At most maxSources preprocessed sources are kept (the sources are cleared when the limit is reached).
+     */
+    class ShaderPreprocessor {
+    public:
+        struct Entry {
+            std::string source;
+            std::vector<std::string> errors;
+        };
+
+        static const size_t maxSources = 256;
+
+        static std::string getKey(const std::string& resource, uint32_t shaderType, const std::string& specializationKey, int glslVersion); // specializationKey from Shader::SpecializationKey::getKey()
+
+        const Entry* find(const std::string& key);         // returns null if not cached
+        const Entry& store(const std::string& key, Entry entry);
+
+        const Entry& expandIncludes(const std::string& resource, uint32_t shaderType);     // source of resource with includes expanded (one level)
+
+        void clear();
+
+        int getHits();
+        int getMisses();
+        size_t getCacheSize();
+    private:
+        const std::string& loadText(const std::string& resource);
+
+        std::unordered_map<std::string, std::string> texts;
+        std::unordered_map<std::string, Entry> expanded;
+        std::unordered_map<std::string, Entry> sources;
+        int hits = 0;
+        int misses = 0;
+    };
+}
@@ -1,5 +1,5 @@
 // autogenerated by
-// files_to_cpp shader src/embedded_deps/shadow_frag.glsl shadow_frag.glsl src/embedded_deps/shadow_vert.glsl shadow_vert.glsl src/embedded_deps/skybox_proc_frag.glsl skybox_proc_frag.glsl src/embedded_deps/skybox_proc_vert.glsl skybox_proc_vert.glsl src/embedded_deps/skybox_frag.glsl skybox_frag.glsl src/embedded_deps/skybox_vert.glsl skybox_vert.glsl src/embedded_deps/sre_utils_incl.glsl sre_utils_incl.glsl src/embedded_deps/debug_normal_frag.glsl debug_normal_frag.glsl src/embedded_deps/debug_normal_vert.glsl debug_normal_vert.glsl src/embedded_deps/debug_uv_frag.glsl debug_uv_frag.glsl src/embedded_deps/debug_uv_vert.glsl debug_uv_vert.glsl src/embedded_deps/light_incl.glsl light_incl.glsl src/embedded_deps/particles_frag.glsl particles_frag.glsl src/embedded_deps/particles_vert.glsl particles_vert.glsl src/embedded_deps/sprite_frag.glsl sprite_frag.glsl src/embedded_deps/sprite_vert.glsl sprite_vert.glsl src/embedded_deps/standard_pbr_frag.glsl standard_pbr_frag.glsl src/embedded_deps/standard_pbr_vert.glsl standard_pbr_vert.glsl src/embedded_deps/standard_blinn_phong_frag.glsl standard_blinn_phong_frag.glsl src/embedded_deps/standard_blinn_phong_vert.glsl standard_blinn_phong_vert.glsl src/embedded_deps/standard_phong_frag.glsl standard_phong_frag.glsl src/embedded_deps/standard_phong_vert.glsl standard_phong_vert.glsl src/embedded_deps/blit_frag.glsl blit_frag.glsl src/embedded_deps/blit_vert.glsl blit_vert.glsl src/embedded_deps/unlit_frag.glsl unlit_frag.glsl src/embedded_deps/unlit_vert.glsl unlit_vert.glsl src/embedded_deps/debug_tangent_frag.glsl debug_tangent_frag.glsl src/embedded_deps/debug_tangent_vert.glsl debug_tangent_vert.glsl src/embedded_deps/normalmap_incl.glsl normalmap_incl.glsl src/embedded_deps/global_uniforms_incl.glsl global_uniforms_incl.glsl include/sre/impl/ShaderSource.inl
+// files_to_cpp shader src/embedded_deps/shadow_frag.glsl shadow_frag.glsl src/embedded_deps/shadow_vert.glsl shadow_vert.glsl src/embedded_deps/skybox_proc_frag.glsl skybox_proc_frag.glsl src/embedded_deps/skybox_proc_vert.glsl skybox_proc_vert.glsl src/embedded_deps/skybox_frag.glsl skybox_frag.glsl src/embedded_deps/skybox_vert.glsl skybox_vert.glsl src/embedded_deps/sre_utils_incl.glsl sre_utils_incl.glsl src/embedded_deps/debug_normal_frag.glsl debug_normal_frag.glsl src/embedded_deps/debug_normal_vert.glsl debug_normal_vert.glsl src/embedded_deps/debug_uv_frag.glsl debug_uv_frag.glsl src/embedded_deps/debug_uv_vert.glsl debug_uv_vert.glsl src/embedded_deps/light_incl.glsl light_incl.glsl src/embedded_deps/particles_frag.glsl particles_frag.glsl src/embedded_deps/particles_vert.glsl particles_vert.glsl src/embedded_deps/sprite_frag.glsl sprite_frag.glsl src/embedded_deps/sprite_vert.glsl sprite_vert.glsl src/embedded_deps/standard_pbr_frag.glsl standard_pbr_frag.glsl src/embedded_deps/standard_pbr_vert.glsl standard_pbr_vert.glsl src/embedded_deps/standard_blinn_phong_frag.glsl standard_blinn_phong_frag.glsl src/embedded_deps/standard_blinn_phong_vert.glsl standard_blinn_phong_vert.glsl src/embedded_deps/standard_phong_frag.glsl standard_phong_frag.glsl src/embedded_deps/standard_phong_vert.glsl standard_phong_vert.glsl src/embedded_deps/blit_frag.glsl blit_frag.glsl src/embedded_deps/blit_vert.glsl blit_vert.glsl src/embedded_deps/unlit_frag.glsl unlit_frag.glsl src/embedded_deps/unlit_vert.glsl unlit_vert.glsl src/embedded_deps/debug_tangent_frag.glsl debug_tangent_frag.glsl src/embedded_deps/debug_tangent_vert.glsl debug_tangent_vert.glsl src/embedded_deps/normalmap_incl.glsl normalmap_incl.glsl src/embedded_deps/global_uniforms_incl.glsl global_uniforms_incl.glsl src/embedded_deps/pbr_incl.glsl pbr_incl.glsl src/embedded_deps/gbuffer_incl.glsl gbuffer_incl.glsl src/embedded_deps/deferred_light_vert.glsl deferred_light_vert.glsl src/embedded_deps/deferred_light_frag.glsl deferred_light_frag.glsl src/embedded_deps/sprite_instanced_vert.glsl sprite_instanced_vert.glsl src/embedded_deps/particles_emit_comp.glsl particles_emit_comp.glsl src/embedded_deps/particles_simulate_comp.glsl particles_simulate_comp.glsl src/embedded_deps/particles_sort_comp.glsl particles_sort_comp.glsl src/embedded_deps/particles_indices_comp.glsl particles_indices_comp.glsl include/sre/impl/ShaderSource.inl
 #include <map>
 #include <utility>
 #include <string>
@@ -176,7 +176,12 @@ void main(void) {
     vUV = uv;
 })"),
 std::make_pair<std::string,std::string>("light_incl.glsl",R"(#ifdef S_SHADOW
+#ifdef S_SHADOW_CASCADES
+uniform mat4 shadowViewProjOffsets[S_SHADOW_CASCADES]; // world space to texture coordinates of each cascade (see ShadowMap)
+uniform vec4 shadowCascadeSplits;                   // view space far distance of each cascade
+#else
 in vec4 vShadowmapCoord;
+#endif
 #ifdef GL_ES
 #ifdef SI_FBO_DEPTH_ATTACHMENT
 #ifdef GL_FRAGMENT_PRECISION_HIGH
@@ -200,6 +205,53 @@ uniform sampler2D shadowMap;
 #endif
 #endif
 
+#if defined(S_CLUSTERED_LIGHTS) && __VERSION__ <= 100
+#undef S_CLUSTERED_LIGHTS                           // clustered lights requires integer textures (OpenGL 3.3 / OpenGL ES 3.0)
+#endif
+#ifdef S_CLUSTERED_LIGHTS
+#ifdef GL_ES
+uniform highp sampler2D g_clusterLights;            // light i is stored as lightPosType and lightColorRange in texel 2i and 2i+1
+uniform highp usampler2D g_clusterGrid;             // offset and count into g_clusterLightIndices for each cluster
+uniform highp usampler2D g_clusterLightIndices;
+#else
+uniform sampler2D g_clusterLights;
+uniform usampler2D g_clusterGrid;
+uniform usampler2D g_clusterLightIndices;
+#endif
+uniform vec4 g_clusterSize;                         // tiles x, tiles y, depth slices, number of unclustered lights
+uniform vec4 g_clusterDepth;                        // depth slice scale, depth slice bias, unused, orthographic (1.0) or perspective (0.0)
+
+ivec2 clusterTexel(int index){
+    const int clusterTextureWidth = 1024;
+    return ivec2(index % clusterTextureWidth, index / clusterTextureWidth);
+}
+
+// returns offset and count of the light indices in the cluster containing the fragment
+ivec2 clusterLightRange(vec3 wsPos){
+    float depth = -(g_view * vec4(wsPos, 1.0)).z;
+    float slice = g_clusterDepth.w > 0.5 ? depth * g_clusterDepth.x + g_clusterDepth.y : log(max(depth, 0.0001)) * g_clusterDepth.x + g_clusterDepth.y;
+    vec2 tile = (gl_FragCoord.xy - g_viewport.zw) / g_viewport.xy * g_clusterSize.xy;
+    ivec3 cluster = ivec3(clamp(vec3(tile, slice), vec3(0.0), g_clusterSize.xyz - 1.0));
+    int clusterIndex = cluster.x + (cluster.y + cluster.z * int(g_clusterSize.y)) * int(g_clusterSize.x);
+    return ivec2(texelFetch(g_clusterGrid, clusterTexel(clusterIndex), 0).xy);
+}
+
+int clusterLightCount(ivec2 lightRange){
+    return int(g_clusterSize.w) + lightRange.y;
+}
+
+// the unclustered lights (directional lights and point lights without range) are followed by the lights of the cluster
+void clusterLight(ivec2 lightRange, int index, out vec4 lightPosType, out vec4 lightColorRange){
+    int unclusteredLights = int(g_clusterSize.w);
+    int i = index;
+    if (index >= unclusteredLights){
+        i = int(texelFetch(g_clusterLightIndices, clusterTexel(lightRange.x + index - unclusteredLights), 0).x);
+    }
+    lightPosType = texelFetch(g_clusterLights, clusterTexel(i*2), 0);
+    lightColorRange = texelFetch(g_clusterLights, clusterTexel(i*2+1), 0);
+}
+#endif
+
 in vec4 vLightDir[SI_LIGHTS];
 
 uniform vec4 specularity;
@@ -211,8 +263,30 @@ float unpackDepth(const in vec4 rgba_depth)
     return depth;
 }
 
-float getShadow() {                                 // returns 0.0 if in shadow and 1.0 if fully lit
+float getShadow(vec3 wsPos) {                        // returns 0.0 if in shadow and 1.0 if fully lit
 #ifdef S_SHADOW
+#ifdef S_SHADOW_CASCADES
+    // the cascades are placed side by side in the shadow map
+    float depth = -(g_view * vec4(wsPos, 1.0)).z;
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0));
+    for (int i=0;i<S_SHADOW_CASCADES;i++){
+        if (depth > shadowCascadeSplits[i]){
+            continue;
+        }
+        vec3 coord = (shadowViewProjOffsets[i] * vec4(wsPos, 1.0)).xyz; // orthographic projection
+        if (any(lessThan(coord, vec3(0.0))) || any(greaterThan(coord, vec3(1.0)))){
+            continue;                                   // outside cascade - use the next cascade
+        }
+        coord.x = clamp(coord.x, texelSize.x * float(S_SHADOW_CASCADES), 1.0 - texelSize.x * float(S_SHADOW_CASCADES));
+        coord.x = (coord.x + float(i)) / float(S_SHADOW_CASCADES);
+#ifndef SI_FBO_DEPTH_ATTACHMENT
+        return unpackDepth(texture(shadowMap, coord.xy)) > coord.z ? 1.0 : 0.0;
+#else
+        return texture(shadowMap, coord);               // compare .z with shadow map depth
+#endif
+    }
+    return 1.0;
+#else
 #ifdef GL_ES
     if (vShadowmapCoord.x < 0.0 || vShadowmapCoord.y < 0.0 || vShadowmapCoord.x > vShadowmapCoord.w || vShadowmapCoord.y > vShadowmapCoord.w ){
         return 1.0;
@@ -226,6 +300,7 @@ float getShadow() {                                 // returns 0.0 if in shadow
 #else
     return textureProj(shadowMap, vShadowmapCoord); // performs w division and compare .z with current depth
 #endif
+#endif
 #else
     return 0.0;
 #endif
@@ -240,7 +315,7 @@ void lightDirectionAndAttenuation(vec4 lightPosType, float lightRange, vec3 pos,
         attenuation = 1.0;
 #ifdef S_SHADOW
         if (shadow){
-            attenuation = getShadow();
+            attenuation = getShadow(pos);
         }
 #endif
     } else if (isPoint) {
@@ -266,10 +341,21 @@ vec3 computeLightBlinnPhong(vec3 wsPos, vec3 wsCameraPos, vec3 normal, out vec3
     specularityOut = vec3(0.0, 0.0, 0.0);
     vec3 lightColor = vec3(0.0,0.0,0.0);
     vec3 cam = normalize(wsCameraPos - wsPos);
+#ifdef S_CLUSTERED_LIGHTS
+    ivec2 lightRange = clusterLightRange(wsPos);
+    int lightCount = clusterLightCount(lightRange);
+    for (int i=0;i<lightCount;i++){
+        vec4 lightPosType;
+        vec4 lightColorRange;
+        clusterLight(lightRange, i, lightPosType, lightColorRange);
+#else
     for (int i=0;i<SI_LIGHTS;i++){
+        vec4 lightPosType = g_lightPosType[i];
+        vec4 lightColorRange = g_lightColorRange[i];
+#endif
         vec3 lightDirection = vec3(0.0,0.0,0.0);
         float att = 0.0;
-        lightDirectionAndAttenuation(g_lightPosType[i], g_lightColorRange[i].w, wsPos,i==0, lightDirection, att);
+        lightDirectionAndAttenuation(lightPosType, lightColorRange.w, wsPos,i==0, lightDirection, att);
 
         if (att <= 0.0){
             continue;
@@ -278,7 +364,7 @@ vec3 computeLightBlinnPhong(vec3 wsPos, vec3 wsCameraPos, vec3 normal, out vec3
         // diffuse light
         float diffuse = dot(lightDirection, normal);
         if (diffuse > 0.0){
-            lightColor += (att * diffuse) * g_lightColorRange[i].xyz;
+            lightColor += (att * diffuse) * lightColorRange.xyz;
         }
 
         // specular light
@@ -300,10 +386,21 @@ vec3 computeLightPhong(vec3 wsPos, vec3 wsCameraPos, vec3 normal, out vec3 specu
     specularityOut = vec3(0.0, 0.0, 0.0);
     vec3 lightColor = vec3(0.0,0.0,0.0);
     vec3 cam = normalize(wsCameraPos - wsPos);
+#ifdef S_CLUSTERED_LIGHTS
+    ivec2 lightRange = clusterLightRange(wsPos);
+    int lightCount = clusterLightCount(lightRange);
+    for (int i=0;i<lightCount;i++){
+        vec4 lightPosType;
+        vec4 lightColorRange;
+        clusterLight(lightRange, i, lightPosType, lightColorRange);
+#else
     for (int i=0;i<SI_LIGHTS;i++){
+        vec4 lightPosType = g_lightPosType[i];
+        vec4 lightColorRange = g_lightColorRange[i];
+#endif
         vec3 lightDirection = vec3(0.0,0.0,0.0);
         float att = 0.0;
-        lightDirectionAndAttenuation(g_lightPosType[i], g_lightColorRange[i].w, wsPos, i==0, lightDirection, att);
+        lightDirectionAndAttenuation(lightPosType, lightColorRange.w, wsPos, i==0, lightDirection, att);
 
         if (att <= 0.0){
             continue;
@@ -312,7 +409,7 @@ vec3 computeLightPhong(vec3 wsPos, vec3 wsCameraPos, vec3 normal, out vec3 specu
         // diffuse light
         float diffuse = dot(lightDirection, normal);
         if (diffuse > 0.0){
-            lightColor += (att * diffuse) * g_lightColorRange[i].xyz;
+            lightColor += (att * diffuse) * lightColorRange.xyz;
         }
 
         // specular light
@@ -395,14 +492,26 @@ std::make_pair<std::string,std::string>("sprite_frag.glsl",R"(#version 330
 out vec4 fragColor;
 in vec2 vUV;
 in vec4 vColor;
-
+#ifdef S_TEXTURE_ARRAY
+in float vLayer;
+#ifdef GL_ES
+uniform mediump sampler2DArray tex;
+#else
+uniform sampler2DArray tex;
+#endif
+#else
 uniform sampler2D tex;
+#endif
 
 #pragma include "sre_utils_incl.glsl"
 
 void main(void)
 {
+#ifdef S_TEXTURE_ARRAY
+    fragColor = vColor * toLinear(texture(tex, vec3(vUV, vLayer)));
+#else
     fragColor = vColor * toLinear(texture(tex, vUV));
+#endif
     fragColor = toOutput(fragColor);
 })"),
 std::make_pair<std::string,std::string>("sprite_vert.glsl",R"(#version 330
@@ -411,6 +520,9 @@ in vec4 uv;
 in vec4 vertex_color;
 out vec2 vUV;
 out vec4 vColor;
+#ifdef S_TEXTURE_ARRAY
+out float vLayer;
+#endif
 
 #pragma include "global_uniforms_incl.glsl"
 
@@ -418,11 +530,20 @@ void main(void) {
     gl_Position = g_projection * g_view * g_model * vec4(position,1.0);
     vUV = uv.xy;
     vColor = vertex_color;
+#ifdef S_TEXTURE_ARRAY
+    vLayer = uv.z;
+#endif
 })"),
 std::make_pair<std::string,std::string>("standard_pbr_frag.glsl",R"(#version 330
 #extension GL_EXT_shader_texture_lod: enable
 #extension GL_OES_standard_derivatives : enable
+#ifdef S_GBUFFER
+layout(location = 0) out vec4 fragColor;                // base color and occlusion (see gbuffer_incl.glsl)
+layout(location = 1) out vec4 gbufferNormalMetallic;
+layout(location = 2) out vec4 gbufferEmissiveRoughness;
+#else
 out vec4 fragColor;
+#endif
 #if defined(S_TANGENTS) && defined(S_NORMALMAP)
 in mat3 vTBN;
 #else
@@ -457,71 +578,11 @@ in vec4 vColor;
 #pragma include "global_uniforms_incl.glsl"
 #pragma include "normalmap_incl.glsl"
 #pragma include "light_incl.glsl"
+#pragma include "pbr_incl.glsl"
+#pragma include "gbuffer_incl.glsl"
 #pragma include "sre_utils_incl.glsl"
 
 
-// Encapsulate the various inputs used by the various functions in the shading equation
-// We store values in this struct to simplify the integration of alternative implementations
-// of the shading terms, outlined in the Readme.MD Appendix.
-struct PBRInfo
-{
-    float NdotL;                  // cos angle between normal and light direction
-    float NdotV;                  // cos angle between normal and view direction
-    float NdotH;                  // cos angle between normal and half vector
-    float LdotH;                  // cos angle between light direction and half vector
-    float VdotH;                  // cos angle between view direction and half vector
-    float perceptualRoughness;    // roughness value, as authored by the model creator (input to shader)
-    float metalness;              // metallic value at the surface
-    vec3 reflectance0;            // full reflectance color (normal incidence angle)
-    vec3 reflectance90;           // reflectance color at grazing angle
-    float alphaRoughness;         // roughness mapped to a more linear change in the roughness (proposed by [2])
-    vec3 diffuseColor;            // color contribution from diffuse lighting
-    vec3 specularColor;           // color contribution from specular lighting
-};
-
-const float M_PI = 3.141592653589793;
-const float c_MinRoughness = 0.04;
-
-// The following equation models the Fresnel reflectance term of the spec equation (aka F())
-// Implementation of fresnel from [4], Equation 15
-vec3 specularReflection(PBRInfo pbrInputs)
-{
-    return pbrInputs.reflectance0 + (pbrInputs.reflectance90 - pbrInputs.reflectance0) * pow(clamp(1.0 - pbrInputs.VdotH, 0.0, 1.0), 5.0);
-}
-
-// Basic Lambertian diffuse
-// Implementation from Lambert's Photometria https://archive.org/details/lambertsphotome00lambgoog
-// See also [1], Equation 1
-vec3 diffuse(PBRInfo pbrInputs)
-{
-    return pbrInputs.diffuseColor / M_PI;
-}
-
-// This calculates the specular geometric attenuation (aka G()),
-// where rougher material will reflect less light back to the viewer.
-// This implementation is based on [1] Equation 4, and we adopt their modifications to
-// alphaRoughness as input as originally proposed in [2].
-float geometricOcclusion(PBRInfo pbrInputs)
-{
-    float NdotL = pbrInputs.NdotL;
-    float NdotV = pbrInputs.NdotV;
-    float r = pbrInputs.alphaRoughness;
-
-    float attenuationL = 2.0 * NdotL / (NdotL + sqrt(r * r + (1.0 - r * r) * (NdotL * NdotL)));
-    float attenuationV = 2.0 * NdotV / (NdotV + sqrt(r * r + (1.0 - r * r) * (NdotV * NdotV)));
-    return attenuationL * attenuationV;
-}
-
-// The following equation(s) model the distribution of microfacet normals across the area being drawn (aka D())
-// Implementation from "Average Irregularity Representation of a Roughened Surface for Ray Reflection" by T. S. Trowbridge, and K. P. Reitz
-// Follows the distribution function recommended in the SIGGRAPH 2013 course notes from EPIC Games [1], Equation 3.
-float microfacetDistribution(PBRInfo pbrInputs)
-{
-    float roughnessSq = pbrInputs.alphaRoughness * pbrInputs.alphaRoughness;
-    float f = (pbrInputs.NdotH * roughnessSq - pbrInputs.NdotH) * pbrInputs.NdotH + 1.0;
-    return roughnessSq / (M_PI * f * f);
-}
-
 void main(void)
 {
     float perceptualRoughness = metallicRoughness.y;
@@ -536,10 +597,6 @@ void main(void)
 #endif
     perceptualRoughness = clamp(perceptualRoughness, c_MinRoughness, 1.0);
     metallic = clamp(metallic, 0.0, 1.0);
-    // Roughness is authored as perceptual roughness; as is convention,
-    // convert to material roughness by squaring the perceptual roughness [2].
-    float alphaRoughness = perceptualRoughness * perceptualRoughness;
-
 #ifndef S_NO_BASECOLORMAP
     vec4 baseColor = toLinear(texture(tex, vUV)) * color;
 #else
@@ -554,72 +611,28 @@ void main(void)
     diffuseColor *= 1.0 - metallic;
 
     vec3 specularColor = mix(f0, baseColor.rgb, metallic);
-
-    // Compute reflectance.
-    float reflectance = max(max(specularColor.r, specularColor.g), specularColor.b);
-
-    // For typical incident reflectance range (between 4% to 100%) set the grazing reflectance to 100% for typical fresnel effect.
-    // For very low reflectance range on highly diffuse objects (below 4%), incrementally reduce grazing reflectance to 0%.
-    float reflectance90 = clamp(reflectance * 25.0, 0.0, 1.0);
-    vec3 specularEnvironmentR0 = specularColor.rgb;
-    vec3 specularEnvironmentR90 = vec3(1.0, 1.0, 1.0) * reflectance90;
-    vec3 color = baseColor.rgb * g_ambientLight.rgb;      // non pbr
     vec3 n = getNormal();                             // Normal at surface point
-    vec3 v = normalize(g_cameraPos.xyz - vWsPos.xyz); // Vector from surface point to camera
-    for (int i=0;i<SI_LIGHTS;i++) {
-        float attenuation = 0.0;
-        vec3 l = vec3(0.0,0.0,0.0);
-        lightDirectionAndAttenuation(g_lightPosType[i], g_lightColorRange[i].w, vWsPos, i==0, l, attenuation);
-        if (attenuation <= 0.0){
-            continue;
-        }
-
-        vec3 h = normalize(l+v);                          // Half vector between both l and v
-        vec3 reflection = -normalize(reflect(v, n));
-
-        float NdotL = clamp(dot(n, l), 0.0001, 1.0);
-        float NdotV = abs(dot(n, v)) + 0.0001;
-        float NdotH = clamp(dot(n, h), 0.0, 1.0);
-        float LdotH = clamp(dot(l, h), 0.0, 1.0);
-        float VdotH = clamp(dot(v, h), 0.0, 1.0);
-
-        PBRInfo pbrInputs = PBRInfo(
-            NdotL,
-            NdotV,
-            NdotH,
-            LdotH,
-            VdotH,
-            perceptualRoughness,
-            metallic,
-            specularEnvironmentR0,
-            specularEnvironmentR90,
-            alphaRoughness,
-            diffuseColor,
-            specularColor
-        );
-
-        // Calculate the shading terms for the microfacet specular shading model
-        vec3 F = specularReflection(pbrInputs);
-        float G = geometricOcclusion(pbrInputs);
-        float D = microfacetDistribution(pbrInputs);
-
-        // Calculation of analytical lighting contribution
-        vec3 diffuseContrib = (1.0 - F) * diffuse(pbrInputs);
-        vec3 specContrib = F * G * D / (4.0 * NdotL * NdotV);
-        color += attenuation * NdotL * g_lightColorRange[i].xyz * (diffuseContrib + specContrib);
-    }
 
     // Apply optional PBR terms for additional (optional) shading
+    float occlusion = 1.0;
 #ifdef S_OCCLUSIONMAP
-    float ao = texture(occlusionTex, vUV).r;
-    color = mix(color, color * ao, occlusionStrength);
+    occlusion = mix(1.0, texture(occlusionTex, vUV).r, occlusionStrength);
 #endif
+    vec3 emissive = vec3(0.0);
 #ifdef S_EMISSIVEMAP
-    vec3 emissive = toLinear(texture(emissiveTex, vUV)).rgb * emissiveFactor.xyz;
-    color += emissive;
+    emissive = toLinear(texture(emissiveTex, vUV)).rgb * emissiveFactor.xyz;
 #endif
 
+#ifdef S_GBUFFER
+    writeGBuffer(baseColor.rgb, occlusion, n, metallic, emissive, perceptualRoughness, fragColor, gbufferNormalMetallic, gbufferEmissiveRoughness);
+#else
+    vec3 v = normalize(g_cameraPos.xyz - vWsPos.xyz); // Vector from surface point to camera
+    vec3 color = baseColor.rgb * g_ambientLight.rgb;      // non pbr
+    color += computeLightPBR(vWsPos, n, v, diffuseColor, specularColor, perceptualRoughness, metallic);
+    color = color * occlusion + emissive;
+
     fragColor = toOutput(color,baseColor.a);
+#endif
 })"),
 std::make_pair<std::string,std::string>("standard_pbr_vert.glsl",R"(#version 330
 in vec3 position;
@@ -637,7 +650,7 @@ out vec4 vColor;
 #endif
 out vec2 vUV;
 out vec3 vWsPos;
-#ifdef S_SHADOW
+#if defined(S_SHADOW) && !defined(S_SHADOW_CASCADES)
 uniform mat4 shadowViewProjOffset;
 out vec4 vShadowmapCoord;
 #endif
@@ -659,7 +672,7 @@ void main(void) {
 #ifdef S_VERTEX_COLOR
     vColor = vertex_color;
 #endif
-#ifdef S_SHADOW
+#if defined(S_SHADOW) && !defined(S_SHADOW_CASCADES)
     vShadowmapCoord = shadowViewProjOffset * wsPos;
 #endif
 })"),
@@ -717,7 +730,7 @@ out vec3 vWsPos;
 in vec4 vertex_color;
 out vec4 vColor;
 #endif
-#ifdef S_SHADOW
+#if defined(S_SHADOW) && !defined(S_SHADOW_CASCADES)
 uniform mat4 shadowViewProjOffset;
 out vec4 vShadowmapCoord;
 #endif
@@ -739,7 +752,7 @@ void main(void) {
 #ifdef S_VERTEX_COLOR
     vColor = vertex_color;
 #endif
-#ifdef S_SHADOW
+#if defined(S_SHADOW) && !defined(S_SHADOW_CASCADES)
     vShadowmapCoord = shadowViewProjOffset * wsPos;
 #endif
 })"),
@@ -798,7 +811,7 @@ out vec3 vWsPos;
 in vec4 vertex_color;
 out vec4 vColor;
 #endif
-#ifdef S_SHADOW
+#if defined(S_SHADOW) && !defined(S_SHADOW_CASCADES)
 uniform mat4 shadowViewProjOffset;
 out vec4 vShadowmapCoord;
 #endif
@@ -820,7 +833,7 @@ void main(void) {
 #ifdef S_VERTEX_COLOR
     vColor = vertex_color;
 #endif
-#ifdef S_SHADOW
+#if defined(S_SHADOW) && !defined(S_SHADOW_CASCADES)
     vShadowmapCoord = shadowViewProjOffset * wsPos;
 #endif
 })"),
@@ -977,4 +990,444 @@ uniform vec4 g_lightPosType[SI_LIGHTS];
 uniform mat4 g_model;
 uniform mat3 g_model_it;
 uniform mat3 g_model_view_it;)"),
+std::make_pair<std::string,std::string>("pbr_incl.glsl",R"(// Encapsulate the various inputs used by the various functions in the shading equation
+// We store values in this struct to simplify the integration of alternative implementations
+// of the shading terms, outlined in the Readme.MD Appendix.
+struct PBRInfo
+{
+    float NdotL;                  // cos angle between normal and light direction
+    float NdotV;                  // cos angle between normal and view direction
+    float NdotH;                  // cos angle between normal and half vector
+    float LdotH;                  // cos angle between light direction and half vector
+    float VdotH;                  // cos angle between view direction and half vector
+    float perceptualRoughness;    // roughness value, as authored by the model creator (input to shader)
+    float metalness;              // metallic value at the surface
+    vec3 reflectance0;            // full reflectance color (normal incidence angle)
+    vec3 reflectance90;           // reflectance color at grazing angle
+    float alphaRoughness;         // roughness mapped to a more linear change in the roughness (proposed by [2])
+    vec3 diffuseColor;            // color contribution from diffuse lighting
+    vec3 specularColor;           // color contribution from specular lighting
+};
+
+const float M_PI = 3.141592653589793;
+const float c_MinRoughness = 0.04;
+
+// The following equation models the Fresnel reflectance term of the spec equation (aka F())
+// Implementation of fresnel from [4], Equation 15
+vec3 specularReflection(PBRInfo pbrInputs)
+{
+    return pbrInputs.reflectance0 + (pbrInputs.reflectance90 - pbrInputs.reflectance0) * pow(clamp(1.0 - pbrInputs.VdotH, 0.0, 1.0), 5.0);
+}
+
+// Basic Lambertian diffuse
+// Implementation from Lambert's Photometria https://archive.org/details/lambertsphotome00lambgoog
+// See also [1], Equation 1
+vec3 diffuse(PBRInfo pbrInputs)
+{
+    return pbrInputs.diffuseColor / M_PI;
+}
+
+// This calculates the specular geometric attenuation (aka G()),
+// where rougher material will reflect less light back to the viewer.
+// This implementation is based on [1] Equation 4, and we adopt their modifications to
+// alphaRoughness as input as originally proposed in [2].
+float geometricOcclusion(PBRInfo pbrInputs)
+{
+    float NdotL = pbrInputs.NdotL;
+    float NdotV = pbrInputs.NdotV;
+    float r = pbrInputs.alphaRoughness;
+
+    float attenuationL = 2.0 * NdotL / (NdotL + sqrt(r * r + (1.0 - r * r) * (NdotL * NdotL)));
+    float attenuationV = 2.0 * NdotV / (NdotV + sqrt(r * r + (1.0 - r * r) * (NdotV * NdotV)));
+    return attenuationL * attenuationV;
+}
+
+// The following equation(s) model the distribution of microfacet normals across the area being drawn (aka D())
+// Implementation from "Average Irregularity Representation of a Roughened Surface for Ray Reflection" by T. S. Trowbridge, and K. P. Reitz
+// Follows the distribution function recommended in the SIGGRAPH 2013 course notes from EPIC Games [1], Equation 3.
+float microfacetDistribution(PBRInfo pbrInputs)
+{
+    float roughnessSq = pbrInputs.alphaRoughness * pbrInputs.alphaRoughness;
+    float f = (pbrInputs.NdotH * roughnessSq - pbrInputs.NdotH) * pbrInputs.NdotH + 1.0;
+    return roughnessSq / (M_PI * f * f);
+}
+
+// Returns the light reflected towards v from all scene lights (ambient light is not included)
+vec3 computeLightPBR(vec3 wsPos, vec3 n, vec3 v, vec3 diffuseColor, vec3 specularColor, float perceptualRoughness, float metallic){
+    float alphaRoughness = perceptualRoughness * perceptualRoughness;
+
+    // Compute reflectance.
+    float reflectance = max(max(specularColor.r, specularColor.g), specularColor.b);
+
+    // For typical incident reflectance range (between 4% to 100%) set the grazing reflectance to 100% for typical fresnel effect.
+    // For very low reflectance range on highly diffuse objects (below 4%), incrementally reduce grazing reflectance to 0%.
+    float reflectance90 = clamp(reflectance * 25.0, 0.0, 1.0);
+    vec3 specularEnvironmentR0 = specularColor.rgb;
+    vec3 specularEnvironmentR90 = vec3(1.0, 1.0, 1.0) * reflectance90;
+    vec3 color = vec3(0.0, 0.0, 0.0);
+#ifdef S_CLUSTERED_LIGHTS
+    ivec2 lightRange = clusterLightRange(wsPos);
+    int lightCount = clusterLightCount(lightRange);
+    for (int i=0;i<lightCount;i++) {
+        vec4 lightPosType;
+        vec4 lightColorRange;
+        clusterLight(lightRange, i, lightPosType, lightColorRange);
+#else
+    for (int i=0;i<SI_LIGHTS;i++) {
+        vec4 lightPosType = g_lightPosType[i];
+        vec4 lightColorRange = g_lightColorRange[i];
+#endif
+        float attenuation = 0.0;
+        vec3 l = vec3(0.0,0.0,0.0);
+        lightDirectionAndAttenuation(lightPosType, lightColorRange.w, wsPos, i==0, l, attenuation);
+        if (attenuation <= 0.0){
+            continue;
+        }
+
+        vec3 h = normalize(l+v);                          // Half vector between both l and v
+        vec3 reflection = -normalize(reflect(v, n));
+
+        float NdotL = clamp(dot(n, l), 0.0001, 1.0);
+        float NdotV = abs(dot(n, v)) + 0.0001;
+        float NdotH = clamp(dot(n, h), 0.0, 1.0);
+        float LdotH = clamp(dot(l, h), 0.0, 1.0);
+        float VdotH = clamp(dot(v, h), 0.0, 1.0);
+
+        PBRInfo pbrInputs = PBRInfo(
+            NdotL,
+            NdotV,
+            NdotH,
+            LdotH,
+            VdotH,
+            perceptualRoughness,
+            metallic,
+            specularEnvironmentR0,
+            specularEnvironmentR90,
+            alphaRoughness,
+            diffuseColor,
+            specularColor
+        );
+
+        // Calculate the shading terms for the microfacet specular shading model
+        vec3 F = specularReflection(pbrInputs);
+        float G = geometricOcclusion(pbrInputs);
+        float D = microfacetDistribution(pbrInputs);
+
+        // Calculation of analytical lighting contribution
+        vec3 diffuseContrib = (1.0 - F) * diffuse(pbrInputs);
+        vec3 specContrib = F * G * D / (4.0 * NdotL * NdotV);
+        color += attenuation * NdotL * lightColorRange.xyz * (diffuseContrib + specContrib);
+    }
+    return color;
+})"),
+std::make_pair<std::string,std::string>("gbuffer_incl.glsl",R"(// G-buffer layout used by DeferredRenderer (three RGBA8 color attachments without sRGB conversion and a depth attachment)
+//   0: base color (gamma encoded) and occlusion
+//   1: normal (octahedral encoded using 12 bits per component) and metallic
+//   2: emissive (gamma encoded) and perceptual roughness
+// The world space position is reconstructed from depth.
+
+vec2 octahedralEncode(vec3 n){
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 res = n.xy;
+    if (n.z < 0.0){
+        res = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return res;
+}
+
+vec3 octahedralDecode(vec2 e){
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0){
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+vec3 packNormal(vec3 n){
+    vec2 q = floor(clamp(octahedralEncode(n) * 0.5 + 0.5, 0.0, 1.0) * 4095.0 + 0.5);
+    vec2 high = floor(q / 256.0);
+    vec2 low = q - high * 256.0;
+    return vec3(low, high.x * 16.0 + high.y) / 255.0;
+}
+
+vec3 unpackNormal(vec3 p){
+    vec3 b = floor(p * 255.0 + 0.5);
+    float highX = floor(b.z / 16.0);
+    vec2 q = vec2(highX, b.z - highX * 16.0) * 256.0 + b.xy;
+    return octahedralDecode(q / 4095.0 * 2.0 - 1.0);
+}
+
+void writeGBuffer(vec3 baseColor, float occlusion, vec3 normal, float metallic, vec3 emissive, float perceptualRoughness,
+                  out vec4 colorOcclusion, out vec4 normalMetallic, out vec4 emissiveRoughness){
+    colorOcclusion = vec4(pow(baseColor, vec3(1.0/2.2)), occlusion);
+    normalMetallic = vec4(packNormal(normal), metallic);
+    emissiveRoughness = vec4(pow(clamp(emissive, 0.0, 1.0), vec3(1.0/2.2)), perceptualRoughness);
+}
+
+// Reconstructs the world space position from a depth buffer value (in [0.0;1.0]) using g_projection and g_view
+// (the view transform is assumed to be rigid). ndc is the normalized device xy coordinate of the fragment.
+vec3 reconstructPosition(vec2 ndc, float depth){
+    float z = depth * 2.0 - 1.0;
+    vec3 vsPos;
+    if (g_projection[3][3] == 1.0){                     // orthographic
+        vsPos.z = (z - g_projection[3][2]) / g_projection[2][2];
+        vsPos.xy = (ndc - vec2(g_projection[3][0], g_projection[3][1])) / vec2(g_projection[0][0], g_projection[1][1]);
+    } else {
+        vsPos.z = -g_projection[3][2] / (z + g_projection[2][2]);
+        vsPos.xy = (ndc * -vsPos.z - vec2(g_projection[2][0], g_projection[2][1]) * vsPos.z) / vec2(g_projection[0][0], g_projection[1][1]);
+    }
+    return transpose(mat3(g_view)) * (vsPos - g_view[3].xyz);
+})"),
+std::make_pair<std::string,std::string>("deferred_light_vert.glsl",R"(#version 330
+in vec3 position;
+
+void main(void) {
+    gl_Position = vec4(position.xy, 0.0, 1.0);        // full viewport quad
+})"),
+std::make_pair<std::string,std::string>("deferred_light_frag.glsl",R"(#version 330
+out vec4 fragColor;
+
+uniform sampler2D gbufferColorOcclusion;
+uniform sampler2D gbufferNormalMetallic;
+uniform sampler2D gbufferEmissiveRoughness;
+uniform sampler2D gbufferDepth;
+
+#pragma include "global_uniforms_incl.glsl"
+#pragma include "light_incl.glsl"
+#pragma include "pbr_incl.glsl"
+#pragma include "gbuffer_incl.glsl"
+#pragma include "sre_utils_incl.glsl"
+
+void main(void)
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);               // the G-buffer has the same size as the target
+    float depth = texelFetch(gbufferDepth, texel, 0).r;
+    if (depth >= 1.0){
+        discard;                                        // nothing rendered in the G-buffer
+    }
+    vec4 colorOcclusion = texelFetch(gbufferColorOcclusion, texel, 0);
+    vec4 normalMetallic = texelFetch(gbufferNormalMetallic, texel, 0);
+    vec4 emissiveRoughness = texelFetch(gbufferEmissiveRoughness, texel, 0);
+
+    vec3 baseColor = pow(colorOcclusion.rgb, vec3(2.2));
+    vec3 n = unpackNormal(normalMetallic.rgb);
+    float metallic = normalMetallic.a;
+    vec3 emissive = pow(emissiveRoughness.rgb, vec3(2.2));
+    float perceptualRoughness = emissiveRoughness.a;
+
+    vec2 ndc = (gl_FragCoord.xy - g_viewport.zw) / g_viewport.xy * 2.0 - 1.0;
+    vec3 wsPos = reconstructPosition(ndc, depth);
+
+    vec3 f0 = vec3(0.04);
+    vec3 diffuseColor = baseColor * (vec3(1.0) - f0) * (1.0 - metallic);
+    vec3 specularColor = mix(f0, baseColor, metallic);
+    vec3 v = normalize(g_cameraPos.xyz - wsPos);
+
+    vec3 color = baseColor * g_ambientLight.rgb;
+    color += computeLightPBR(wsPos, n, v, diffuseColor, specularColor, perceptualRoughness, metallic);
+    color = color * colorOcclusion.a + emissive;
+
+    gl_FragDepth = depth;                               // allows forward rendering on top of the shaded G-buffer
+    fragColor = toOutput(color, 1.0);
+})"),
+std::make_pair<std::string,std::string>("sprite_instanced_vert.glsl",R"(#version 330
+in vec4 instance_axes;          // xy: edge along the sprite x axis, zw: edge along the sprite y axis
+in vec4 instance_uv;            // xy: uv of the first corner, zw: uv of the opposite corner
+in ivec4 instance_data;         // xy: bits of the first corner position, z: color (RGBA8), w: texture array layer
+out vec2 vUV;
+out vec4 vColor;
+#ifdef S_TEXTURE_ARRAY
+out float vLayer;
+#endif
+
+#pragma include "global_uniforms_incl.glsl"
+
+void main(void) {
+    // the quad is drawn as a triangle strip with the corners (0,0), (1,0), (0,1), (1,1)
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+    vec2 origin = intBitsToFloat(instance_data.xy);
+    vec2 position = origin + instance_axes.xy * corner.x + instance_axes.zw * corner.y;
+    gl_Position = g_projection * g_view * g_model * vec4(position, 0.0, 1.0);
+    vUV = mix(instance_uv.xy, instance_uv.zw, corner);
+    uint color = uint(instance_data.z);
+    vColor = vec4(uvec4(color, color >> 8u, color >> 16u, color >> 24u) & 255u) / 255.0;
+#ifdef S_TEXTURE_ARRAY
+    vLayer = float(instance_data.w);
+#endif
+})"),
+std::make_pair<std::string,std::string>("particles_emit_comp.glsl",R"(#version 430
+// Emits particles into the slots ringStart, ringStart+1, ... (wrapping at maxParticles) of the particle buffer
+layout(local_size_x = 256) in;
+
+struct Particle {
+    vec4 positionAge;                   // xyz: position, w: age in seconds
+    vec4 velocityInvLifetime;           // xyz: velocity, w: 1/lifetime (0 is an unused slot)
+    vec4 rotation;                      // x: rotation, y: angular velocity
+};
+
+layout(std430, binding = 0) buffer ParticleBuffer {
+    Particle particles[];
+};
+
+uniform int ringStart;
+uniform int count;
+uniform int maxParticles;
+uniform uint seed;
+uniform vec3 position;
+uniform vec3 positionSpread;
+uniform vec3 velocity;
+uniform vec3 velocitySpread;
+uniform vec2 lifetime;
+uniform vec2 rotation;
+uniform vec2 angularVelocity;
+
+uint state;
+
+// pcg hash (Jarzynski and Olano, Hash Functions for GPU Rendering)
+float random(){
+    state = state * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return float((word >> 22u) ^ word) * (1.0 / 4294967296.0);
+}
+
+vec3 randomSpread(){
+    return vec3(random(), random(), random()) * 2.0 - 1.0;
+}
+
+void main(void) {
+    int i = int(gl_GlobalInvocationID.x);
+    if (i >= count){
+        return;
+    }
+    state = seed ^ (uint(i) * 2654435761u);
+    int slot = (ringStart + i) % maxParticles;
+    float life = max(mix(lifetime.x, lifetime.y, random()), 0.0001);
+    particles[slot].positionAge = vec4(position + positionSpread * randomSpread(), 0.0);
+    particles[slot].velocityInvLifetime = vec4(velocity + velocitySpread * randomSpread(), 1.0 / life);
+    particles[slot].rotation = vec4(mix(rotation.x, rotation.y, random()), mix(angularVelocity.x, angularVelocity.y, random()), 0.0, 0.0);
+})"),
+std::make_pair<std::string,std::string>("particles_simulate_comp.glsl",R"(#version 430
+// Integrates the particles, writes the vertices of the particle mesh and the depth sort keys
+layout(local_size_x = 256) in;
+
+struct Particle {
+    vec4 positionAge;                   // xyz: position, w: age in seconds
+    vec4 velocityInvLifetime;           // xyz: velocity, w: 1/lifetime (0 is an unused slot)
+    vec4 rotation;                      // x: rotation, y: angular velocity
+};
+
+struct SortEntry {
+    float key;                          // view space depth (dead particles and padding are sorted last)
+    uint index;
+};
+
+layout(std430, binding = 0) buffer ParticleBuffer {
+    Particle particles[];
+};
+
+layout(std430, binding = 1) writeonly buffer VertexBuffer {
+    vec4 vertices[];                    // interleaved mesh layout: position, uv, vertex_color, particleSize
+};
+
+layout(std430, binding = 2) writeonly buffer SortBuffer {
+    SortEntry sortEntries[];
+};
+
+uniform int maxParticles;
+uniform int sortSize;
+uniform float deltaTime;
+uniform vec3 deltaVelocity;             // gravity * deltaTime
+uniform float damping;
+uniform vec4 colorStart;
+uniform vec4 colorDelta;
+uniform float sizeStart;
+uniform float sizeDelta;
+uniform vec4 uv;
+uniform mat4 modelView;
+
+const float deadKey = 3.0e38;
+const float paddingKey = 3.4e38;
+
+void main(void) {
+    int i = int(gl_GlobalInvocationID.x);
+    if (i >= sortSize){
+        return;
+    }
+    if (i >= maxParticles){
+        sortEntries[i] = SortEntry(paddingKey, uint(i));
+        return;
+    }
+    Particle p = particles[i];
+    bool alive = p.velocityInvLifetime.w > 0.0 && p.positionAge.w * p.velocityInvLifetime.w < 1.0;
+    if (alive){
+        vec3 v = (p.velocityInvLifetime.xyz + deltaVelocity) * damping;
+        p.positionAge = vec4(p.positionAge.xyz + v * deltaTime, p.positionAge.w + deltaTime);
+        p.velocityInvLifetime.xyz = v;
+        p.rotation.x += p.rotation.y * deltaTime;
+        particles[i] = p;
+        alive = p.positionAge.w * p.velocityInvLifetime.w < 1.0;
+    }
+    float t = min(p.positionAge.w * p.velocityInvLifetime.w, 1.0);
+    vertices[i*4] = vec4(p.positionAge.xyz, 0.0);
+    vertices[i*4+1] = vec4(uv.xyz, p.rotation.x);
+    vertices[i*4+2] = alive ? colorStart + colorDelta * t : vec4(0.0);
+    vertices[i*4+3] = vec4(alive ? sizeStart + sizeDelta * t : 0.0, 0.0, 0.0, 0.0);
+    sortEntries[i] = SortEntry(alive ? (modelView * vec4(p.positionAge.xyz, 1.0)).z : deadKey, uint(i));
+})"),
+std::make_pair<std::string,std::string>("particles_sort_comp.glsl",R"(#version 430
+// One compare and swap step (k, j) of a bitonic sort of the sort entries in ascending key order (farthest first)
+layout(local_size_x = 256) in;
+
+struct SortEntry {
+    float key;
+    uint index;
+};
+
+layout(std430, binding = 2) buffer SortBuffer {
+    SortEntry sortEntries[];
+};
+
+uniform int k;                          // size of the bitonic sequences being merged
+uniform int j;                          // compare distance
+
+void main(void) {
+    int i = int(gl_GlobalInvocationID.x);
+    int l = i ^ j;
+    if (l <= i || l >= sortEntries.length()){
+        return;
+    }
+    SortEntry a = sortEntries[i];
+    SortEntry b = sortEntries[l];
+    bool ascending = (i & k) == 0;
+    if ((a.key > b.key) == ascending){
+        sortEntries[i] = b;
+        sortEntries[l] = a;
+    }
+})"),
+std::make_pair<std::string,std::string>("particles_indices_comp.glsl",R"(#version 430
+// Writes the sorted particle indices into the index buffer of the particle mesh
+layout(local_size_x = 256) in;
+
+struct SortEntry {
+    float key;
+    uint index;
+};
+
+layout(std430, binding = 2) readonly buffer SortBuffer {
+    SortEntry sortEntries[];
+};
+
+layout(std430, binding = 3) writeonly buffer IndexBuffer {
+    uint indices[];
+};
+
+uniform int maxParticles;
+
+void main(void) {
+    int i = int(gl_GlobalInvocationID.x);
+    if (i >= maxParticles){
+        return;
+    }
+    indices[i] = min(sortEntries[i].index, uint(maxParticles - 1));
+})"),
 };
\ No newline at end of file
@@ -0,0 +1,69 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+namespace sre {
+    class Sprite;
+    class Texture;
+
+    /**
+     * Internal class used by SpriteBatch to sort sprites and expand them into vertices.
+     */
+    class SpriteVertices {
+    public:
+        struct Run {                                    // sprites (in sorted order) rendered with the same texture
+            int first;
+            int count;
+            Texture* texture;
+            glm::vec2 boundsMin;                        // computed by expand()
+            glm::vec2 boundsMax;
+        };
+        struct Task {                                   // part of a run expanded by a worker thread
+            int run;
+            int first;
+            int count;
+            glm::vec2 boundsMin;
+            glm::vec2 boundsMax;
+        };
+
+        // Computes the render order of the sprites (see SpriteBatch) using a stable radix sort on orderInBatch and texture.
+        // The sprites must be stored in draw order (as added to the SpriteBatchBuilder). Sprites with the same
+        // orderInBatch and texture are ordered by the secondary keys (if not null) and then by draw order.
+        static void sort(const std::vector<Sprite>& sprites, std::vector<uint32_t>& order,
+                         std::vector<uint32_t>& keys, std::vector<uint32_t>& tmp,
+                         const std::vector<uint32_t>* secondaryKeys = nullptr);
+
+        // Writes 4 vertices of 3 vec4 (position, uv, vertex_color) per sprite into dst, where the sprites of a run starts
+        // at dst[run.first * 12]. The sprites are processed four at a time using SSE when available, and large batches
+        // are split into tasks executed by the WorkerPool (tasks is scratch memory reused between calls).
+        // When instances is true a single 48 byte instance (instance_axes, instance_uv, instance_data)
+        // is written per sprite instead, starting at dst[run.first * 3] (see Shader::getUnlitSpriteInstanced()).
+        static void expand(const std::vector<Sprite>& sprites, const std::vector<uint32_t>& order,
+                           std::vector<Run>& runs, std::vector<Task>& tasks, glm::vec4* dst, bool instances = false);
+
+        static int vec4PerSprite(bool instances);
+    private:
+        static void radixSort(const uint32_t* keys, std::vector<uint32_t>& order, std::vector<uint32_t>& tmp);
+        struct Quad {                                   // trimmed sprite corners, transform and uv rect
+            float x0, x1, y0, y1;
+            float a, b, c, d;                           // rotation and scale (column major 2x2)
+            float tx, ty;
+            float u0, u1, v0, v1;
+            float layer;
+        };
+        static Quad quad(const Sprite& sprite, glm::vec2 invTextureSize);
+        static void expandRange(const std::vector<Sprite>& sprites, const uint32_t* order, int count,
+                                glm::vec2 invTextureSize, glm::vec4* dst, glm::vec2& boundsMin, glm::vec2& boundsMax);
+        static void expandInstanceRange(const std::vector<Sprite>& sprites, const uint32_t* order, int count,
+                                glm::vec2 invTextureSize, glm::vec4* dst, glm::vec2& boundsMin, glm::vec2& boundsMax);
+    };
+}
@@ -0,0 +1,71 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "sre/Texture.hpp"
+
+namespace sre {
+    /**
+     * Internal class used by Texture::createAsync() and TextureBuilder::withFileAsync().
+     * Image files are decoded (and mipmaps computed, if the texture uses a CPU mipmap filter) on a pool of worker threads. The decoded images are uploaded on the render thread
+     * (in Renderer::swapWindow()) through a pixel unpack buffer, limited by a per-frame byte budget.
+     * When the upload is complete the placeholder texture storage is replaced by the loaded image.
+     */
+    class TextureLoader {
+    public:
+        TextureLoader();
+        ~TextureLoader();
+
+        void load(std::shared_ptr<Texture> texture, const std::string& filename, std::function<void(std::shared_ptr<Texture>)> onLoaded);
+
+        void addCallback(std::shared_ptr<Texture> texture, std::function<void(std::shared_ptr<Texture>)> onLoaded); // invoke onLoaded when the pending texture is loaded
+
+        void update(int byteBudget);                    // upload decoded images. Must be called on the render thread once each frame
+
+        int getPendingCount();                          // number of textures not yet loaded
+    private:
+        struct Job {
+            std::weak_ptr<Texture> texture;
+            std::string filename;
+            std::vector<std::function<void(std::shared_ptr<Texture>)>> onLoaded;
+            Texture::DecodedImage image;
+            Texture::MipmapFilter mipmapFilter = Texture::MipmapFilter::GPU;    // CPU filters are computed on the worker thread
+            bool srgb = true;
+            bool wrap = true;
+            unsigned int textureId = 0;                 // staging texture receiving the uploaded rows
+            int uploadedRows = 0;
+        };
+
+        void workerLoop();
+        static void decode(Job& job);
+        void startUpload(Job& job, Texture* texture);
+        int uploadRows(Job& job, int byteBudget);       // returns number of bytes uploaded
+        void finish(Job& job);
+        static void notify(Job& job, std::shared_ptr<Texture> texture);
+
+        std::mutex mutex;
+        std::condition_variable decodeCondition;
+        std::deque<std::shared_ptr<Job>> decodeQueue;   // guarded by mutex
+        std::deque<std::shared_ptr<Job>> decodedQueue;  // guarded by mutex
+        std::deque<std::shared_ptr<Job>> uploadQueue;   // render thread only
+        std::vector<std::thread> workers;
+        bool stopWorkers = false;
+        int pendingCount = 0;
+
+        unsigned int pixelUnpackBuffer = 0;
+    };
+}
@@ -0,0 +1,35 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace sre {
+    class Texture;
+
+    /**
+     * Keeps the resident mip levels of streaming textures within the memory and upload budgets.
+     */
+    class TextureStreamer {
+    public:
+        void add(Texture* texture);
+        void remove(Texture* texture);
+        bool empty();
+
+        void recordUsage(Texture* texture, float screenSize);          // screenSize is the size of the textured object in pixels
+
+        void update(int64_t memoryBudget, int uploadBudget);           // memoryBudget 0 means unlimited
+
+        int64_t getStreamingBytes();                                    // GPU memory used by streaming textures
+
+        static int getMinimumResidentLevel(Texture* texture);           // lowest resolution kept resident (the level below 64 pixels)
+    private:
+        std::vector<Texture*> textures;
+    };
+}
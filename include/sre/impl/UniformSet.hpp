@@ -45,6 +45,7 @@ namespace sre {
         std::map<int,float> floatValues;
 
         friend class Material;
+        friend class RenderPass;
     };
 
     template<>
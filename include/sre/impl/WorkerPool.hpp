@@ -0,0 +1,63 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace sre {
+    /**
+     * Persistent threads (up to 8 including the calling thread) shared by the parallel loops of the engine.
+     * If the pool is already running a loop (started from another thread or from inside a task) the tasks are executed
+     * on the calling thread instead, so the threads are never oversubscribed.
+     */
+    class WorkerPool {
+    public:
+        static WorkerPool& instance();
+        ~WorkerPool();
+
+        template<typename F>
+        void parallelFor(int taskCount, F&& task);      // executes task(0) ... task(taskCount-1) and waits for the tasks
+
+        int getThreadCount();                           // including the calling thread
+    private:
+        using Invoke = void (*)(void* context, int task);
+
+        WorkerPool();
+        void run(int taskCount, Invoke invoke, void* context);
+        void execute();
+        void work();
+
+        std::vector<std::thread> threads;
+        std::mutex runMutex;                            // held while a loop is running
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        uint64_t generation = 0;
+        int pending = 0;                                // workers which have not finished the current loop
+        bool quit = false;
+
+        Invoke invoke = nullptr;
+        void* context = nullptr;
+        int taskCount = 0;
+        std::atomic<int> nextTask;
+    };
+
+    template<typename F>
+    void WorkerPool::parallelFor(int taskCount, F&& task) {
+        using Task = typename std::remove_reference<F>::type;
+        run(taskCount, [](void* context, int t){
+            (*static_cast<Task*>(context))(t);
+        }, (void*)&task);
+    }
+}
@@ -0,0 +1,46 @@
+#version 330
+out vec4 fragColor;
+
+uniform sampler2D gbufferColorOcclusion;
+uniform sampler2D gbufferNormalMetallic;
+uniform sampler2D gbufferEmissiveRoughness;
+uniform sampler2D gbufferDepth;
+
+#pragma include "global_uniforms_incl.glsl"
+#pragma include "light_incl.glsl"
+#pragma include "pbr_incl.glsl"
+#pragma include "gbuffer_incl.glsl"
+#pragma include "sre_utils_incl.glsl"
+
+void main(void)
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);               // the G-buffer has the same size as the target
+    float depth = texelFetch(gbufferDepth, texel, 0).r;
+    if (depth >= 1.0){
+        discard;                                        // nothing rendered in the G-buffer
+    }
+    vec4 colorOcclusion = texelFetch(gbufferColorOcclusion, texel, 0);
+    vec4 normalMetallic = texelFetch(gbufferNormalMetallic, texel, 0);
+    vec4 emissiveRoughness = texelFetch(gbufferEmissiveRoughness, texel, 0);
+
+    vec3 baseColor = pow(colorOcclusion.rgb, vec3(2.2));
+    vec3 n = unpackNormal(normalMetallic.rgb);
+    float metallic = normalMetallic.a;
+    vec3 emissive = pow(emissiveRoughness.rgb, vec3(2.2));
+    float perceptualRoughness = emissiveRoughness.a;
+
+    vec2 ndc = (gl_FragCoord.xy - g_viewport.zw) / g_viewport.xy * 2.0 - 1.0;
+    vec3 wsPos = reconstructPosition(ndc, depth);
+
+    vec3 f0 = vec3(0.04);
+    vec3 diffuseColor = baseColor * (vec3(1.0) - f0) * (1.0 - metallic);
+    vec3 specularColor = mix(f0, baseColor, metallic);
+    vec3 v = normalize(g_cameraPos.xyz - wsPos);
+
+    vec3 color = baseColor * g_ambientLight.rgb;
+    color += computeLightPBR(wsPos, n, v, diffuseColor, specularColor, perceptualRoughness, metallic);
+    color = color * colorOcclusion.a + emissive;
+
+    gl_FragDepth = depth;                               // allows forward rendering on top of the shaded G-buffer
+    fragColor = toOutput(color, 1.0);
+}
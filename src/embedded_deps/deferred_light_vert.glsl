@@ -0,0 +1,6 @@
+#version 330
+in vec3 position;
+
+void main(void) {
+    gl_Position = vec4(position.xy, 0.0, 1.0);        // full viewport quad
+}
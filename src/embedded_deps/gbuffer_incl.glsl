@@ -0,0 +1,58 @@
+// G-buffer layout used by DeferredRenderer (three RGBA8 color attachments without sRGB conversion and a depth attachment)
+//   0: base color (gamma encoded) and occlusion
+//   1: normal (octahedral encoded using 12 bits per component) and metallic
+//   2: emissive (gamma encoded) and perceptual roughness
+// The world space position is reconstructed from depth.
+
+vec2 octahedralEncode(vec3 n){
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 res = n.xy;
+    if (n.z < 0.0){
+        res = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return res;
+}
+
+vec3 octahedralDecode(vec2 e){
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0){
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+vec3 packNormal(vec3 n){
+    vec2 q = floor(clamp(octahedralEncode(n) * 0.5 + 0.5, 0.0, 1.0) * 4095.0 + 0.5);
+    vec2 high = floor(q / 256.0);
+    vec2 low = q - high * 256.0;
+    return vec3(low, high.x * 16.0 + high.y) / 255.0;
+}
+
+vec3 unpackNormal(vec3 p){
+    vec3 b = floor(p * 255.0 + 0.5);
+    float highX = floor(b.z / 16.0);
+    vec2 q = vec2(highX, b.z - highX * 16.0) * 256.0 + b.xy;
+    return octahedralDecode(q / 4095.0 * 2.0 - 1.0);
+}
+
+void writeGBuffer(vec3 baseColor, float occlusion, vec3 normal, float metallic, vec3 emissive, float perceptualRoughness,
+                  out vec4 colorOcclusion, out vec4 normalMetallic, out vec4 emissiveRoughness){
+    colorOcclusion = vec4(pow(baseColor, vec3(1.0/2.2)), occlusion);
+    normalMetallic = vec4(packNormal(normal), metallic);
+    emissiveRoughness = vec4(pow(clamp(emissive, 0.0, 1.0), vec3(1.0/2.2)), perceptualRoughness);
+}
+
+// Reconstructs the world space position from a depth buffer value (in [0.0;1.0]) using g_projection and g_view
+// (the view transform is assumed to be rigid). ndc is the normalized device xy coordinate of the fragment.
+vec3 reconstructPosition(vec2 ndc, float depth){
+    float z = depth * 2.0 - 1.0;
+    vec3 vsPos;
+    if (g_projection[3][3] == 1.0){                     // orthographic
+        vsPos.z = (z - g_projection[3][2]) / g_projection[2][2];
+        vsPos.xy = (ndc - vec2(g_projection[3][0], g_projection[3][1])) / vec2(g_projection[0][0], g_projection[1][1]);
+    } else {
+        vsPos.z = -g_projection[3][2] / (z + g_projection[2][2]);
+        vsPos.xy = (ndc * -vsPos.z - vec2(g_projection[2][0], g_projection[2][1]) * vsPos.z) / vec2(g_projection[0][0], g_projection[1][1]);
+    }
+    return transpose(mat3(g_view)) * (vsPos - g_view[3].xyz);
+}
@@ -1,5 +1,10 @@
 #ifdef S_SHADOW
+#ifdef S_SHADOW_CASCADES
+uniform mat4 shadowViewProjOffsets[S_SHADOW_CASCADES]; // world space to texture coordinates of each cascade (see ShadowMap)
+uniform vec4 shadowCascadeSplits;                   // view space far distance of each cascade
+#else
 in vec4 vShadowmapCoord;
+#endif
 #ifdef GL_ES
 #ifdef SI_FBO_DEPTH_ATTACHMENT
 #ifdef GL_FRAGMENT_PRECISION_HIGH
@@ -23,6 +28,53 @@ uniform sampler2D shadowMap;
 #endif
 #endif
 
+#if defined(S_CLUSTERED_LIGHTS) && __VERSION__ <= 100
+#undef S_CLUSTERED_LIGHTS                           // clustered lights requires integer textures (OpenGL 3.3 / OpenGL ES 3.0)
+#endif
+#ifdef S_CLUSTERED_LIGHTS
+#ifdef GL_ES
+uniform highp sampler2D g_clusterLights;            // light i is stored as lightPosType and lightColorRange in texel 2i and 2i+1
+uniform highp usampler2D g_clusterGrid;             // offset and count into g_clusterLightIndices for each cluster
+uniform highp usampler2D g_clusterLightIndices;
+#else
+uniform sampler2D g_clusterLights;
+uniform usampler2D g_clusterGrid;
+uniform usampler2D g_clusterLightIndices;
+#endif
+uniform vec4 g_clusterSize;                         // tiles x, tiles y, depth slices, number of unclustered lights
+uniform vec4 g_clusterDepth;                        // depth slice scale, depth slice bias, unused, orthographic (1.0) or perspective (0.0)
+
+ivec2 clusterTexel(int index){
+    const int clusterTextureWidth = 1024;
+    return ivec2(index % clusterTextureWidth, index / clusterTextureWidth);
+}
+
+// returns offset and count of the light indices in the cluster containing the fragment
+ivec2 clusterLightRange(vec3 wsPos){
+    float depth = -(g_view * vec4(wsPos, 1.0)).z;
+    float slice = g_clusterDepth.w > 0.5 ? depth * g_clusterDepth.x + g_clusterDepth.y : log(max(depth, 0.0001)) * g_clusterDepth.x + g_clusterDepth.y;
+    vec2 tile = (gl_FragCoord.xy - g_viewport.zw) / g_viewport.xy * g_clusterSize.xy;
+    ivec3 cluster = ivec3(clamp(vec3(tile, slice), vec3(0.0), g_clusterSize.xyz - 1.0));
+    int clusterIndex = cluster.x + (cluster.y + cluster.z * int(g_clusterSize.y)) * int(g_clusterSize.x);
+    return ivec2(texelFetch(g_clusterGrid, clusterTexel(clusterIndex), 0).xy);
+}
+
+int clusterLightCount(ivec2 lightRange){
+    return int(g_clusterSize.w) + lightRange.y;
+}
+
+// the unclustered lights (directional lights and point lights without range) are followed by the lights of the cluster
+void clusterLight(ivec2 lightRange, int index, out vec4 lightPosType, out vec4 lightColorRange){
+    int unclusteredLights = int(g_clusterSize.w);
+    int i = index;
+    if (index >= unclusteredLights){
+        i = int(texelFetch(g_clusterLightIndices, clusterTexel(lightRange.x + index - unclusteredLights), 0).x);
+    }
+    lightPosType = texelFetch(g_clusterLights, clusterTexel(i*2), 0);
+    lightColorRange = texelFetch(g_clusterLights, clusterTexel(i*2+1), 0);
+}
+#endif
+
 in vec4 vLightDir[SI_LIGHTS];
 
 uniform vec4 specularity;
@@ -34,8 +86,30 @@ float unpackDepth(const in vec4 rgba_depth)
     return depth;
 }
 
-float getShadow() {                                 // returns 0.0 if in shadow and 1.0 if fully lit
+float getShadow(vec3 wsPos) {                        // returns 0.0 if in shadow and 1.0 if fully lit
 #ifdef S_SHADOW
+#ifdef S_SHADOW_CASCADES
+    // the cascades are placed side by side in the shadow map
+    float depth = -(g_view * vec4(wsPos, 1.0)).z;
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0));
+    for (int i=0;i<S_SHADOW_CASCADES;i++){
+        if (depth > shadowCascadeSplits[i]){
+            continue;
+        }
+        vec3 coord = (shadowViewProjOffsets[i] * vec4(wsPos, 1.0)).xyz; // orthographic projection
+        if (any(lessThan(coord, vec3(0.0))) || any(greaterThan(coord, vec3(1.0)))){
+            continue;                                   // outside cascade - use the next cascade
+        }
+        coord.x = clamp(coord.x, texelSize.x * float(S_SHADOW_CASCADES), 1.0 - texelSize.x * float(S_SHADOW_CASCADES));
+        coord.x = (coord.x + float(i)) / float(S_SHADOW_CASCADES);
+#ifndef SI_FBO_DEPTH_ATTACHMENT
+        return unpackDepth(texture(shadowMap, coord.xy)) > coord.z ? 1.0 : 0.0;
+#else
+        return texture(shadowMap, coord);               // compare .z with shadow map depth
+#endif
+    }
+    return 1.0;
+#else
 #ifdef GL_ES
     if (vShadowmapCoord.x < 0.0 || vShadowmapCoord.y < 0.0 || vShadowmapCoord.x > vShadowmapCoord.w || vShadowmapCoord.y > vShadowmapCoord.w ){
         return 1.0;
@@ -49,6 +123,7 @@ float getShadow() {                                 // returns 0.0 if in shadow
 #else
     return textureProj(shadowMap, vShadowmapCoord); // performs w division and compare .z with current depth
 #endif
+#endif
 #else
     return 0.0;
 #endif
@@ -63,7 +138,7 @@ void lightDirectionAndAttenuation(vec4 lightPosType, float lightRange, vec3 pos,
         attenuation = 1.0;
 #ifdef S_SHADOW
         if (shadow){
-            attenuation = getShadow();
+            attenuation = getShadow(pos);
         }
 #endif
     } else if (isPoint) {
@@ -89,10 +164,21 @@ vec3 computeLightBlinnPhong(vec3 wsPos, vec3 wsCameraPos, vec3 normal, out vec3
     specularityOut = vec3(0.0, 0.0, 0.0);
     vec3 lightColor = vec3(0.0,0.0,0.0);
     vec3 cam = normalize(wsCameraPos - wsPos);
+#ifdef S_CLUSTERED_LIGHTS
+    ivec2 lightRange = clusterLightRange(wsPos);
+    int lightCount = clusterLightCount(lightRange);
+    for (int i=0;i<lightCount;i++){
+        vec4 lightPosType;
+        vec4 lightColorRange;
+        clusterLight(lightRange, i, lightPosType, lightColorRange);
+#else
     for (int i=0;i<SI_LIGHTS;i++){
+        vec4 lightPosType = g_lightPosType[i];
+        vec4 lightColorRange = g_lightColorRange[i];
+#endif
         vec3 lightDirection = vec3(0.0,0.0,0.0);
         float att = 0.0;
-        lightDirectionAndAttenuation(g_lightPosType[i], g_lightColorRange[i].w, wsPos,i==0, lightDirection, att);
+        lightDirectionAndAttenuation(lightPosType, lightColorRange.w, wsPos,i==0, lightDirection, att);
 
         if (att <= 0.0){
             continue;
@@ -101,7 +187,7 @@ vec3 computeLightBlinnPhong(vec3 wsPos, vec3 wsCameraPos, vec3 normal, out vec3
         // diffuse light
         float diffuse = dot(lightDirection, normal);
         if (diffuse > 0.0){
-            lightColor += (att * diffuse) * g_lightColorRange[i].xyz;
+            lightColor += (att * diffuse) * lightColorRange.xyz;
         }
 
         // specular light
@@ -123,10 +209,21 @@ vec3 computeLightPhong(vec3 wsPos, vec3 wsCameraPos, vec3 normal, out vec3 specu
     specularityOut = vec3(0.0, 0.0, 0.0);
     vec3 lightColor = vec3(0.0,0.0,0.0);
     vec3 cam = normalize(wsCameraPos - wsPos);
+#ifdef S_CLUSTERED_LIGHTS
+    ivec2 lightRange = clusterLightRange(wsPos);
+    int lightCount = clusterLightCount(lightRange);
+    for (int i=0;i<lightCount;i++){
+        vec4 lightPosType;
+        vec4 lightColorRange;
+        clusterLight(lightRange, i, lightPosType, lightColorRange);
+#else
     for (int i=0;i<SI_LIGHTS;i++){
+        vec4 lightPosType = g_lightPosType[i];
+        vec4 lightColorRange = g_lightColorRange[i];
+#endif
         vec3 lightDirection = vec3(0.0,0.0,0.0);
         float att = 0.0;
-        lightDirectionAndAttenuation(g_lightPosType[i], g_lightColorRange[i].w, wsPos, i==0, lightDirection, att);
+        lightDirectionAndAttenuation(lightPosType, lightColorRange.w, wsPos, i==0, lightDirection, att);
 
         if (att <= 0.0){
             continue;
@@ -135,7 +232,7 @@ vec3 computeLightPhong(vec3 wsPos, vec3 wsCameraPos, vec3 normal, out vec3 specu
         // diffuse light
         float diffuse = dot(lightDirection, normal);
         if (diffuse > 0.0){
-            lightColor += (att * diffuse) * g_lightColorRange[i].xyz;
+            lightColor += (att * diffuse) * lightColorRange.xyz;
         }
 
         // specular light
@@ -0,0 +1,51 @@
+#version 430
+// Emits particles into the slots ringStart, ringStart+1, ... (wrapping at maxParticles) of the particle buffer
+layout(local_size_x = 256) in;
+
+struct Particle {
+    vec4 positionAge;                   // xyz: position, w: age in seconds
+    vec4 velocityInvLifetime;           // xyz: velocity, w: 1/lifetime (0 is an unused slot)
+    vec4 rotation;                      // x: rotation, y: angular velocity
+};
+
+layout(std430, binding = 0) buffer ParticleBuffer {
+    Particle particles[];
+};
+
+uniform int ringStart;
+uniform int count;
+uniform int maxParticles;
+uniform uint seed;
+uniform vec3 position;
+uniform vec3 positionSpread;
+uniform vec3 velocity;
+uniform vec3 velocitySpread;
+uniform vec2 lifetime;
+uniform vec2 rotation;
+uniform vec2 angularVelocity;
+
+uint state;
+
+// pcg hash (Jarzynski and Olano, Hash Functions for GPU Rendering)
+float random(){
+    state = state * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return float((word >> 22u) ^ word) * (1.0 / 4294967296.0);
+}
+
+vec3 randomSpread(){
+    return vec3(random(), random(), random()) * 2.0 - 1.0;
+}
+
+void main(void) {
+    int i = int(gl_GlobalInvocationID.x);
+    if (i >= count){
+        return;
+    }
+    state = seed ^ (uint(i) * 2654435761u);
+    int slot = (ringStart + i) % maxParticles;
+    float life = max(mix(lifetime.x, lifetime.y, random()), 0.0001);
+    particles[slot].positionAge = vec4(position + positionSpread * randomSpread(), 0.0);
+    particles[slot].velocityInvLifetime = vec4(velocity + velocitySpread * randomSpread(), 1.0 / life);
+    particles[slot].rotation = vec4(mix(rotation.x, rotation.y, random()), mix(angularVelocity.x, angularVelocity.y, random()), 0.0, 0.0);
+}
\ No newline at end of file
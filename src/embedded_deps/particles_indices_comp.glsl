@@ -0,0 +1,26 @@
+#version 430
+// Writes the sorted particle indices into the index buffer of the particle mesh
+layout(local_size_x = 256) in;
+
+struct SortEntry {
+    float key;
+    uint index;
+};
+
+layout(std430, binding = 2) readonly buffer SortBuffer {
+    SortEntry sortEntries[];
+};
+
+layout(std430, binding = 3) writeonly buffer IndexBuffer {
+    uint indices[];
+};
+
+uniform int maxParticles;
+
+void main(void) {
+    int i = int(gl_GlobalInvocationID.x);
+    if (i >= maxParticles){
+        return;
+    }
+    indices[i] = min(sortEntries[i].index, uint(maxParticles - 1));
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#version 430
+// Integrates the particles, writes the vertices of the particle mesh and the depth sort keys
+layout(local_size_x = 256) in;
+
+struct Particle {
+    vec4 positionAge;                   // xyz: position, w: age in seconds
+    vec4 velocityInvLifetime;           // xyz: velocity, w: 1/lifetime (0 is an unused slot)
+    vec4 rotation;                      // x: rotation, y: angular velocity
+};
+
+struct SortEntry {
+    float key;                          // view space depth (dead particles and padding are sorted last)
+    uint index;
+};
+
+layout(std430, binding = 0) buffer ParticleBuffer {
+    Particle particles[];
+};
+
+layout(std430, binding = 1) writeonly buffer VertexBuffer {
+    vec4 vertices[];                    // interleaved mesh layout: position, uv, vertex_color, particleSize
+};
+
+layout(std430, binding = 2) writeonly buffer SortBuffer {
+    SortEntry sortEntries[];
+};
+
+uniform int maxParticles;
+uniform int sortSize;
+uniform float deltaTime;
+uniform vec3 deltaVelocity;             // gravity * deltaTime
+uniform float damping;
+uniform vec4 colorStart;
+uniform vec4 colorDelta;
+uniform float sizeStart;
+uniform float sizeDelta;
+uniform vec4 uv;
+uniform mat4 modelView;
+
+const float deadKey = 3.0e38;
+const float paddingKey = 3.4e38;
+
+void main(void) {
+    int i = int(gl_GlobalInvocationID.x);
+    if (i >= sortSize){
+        return;
+    }
+    if (i >= maxParticles){
+        sortEntries[i] = SortEntry(paddingKey, uint(i));
+        return;
+    }
+    Particle p = particles[i];
+    bool alive = p.velocityInvLifetime.w > 0.0 && p.positionAge.w * p.velocityInvLifetime.w < 1.0;
+    if (alive){
+        vec3 v = (p.velocityInvLifetime.xyz + deltaVelocity) * damping;
+        p.positionAge = vec4(p.positionAge.xyz + v * deltaTime, p.positionAge.w + deltaTime);
+        p.velocityInvLifetime.xyz = v;
+        p.rotation.x += p.rotation.y * deltaTime;
+        particles[i] = p;
+        alive = p.positionAge.w * p.velocityInvLifetime.w < 1.0;
+    }
+    float t = min(p.positionAge.w * p.velocityInvLifetime.w, 1.0);
+    vertices[i*4] = vec4(p.positionAge.xyz, 0.0);
+    vertices[i*4+1] = vec4(uv.xyz, p.rotation.x);
+    vertices[i*4+2] = alive ? colorStart + colorDelta * t : vec4(0.0);
+    vertices[i*4+3] = vec4(alive ? sizeStart + sizeDelta * t : 0.0, 0.0, 0.0, 0.0);
+    sortEntries[i] = SortEntry(alive ? (modelView * vec4(p.positionAge.xyz, 1.0)).z : deadKey, uint(i));
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#version 430
+// One compare and swap step (k, j) of a bitonic sort of the sort entries in ascending key order (farthest first)
+layout(local_size_x = 256) in;
+
+struct SortEntry {
+    float key;
+    uint index;
+};
+
+layout(std430, binding = 2) buffer SortBuffer {
+    SortEntry sortEntries[];
+};
+
+uniform int k;                          // size of the bitonic sequences being merged
+uniform int j;                          // compare distance
+
+void main(void) {
+    int i = int(gl_GlobalInvocationID.x);
+    int l = i ^ j;
+    if (l <= i || l >= sortEntries.length()){
+        return;
+    }
+    SortEntry a = sortEntries[i];
+    SortEntry b = sortEntries[l];
+    bool ascending = (i & k) == 0;
+    if ((a.key > b.key) == ascending){
+        sortEntries[i] = b;
+        sortEntries[l] = a;
+    }
+}
\ No newline at end of file
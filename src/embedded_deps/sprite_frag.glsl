@@ -2,13 +2,25 @@
 out vec4 fragColor;
 in vec2 vUV;
 in vec4 vColor;
-
+#ifdef S_TEXTURE_ARRAY
+in float vLayer;
+#ifdef GL_ES
+uniform mediump sampler2DArray tex;
+#else
+uniform sampler2DArray tex;
+#endif
+#else
 uniform sampler2D tex;
+#endif
 
 #pragma include "sre_utils_incl.glsl"
 
 void main(void)
 {
+#ifdef S_TEXTURE_ARRAY
+    fragColor = vColor * toLinear(texture(tex, vec3(vUV, vLayer)));
+#else
     fragColor = vColor * toLinear(texture(tex, vUV));
+#endif
     fragColor = toOutput(fragColor);
 }
\ No newline at end of file
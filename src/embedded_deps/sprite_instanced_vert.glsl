@@ -0,0 +1,25 @@
+#version 330
+in vec4 instance_axes;          // xy: edge along the sprite x axis, zw: edge along the sprite y axis
+in vec4 instance_uv;            // xy: uv of the first corner, zw: uv of the opposite corner
+in ivec4 instance_data;         // xy: bits of the first corner position, z: color (RGBA8), w: texture array layer
+out vec2 vUV;
+out vec4 vColor;
+#ifdef S_TEXTURE_ARRAY
+out float vLayer;
+#endif
+
+#pragma include "global_uniforms_incl.glsl"
+
+void main(void) {
+    // the quad is drawn as a triangle strip with the corners (0,0), (1,0), (0,1), (1,1)
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+    vec2 origin = intBitsToFloat(instance_data.xy);
+    vec2 position = origin + instance_axes.xy * corner.x + instance_axes.zw * corner.y;
+    gl_Position = g_projection * g_view * g_model * vec4(position, 0.0, 1.0);
+    vUV = mix(instance_uv.xy, instance_uv.zw, corner);
+    uint color = uint(instance_data.z);
+    vColor = vec4(uvec4(color, color >> 8u, color >> 16u, color >> 24u) & 255u) / 255.0;
+#ifdef S_TEXTURE_ARRAY
+    vLayer = float(instance_data.w);
+#endif
+}
\ No newline at end of file
@@ -4,6 +4,9 @@ in vec4 uv;
 in vec4 vertex_color;
 out vec2 vUV;
 out vec4 vColor;
+#ifdef S_TEXTURE_ARRAY
+out float vLayer;
+#endif
 
 #pragma include "global_uniforms_incl.glsl"
 
@@ -11,4 +14,7 @@ void main(void) {
     gl_Position = g_projection * g_view * g_model * vec4(position,1.0);
     vUV = uv.xy;
     vColor = vertex_color;
+#ifdef S_TEXTURE_ARRAY
+    vLayer = uv.z;
+#endif
 }
\ No newline at end of file
@@ -1,7 +1,13 @@
 #version 330
 #extension GL_EXT_shader_texture_lod: enable
 #extension GL_OES_standard_derivatives : enable
+#ifdef S_GBUFFER
+layout(location = 0) out vec4 fragColor;                // base color and occlusion (see gbuffer_incl.glsl)
+layout(location = 1) out vec4 gbufferNormalMetallic;
+layout(location = 2) out vec4 gbufferEmissiveRoughness;
+#else
 out vec4 fragColor;
+#endif
 #if defined(S_TANGENTS) && defined(S_NORMALMAP)
 in mat3 vTBN;
 #else
@@ -36,71 +42,11 @@ in vec4 vColor;
 #pragma include "global_uniforms_incl.glsl"
 #pragma include "normalmap_incl.glsl"
 #pragma include "light_incl.glsl"
+#pragma include "pbr_incl.glsl"
+#pragma include "gbuffer_incl.glsl"
 #pragma include "sre_utils_incl.glsl"
 
 
-// Encapsulate the various inputs used by the various functions in the shading equation
-// We store values in this struct to simplify the integration of alternative implementations
-// of the shading terms, outlined in the Readme.MD Appendix.
-struct PBRInfo
-{
-    float NdotL;                  // cos angle between normal and light direction
-    float NdotV;                  // cos angle between normal and view direction
-    float NdotH;                  // cos angle between normal and half vector
-    float LdotH;                  // cos angle between light direction and half vector
-    float VdotH;                  // cos angle between view direction and half vector
-    float perceptualRoughness;    // roughness value, as authored by the model creator (input to shader)
-    float metalness;              // metallic value at the surface
-    vec3 reflectance0;            // full reflectance color (normal incidence angle)
-    vec3 reflectance90;           // reflectance color at grazing angle
-    float alphaRoughness;         // roughness mapped to a more linear change in the roughness (proposed by [2])
-    vec3 diffuseColor;            // color contribution from diffuse lighting
-    vec3 specularColor;           // color contribution from specular lighting
-};
-
-const float M_PI = 3.141592653589793;
-const float c_MinRoughness = 0.04;
-
-// The following equation models the Fresnel reflectance term of the spec equation (aka F())
-// Implementation of fresnel from [4], Equation 15
-vec3 specularReflection(PBRInfo pbrInputs)
-{
-    return pbrInputs.reflectance0 + (pbrInputs.reflectance90 - pbrInputs.reflectance0) * pow(clamp(1.0 - pbrInputs.VdotH, 0.0, 1.0), 5.0);
-}
-
-// Basic Lambertian diffuse
-// Implementation from Lambert's Photometria https://archive.org/details/lambertsphotome00lambgoog
-// See also [1], Equation 1
-vec3 diffuse(PBRInfo pbrInputs)
-{
-    return pbrInputs.diffuseColor / M_PI;
-}
-
-// This calculates the specular geometric attenuation (aka G()),
-// where rougher material will reflect less light back to the viewer.
-// This implementation is based on [1] Equation 4, and we adopt their modifications to
-// alphaRoughness as input as originally proposed in [2].
-float geometricOcclusion(PBRInfo pbrInputs)
-{
-    float NdotL = pbrInputs.NdotL;
-    float NdotV = pbrInputs.NdotV;
-    float r = pbrInputs.alphaRoughness;
-
-    float attenuationL = 2.0 * NdotL / (NdotL + sqrt(r * r + (1.0 - r * r) * (NdotL * NdotL)));
-    float attenuationV = 2.0 * NdotV / (NdotV + sqrt(r * r + (1.0 - r * r) * (NdotV * NdotV)));
-    return attenuationL * attenuationV;
-}
-
-// The following equation(s) model the distribution of microfacet normals across the area being drawn (aka D())
-// Implementation from "Average Irregularity Representation of a Roughened Surface for Ray Reflection" by T. S. Trowbridge, and K. P. Reitz
-// Follows the distribution function recommended in the SIGGRAPH 2013 course notes from EPIC Games [1], Equation 3.
-float microfacetDistribution(PBRInfo pbrInputs)
-{
-    float roughnessSq = pbrInputs.alphaRoughness * pbrInputs.alphaRoughness;
-    float f = (pbrInputs.NdotH * roughnessSq - pbrInputs.NdotH) * pbrInputs.NdotH + 1.0;
-    return roughnessSq / (M_PI * f * f);
-}
-
 void main(void)
 {
     float perceptualRoughness = metallicRoughness.y;
@@ -115,10 +61,6 @@ void main(void)
 #endif
     perceptualRoughness = clamp(perceptualRoughness, c_MinRoughness, 1.0);
     metallic = clamp(metallic, 0.0, 1.0);
-    // Roughness is authored as perceptual roughness; as is convention,
-    // convert to material roughness by squaring the perceptual roughness [2].
-    float alphaRoughness = perceptualRoughness * perceptualRoughness;
-
 #ifndef S_NO_BASECOLORMAP
     vec4 baseColor = toLinear(texture(tex, vUV)) * color;
 #else
@@ -133,70 +75,26 @@ void main(void)
     diffuseColor *= 1.0 - metallic;
 
     vec3 specularColor = mix(f0, baseColor.rgb, metallic);
-
-    // Compute reflectance.
-    float reflectance = max(max(specularColor.r, specularColor.g), specularColor.b);
-
-    // For typical incident reflectance range (between 4% to 100%) set the grazing reflectance to 100% for typical fresnel effect.
-    // For very low reflectance range on highly diffuse objects (below 4%), incrementally reduce grazing reflectance to 0%.
-    float reflectance90 = clamp(reflectance * 25.0, 0.0, 1.0);
-    vec3 specularEnvironmentR0 = specularColor.rgb;
-    vec3 specularEnvironmentR90 = vec3(1.0, 1.0, 1.0) * reflectance90;
-    vec3 color = baseColor.rgb * g_ambientLight.rgb;      // non pbr
     vec3 n = getNormal();                             // Normal at surface point
-    vec3 v = normalize(g_cameraPos.xyz - vWsPos.xyz); // Vector from surface point to camera
-    for (int i=0;i<SI_LIGHTS;i++) {
-        float attenuation = 0.0;
-        vec3 l = vec3(0.0,0.0,0.0);
-        lightDirectionAndAttenuation(g_lightPosType[i], g_lightColorRange[i].w, vWsPos, i==0, l, attenuation);
-        if (attenuation <= 0.0){
-            continue;
-        }
-
-        vec3 h = normalize(l+v);                          // Half vector between both l and v
-        vec3 reflection = -normalize(reflect(v, n));
-
-        float NdotL = clamp(dot(n, l), 0.0001, 1.0);
-        float NdotV = abs(dot(n, v)) + 0.0001;
-        float NdotH = clamp(dot(n, h), 0.0, 1.0);
-        float LdotH = clamp(dot(l, h), 0.0, 1.0);
-        float VdotH = clamp(dot(v, h), 0.0, 1.0);
-
-        PBRInfo pbrInputs = PBRInfo(
-            NdotL,
-            NdotV,
-            NdotH,
-            LdotH,
-            VdotH,
-            perceptualRoughness,
-            metallic,
-            specularEnvironmentR0,
-            specularEnvironmentR90,
-            alphaRoughness,
-            diffuseColor,
-            specularColor
-        );
-
-        // Calculate the shading terms for the microfacet specular shading model
-        vec3 F = specularReflection(pbrInputs);
-        float G = geometricOcclusion(pbrInputs);
-        float D = microfacetDistribution(pbrInputs);
-
-        // Calculation of analytical lighting contribution
-        vec3 diffuseContrib = (1.0 - F) * diffuse(pbrInputs);
-        vec3 specContrib = F * G * D / (4.0 * NdotL * NdotV);
-        color += attenuation * NdotL * g_lightColorRange[i].xyz * (diffuseContrib + specContrib);
-    }
 
     // Apply optional PBR terms for additional (optional) shading
+    float occlusion = 1.0;
 #ifdef S_OCCLUSIONMAP
-    float ao = texture(occlusionTex, vUV).r;
-    color = mix(color, color * ao, occlusionStrength);
+    occlusion = mix(1.0, texture(occlusionTex, vUV).r, occlusionStrength);
 #endif
+    vec3 emissive = vec3(0.0);
 #ifdef S_EMISSIVEMAP
-    vec3 emissive = toLinear(texture(emissiveTex, vUV)).rgb * emissiveFactor.xyz;
-    color += emissive;
+    emissive = toLinear(texture(emissiveTex, vUV)).rgb * emissiveFactor.xyz;
 #endif
 
+#ifdef S_GBUFFER
+    writeGBuffer(baseColor.rgb, occlusion, n, metallic, emissive, perceptualRoughness, fragColor, gbufferNormalMetallic, gbufferEmissiveRoughness);
+#else
+    vec3 v = normalize(g_cameraPos.xyz - vWsPos.xyz); // Vector from surface point to camera
+    vec3 color = baseColor.rgb * g_ambientLight.rgb;      // non pbr
+    color += computeLightPBR(vWsPos, n, v, diffuseColor, specularColor, perceptualRoughness, metallic);
+    color = color * occlusion + emissive;
+
     fragColor = toOutput(color,baseColor.a);
+#endif
 }
\ No newline at end of file
@@ -14,7 +14,7 @@ out vec4 vColor;
 #endif
 out vec2 vUV;
 out vec3 vWsPos;
-#ifdef S_SHADOW
+#if defined(S_SHADOW) && !defined(S_SHADOW_CASCADES)
 uniform mat4 shadowViewProjOffset;
 out vec4 vShadowmapCoord;
 #endif
@@ -36,7 +36,7 @@ void main(void) {
 #ifdef S_VERTEX_COLOR
     vColor = vertex_color;
 #endif
-#ifdef S_SHADOW
+#if defined(S_SHADOW) && !defined(S_SHADOW_CASCADES)
     vShadowmapCoord = shadowViewProjOffset * wsPos;
 #endif
 }
\ No newline at end of file
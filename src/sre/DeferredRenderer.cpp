@@ -0,0 +1,139 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/DeferredRenderer.hpp"
+
+#include "sre/Framebuffer.hpp"
+#include "sre/Texture.hpp"
+#include "sre/Material.hpp"
+#include "sre/Mesh.hpp"
+#include "sre/Shader.hpp"
+#include "sre/Renderer.hpp"
+#include "sre/Log.hpp"
+#include "sre/impl/GL.hpp"
+
+namespace sre {
+    DeferredRenderer::DeferredRendererBuilder DeferredRenderer::create() {
+        return DeferredRendererBuilder();
+    }
+
+    DeferredRenderer::DeferredRendererBuilder &DeferredRenderer::DeferredRendererBuilder::withSize(glm::ivec2 size) {
+        this->size = size;
+        return *this;
+    }
+
+    DeferredRenderer::DeferredRendererBuilder &DeferredRenderer::DeferredRendererBuilder::withName(const std::string &name) {
+        this->name = name;
+        return *this;
+    }
+
+    std::shared_ptr<DeferredRenderer> DeferredRenderer::DeferredRendererBuilder::build() {
+        if (!isSupported()){
+            LOG_ERROR("DeferredRenderer requires OpenGL 3.3 / OpenGL ES 3.0");
+            return nullptr;
+        }
+        if (name.empty()){
+            name = "DeferredRenderer";
+        }
+        return std::shared_ptr<DeferredRenderer>(new DeferredRenderer(name, size));
+    }
+
+    bool DeferredRenderer::isSupported() {
+        auto& info = renderInfo();
+        if (info.graphicsAPIVersionES && info.graphicsAPIVersionMajor <= 2){
+            return false;
+        }
+        return Framebuffer::getMaximumColorAttachments() >= 3;
+    }
+
+    DeferredRenderer::DeferredRenderer(const std::string& name, glm::ivec2 size)
+    :name(name), autoSize(size.x <= 0 || size.y <= 0)
+    {
+        auto shader = Shader::create()
+                .withSourceResource("deferred_light_vert.glsl", ShaderType::Vertex)
+                .withSourceResource("deferred_light_frag.glsl", ShaderType::Fragment)
+                .withCullFace(CullFace::None)
+                .withName("Deferred light")
+                .build();
+        lightMaterial = shader->createMaterial({{"S_CLUSTERED_LIGHTS", "1"}});
+        lightMaterial->setName(name + " light");
+        quad = Mesh::create().withQuad().withName("Deferred light quad").build();
+        resize(autoSize ? Renderer::instance->getDrawableSize() : size);
+    }
+
+    void DeferredRenderer::resize(glm::ivec2 size) {
+        this->size = size;
+        // the G-buffer stores exact bytes (packed normals and manually gamma encoded colors), so no sRGB conversion is used
+        auto gbufferTexture = [&](const std::string& targetName){
+            return Texture::create().withRGBAData(nullptr, size.x, size.y).withFilterSampling(false)
+                    .withSamplerColorspace(Texture::SamplerColorspace::Gamma).withName(name + " " + targetName).build();
+        };
+        colorOcclusion = gbufferTexture("color occlusion");
+        normalMetallic = gbufferTexture("normal metallic");
+        emissiveRoughness = gbufferTexture("emissive roughness");
+        depth = Texture::create().withDepth(size.x, size.y, DepthPrecision::I24).withFilterSampling(false).withName(name + " depth").build();
+        // the depth is read as a value (not compared as a shadow map)
+        glBindTexture(GL_TEXTURE_2D, depth->textureId);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        framebuffer = Framebuffer::create()
+                .withColorTexture(colorOcclusion)
+                .withColorTexture(normalMetallic)
+                .withColorTexture(emissiveRoughness)
+                .withDepthTexture(depth)
+                .withName(name + " G-buffer")
+                .build();
+
+        lightMaterial->set("gbufferColorOcclusion", colorOcclusion);
+        lightMaterial->set("gbufferNormalMetallic", normalMetallic);
+        lightMaterial->set("gbufferEmissiveRoughness", emissiveRoughness);
+        lightMaterial->set("gbufferDepth", depth);
+    }
+
+    RenderPass DeferredRenderer::geometryPass(RenderPass::RenderPassBuilder &builder) {
+        if (autoSize && Renderer::instance->getDrawableSize() != size){
+            resize(Renderer::instance->getDrawableSize());
+        }
+        return builder.withFramebuffer(framebuffer)
+                .withClearColor(true, {0,0,0,0})
+                .withClearDepth(true, 1)
+                .withLightSelection(false)
+                .withGUI(false)
+                .build();
+    }
+
+    RenderPass DeferredRenderer::lightPass(RenderPass::RenderPassBuilder &builder) {
+        auto renderPass = builder.build();
+        renderPass.draw(quad, glm::mat4(1), lightMaterial);
+        return renderPass;
+    }
+
+    glm::ivec2 DeferredRenderer::getSize() {
+        return size;
+    }
+
+    std::shared_ptr<Texture> DeferredRenderer::getColorOcclusionTexture() {
+        return colorOcclusion;
+    }
+
+    std::shared_ptr<Texture> DeferredRenderer::getNormalMetallicTexture() {
+        return normalMetallic;
+    }
+
+    std::shared_ptr<Texture> DeferredRenderer::getEmissiveRoughnessTexture() {
+        return emissiveRoughness;
+    }
+
+    std::shared_ptr<Texture> DeferredRenderer::getDepthTexture() {
+        return depth;
+    }
+
+    const std::string &DeferredRenderer::getName() {
+        return name;
+    }
+}
@@ -19,6 +19,10 @@
 #include "sre/SDLRenderer.hpp"
 #include "sre/impl/GL.hpp"
 #include "sre/Texture.hpp"
+#include "sre/TextureCache.hpp"
+#include "sre/impl/TextureStreamer.hpp"
+#include "sre/impl/ShaderPreprocessor.hpp"
+#include "sre/impl/LightClusters.hpp"
 #include "sre/imgui_sre.hpp"
 #include "sre/Camera.hpp"
 #include "sre/SpriteAtlas.hpp"
@@ -121,6 +125,9 @@ namespace sre {
 
             ImGui::LabelText("Size","%ix%i",tex->getWidth(),tex->getHeight());
             ImGui::LabelText("Cubemap","%s",tex->isCubemap()?"true":"false");
+            if (tex->isTextureArray()){
+                ImGui::LabelText("Array layers","%i",tex->getLayerCount());
+            }
             const char* depthStr;
             switch (tex->getDepthPrecision()){
                 case Texture::DepthPrecision::I16:                // 16 bit integer
@@ -151,6 +158,11 @@ namespace sre {
             ImGui::LabelText("Depth",depthStr);
             ImGui::LabelText("Filtersampling","%s",tex->isFilterSampling()?"true":"false");
             ImGui::LabelText("Mipmapping","%s",tex->isMipmapped()?"true":"false");
+            if (tex->isMipmapped()){
+                const char* mipmapFilters[] = {"GPU","Box","Kaiser","Lanczos"};
+                ImGui::LabelText("Mipmap filter","%s",mipmapFilters[(int)tex->getMipmapFilter()]);
+            }
+            ImGui::LabelText("Compressed","%s",tex->isCompressed()?"true":"false");
             ImGui::LabelText("Transparent","%s",tex->isTransparent()?"true":"false");
             const char* colorSpace;
             if (tex->getSamplerColorSpace() == Texture::SamplerColorspace::Gamma){
@@ -162,7 +174,14 @@ namespace sre {
             const char* wrap = tex->getWrapUV()==Texture::Wrap::Repeat?"Repeat":(tex->getWrapUV()==Texture::Wrap::Mirror?"Mirror":"Clamp to edge");
             ImGui::LabelText("Wrap tex-coords",wrap);
             ImGui::LabelText("Data size","%f MB",tex->getDataSize()/(1000*1000.0f));
-            if (!tex->isCubemap()){
+            if (tex->isStreaming()){
+                int resident = tex->getResidentMipLevel();
+                int required = tex->getRequiredMipLevel();
+                ImGui::LabelText("Resident mip","%i (%i x %i)",resident, std::max(1, tex->getWidth()>>resident), std::max(1, tex->getHeight()>>resident));
+                ImGui::LabelText("Required mip","%i (%i x %i)",required, std::max(1, tex->getWidth()>>required), std::max(1, tex->getHeight()>>required));
+                ImGui::LabelText("Mip levels","%i",tex->getMipLevelCount());
+            }
+            if (!tex->isCubemap() && !tex->isTextureArray()){
                 ImGui_RenderTexture(tex,glm::vec2(previewSize, previewSize),{0,1},{1,0});
             }
 
@@ -312,11 +331,15 @@ namespace sre {
 
     void Inspector::showShader(Shader* shader){
         auto specialization = shader->getCurrentSpecializationConstants();
-        std::string s = shader->getName()+(specialization.empty()?"":" Specialized")+"##"+std::to_string((int64_t)shader);
+        std::string s = shader->getName()+(specialization.empty()?"":" Specialized")+(shader->isCompiling()?" (Compiling)":"")+"##"+std::to_string((int64_t)shader);
         if (ImGui::TreeNode(s.c_str())){
             if (ImGui::Button("Edit")) {
                 shaderEdit = std::weak_ptr<Shader>(shader->shared_from_this());
             }
+            ImGui::LabelText("Build time","%.2f ms",shader->getBuildTime());
+            if (specialization.empty()){
+                ImGui::LabelText("Specializations","%i",shader->getSpecializationCount());
+            }
             if (ImGui::TreeNode("Attributes")) {
                 auto attributeNames = shader->getAttributeNames();
                 for (auto a : attributeNames){
@@ -641,6 +664,13 @@ namespace sre {
                                 sprintf(label, "Draw call #%i", i++);
                                 if (ImGui::TreeNode(label)) {
                                     ImGui::LabelText("Submesh", "%i", r.subMesh);
+                                    if (r.lightSet != -1){
+                                        std::string lights;
+                                        for (auto l : rp->lightSets[r.lightSet]){
+                                            lights += (lights.empty() ? "" : ", ") + std::to_string(l);
+                                        }
+                                        ImGui::LabelText("Lights", "%s", lights.c_str());
+                                    }
                                     showMaterial(r.material.get());
                                     showMatrix("ModelTransform", r.modelTransform);
                                     showMesh(r.mesh.get());
@@ -700,6 +730,32 @@ namespace sre {
             ImGui::PlotLines(res,data.data(),frames, 0, "Texture MB", -1,max*1.2f,ImVec2(ImGui::CalcItemWidth(),150));
         }
         if (ImGui::CollapsingHeader("Shaders")){
+            ImGui::LabelText("Compiling","%i",Shader::getCompilingCount());
+            ImGui::LabelText("Build time","%.1f ms",r->renderStats.shaderBuildTime);
+            if (r->lightClusters && ImGui::TreeNode("Clustered lights")){
+                auto lightClusters = r->lightClusters.get();
+                auto size = lightClusters->getClusterSize();
+                ImGui::LabelText("Clusters","%ix%ix%i",size.x,size.y,size.z);
+                ImGui::LabelText("Lights","%i",lightClusters->getLightCount());
+                ImGui::LabelText("Light indices","%i",lightClusters->getLightIndexCount());
+                ImGui::LabelText("Update time","%.2f ms",lightClusters->getUpdateTime());
+                ImGui::TreePop();
+            }
+            if (ImGui::TreeNode("Source cache")){
+                auto preprocessor = r->getShaderPreprocessor();
+                ImGui::LabelText("Sources","%i",(int)preprocessor->getCacheSize());
+                ImGui::LabelText("Hits","%i",preprocessor->getHits());
+                ImGui::LabelText("Misses","%i",preprocessor->getMisses());
+                ImGui::TreePop();
+            }
+            if (!r->getShaderCacheDirectory().empty() && ImGui::TreeNode("Shader cache")){
+                auto& renderStats = r->renderStats;
+                ImGui::LabelText("Directory","%s",r->getShaderCacheDirectory().c_str());
+                ImGui::LabelText("Supported","%s",r->getProgramBinaryCache()?"true":"false");
+                ImGui::LabelText("Hits","%i",renderStats.shaderCacheHits);
+                ImGui::LabelText("Misses","%i",renderStats.shaderCacheMisses);
+                ImGui::TreePop();
+            }
             for (auto s : r->shaders){
                 showShader(s);
             }
@@ -708,6 +764,26 @@ namespace sre {
             }
         }
         if (ImGui::CollapsingHeader("Textures")){
+            if (ImGui::TreeNode("Texture cache")){
+                auto& renderStats = r->renderStats;
+                ImGui::LabelText("Cached textures","%i",TextureCache::size());
+                ImGui::LabelText("Hits","%i",renderStats.textureCacheHits);
+                ImGui::LabelText("Misses","%i",renderStats.textureCacheMisses);
+                ImGui::LabelText("Data saved","%f MB",renderStats.textureCacheBytesSaved/(1000*1000.0f));
+                ImGui::TreePop();
+            }
+            if (r->textureStreamer && !r->textureStreamer->empty() && ImGui::TreeNode("Texture streaming")){
+                auto& renderStats = r->getRenderStats();
+                ImGui::LabelText("Streaming data","%f MB",r->textureStreamer->getStreamingBytes()/(1000*1000.0f));
+                if (r->getTextureMemoryBudget() > 0){
+                    ImGui::LabelText("Budget","%f MB",r->getTextureMemoryBudget()/(1000*1000.0f));
+                } else {
+                    ImGui::LabelText("Budget","Unlimited");
+                }
+                ImGui::LabelText("Mip loads","%i",renderStats.textureMipLoads);
+                ImGui::LabelText("Mip evictions","%i",renderStats.textureMipEvictions);
+                ImGui::TreePop();
+            }
             for (auto t : r->textures){
                 showTexture(t);
             }
@@ -1018,9 +1094,13 @@ namespace sre {
                 ImGui::LabelText("Sprite size","%ix%i",sprite.getSpriteSize().x,sprite.getSpriteSize().y);
                 ImGui::LabelText("Sprite pos","(%i,%i)",sprite.getSpritePos().x,sprite.getSpritePos().y);
                 auto tex = sprite.texture;
-                auto uv0 = glm::vec2((sprite.getSpritePos().x)/(float)tex->getWidth(), (sprite.getSpritePos().y+sprite.getSpriteSize().y)/(float)tex->getHeight());
-                auto uv1 = glm::vec2((sprite.getSpritePos().x+sprite.getSpriteSize().x)/(float)tex->getWidth(),(sprite.getSpritePos().y)/(float)tex->getHeight());
-                ImGui_RenderTexture(tex,glm::vec2(previewSize/sprite.getSpriteSize().y*(float)sprite.getSpriteSize().x, previewSize),uv0,uv1);
+                if (tex->isTextureArray()){
+                    ImGui::LabelText("Sprite layer","%i",sprite.getLayer());     // texture arrays cannot be previewed
+                } else {
+                    auto uv0 = glm::vec2((sprite.getSpritePos().x)/(float)tex->getWidth(), (sprite.getSpritePos().y+sprite.getSpriteSize().y)/(float)tex->getHeight());
+                    auto uv1 = glm::vec2((sprite.getSpritePos().x+sprite.getSpriteSize().x)/(float)tex->getWidth(),(sprite.getSpritePos().y)/(float)tex->getHeight());
+                    ImGui_RenderTexture(tex,glm::vec2(previewSize/sprite.getSpriteSize().y*(float)sprite.getSpriteSize().x, previewSize),uv0,uv1);
+                }
             }
 
             ImGui::TreePop();
@@ -11,7 +11,7 @@
 
 namespace sre{
     constexpr int maxErrorSize = 1024;
-    char errorMsg[maxErrorSize];
+    thread_local char errorMsg[maxErrorSize];             // per thread, since textures may be decoded on worker threads
     std::function<void(const char * function,const char * file, int line,LogType, std::string)> Log::logHandler = [](const char * function,const char * file, int line, LogType type, std::string msg){
         switch (type){
             case LogType::Verbose:
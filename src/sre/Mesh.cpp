@@ -131,6 +131,7 @@ namespace sre {
         }
         glBindBuffer(GL_ARRAY_BUFFER, vertexBufferId);
         glBufferData(GL_ARRAY_BUFFER, sizeof(float)*interleavedData.size(), interleavedData.data(), GL_STATIC_DRAW);
+        vertexBufferCapacity = static_cast<int>(sizeof(float)*interleavedData.size());
 
         updateIndexBuffers();
 
@@ -151,6 +152,7 @@ namespace sre {
 
     void Mesh::updateIndexBuffers() {
         elementBufferOffsetCount.clear();
+        elementBufferCapacity = 0;
         if (this->indices.empty()){
             if (elementBufferId != 0){
                 glDeleteBuffers(1, &elementBufferId);
@@ -203,11 +205,107 @@ namespace sre {
             }
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBufferId);
             glBufferData(GL_ELEMENT_ARRAY_BUFFER, offset, concatenatedIndices.data(), GL_STATIC_DRAW);
+            elementBufferCapacity = offset;
 
             this->dataSize += offset;
         }
     }
 
+    void Mesh::setVertexData(const void* interleavedData, int vertexCount, bool dynamic) {
+        RenderStats& renderStats = Renderer::instance->renderStats;
+        int bytes = vertexCount * totalBytesPerVertex;
+        int capacity = vertexBufferCapacity;
+        if (!dynamic){
+            capacity = bytes;
+        } else if (bytes > capacity){
+            capacity = std::max(bytes, capacity + capacity/2);
+        }
+        if (capacity != vertexBufferCapacity){
+            int delta = capacity - vertexBufferCapacity;
+            dataSize += delta;
+            renderStats.meshBytes += delta;
+            if (delta > 0){
+                renderStats.meshBytesAllocated += delta;
+            } else {
+                renderStats.meshBytesDeallocated -= delta;
+            }
+            vertexBufferCapacity = capacity;
+        }
+        this->vertexCount = vertexCount;
+
+        if (renderInfo().graphicsAPIVersionMajor >= 3) {
+            glBindVertexArray(0);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBufferId);
+        if (dynamic){
+            // orphan the storage, so the driver does not wait for draw calls still using the old data
+            glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, interleavedData);
+        } else {
+            glBufferData(GL_ARRAY_BUFFER, bytes, interleavedData, GL_STATIC_DRAW);
+        }
+    }
+
+    void Mesh::setIndexData(const void* indices, int indexCount, bool indices32Bit, bool dynamic) {
+        RenderStats& renderStats = Renderer::instance->renderStats;
+        int bytes = indexCount * (indices32Bit ? sizeof(uint32_t) : sizeof(uint16_t));
+        int capacity = elementBufferCapacity;
+        if (!dynamic){
+            capacity = bytes;
+        } else if (bytes > capacity){
+            capacity = std::max(bytes, capacity + capacity/2);
+        }
+        if (capacity != elementBufferCapacity){
+            int delta = capacity - elementBufferCapacity;
+            dataSize += delta;
+            renderStats.meshBytes += delta;
+            if (delta > 0){
+                renderStats.meshBytesAllocated += delta;
+            } else {
+                renderStats.meshBytesDeallocated -= delta;
+            }
+            elementBufferCapacity = capacity;
+        }
+        this->indices.resize(1);
+        this->indices[0].clear();                           // index data is only kept on the GPU
+        elementBufferOffsetCount.resize(1);
+        elementBufferOffsetCount[0] = {0, (uint32_t)indexCount, (uint32_t)(indices32Bit ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT)};
+        meshTopology.resize(1);
+        meshTopology[0] = MeshTopology::Triangles;
+
+        if (renderInfo().graphicsAPIVersionMajor >= 3) {
+            glBindVertexArray(0);
+        }
+        if (elementBufferId == 0){
+            glGenBuffers(1, &elementBufferId);
+            // vertex array objects store the element buffer binding
+            if (renderInfo().graphicsAPIVersionMajor >= 3) {
+                for (auto arrayObj : shaderToVertexArrayObject){
+                    glDeleteVertexArrays(1, &(arrayObj.second.vaoID));
+                }
+                shaderToVertexArrayObject.clear();
+            }
+        }
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBufferId);
+        if (dynamic){
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, bytes, indices);
+        } else {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, bytes, indices, GL_STATIC_DRAW);
+        }
+    }
+
+    void Mesh::setIndexRanges(const std::vector<glm::ivec2>& ranges) {
+        uint32_t type = elementBufferOffsetCount[0].type;
+        uint32_t bytesPerIndex = type == GL_UNSIGNED_INT ? sizeof(uint32_t) : sizeof(uint16_t);
+        indices.resize(ranges.size());
+        elementBufferOffsetCount.resize(ranges.size());
+        meshTopology.resize(ranges.size(), MeshTopology::Triangles);
+        for (size_t i=0;i<ranges.size();i++){
+            elementBufferOffsetCount[i] = {ranges[i].x * bytesPerIndex, (uint32_t)ranges[i].y, type};
+        }
+    }
+
     void Mesh::setVertexAttributePointers(Shader* shader) {
         glBindBuffer(GL_ARRAY_BUFFER, vertexBufferId);
         int vertexAttribArray = 0;
@@ -229,6 +327,9 @@ namespace sre {
                 } else {
                     glVertexAttribPointer(shaderAttribute.second.position, meshAttribute->second.elementCount, meshAttribute->second.dataType, GL_FALSE, totalBytesPerVertex, BUFFER_OFFSET(meshAttribute->second.offset));
                 }
+                if (instanced){
+                    glVertexAttribDivisor(shaderAttribute.second.position, 1);
+                }
                 vertexAttribArray++;
             } else {
 				assert(shaderAttribute.second.arraySize == 1 && "Constant vertex attributes not supported as arrays");
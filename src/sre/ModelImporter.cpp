@@ -15,8 +15,12 @@
 #include <cerrno>
 #include <cctype>
 #include <unordered_map>
+#include <map>
+#include <thread>
+#include <atomic>
 #include "sre/Mesh.hpp"
 #include "sre/Log.hpp"
+#include "sre/TextureCache.hpp"
 #include <unordered_map>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/string_cast.hpp>
@@ -339,22 +343,85 @@ namespace {
         std::vector<uint32_t> vertexIndices;
     };
 
-    shared_ptr<sre::Material> createMaterial(const std::string& materialName, const std::vector<ObjMaterial>& matVector, std::string path) {
-        if (matVector.empty()){
-            auto shader = sre::Shader::getStandardBlinnPhong();
-            auto mat = shader->createMaterial();
-            return mat;
-        }
-        const ObjMaterial* foundMat = nullptr;
+    using ImportedTextures = std::map<std::string, std::shared_ptr<sre::Texture>>;     // importer scoped (resolved path to texture)
+
+    const ObjMaterial* findMaterial(const std::string& materialName, const std::vector<ObjMaterial>& matVector){
         for (auto & v : matVector){
             if (v.name == materialName
                 || materialName.empty()){ // empty is used for default material
-                foundMat = &v;
-                break;
+                return &v;
+            }
+        }
+        return nullptr;
+    }
+
+    // Decode every diffuse map referenced by the used materials in parallel, then upload each unique file once
+    // (files already loaded are taken from sre::TextureCache)
+    ImportedTextures loadTextures(const std::vector<ObjInterleavedIndex>& indices, const std::vector<ObjMaterial>& matVector, const std::string& path){
+        ImportedTextures importedTextures;
+        std::vector<std::string> filenames;
+        for (auto & index : indices){
+            auto foundMat = findMaterial(index.materialName, matVector);
+            if (foundMat == nullptr){
+                if (matVector.empty()){
+                    continue;
+                }
+                foundMat = matVector.data();
+            }
+            for (auto & map :foundMat->textureMaps){
+                if (map.type == ObjTextureMapType::Diffuse){
+                    auto filename = fixPath(path+map.filename);
+                    if (importedTextures.find(filename) != importedTextures.end() ||
+                        std::find(filenames.begin(), filenames.end(), filename) != filenames.end()){
+                        continue;
+                    }
+                    auto cached = sre::TextureCache::find(sre::TextureCache::Key(filename));
+                    if (cached){
+                        importedTextures[filename] = cached;
+                    } else {
+                        filenames.push_back(filename);
+                    }
+                }
             }
         }
+
+        std::vector<sre::Texture::DecodedImage> images(filenames.size());
+        std::atomic<size_t> nextImage{0};
+        auto decodeImages = [&](){
+            for (size_t i = nextImage++; i < filenames.size(); i = nextImage++){
+                images[i] = sre::Texture::decodeFile(filenames[i]);
+            }
+        };
+        size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), filenames.size());
+        std::vector<std::thread> threads;
+        for (size_t i=1;i<threadCount;i++){
+            threads.emplace_back(decodeImages);
+        }
+        decodeImages();                                                             // calling thread decodes too
+        for (auto & t : threads){
+            t.join();
+        }
+
+        // GL upload must happen on the thread owning the context
+        for (size_t i=0;i<filenames.size();i++){
+            if (images[i].valid()){
+                auto texture = sre::Texture::create().withDecodedImage(std::move(images[i])).build();
+                sre::TextureCache::insert(sre::TextureCache::Key(filenames[i]), texture);
+                importedTextures[filenames[i]] = texture;
+            }
+        }
+        return importedTextures;
+    }
+
+    shared_ptr<sre::Material> createMaterial(const std::string& materialName, const std::vector<ObjMaterial>& matVector, std::string path, const ImportedTextures& importedTextures) {
+        if (matVector.empty()){
+            auto shader = sre::Shader::getStandardBlinnPhong();
+            auto mat = shader->createMaterial();
+            return mat;
+        }
+        const ObjMaterial* foundMat = findMaterial(materialName, matVector);
         if (foundMat == nullptr){
-            LOG_WARNING("Could not find material ",materialName.c_str());
+            LOG_WARNING("Could not find material %s",materialName.c_str());
             foundMat = matVector.data();
         }
         auto shader = sre::Shader::getStandardBlinnPhong();
@@ -366,7 +433,10 @@ namespace {
         auto name = materialName;
         for (auto & map :foundMat->textureMaps){
             if (map.type == ObjTextureMapType::Diffuse){
-                mat->setTexture(sre::Texture::create().withFile(fixPath(path+map.filename)).build());
+                auto texture = importedTextures.find(fixPath(path+map.filename));
+                if (texture != importedTextures.end()){
+                    mat->setTexture(texture->second);
+                }
                 name+=" "+map.filename;
             }
         }
@@ -532,8 +602,9 @@ std::shared_ptr<sre::Mesh> sre::ModelImporter::importObj(std::string path, std::
         meshBuilder.withNormals(finalNormals);
     }
 
+    auto importedTextures = loadTextures(indices, materials, path);
     for (int i=0;i<indices.size();i++){
-        outModelMaterials.push_back(createMaterial(indices[i].materialName, materials, path));
+        outModelMaterials.push_back(createMaterial(indices[i].materialName, materials, path, importedTextures));
         meshBuilder.withIndices(indices[i].vertexIndices, MeshTopology::Triangles, i);
     }
 
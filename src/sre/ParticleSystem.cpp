@@ -0,0 +1,483 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/ParticleSystem.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <random>
+#include "sre/Mesh.hpp"
+#include "sre/Log.hpp"
+#include "sre/impl/GPUParticles.hpp"
+#include "sre/impl/WorkerPool.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SRE_PARTICLE_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace sre {
+    namespace {
+        const int minParticlesPerTask = 16384;
+
+        using Clock = std::chrono::high_resolution_clock;
+        using Milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>;
+
+#ifdef SRE_PARTICLE_SSE
+        float horizontalMin(__m128 v){
+            float lanes[4];
+            _mm_storeu_ps(lanes, v);
+            return std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+        }
+
+        float horizontalMax(__m128 v){
+            float lanes[4];
+            _mm_storeu_ps(lanes, v);
+            return std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+        }
+#endif
+    }
+
+    ParticleSystem::ParticleSystemBuilder ParticleSystem::create() {
+        return ParticleSystemBuilder();
+    }
+
+    ParticleSystem::ParticleSystemBuilder &ParticleSystem::ParticleSystemBuilder::withMaxParticles(int maxParticles) {
+        this->maxParticles = maxParticles;
+        return *this;
+    }
+
+    ParticleSystem::ParticleSystemBuilder &ParticleSystem::ParticleSystemBuilder::withGravity(glm::vec3 gravity) {
+        this->gravity = gravity;
+        return *this;
+    }
+
+    ParticleSystem::ParticleSystemBuilder &ParticleSystem::ParticleSystemBuilder::withDrag(float drag) {
+        this->drag = drag;
+        return *this;
+    }
+
+    ParticleSystem::ParticleSystemBuilder &ParticleSystem::ParticleSystemBuilder::withColor(glm::vec4 start, glm::vec4 end) {
+        this->colorStart = start;
+        this->colorEnd = end;
+        return *this;
+    }
+
+    ParticleSystem::ParticleSystemBuilder &ParticleSystem::ParticleSystemBuilder::withSize(float start, float end) {
+        this->sizeStart = start;
+        this->sizeEnd = end;
+        return *this;
+    }
+
+    ParticleSystem::ParticleSystemBuilder &ParticleSystem::ParticleSystemBuilder::withUV(glm::vec4 uv) {
+        this->uv = uv;
+        return *this;
+    }
+
+    ParticleSystem::ParticleSystemBuilder &ParticleSystem::ParticleSystemBuilder::withGPUSimulation(bool enabled) {
+        this->gpuSimulation = enabled;
+        return *this;
+    }
+
+    ParticleSystem::ParticleSystemBuilder &ParticleSystem::ParticleSystemBuilder::withDepthSort(bool enabled) {
+        this->depthSort = enabled;
+        return *this;
+    }
+
+    ParticleSystem::ParticleSystemBuilder &ParticleSystem::ParticleSystemBuilder::withName(const std::string &name) {
+        this->name = name;
+        return *this;
+    }
+
+    std::shared_ptr<ParticleSystem> ParticleSystem::ParticleSystemBuilder::build() {
+        if (maxParticles <= 0){
+            LOG_ERROR("ParticleSystem maxParticles must be positive (was %i)", maxParticles);
+            return nullptr;
+        }
+        if (name.empty()){
+            name = "Unnamed ParticleSystem";
+        }
+        return std::shared_ptr<ParticleSystem>(new ParticleSystem(*this));
+    }
+
+    ParticleSystem::ParticleSystem(const ParticleSystemBuilder& builder)
+    :name(builder.name), maxParticles(builder.maxParticles), gravity(builder.gravity), drag(builder.drag),
+     colorStart(builder.colorStart), colorEnd(builder.colorEnd), sizeStart(builder.sizeStart), sizeEnd(builder.sizeEnd),
+     uv(builder.uv), depthSort(builder.depthSort)
+    {
+        mesh = Mesh::create()
+                .withName(name)
+                .withPositions(std::vector<glm::vec3>())
+                .withUVs(std::vector<glm::vec4>())
+                .withColors(std::vector<glm::vec4>())
+                .withParticleSizes(std::vector<float>())
+                .withMeshTopology(MeshTopology::Points)
+                .build();
+        assert(mesh->totalBytesPerVertex == 64 && mesh->attributeByName["particleSize"].offset == 48);
+
+        if (builder.gpuSimulation){
+            if (GPUParticles::isSupported()){
+                gpu.reset(new GPUParticles(*this));
+                if (!gpu->isValid()){
+                    gpu.reset();
+                }
+            }
+            if (!gpu){
+                LOG_WARNING("ParticleSystem %s: compute shaders not supported. Simulating on the CPU", name.c_str());
+            }
+        }
+        if (!gpu){
+            if (depthSort){
+                LOG_WARNING("ParticleSystem %s: depth sort is only supported with GPU simulation", name.c_str());
+            }
+            for (auto & attribute : particles){
+                attribute.resize((size_t)maxParticles);
+            }
+        }
+    }
+
+    ParticleSystem::~ParticleSystem() = default;
+
+    int ParticleSystem::addEmitter(const Emitter& emitter) {
+        emitters.push_back({emitter});
+        return (int)emitters.size() - 1;
+    }
+
+    ParticleSystem::Emitter& ParticleSystem::getEmitter(int id) {
+        return emitters.at(id).emitter;
+    }
+
+    int ParticleSystem::getEmitterCount() {
+        return (int)emitters.size();
+    }
+
+    void ParticleSystem::emit(const Emitter& emitter, int count) {
+        bursts.emplace_back(emitter, count);
+    }
+
+    void ParticleSystem::moveParticles(int from, int to, int count) {
+        if (from == to || count <= 0){
+            return;
+        }
+        for (auto & attribute : particles){
+            memmove(attribute.data() + to, attribute.data() + from, sizeof(float) * count);
+        }
+    }
+
+    int ParticleSystem::simulate(int first, int count, float deltaTime) {
+        float* px = particles[PositionX].data();
+        float* py = particles[PositionY].data();
+        float* pz = particles[PositionZ].data();
+        float* vx = particles[VelocityX].data();
+        float* vy = particles[VelocityY].data();
+        float* vz = particles[VelocityZ].data();
+        float* age = particles[Age].data();
+        const float* invLifetime = particles[InvLifetime].data();
+        float* rotation = particles[Rotation].data();
+        const float* angularVelocity = particles[AngularVelocity].data();
+
+        glm::vec3 deltaVelocity = gravity * deltaTime;
+        float damping = std::max(0.0f, 1.0f - drag * deltaTime);
+        int end = first + count;
+        int i = first;
+        bool dead = false;
+#ifdef SRE_PARTICLE_SSE
+        const __m128 dt = _mm_set1_ps(deltaTime);
+        const __m128 damp = _mm_set1_ps(damping);
+        const __m128 dvx = _mm_set1_ps(deltaVelocity.x);
+        const __m128 dvy = _mm_set1_ps(deltaVelocity.y);
+        const __m128 dvz = _mm_set1_ps(deltaVelocity.z);
+        const __m128 one = _mm_set1_ps(1.0f);
+        __m128 deadMask = _mm_setzero_ps();
+        for (;i+4<=end;i+=4){
+            __m128 x = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vx + i), dvx), damp);
+            __m128 y = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vy + i), dvy), damp);
+            __m128 z = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vz + i), dvz), damp);
+            _mm_storeu_ps(vx + i, x);
+            _mm_storeu_ps(vy + i, y);
+            _mm_storeu_ps(vz + i, z);
+            _mm_storeu_ps(px + i, _mm_add_ps(_mm_loadu_ps(px + i), _mm_mul_ps(x, dt)));
+            _mm_storeu_ps(py + i, _mm_add_ps(_mm_loadu_ps(py + i), _mm_mul_ps(y, dt)));
+            _mm_storeu_ps(pz + i, _mm_add_ps(_mm_loadu_ps(pz + i), _mm_mul_ps(z, dt)));
+            _mm_storeu_ps(rotation + i, _mm_add_ps(_mm_loadu_ps(rotation + i), _mm_mul_ps(_mm_loadu_ps(angularVelocity + i), dt)));
+            __m128 a = _mm_add_ps(_mm_loadu_ps(age + i), dt);
+            _mm_storeu_ps(age + i, a);
+            deadMask = _mm_or_ps(deadMask, _mm_cmpge_ps(_mm_mul_ps(a, _mm_loadu_ps(invLifetime + i)), one));
+        }
+        dead = _mm_movemask_ps(deadMask) != 0;
+#endif
+        for (;i<end;i++){
+            vx[i] = (vx[i] + deltaVelocity.x) * damping;
+            vy[i] = (vy[i] + deltaVelocity.y) * damping;
+            vz[i] = (vz[i] + deltaVelocity.z) * damping;
+            px[i] += vx[i] * deltaTime;
+            py[i] += vy[i] * deltaTime;
+            pz[i] += vz[i] * deltaTime;
+            rotation[i] += angularVelocity[i] * deltaTime;
+            age[i] += deltaTime;
+            dead |= age[i] * invLifetime[i] >= 1.0f;
+        }
+        if (!dead){
+            return count;
+        }
+
+        // remove the dead particles by moving the last live particle of the range into their place
+        int alive = count;
+        for (i=first;i<first+alive;){
+            if (age[i] * invLifetime[i] >= 1.0f){
+                alive--;
+                moveParticles(first + alive, i, 1);
+            } else {
+                i++;
+            }
+        }
+        return alive;
+    }
+
+    void ParticleSystem::emitRange(const Emission& emission) {
+        auto& emitter = *emission.emitter;
+        std::minstd_rand random(emission.seed);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        auto range = [&](glm::vec2 minMax){
+            return minMax.x + (minMax.y - minMax.x) * unit(random);
+        };
+        auto spread = [&](float value, float spread){
+            return value + spread * (unit(random) * 2.0f - 1.0f);
+        };
+        for (int i=emission.first;i<emission.first+emission.count;i++){
+            particles[PositionX][i] = spread(emitter.position.x, emitter.positionSpread.x);
+            particles[PositionY][i] = spread(emitter.position.y, emitter.positionSpread.y);
+            particles[PositionZ][i] = spread(emitter.position.z, emitter.positionSpread.z);
+            particles[VelocityX][i] = spread(emitter.velocity.x, emitter.velocitySpread.x);
+            particles[VelocityY][i] = spread(emitter.velocity.y, emitter.velocitySpread.y);
+            particles[VelocityZ][i] = spread(emitter.velocity.z, emitter.velocitySpread.z);
+            particles[Age][i] = 0;
+            particles[InvLifetime][i] = 1.0f / std::max(range(emitter.lifetime), 0.0001f);
+            particles[Rotation][i] = range(emitter.rotation);
+            particles[AngularVelocity][i] = range(emitter.angularVelocity);
+        }
+    }
+
+    void ParticleSystem::writeVertices(int first, int count, glm::vec4* dst, glm::vec3& boundsMin, glm::vec3& boundsMax) {
+        const float* px = particles[PositionX].data();
+        const float* py = particles[PositionY].data();
+        const float* pz = particles[PositionZ].data();
+        const float* age = particles[Age].data();
+        const float* invLifetime = particles[InvLifetime].data();
+        const float* rotation = particles[Rotation].data();
+
+        glm::vec4 deltaColor = colorEnd - colorStart;
+        float deltaSize = sizeEnd - sizeStart;
+        int end = first + count;
+        int i = first;
+#ifdef SRE_PARTICLE_SSE
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 color0[4] = {_mm_set1_ps(colorStart.x), _mm_set1_ps(colorStart.y), _mm_set1_ps(colorStart.z), _mm_set1_ps(colorStart.w)};
+        const __m128 colorDelta[4] = {_mm_set1_ps(deltaColor.x), _mm_set1_ps(deltaColor.y), _mm_set1_ps(deltaColor.z), _mm_set1_ps(deltaColor.w)};
+        const __m128 size0 = _mm_set1_ps(sizeStart);
+        const __m128 sizeDelta = _mm_set1_ps(deltaSize);
+        const __m128 u = _mm_set1_ps(uv.x), v = _mm_set1_ps(uv.y), uvSize = _mm_set1_ps(uv.z);
+        __m128 minX = _mm_set1_ps(std::numeric_limits<float>::max());
+        __m128 minY = minX, minZ = minX;
+        __m128 maxX = _mm_set1_ps(-std::numeric_limits<float>::max());
+        __m128 maxY = maxX, maxZ = maxX;
+        // four particles at a time. The lanes are transposed into the interleaved vertex layout
+        for (;i+4<=end;i+=4){
+            __m128 t = _mm_min_ps(_mm_mul_ps(_mm_loadu_ps(age + i), _mm_loadu_ps(invLifetime + i)), one);
+            __m128 x = _mm_loadu_ps(px + i), y = _mm_loadu_ps(py + i), z = _mm_loadu_ps(pz + i);
+            minX = _mm_min_ps(minX, x);
+            minY = _mm_min_ps(minY, y);
+            minZ = _mm_min_ps(minZ, z);
+            maxX = _mm_max_ps(maxX, x);
+            maxY = _mm_max_ps(maxY, y);
+            maxZ = _mm_max_ps(maxZ, z);
+
+            __m128 p0 = x, p1 = y, p2 = z, p3 = zero;
+            _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+            __m128 uv0 = u, uv1 = v, uv2 = uvSize, uv3 = _mm_loadu_ps(rotation + i);
+            _MM_TRANSPOSE4_PS(uv0, uv1, uv2, uv3);
+            __m128 c0 = _mm_add_ps(color0[0], _mm_mul_ps(colorDelta[0], t));
+            __m128 c1 = _mm_add_ps(color0[1], _mm_mul_ps(colorDelta[1], t));
+            __m128 c2 = _mm_add_ps(color0[2], _mm_mul_ps(colorDelta[2], t));
+            __m128 c3 = _mm_add_ps(color0[3], _mm_mul_ps(colorDelta[3], t));
+            _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+            __m128 s0 = _mm_add_ps(size0, _mm_mul_ps(sizeDelta, t)), s1 = zero, s2 = zero, s3 = zero;
+            _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+
+            const __m128 vertices[4][4] = {{p0, uv0, c0, s0}, {p1, uv1, c1, s1}, {p2, uv2, c2, s2}, {p3, uv3, c3, s3}};
+            float* out = (float*)(dst + (size_t)i * 4);
+            for (int k=0;k<4;k++){
+                for (int j=0;j<4;j++){
+                    _mm_storeu_ps(out + k*16 + j*4, vertices[k][j]);
+                }
+            }
+        }
+        boundsMin = glm::min(boundsMin, glm::vec3(horizontalMin(minX), horizontalMin(minY), horizontalMin(minZ)));
+        boundsMax = glm::max(boundsMax, glm::vec3(horizontalMax(maxX), horizontalMax(maxY), horizontalMax(maxZ)));
+#endif
+        for (;i<end;i++){
+            float t = std::min(age[i] * invLifetime[i], 1.0f);
+            glm::vec3 position(px[i], py[i], pz[i]);
+            boundsMin = glm::min(boundsMin, position);
+            boundsMax = glm::max(boundsMax, position);
+            glm::vec4* vertex = dst + (size_t)i * 4;
+            vertex[0] = glm::vec4(position, 0);
+            vertex[1] = glm::vec4(uv.x, uv.y, uv.z, rotation[i]);
+            vertex[2] = colorStart + deltaColor * t;
+            vertex[3] = glm::vec4(sizeStart + deltaSize * t, 0, 0, 0);
+        }
+    }
+
+    void ParticleSystem::countEmissions(float deltaTime) {
+        emissionCounts.clear();
+        for (auto & state : emitters){
+            if (!state.emitter.enabled){
+                state.accumulated = 0;
+                continue;
+            }
+            state.accumulated += state.emitter.rate * deltaTime;
+            int n = (int)state.accumulated;
+            state.accumulated -= n;
+            emissionCounts.emplace_back(&state.emitter, n);
+        }
+        for (auto & burst : bursts){
+            emissionCounts.emplace_back(&burst.first, burst.second);
+        }
+    }
+
+    void ParticleSystem::updateGPU(float deltaTime, const glm::mat4& modelView) {
+        // the particles stay on the GPU, so the number of live particles is estimated from the emission times
+        countEmissions(deltaTime);
+        gpuTime += deltaTime;
+        for (auto & emission : emissionCounts){
+            int n = std::min(std::max(emission.second, 0), maxParticles);
+            if (n > 0){
+                gpuEmissions.emplace_back(gpuTime + std::max(emission.first->lifetime.x, emission.first->lifetime.y), n);
+                gpuSlotsUsed = std::min(gpuSlotsUsed + n, maxParticles);
+            }
+        }
+        gpuEmissions.erase(std::remove_if(gpuEmissions.begin(), gpuEmissions.end(), [&](const std::pair<float, int>& e){
+            return e.first < gpuTime;
+        }), gpuEmissions.end());
+        int alive = 0;
+        for (auto & e : gpuEmissions){
+            alive = std::min(alive + e.second, maxParticles);
+        }
+        particleCount = alive;
+
+        // sorted slots have the live particles first. Otherwise every slot which has been used is drawn (dead
+        // particles have size 0)
+        gpu->update(deltaTime, emissionCounts, modelView, depthSort ? alive : gpuSlotsUsed);
+        bursts.clear();
+    }
+
+    void ParticleSystem::update(float deltaTime, const glm::mat4& modelView) {
+        auto start = Clock::now();
+        frame++;
+        if (gpu){
+            updateGPU(deltaTime, modelView);
+            updateTime = Milliseconds(Clock::now() - start).count();
+            return;
+        }
+
+        // simulate each task range (dead particles are removed within the range), then close the gaps between the ranges
+        int taskCount = (particleCount + minParticlesPerTask - 1) / minParticlesPerTask;
+        std::vector<int> alive((size_t)taskCount);
+        WorkerPool::instance().parallelFor(taskCount, [&](int t){
+            int first = t * minParticlesPerTask;
+            alive[t] = simulate(first, std::min(minParticlesPerTask, particleCount - first), deltaTime);
+        });
+        int count = 0;
+        for (int t=0;t<taskCount;t++){
+            moveParticles(t * minParticlesPerTask, count, alive[t]);
+            count += alive[t];
+        }
+        particleCount = count;
+
+        // emit new particles after the live particles. Large emissions are split into tasks with separate random seeds
+        std::vector<Emission> emissions;
+        int emitted = particleCount;
+        auto schedule = [&](const Emitter* emitter, int n){
+            n = std::min(n, maxParticles - emitted);
+            for (int first = 0; first < n; first += minParticlesPerTask){
+                uint32_t seed = frame * 0x9E3779B9u ^ (uint32_t)(emissions.size() + 1) * 0x85EBCA6Bu;
+                emissions.push_back({emitter, emitted + first, std::min(minParticlesPerTask, n - first), seed});
+            }
+            emitted += std::max(n, 0);
+        };
+        countEmissions(deltaTime);
+        for (auto & emission : emissionCounts){
+            schedule(emission.first, emission.second);
+        }
+        WorkerPool::instance().parallelFor((int)emissions.size(), [&](int t){
+            emitRange(emissions[t]);
+        });
+        bursts.clear();
+        particleCount = emitted;
+
+        // write the vertices using the interleaved layout of the mesh: position (vec3 padded to vec4), uv, vertex_color, particleSize
+        vertexScratch.resize((size_t)particleCount * 4);
+        taskCount = (particleCount + minParticlesPerTask - 1) / minParticlesPerTask;
+        std::vector<std::array<glm::vec3,2>> bounds((size_t)taskCount, {{glm::vec3(std::numeric_limits<float>::max()), glm::vec3(-std::numeric_limits<float>::max())}});
+        WorkerPool::instance().parallelFor(taskCount, [&](int t){
+            int first = t * minParticlesPerTask;
+            writeVertices(first, std::min(minParticlesPerTask, particleCount - first), vertexScratch.data(), bounds[t][0], bounds[t][1]);
+        });
+        std::array<glm::vec3,2> boundsMinMax = {{glm::vec3(0), glm::vec3(0)}};
+        for (int t=0;t<taskCount;t++){
+            boundsMinMax[0] = t == 0 ? bounds[t][0] : glm::min(boundsMinMax[0], bounds[t][0]);
+            boundsMinMax[1] = t == 0 ? bounds[t][1] : glm::max(boundsMinMax[1], bounds[t][1]);
+        }
+        mesh->setVertexData(vertexScratch.data(), particleCount, true);
+        mesh->setBoundsMinMax(boundsMinMax);
+
+        updateTime = Milliseconds(Clock::now() - start).count();
+    }
+
+    void ParticleSystem::clear() {
+        particleCount = 0;
+        bursts.clear();
+        for (auto & state : emitters){
+            state.accumulated = 0;
+        }
+        if (gpu){
+            gpuEmissions.clear();
+            gpuSlotsUsed = 0;
+            gpu->clear();
+        } else {
+            mesh->setVertexData(nullptr, 0, true);
+        }
+    }
+
+    std::shared_ptr<Mesh> ParticleSystem::getMesh() {
+        return mesh;
+    }
+
+    int ParticleSystem::getParticleCount() {
+        return particleCount;
+    }
+
+    int ParticleSystem::getMaxParticles() {
+        return maxParticles;
+    }
+
+    float ParticleSystem::getUpdateTime() {
+        return updateTime;
+    }
+
+    bool ParticleSystem::isGPUSimulated() {
+        return gpu != nullptr;
+    }
+
+    const std::string& ParticleSystem::getName() {
+        return name;
+    }
+}
@@ -12,6 +12,11 @@
 #include "sre/RenderStats.hpp"
 #include "sre/Texture.hpp"
 #include "sre/impl/GL.hpp"
+#include "sre/impl/TextureStreamer.hpp"
+#include "sre/impl/PixelReadback.hpp"
+#include "sre/impl/LightClusters.hpp"
+#include "sre/impl/LightSelection.hpp"
+#include "sre/Log.hpp"
 #include <cassert>
 #include <algorithm>
 #include <glm/gtc/type_ptr.hpp>
@@ -89,6 +94,11 @@ namespace sre {
         return *this;
     }
 
+    RenderPass::RenderPassBuilder &RenderPass::RenderPassBuilder::withLightSelection(bool enabled) {
+        this->lightSelection = enabled;
+        return *this;
+    }
+
     RenderPass RenderPass::RenderPassBuilder::build(){
 
         return RenderPass(*this);
@@ -113,9 +123,16 @@ namespace sre {
     RenderPass::RenderPass(RenderPass &&rp) noexcept {
         builder = rp.builder;
         std::swap(mIsFinished,rp.mIsFinished);
+        rp.mIsFinished = true;                                      // the moved-from renderpass must not render
+        std::swap(renderQueue,rp.renderQueue);
         std::swap(lastBoundShader,rp.lastBoundShader);
         std::swap(lastBoundMaterial,rp.lastBoundMaterial);
         std::swap(lastBoundMeshId,rp.lastBoundMeshId);
+        std::swap(lightClusters,rp.lightClusters);
+        std::swap(lightSets,rp.lightSets);
+        std::swap(lightSetStride,rp.lightSetStride);
+        std::swap(lastBoundLightSet,rp.lastBoundLightSet);
+        std::swap(shaderLightSet,rp.shaderLightSet);
         std::swap(projection,rp.projection);
         std::swap(viewportOffset,rp.viewportOffset);
         std::swap(viewportSize,rp.viewportSize);
@@ -154,6 +171,28 @@ namespace sre {
         *globalUniforms.g_projection = projection;
         *globalUniforms.g_viewport = glm::vec4 ((float)viewportSize.x,(float)viewportSize.y,(float)viewportOffset.x,(float)viewportOffset.y);;
         *globalUniforms.g_cameraPos = glm::vec4(this->builder.camera.getPosition(),1.0f);;
+        setupLights(globalUniforms, nullptr);
+        int size = Renderer::instance->globalUniformBufferSize;
+        glBindBuffer(GL_UNIFORM_BUFFER, Renderer::instance->globalUniformBuffer);
+        if (lightSets.empty()){
+            glBufferData(GL_UNIFORM_BUFFER, size, globalUniforms.g_view, GL_STREAM_DRAW);
+        } else {
+            // one copy of the global uniforms per light set (the first using the first lights)
+            GLint alignment = 256;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            lightSetStride = (size + alignment - 1) / alignment * alignment;
+            std::vector<char> data(lightSetStride * (lightSets.size() + 1));
+            memcpy(data.data(), globalUniforms.g_view, size);
+            for (int i=0;i<lightSets.size();i++){
+                setupLights(globalUniforms, &lightSets[i]);
+                memcpy(data.data() + lightSetStride * (i + 1), globalUniforms.g_view, size);
+            }
+            glBufferData(GL_UNIFORM_BUFFER, data.size(), data.data(), GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void RenderPass::setupLights(const RenderPass::GlobalUniforms &globalUniforms, const std::vector<int>* lightIndices) {
         int maxSceneLights = Renderer::instance->maxSceneLights;
         size_t lightSize = sizeof(glm::vec4)*(1 + maxSceneLights*2);
         memset(globalUniforms.g_ambientLight,0, lightSize); // ambient + (lightPosType + lightColorRange) * maxSceneLights
@@ -161,7 +200,12 @@ namespace sre {
             *globalUniforms.g_ambientLight = glm::vec4(builder.worldLights->getAmbientLight(),1.0);
 
             for (int i=0;i<maxSceneLights;i++){
-                auto light = builder.worldLights->getLight(i);
+                Light* light;
+                if (lightIndices){
+                    light = i < (int)lightIndices->size() ? builder.worldLights->getLight((*lightIndices)[i]) : nullptr;
+                } else {
+                    light = builder.worldLights->getLight(i);
+                }
                 if (light == nullptr || light->lightType == LightType::Unused) {
                     globalUniforms.g_lightPosType[i] = glm::vec4(0.0f,0.0f,0.0f, 2);
 
@@ -174,9 +218,54 @@ namespace sre {
                 globalUniforms.g_lightColorRange[i] = glm::vec4(light->color, light->range);
             }
         }
-        glBindBuffer(GL_UNIFORM_BUFFER, Renderer::instance->globalUniformBuffer);
-        glBufferData(GL_UNIFORM_BUFFER, Renderer::instance->globalUniformBufferSize, globalUniforms.g_view, GL_STREAM_DRAW);
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void RenderPass::bindLightSet(Shader *shader, int lightSet) {
+        if (Renderer::instance->globalUniformBuffer){
+            if (lightSet != lastBoundLightSet){
+                const int globalUniformBindingIndex = 1;
+                glBindBufferRange(GL_UNIFORM_BUFFER, globalUniformBindingIndex, Renderer::instance->globalUniformBuffer,
+                                  lightSetStride * (lightSet + 1), Renderer::instance->globalUniformBufferSize);
+                lastBoundLightSet = lightSet;
+            }
+        } else {
+            auto res = shaderLightSet.emplace(shader, -1);     // the first lights are set in setupShaderRenderPass()
+            if (res.first->second != lightSet){
+                res.first->second = lightSet;
+                shader->setLights(builder.worldLights, lightSet == -1 ? nullptr : &lightSets[lightSet]);
+            }
+        }
+    }
+
+    void RenderPass::selectLights() {
+        lightSets.clear();
+        auto worldLights = builder.worldLights;
+        int maxSceneLights = Renderer::instance->maxSceneLights;
+        if (!builder.lightSelection || worldLights == nullptr || worldLights->lightCount() <= maxSceneLights){
+            return;
+        }
+        auto lightSelection = Renderer::instance->getLightSelection();
+        lightSelection->build(worldLights);
+        std::map<std::vector<int>, int> lightSetIndex;
+        std::vector<int> selected;
+        for (int i = builder.skybox ? 1 : 0; i < renderQueue.size(); i++){
+            auto& rqObj = renderQueue[i];
+            if (rqObj.material->getShader()->uniformLocationClusterGrid != -1){
+                continue;                                           // shades all lights
+            }
+            // world space bounds of the mesh
+            auto bounds = rqObj.mesh->getBoundsMinMax();
+            glm::vec3 center = glm::vec3(rqObj.modelTransform * glm::vec4((bounds[0] + bounds[1]) * 0.5f, 1.0f));
+            glm::vec3 extent = glm::abs(glm::mat3(rqObj.modelTransform)[0]) * ((bounds[1].x - bounds[0].x) * 0.5f) +
+                               glm::abs(glm::mat3(rqObj.modelTransform)[1]) * ((bounds[1].y - bounds[0].y) * 0.5f) +
+                               glm::abs(glm::mat3(rqObj.modelTransform)[2]) * ((bounds[1].z - bounds[0].z) * 0.5f);
+            lightSelection->select(center - extent, center + extent, maxSceneLights, selected);
+            auto res = lightSetIndex.emplace(selected, (int)lightSets.size());
+            if (res.second){
+                lightSets.push_back(selected);
+            }
+            rqObj.lightSet = res.first->second;
+        }
     }
 
     void RenderPass::setupShader(const glm::mat4 &modelTransform, Shader *shader)  {
@@ -184,6 +273,9 @@ namespace sre {
             builder.renderStats->stateChangesShader++;
             lastBoundShader = shader;
             shader->bind();
+            if (lightClusters && shader->uniformLocationClusterGrid != -1){
+                lightClusters->bind(shader);
+            }
         }
         if (shader->uniformLocationModel != -1){
             glUniformMatrix4fv(shader->uniformLocationModel, 1, GL_FALSE, glm::value_ptr(modelTransform));
@@ -256,6 +348,13 @@ namespace sre {
         }
     }
 
+    glm::vec2 RenderPass::getTargetSize() {
+        if (builder.framebuffer){
+            return builder.framebuffer->size;
+        }
+        return static_cast<glm::vec2>(Renderer::instance->getDrawableSize());
+    }
+
     void RenderPass::finish(){
         if (mIsFinished){
             return;
@@ -266,12 +365,7 @@ namespace sre {
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
         }
 
-        glm::vec2 windowSize;
-        if (builder.framebuffer){
-            windowSize = builder.framebuffer->size;
-        } else {
-            windowSize = static_cast<glm::vec2>(Renderer::instance->getDrawableSize());
-        }
+        glm::vec2 windowSize = getTargetSize();
         viewportOffset = static_cast<glm::uvec2>(builder.camera.viewportOffset * windowSize);
         viewportSize = static_cast<glm::uvec2>(windowSize * builder.camera.viewportSize);
         glEnable(GL_SCISSOR_TEST);
@@ -309,11 +403,28 @@ namespace sre {
                                 builder.skybox->material};
         }
 
+        selectLights();
         setupGlobalShaderUniforms();
 
+        for (auto & rqObj : renderQueue){
+            if (rqObj.material && rqObj.material->getShader()->uniformLocationClusterGrid != -1){
+                lightClusters = Renderer::instance->getLightClusters();
+                lightClusters->update(builder.worldLights, builder.camera.getViewTransform(), projection);
+                break;
+            }
+        }
+
+        auto textureStreamer = Renderer::instance->textureStreamer.get();
+        if (textureStreamer && !textureStreamer->empty()){
+            recordTextureUsage(textureStreamer);
+        }
+
         for (auto & rqObj : renderQueue){
             drawInstance(rqObj);
         }
+        if (!lightSets.empty() && Renderer::instance->globalUniformBuffer){
+            bindLightSet(nullptr, -1);                              // restore the default global uniforms
+        }
 
         if (builder.gui) {
             ImGui::Render();
@@ -361,6 +472,38 @@ namespace sre {
         return res;
     }
 
+    template<typename T>
+    std::future<std::vector<T>> RenderPass::readAsync(unsigned int x, unsigned int y, unsigned int width, unsigned int height, uint32_t format, uint32_t type) {
+        assert(mIsFinished);
+        if (builder.framebuffer!=nullptr){
+            builder.framebuffer->bind();
+        }
+        auto res = Renderer::instance->getPixelReadback()->readPixels<T>(x, y, width, height, format, type);
+        // set default framebuffer
+        if (builder.framebuffer!=nullptr) {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+        return res;
+    }
+
+    std::future<std::vector<glm::u8vec4>> RenderPass::readPixelsAsync(unsigned int x, unsigned int y, unsigned int width, unsigned int height) {
+        return readAsync<glm::u8vec4>(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE);
+    }
+
+    std::future<std::vector<glm::vec4>> RenderPass::readPixelsFloatAsync(unsigned int x, unsigned int y, unsigned int width, unsigned int height) {
+        return readAsync<glm::vec4>(x, y, width, height, GL_RGBA, GL_FLOAT);
+    }
+
+    std::future<std::vector<float>> RenderPass::readDepthAsync(unsigned int x, unsigned int y, unsigned int width, unsigned int height) {
+        if (renderInfo().graphicsAPIVersionES){
+            LOG_WARNING("readDepthAsync() is not supported on OpenGL ES");
+            std::promise<std::vector<float>> promise;
+            promise.set_value({});
+            return promise.get_future();
+        }
+        return readAsync<float>(x, y, width, height, GL_DEPTH_COMPONENT, GL_FLOAT);
+    }
+
     void RenderPass::draw(std::shared_ptr<Mesh> &meshPtr, glm::mat4 modelTransform,
                           std::vector<std::shared_ptr<Material>> materials) {
         assert(!mIsFinished && "RenderPass is finished. Can no longer be modified.");
@@ -381,6 +524,9 @@ namespace sre {
         assert(mesh  != nullptr);
         builder.renderStats->drawCalls++;
         setupShader(rqObj.modelTransform, shader);
+        if (!lightSets.empty()){
+            bindLightSet(shader, rqObj.lightSet);
+        }
         if (material != lastBoundMaterial)
         {
             builder.renderStats->stateChangesMaterial++;
@@ -394,7 +540,9 @@ namespace sre {
             lastBoundMeshId = mesh->meshId;
             mesh->bind(shader);
         }
-        if (mesh->elementBufferOffsetCount.empty()){
+        if (mesh->instanced){
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, mesh->getVertexCount());
+        } else if (mesh->elementBufferOffsetCount.empty()){
             glDrawArrays((GLenum) mesh->getMeshTopology(), 0, mesh->getVertexCount());
         } else {
             auto offsetCount = mesh->elementBufferOffsetCount[rqObj.subMesh];
@@ -402,6 +550,36 @@ namespace sre {
         }
     }
 
+    void RenderPass::recordTextureUsage(TextureStreamer* textureStreamer) {
+        glm::mat4 view = builder.camera.getViewTransform();
+        bool orthographic = projection[3][3] == 1.0f;
+        for (auto & rqObj : renderQueue){
+            float screenSize = -1;
+            for (auto & tv : rqObj.material->uniformMap.textureValues){
+                auto texture = tv.second.get();
+                if (texture == nullptr || !texture->isStreaming()){
+                    continue;
+                }
+                if (screenSize < 0){
+                    // project the bounding sphere of the mesh (assumes the uv coordinates span the mesh)
+                    auto bounds = rqObj.mesh->getBoundsMinMax();
+                    glm::vec3 center = (bounds[0] + bounds[1]) * 0.5f;
+                    float scale = glm::max(glm::length(glm::vec3(rqObj.modelTransform[0])),
+                                  glm::max(glm::length(glm::vec3(rqObj.modelTransform[1])), glm::length(glm::vec3(rqObj.modelTransform[2]))));
+                    float diameter = glm::length(bounds[1] - bounds[0]) * scale;
+                    float pixelsPerUnit = projection[1][1] * 0.5f * viewportSize.y;
+                    if (orthographic){
+                        screenSize = diameter * pixelsPerUnit;
+                    } else {
+                        float depth = -(view * rqObj.modelTransform * glm::vec4(center, 1.0f)).z;
+                        screenSize = depth <= diameter * 0.5f ? std::numeric_limits<float>::max() : diameter * pixelsPerUnit / depth;
+                    }
+                }
+                textureStreamer->recordUsage(texture, screenSize);
+            }
+        }
+    }
+
     void RenderPass::finishGPUCommandBuffer() {
         glFinish();
     }
@@ -410,18 +588,42 @@ namespace sre {
         assert(!mIsFinished && "RenderPass is finished. Can no longer be modified.");
         if (spriteBatch == nullptr) return;
 
-        for (int i=0;i<spriteBatch->materials.size();i++) {
-            renderQueue.emplace_back(RenderQueueObj{spriteBatch->spriteMeshes[i], modelTransform, spriteBatch->materials[i]});
+        // chunks are culled against the view volume projected on the sprite plane (only for orthographic cameras).
+        // The projection member is first set in finish(), so the projection is computed from the camera here
+        bool cull = false;
+        glm::mat4 cameraProjection;
+        if (spriteBatch->isChunked()){
+            cameraProjection = builder.camera.getProjectionTransform(static_cast<glm::uvec2>(getTargetSize() * builder.camera.viewportSize));
+            cull = cameraProjection[3][3] == 1.0f;
+        }
+        glm::vec2 viewMin{std::numeric_limits<float>::max()};
+        glm::vec2 viewMax{-std::numeric_limits<float>::max()};
+        if (cull){
+            glm::mat4 clipToSprite = glm::inverse(cameraProjection * builder.camera.getViewTransform() * modelTransform);
+            for (int i=0;i<8;i++){
+                glm::vec4 corner = clipToSprite * glm::vec4(i & 1 ? 1 : -1, i & 2 ? 1 : -1, i & 4 ? 1 : -1, 1);
+                glm::vec2 p = glm::vec2(corner) / corner.w;
+                viewMin = glm::min(viewMin, p);
+                viewMax = glm::max(viewMax, p);
+            }
+        }
+
+        for (int i=0;i<spriteBatch->meshCount;i++) {
+            int firstRun = spriteBatch->meshFirstRun[i];
+            int runCount = spriteBatch->meshFirstRun[i+1] - firstRun;
+            for (int subMesh=0;subMesh<runCount;subMesh++){
+                auto& run = spriteBatch->runs[firstRun + subMesh];
+                if (cull && (run.boundsMax.x < viewMin.x || run.boundsMin.x > viewMax.x ||
+                             run.boundsMax.y < viewMin.y || run.boundsMin.y > viewMax.y)){
+                    continue;
+                }
+                renderQueue.emplace_back(RenderQueueObj{spriteBatch->spriteMeshes[i], modelTransform, spriteBatch->materials[i], subMesh});
+            }
         }
     }
 
     void RenderPass::draw(std::shared_ptr<SpriteBatch>&& spriteBatch, glm::mat4 modelTransform) {
-        assert(!mIsFinished && "RenderPass is finished. Can no longer be modified.");
-        if (spriteBatch == nullptr) return;
-
-        for (int i=0;i<spriteBatch->materials.size();i++) {
-            renderQueue.emplace_back(RenderQueueObj{spriteBatch->spriteMeshes[i], modelTransform, spriteBatch->materials[i]});
-        }
+        draw(spriteBatch, modelTransform);
     }
 
     bool RenderPass::isFinished() {
@@ -15,14 +15,24 @@ __declspec(dllexport) int AmdPowerXpressRequestHighPerformance = 1;
 #endif
 
 #include <SDL_events.h>
+#include <algorithm>
 #include "sre/Log.hpp"
 #include "sre/VR.hpp"
 
 #include "sre/Renderer.hpp"
 #include "sre/Framebuffer.hpp"
 #include "sre/Texture.hpp"
+#include "sre/TextureCache.hpp"
 
 #include "sre/impl/GL.hpp"
+#include "sre/impl/TextureLoader.hpp"
+#include "sre/impl/TextureStreamer.hpp"
+#include "sre/impl/PixelReadback.hpp"
+#include "sre/impl/ProgramBinaryCache.hpp"
+#include "sre/impl/ShaderCompiler.hpp"
+#include "sre/impl/ShaderPreprocessor.hpp"
+#include "sre/impl/LightClusters.hpp"
+#include "sre/impl/LightSelection.hpp"
 
 #ifdef EMSCRIPTEN
 #include "emscripten.h"
@@ -136,6 +146,22 @@ namespace sre {
 		}
         renderInfo_.supportFBODepthAttachment = !renderInfo_.graphicsAPIVersionES || renderInfo_.graphicsAPIVersionMajor>2;
 
+        auto extensions = listExtension();
+        auto hasExt = [&](const char* name){
+            return std::find(extensions.begin(), extensions.end(), name) != extensions.end();
+        };
+        renderInfo_.supportTextureCompressionS3TC = hasExt("GL_EXT_texture_compression_s3tc") || hasExt("WEBGL_compressed_texture_s3tc");
+        renderInfo_.supportTextureCompressionBPTC = hasExt("GL_ARB_texture_compression_bptc") || hasExt("GL_EXT_texture_compression_bptc") ||
+                (!renderInfo_.graphicsAPIVersionES && (renderInfo_.graphicsAPIVersionMajor > 4 || (renderInfo_.graphicsAPIVersionMajor == 4 && renderInfo_.graphicsAPIVersionMinor >= 2)));
+        renderInfo_.supportTextureCompressionETC2 = hasExt("GL_ARB_ES3_compatibility") || hasExt("WEBGL_compressed_texture_etc") ||
+                (renderInfo_.graphicsAPIVersionES && renderInfo_.graphicsAPIVersionMajor >= 3 && !renderInfo_.graphicsAPIVersion.empty() && renderInfo_.graphicsAPIVersion.find("WebGL") == std::string::npos) ||
+                (!renderInfo_.graphicsAPIVersionES && (renderInfo_.graphicsAPIVersionMajor > 4 || (renderInfo_.graphicsAPIVersionMajor == 4 && renderInfo_.graphicsAPIVersionMinor >= 3)));
+        renderInfo_.supportParallelShaderCompile = hasExt("GL_KHR_parallel_shader_compile") || hasExt("GL_ARB_parallel_shader_compile") || hasExt("KHR_parallel_shader_compile");
+#ifdef GL_COMPUTE_SHADER
+        renderInfo_.supportComputeShader = !renderInfo_.graphicsAPIVersionES &&
+                (renderInfo_.graphicsAPIVersionMajor > 4 || (renderInfo_.graphicsAPIVersionMajor == 4 && renderInfo_.graphicsAPIVersionMinor >= 3));
+#endif
+
         initGlobalUniformBuffer();
 
         // initialize ImGUI
@@ -147,6 +173,15 @@ namespace sre {
     }
 
     Renderer::~Renderer() {
+        textureLoader.reset();
+        textureStreamer.reset();
+        pixelReadback.reset();
+        shaderCompiler.reset();
+        shaderPreprocessor.reset();
+        lightClusters.reset();
+        lightSelection.reset();
+        programBinaryCache.reset();
+        TextureCache::clear();
         ImGui_SRE_Shutdown();
         ImGui::DestroyContext(imGuiContext);
         glDeleteBuffers(1,&globalUniformBuffer);
@@ -155,12 +190,26 @@ namespace sre {
     }
 
     void Renderer::swapWindow() {
+        if (textureLoader){
+            textureLoader->update(textureUploadBudget);
+        }
+        if (textureStreamer){
+            textureStreamer->update(textureMemoryBudget, textureUploadBudget);
+        }
+        if (pixelReadback){
+            pixelReadback->update();
+        }
+        if (shaderCompiler){
+            shaderCompiler->update();
+        }
         renderStatsLast = renderStats;
         renderStats.frame++;
         renderStats.meshBytesAllocated=0;
         renderStats.meshBytesDeallocated=0;
         renderStats.textureBytesAllocated=0;
         renderStats.textureBytesDeallocated=0;
+        renderStats.textureMipLoads=0;
+        renderStats.textureMipEvictions=0;
         renderStats.drawCalls=0;
         renderStats.stateChangesShader = 0;
         renderStats.stateChangesMesh = 0;
@@ -194,6 +243,90 @@ namespace sre {
         return maxSceneLights;
     }
 
+    void Renderer::setTextureUploadBudget(int bytesPerFrame) {
+        textureUploadBudget = bytesPerFrame;
+    }
+
+    int Renderer::getTextureUploadBudget() {
+        return textureUploadBudget;
+    }
+
+    void Renderer::setTextureMemoryBudget(int64_t bytes) {
+        textureMemoryBudget = bytes;
+    }
+
+    int64_t Renderer::getTextureMemoryBudget() {
+        return textureMemoryBudget;
+    }
+
+    TextureStreamer* Renderer::getTextureStreamer() {
+        if (!textureStreamer){
+            textureStreamer.reset(new TextureStreamer());
+        }
+        return textureStreamer.get();
+    }
+
+    PixelReadback* Renderer::getPixelReadback() {
+        if (!pixelReadback){
+            pixelReadback.reset(new PixelReadback());
+        }
+        return pixelReadback.get();
+    }
+
+    void Renderer::setShaderCacheDirectory(const std::string& directory) {
+        shaderCacheDirectory = directory;
+        programBinaryCache.reset();
+    }
+
+    const std::string& Renderer::getShaderCacheDirectory() {
+        return shaderCacheDirectory;
+    }
+
+    ProgramBinaryCache* Renderer::getProgramBinaryCache() {
+        if (shaderCacheDirectory.empty()){
+            return nullptr;
+        }
+        if (!programBinaryCache){
+            programBinaryCache.reset(new ProgramBinaryCache(shaderCacheDirectory));
+        }
+        return programBinaryCache->isSupported() ? programBinaryCache.get() : nullptr;
+    }
+
+    ShaderCompiler* Renderer::getShaderCompiler() {
+        if (!shaderCompiler){
+            shaderCompiler.reset(new ShaderCompiler());
+        }
+        return shaderCompiler.get();
+    }
+
+    ShaderPreprocessor* Renderer::getShaderPreprocessor() {
+        if (!shaderPreprocessor){
+            shaderPreprocessor.reset(new ShaderPreprocessor());
+        }
+        return shaderPreprocessor.get();
+    }
+
+    LightClusters* Renderer::getLightClusters() {
+        if (!lightClusters){
+            lightClusters.reset(new LightClusters());
+        }
+        return lightClusters.get();
+    }
+
+    LightSelection* Renderer::getLightSelection() {
+        if (!lightSelection){
+            lightSelection.reset(new LightSelection());
+        }
+        return lightSelection.get();
+    }
+
+    TextureLoader* Renderer::getTextureLoader() {
+        if (!textureLoader){
+            textureLoader.reset(new TextureLoader());
+        }
+        return textureLoader.get();
+    }
+
     void Renderer::initGlobalUniformBuffer(){
         if (renderInfo_.graphicsAPIVersionMajor <= 2){
             globalUniformBuffer = 0;
@@ -9,8 +9,11 @@
 #include "sre/Material.hpp"
 
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
+#include <chrono>
+#include <functional>
 #include <glm/gtc/type_ptr.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/string_cast.hpp>
@@ -18,6 +21,13 @@
 #include "sre/Log.hpp"
 #include "sre/Resource.hpp"
 #include "sre/Renderer.hpp"
+#include "sre/impl/ProgramBinaryCache.hpp"
+#include "sre/impl/ShaderCompiler.hpp"
+#include "sre/impl/ShaderPreprocessor.hpp"
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
 
 using namespace std;
@@ -34,67 +44,31 @@ namespace sre {
         std::shared_ptr<Shader> skyboxProcedural;
         std::shared_ptr<Shader> blit;
         std::shared_ptr<Shader> unlitSprite;
+        std::shared_ptr<Shader> unlitSpriteInstanced;
         std::shared_ptr<Shader> standardParticles;
 
         long globalShaderCounter = 1;
 
-        // From https://stackoverflow.com/a/8473603/420250
-        template <typename Map>
-        bool map_compare (Map const &lhs, Map const &rhs) {
-            // No predicate needed because there is operator== for pairs already.
-            return lhs.size() == rhs.size()
-                   && std::equal(lhs.begin(), lhs.end(),
-                                 rhs.begin());
-        }
-
-        template<typename Out>
-        void split(const std::string &s, char delim, Out result) {
-            std::stringstream ss(s);
-            std::string item;
-            while (std::getline(ss, item, delim)) {
-                *(result++) = item;
-            }
-        }
+        using Clock = std::chrono::high_resolution_clock;
+        using Milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>;
 
-        std::vector<std::string> split(const std::string &s, char delim) {
-            std::vector<std::string> elems;
-            split(s, delim, std::back_inserter(elems));
-            return elems;
-        }
-
-        std::string pragmaInclude(std::string source, std::vector<std::string>& errors, uint32_t shaderType){
-            if (source.find("#pragma include")==-1) {
-                return source;
-            }
-            std::stringstream sstream;
-
-            std::regex e ( R"_(#pragma\s+include\s+"([^"]*)")_", std::regex::ECMAScript);
-            int lineNumber = 0;
-            std::vector<std::string> lines = split(source, '\n');
-            int includes = 0;
-            for (auto& s : lines)
+        // adds the CPU time used in scope to the shader build time and the total build time
+        class BuildTimer {
+        public:
+            BuildTimer(float& buildTime, float& totalBuildTime)
+            :buildTime(buildTime), totalBuildTime(totalBuildTime), start(Clock::now())
             {
-                lineNumber++;
-
-                std::smatch m;
-                if (std::regex_search (s,m,e)) {
-                    std::string match = m[1];
-                    auto res = Resource::loadText(match);
-                    if (res.empty()){
-                        errors.push_back(std::string("0:")+std::to_string(lineNumber)+" cannot find include file "+match+"##"+std::to_string(shaderType));
-                        sstream << s << "\n";
-                    } else {
-                        includes++;
-                        sstream << "#line "<<(includes*10000+1) <<"\n";
-                        sstream << res << "\n";
-                        sstream << "#line "<<lineNumber << "\n";
-                    }
-                } else {
-                    sstream << s << "\n";
-                }
             }
-            return sstream.str();
-        }
+            ~BuildTimer(){
+                float time = std::chrono::duration_cast<Milliseconds>(Clock::now() - start).count();
+                buildTime += time;
+                totalBuildTime += time;
+            }
+        private:
+            float& buildTime;
+            float& totalBuildTime;
+            Clock::time_point start;
+        };
 
         void logCurrentCompileInfo(GLuint &shader, GLenum type, vector<string> &errors, const std::string& source, const std::string name, bool compileSuccess) {
             GLint logSize = 0;
@@ -138,12 +112,7 @@ namespace sre {
             }
         }
 
-        bool linkProgram(GLuint mShaderProgram, std::vector<std::string>& errors){
-#ifndef EMSCRIPTEN
-            glBindFragDataLocation(mShaderProgram, 0, "fragColor");
-#endif
-            glLinkProgram(mShaderProgram);
-
+        bool linkStatus(GLuint mShaderProgram, std::vector<std::string>& errors){
             GLint  linked;
             glGetProgramiv(mShaderProgram, GL_LINK_STATUS, &linked );
             if (linked == GL_FALSE) {
@@ -225,6 +194,7 @@ namespace sre {
         std::shared_ptr<Shader> shader;
         if (updateShader){
             shader = updateShader->shared_from_this();
+            Renderer::instance->getShaderPreprocessor()->clear();    // sources may have changed
         } else {
             if (name.length()==0){
                 name = "Unnamed shader";
@@ -232,7 +202,12 @@ namespace sre {
             shader = std::shared_ptr<Shader>(new Shader());
             shader->specializationConstants = this->specializationConstants;
         }
-        bool compileSuccess = shader->build(shaderSources, errors);
+        bool compileSuccess = true;
+        if (async){
+            shader->beginBuild(shaderSources, errors);  // completed by ShaderCompiler
+        } else {
+            compileSuccess = shader->build(shaderSources, errors);
+        }
         if (!compileSuccess){
             if (!updateShader) {
                 shader.reset();
@@ -364,6 +339,11 @@ namespace sre {
         uniformLocationLightPosType = -1;
         uniformLocationLightColorRange = -1;
         uniformLocationCameraPosition = -1;
+        uniformLocationClusterLights = -1;
+        uniformLocationClusterGrid = -1;
+        uniformLocationClusterLightIndices = -1;
+        uniformLocationClusterSize = -1;
+        uniformLocationClusterDepth = -1;
         uniforms = std::make_shared<std::vector<Uniform>>();
 
         bool hasGlobalUniformBuffer = false;
@@ -415,6 +395,8 @@ namespace sre {
                     break;
                 case GL_SAMPLER_2D:
                 case GL_SAMPLER_2D_SHADOW:
+                case GL_SAMPLER_2D_ARRAY:
+                case GL_UNSIGNED_INT_SAMPLER_2D:
                     uniformType = UniformType::Texture;
                     break;
                 case GL_SAMPLER_CUBE:
@@ -441,7 +423,8 @@ namespace sre {
                 if (Renderer::instance->globalUniformBuffer){
                     if (strncmp(name, "g_model_it",64)!=0 &&
                         strncmp(name, "g_model_view_it",64)!=0 &&
-                        strncmp(name, "g_model",64)!=0){
+                        strncmp(name, "g_model",64)!=0 &&
+                        strncmp(name, "g_cluster",9)!=0){
                         if (!hasGlobalUniformBuffer){
                             // Check using old style non uniform buffer
                             LOG_ERROR("global uniform %s must be loaded using #pragma include \"global_uniforms_incl.glsl\"", name);
@@ -449,6 +432,20 @@ namespace sre {
                         continue;
                     }
                 }
+                if (strncmp(name, "g_cluster",9)==0){
+                    if (strcmp(name, "g_clusterLights")==0){
+                        uniformLocationClusterLights = location;
+                    } else if (strcmp(name, "g_clusterGrid")==0){
+                        uniformLocationClusterGrid = location;
+                    } else if (strcmp(name, "g_clusterLightIndices")==0){
+                        uniformLocationClusterLightIndices = location;
+                    } else if (strcmp(name, "g_clusterSize")==0){
+                        uniformLocationClusterSize = location;
+                    } else if (strcmp(name, "g_clusterDepth")==0){
+                        uniformLocationClusterDepth = location;
+                    }
+                    continue;
+                }
                 if (strcmp(name, "g_model")==0){
                     if (uniformType == UniformType::Mat4){
                         uniformLocationModel = location;
@@ -552,6 +549,7 @@ namespace sre {
         Renderer::instance->renderStats.shaderCount++;
 
         Renderer::instance->shaders.emplace_back(this);
+        uniforms = std::make_shared<std::vector<Uniform>>();
     }
 
     Shader::~Shader() {
@@ -561,11 +559,17 @@ namespace sre {
 
             r->shaders.erase(std::remove(r->shaders.begin(), r->shaders.end(), this));
 
+            for (auto & stage : pendingStages){
+                glDeleteShader(stage.shader);
+            }
+            if (pendingProgramId != 0){
+                glDeleteProgram(pendingProgramId);
+            }
             glDeleteShader(shaderProgramId);
         }
     }
 
-    bool Shader::setLights(WorldLights* worldLights){
+    bool Shader::setLights(WorldLights* worldLights, const std::vector<int>* lightIndices){
         int maxSceneLights = Renderer::instance->maxSceneLights;
         if (worldLights == nullptr){
             glUniform4f(uniformLocationAmbientLight, 0,0,0,0);
@@ -582,7 +586,12 @@ namespace sre {
 			std::vector<glm::vec4> lightPosType(maxSceneLights, glm::vec4(0));
 			std::vector<glm::vec4> lightColorRange(maxSceneLights, glm::vec4(0));
             for (int i=0;i<maxSceneLights;i++){
-                auto light = worldLights->getLight(i);
+                Light* light;
+                if (lightIndices){
+                    light = i < (int)lightIndices->size() ? worldLights->getLight((*lightIndices)[i]) : nullptr;
+                } else {
+                    light = worldLights->getLight(i);
+                }
                 if (light == nullptr || light->lightType == LightType::Unused) {
                     lightPosType[i] = glm::vec4(0.0f,0.0f,0.0f, 2);
                     continue;
@@ -771,6 +780,21 @@ namespace sre {
         return unlitSprite;
     }
 
+    std::shared_ptr<Shader> Shader::getUnlitSpriteInstanced() {
+        if (unlitSpriteInstanced != nullptr){
+            return unlitSpriteInstanced;
+        }
+
+        unlitSpriteInstanced =  create()
+                .withSourceResource("sprite_instanced_vert.glsl", ShaderType::Vertex)
+                .withSourceResource("sprite_frag.glsl", ShaderType::Fragment)
+                .withBlend(BlendType::AlphaBlending)
+                .withDepthTest(false)
+                .withName("Unlit Sprite Instanced")
+                .build();
+        return unlitSpriteInstanced;
+    }
+
     std::shared_ptr<Shader> Shader::getStandardPBR(){
         if (standardPBR != nullptr){
             return standardPBR;
@@ -818,45 +842,97 @@ namespace sre {
     }
 
     bool Shader::build(std::map<ShaderType,std::string> shaderSources, std::vector<std::string>& errors) {
-        unsigned int oldShaderProgramId = shaderProgramId;
-        shaderProgramId = glCreateProgram();
-        assert(shaderProgramId != 0);
-        std::vector<GLuint> shaders;
-
-        auto cleanupShaders = [&](){
-            for (auto id : shaders){
-                glDeleteShader(id);
+        beginBuild(std::move(shaderSources), errors);
+        return endBuild(errors);
+    }
+
+    void Shader::beginBuild(std::map<ShaderType,std::string> shaderSources, std::vector<std::string>& errors) {
+        buildTime = 0;
+        BuildTimer timer(buildTime, Renderer::instance->renderStats.shaderBuildTime);
+        // the preprocessed sources identifies the program in the program binary cache
+        std::map<uint32_t, std::string> preprocessedSources;
+        for (auto & s : shaderSources){
+            GLenum type = to_id(s.first);
+            preprocessedSources[type] = precompile(s.second, errors, type);
+        }
+        auto cache = Renderer::instance->getProgramBinaryCache();
+        pendingCacheKey = 0;
+        pendingProgramId = 0;
+        if (cache){
+            pendingCacheKey = cache->computeKey(preprocessedSources, specializationConstants);
+            pendingProgramId = cache->load(pendingCacheKey);
+            if (pendingProgramId != 0){
+                Renderer::instance->renderStats.shaderCacheHits++;
+            } else {
+                Renderer::instance->renderStats.shaderCacheMisses++;
             }
-        };
+        }
 
-        for (ShaderType i=ShaderType::Vertex;i<ShaderType::NumberOfShaderTypes;i = (ShaderType )((int)i+1)) {
-            auto shaderSourcesIter = shaderSources.find(i);
-            if (shaderSourcesIter!=shaderSources.end()) {
-                GLuint s;
-                GLenum shader = to_id(i);
-                bool res = compileShader(shaderSourcesIter->second, shader, s, errors);
-                if (!res) {
-                    cleanupShaders();
-                    glDeleteProgram( shaderProgramId );
-                    shaderProgramId = oldShaderProgramId;
-                    return false;
-                } else {
-                    shaders.push_back(s);
-                }
-                glAttachShader(shaderProgramId,  s);
+        if (pendingProgramId == 0){
+            pendingProgramId = glCreateProgram();
+            assert(pendingProgramId != 0);
+            for (auto & shaderSource : shaderSources) {
+                GLenum type = to_id(shaderSource.first);
+                PendingStage stage{glCreateShader(type), type, shaderSource.second, std::move(preprocessedSources[type])};
+                auto stringPtr = stage.source.c_str();
+                auto length = (GLint)stage.source.size();
+                glShaderSource(stage.shader, 1, &stringPtr, &length);
+                glCompileShader(stage.shader);          // the status is not queried before endBuild(), which allows the driver to compile in the background
+                glAttachShader(pendingProgramId, stage.shader);
+                pendingStages.push_back(std::move(stage));
+            }
+            if (cache){
+                cache->prepare(pendingProgramId);
             }
+#ifndef EMSCRIPTEN
+            glBindFragDataLocation(pendingProgramId, 0, "fragColor");
+#endif
+            glLinkProgram(pendingProgramId);
         }
+        compiling = true;
+    }
 
-        bool linked = linkProgram(shaderProgramId, errors);
-        cleanupShaders();
-        if (!linked) {
-            glDeleteProgram( shaderProgramId );
-            shaderProgramId = oldShaderProgramId; // revert to old shader
+    bool Shader::isBuildComplete() {
+        if (!compiling || pendingStages.empty() || !renderInfo().supportParallelShaderCompile){
+            return true;
+        }
+        GLint completed = GL_FALSE;
+        glGetProgramiv(pendingProgramId, GL_COMPLETION_STATUS_KHR, &completed);
+        return completed == GL_TRUE;
+    }
+
+    bool Shader::endBuild(std::vector<std::string>& errors) {
+        BuildTimer timer(buildTime, Renderer::instance->renderStats.shaderBuildTime);
+        compiling = false;
+        bool success = true;
+        for (auto & stage : pendingStages){
+            GLint compiled = GL_FALSE;
+            glGetShaderiv(stage.shader, GL_COMPILE_STATUS, &compiled);
+            logCurrentCompileInfo(stage.shader, stage.type, errors, stage.source, stage.resource, compiled == GL_TRUE);
+            success &= compiled == GL_TRUE;
+        }
+        bool compiledFromSource = !pendingStages.empty();
+        if (success && compiledFromSource){
+            success = linkStatus(pendingProgramId, errors);
+        }
+        for (auto & stage : pendingStages){
+            glDeleteShader(stage.shader);
+        }
+        pendingStages.clear();
+        if (!success) {
+            glDeleteProgram( pendingProgramId );
+            pendingProgramId = 0;               // keep old shader (if any)
             return false;
         }
-        if (oldShaderProgramId != 0){
-            glDeleteProgram( oldShaderProgramId ); // delete old shader if any
+        auto cache = Renderer::instance->getProgramBinaryCache();
+        if (cache && compiledFromSource){
+            cache->store(pendingCacheKey, pendingProgramId);
+        }
+        if (shaderProgramId != 0){
+            glDeleteProgram( shaderProgramId ); // delete old shader if any
         }
+        shaderProgramId = pendingProgramId;
+        pendingProgramId = 0;
         // setup global uniform
         if (Renderer::instance->globalUniformBuffer){
             glUseProgram(shaderProgramId);
@@ -915,59 +991,217 @@ namespace sre {
         return valid;
     }
 
+    Shader::SpecializationKey::SpecializationKey(std::map<std::string,std::string> specializationConstants, std::string key, size_t hash)
+    :specializationConstants(std::move(specializationConstants)), key(std::move(key)), hash(hash)
+    {
+    }
+
+    const std::map<std::string,std::string>& Shader::SpecializationKey::getSpecializationConstants() const {
+        return specializationConstants;
+    }
+
+    const std::string& Shader::SpecializationKey::getKey() const {
+        return key;
+    }
+
+    bool Shader::SpecializationKey::operator==(const SpecializationKey& other) const {
+        return hash == other.hash && key == other.key;
+    }
+
+    size_t Shader::SpecializationKey::getHash() const {
+        return hash;
+    }
+
+    Shader::SpecializationKey Shader::getSpecializationKey(std::map<std::string,std::string> specializationConstants) {
+        // names and values are length prefixed (std::map is sorted by name), so different constants never share a key
+        std::string key;
+        for (auto & sc : specializationConstants){
+            key += std::to_string(sc.first.size());
+            key += ':';
+            key += sc.first;
+            key += std::to_string(sc.second.size());
+            key += ':';
+            key += sc.second;
+        }
+        size_t hash = std::hash<std::string>()(key);
+        return SpecializationKey(std::move(specializationConstants), std::move(key), hash);
+    }
+
     std::shared_ptr<Material> Shader::createMaterial(std::map<std::string,std::string> specializationConstants) {
+        if (specializationConstants.empty()){
+            auto shader = parent ? parent : shared_from_this();
+            return std::shared_ptr<Material>(new Material(shader));
+        }
+        return createMaterial(getSpecializationKey(std::move(specializationConstants)));
+    }
+
+    std::shared_ptr<Material> Shader::createMaterial(const SpecializationKey& specializationKey) {
         if (parent){
-            return parent->createMaterial(std::move(specializationConstants));
+            return parent->createMaterial(specializationKey);
         }
-        if (!specializationConstants.empty()){
-            for (auto & s : specializations){
-                if (auto ptr = s.lock()){
-                    if (map_compare(specializationConstants, ptr->specializationConstants)){
-                        return std::shared_ptr<Material>(new Material(ptr));
-                    }
-                }
+        if (!specializationKey.specializationConstants.empty()){
+            auto specializedShader = findSpecialization(specializationKey);
+            if (specializedShader == nullptr){
+                specializedShader = createSpecialization(specializationKey, false);
+            } else if (specializedShader->compiling && !Renderer::instance->getShaderCompiler()->finish(specializedShader.get())){
+                specializedShader.reset();
             }
-            // no specialization shader found
-            auto res =  Shader::ShaderBuilder();
-            res.depthTest = this->depthTest;
-            res.depthWrite = this->depthWrite;
-            res.blend = this->blend;
-            res.name = this->name;
-            res.offset = this->offset;
-            bool isTwoSided = specializationConstants.find("S_TWO_SIDED") != specializationConstants.end();
-            res.cullFace = isTwoSided ? CullFace::None :this->cullFace;
-            res.shaderSources = this->shaderSources;
-            res.specializationConstants = specializationConstants;
-            auto specializedShader = res.build();
             if (specializedShader == nullptr){
                 LOG_WARNING("Cannot create specialized shader. Using shader without specialization.");
                 return std::shared_ptr<Material>(new Material(shared_from_this()));
             }
-            specializedShader->parent = shared_from_this();
-            specializations.push_back(std::weak_ptr<Shader>(specializedShader));
             return std::shared_ptr<Material>(new Material(specializedShader));
         }
         return std::shared_ptr<Material>(new Material(shared_from_this()));
     }
 
-    const std::string& Shader::getName() {
-        return name;
+    std::shared_ptr<Material> Shader::createMaterialAsync(std::map<std::string,std::string> specializationConstants) {
+        if (specializationConstants.empty()){
+            return createMaterial();
+        }
+        return createMaterialAsync(getSpecializationKey(std::move(specializationConstants)));
+    }
+
+    std::shared_ptr<Material> Shader::createMaterialAsync(const SpecializationKey& specializationKey) {
+        if (parent){
+            return parent->createMaterialAsync(specializationKey);
+        }
+        if (specializationKey.specializationConstants.empty()){
+            return createMaterial();
+        }
+        auto specializedShader = findSpecialization(specializationKey);
+        if (specializedShader == nullptr){
+            specializedShader = createSpecialization(specializationKey, true);
+        }
+        if (specializedShader != nullptr && !specializedShader->compiling){
+            return std::shared_ptr<Material>(new Material(specializedShader));
+        }
+        // render using this shader until the specialization is compiled
+        auto material = std::shared_ptr<Material>(new Material(shared_from_this()));
+        if (specializedShader){
+            Renderer::instance->getShaderCompiler()->addMaterial(specializedShader.get(), material);
+        }
+        return material;
+    }
+
+    void Shader::warmup(const std::vector<std::map<std::string,std::string>>& specializations) {
+        if (parent){
+            parent->warmup(specializations);
+            return;
+        }
+        for (auto & specializationConstants : specializations){
+            if (specializationConstants.empty()){
+                continue;
+            }
+            auto specializationKey = getSpecializationKey(specializationConstants);
+            if (findSpecialization(specializationKey)){
+                continue;
+            }
+            auto specializedShader = createSpecialization(specializationKey, true);
+            if (specializedShader){
+                warmedUp.push_back(specializedShader);
+            }
+        }
     }
 
-    bool Shader::compileShader(std::string& resource, GLenum type, GLuint& shader, std::vector<std::string>& errors){
-        auto source = Resource::loadText(resource);
-        std::string source_ = precompile(source, errors, type);
-        shader = glCreateShader(type);
-        auto stringPtr = source_.c_str();
-        auto length = (GLint)strlen(stringPtr);
-        glShaderSource(shader, 1, &stringPtr, &length);
-        glCompileShader(shader);
-        GLint success = 0;
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    void Shader::releaseWarmup() {
+        if (parent){
+            parent->releaseWarmup();
+            return;
+        }
+        warmedUp.clear();
+    }
 
-        logCurrentCompileInfo(shader, type, errors, source_, resource, success==1);
+    bool Shader::isCompiling() {
+        return compiling;
+    }
 
-        return success == 1;
+    float Shader::getBuildTime() {
+        return buildTime;
+    }
+
+    int Shader::getCompilingCount() {
+        if (Renderer::instance == nullptr){
+            return 0;
+        }
+        return Renderer::instance->getShaderCompiler()->getCompilingCount();
+    }
+
+    std::shared_ptr<Shader> Shader::findSpecialization(const SpecializationKey& specializationKey) {
+        auto iter = specializations.find(specializationKey);
+        if (iter == specializations.end()){
+            return nullptr;
+        }
+        auto ptr = iter->second.lock();
+        if (ptr == nullptr){
+            specializations.erase(iter);
+        }
+        return ptr;
+    }
+
+    void Shader::removeSpecialization(Shader* shader) {
+        if (shader->specializationKey == nullptr){
+            return;
+        }
+        auto iter = specializations.find(*shader->specializationKey);
+        if (iter != specializations.end()){
+            auto ptr = iter->second.lock();
+            if (ptr == nullptr || ptr.get() == shader){
+                specializations.erase(iter);
+            }
+        }
+        warmedUp.erase(std::remove_if(warmedUp.begin(), warmedUp.end(), [&](const std::shared_ptr<Shader>& s){
+            return s.get() == shader;
+        }), warmedUp.end());
+    }
+
+    void Shader::pruneSpecializations() {
+        for (auto iter = specializations.begin(); iter != specializations.end(); ){
+            if (iter->second.expired()){
+                iter = specializations.erase(iter);
+            } else {
+                iter++;
+            }
+        }
+    }
+
+    int Shader::getSpecializationCount() {
+        if (parent){
+            return parent->getSpecializationCount();
+        }
+        pruneSpecializations();
+        return (int)specializations.size();
+    }
+
+    std::shared_ptr<Shader> Shader::createSpecialization(const SpecializationKey& specializationKey, bool async) {
+        auto& specializationConstants = specializationKey.specializationConstants;
+        auto res =  Shader::ShaderBuilder();
+        res.depthTest = this->depthTest;
+        res.depthWrite = this->depthWrite;
+        res.blend = this->blend;
+        res.name = this->name;
+        res.offset = this->offset;
+        bool isTwoSided = specializationConstants.find("S_TWO_SIDED") != specializationConstants.end();
+        res.cullFace = isTwoSided ? CullFace::None :this->cullFace;
+        res.shaderSources = this->shaderSources;
+        res.specializationConstants = specializationConstants;
+        res.async = async;
+        auto specializedShader = res.build();
+        if (specializedShader == nullptr){
+            return nullptr;
+        }
+        specializedShader->parent = shared_from_this();
+        specializedShader->specializationKey.reset(new SpecializationKey(specializationKey));
+        pruneSpecializations();
+        specializations[specializationKey] = specializedShader;
+        if (async){
+            Renderer::instance->getShaderCompiler()->add(specializedShader);
+        }
+        return specializedShader;
+    }
+
+    const std::string& Shader::getName() {
+        return name;
     }
 
     std::pair<int, int> Shader::getAttibuteType(const std::string &name) {
@@ -979,18 +1213,29 @@ namespace sre {
         return offset;
     }
 
-    std::string Shader::precompile(std::string source, std::vector<std::string>& errors, uint32_t shaderType) {
-        // Replace includes with content
-        // for each occurrence of #pragma include replace with substitute
-        source = pragmaInclude(source, errors, shaderType);
-
-        // Insert preprocessor define symbols
-        source = insertPreprocessorDefines(source, specializationConstants, shaderType);
-
+    std::string Shader::precompile(const std::string& resource, std::vector<std::string>& errors, uint32_t shaderType) {
+        auto preprocessor = Renderer::instance->getShaderPreprocessor();
+        int glslVersion = 330;
         if (renderInfo().graphicsAPIVersionES) {
-            source = Shader::translateToGLSLES(source, shaderType == GL_VERTEX_SHADER, renderInfo().graphicsAPIVersionMajor<=2?100:300);
+            glslVersion = renderInfo().graphicsAPIVersionMajor<=2?100:300;
         }
-        return source;
+        auto key = ShaderPreprocessor::getKey(resource, shaderType, getSpecializationKey(specializationConstants).getKey(), glslVersion);
+        auto entry = preprocessor->find(key);
+        if (entry == nullptr){
+            // Replace includes with content
+            // for each occurrence of #pragma include replace with substitute
+            ShaderPreprocessor::Entry res = preprocessor->expandIncludes(resource, shaderType);
+
+            // Insert preprocessor define symbols
+            res.source = insertPreprocessorDefines(res.source, specializationConstants, shaderType);
+
+            if (renderInfo().graphicsAPIVersionES) {
+                res.source = Shader::translateToGLSLES(res.source, shaderType == GL_VERTEX_SHADER, glslVersion);
+            }
+            entry = &preprocessor->store(key, std::move(res));
+        }
+        errors.insert(errors.end(), entry->errors.begin(), entry->errors.end());
+        return entry->source;
     }
 
     Shader::ShaderBuilder Shader::update() {
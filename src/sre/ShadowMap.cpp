@@ -0,0 +1,379 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/ShadowMap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "sre/Camera.hpp"
+#include "sre/Framebuffer.hpp"
+#include "sre/Texture.hpp"
+#include "sre/Material.hpp"
+#include "sre/Mesh.hpp"
+#include "sre/Shader.hpp"
+#include "sre/RenderPass.hpp"
+#include "sre/Renderer.hpp"
+#include "sre/Log.hpp"
+#include "sre/impl/GL.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace sre {
+    namespace {
+        // transforms the box into the space and returns the bounds
+        void transformBounds(const glm::mat4& transform, glm::vec3 boundsMin, glm::vec3 boundsMax, glm::vec3& resMin, glm::vec3& resMax){
+            resMin = glm::vec3(std::numeric_limits<float>::max());
+            resMax = glm::vec3(-std::numeric_limits<float>::max());
+            for (int i=0;i<8;i++){
+                glm::vec3 corner((i&1) ? boundsMax.x : boundsMin.x,
+                                 (i&2) ? boundsMax.y : boundsMin.y,
+                                 (i&4) ? boundsMax.z : boundsMin.z);
+                glm::vec3 p = glm::vec3(transform * glm::vec4(corner, 1.0f));
+                resMin = glm::min(resMin, p);
+                resMax = glm::max(resMax, p);
+            }
+        }
+
+        // near and far plane distance of a perspective or orthographic projection matrix
+        void nearFar(const glm::mat4& projection, float& near, float& far){
+            if (projection[3][3] == 0){     // perspective
+                near = projection[3][2] / (projection[2][2] - 1.0f);
+                far = projection[3][2] / (projection[2][2] + 1.0f);
+            } else {                        // orthographic
+                near = (projection[3][2] + 1.0f) / projection[2][2];
+                far = (projection[3][2] - 1.0f) / projection[2][2];
+            }
+        }
+
+        float snap(float value, float step){
+            return std::round(value / step) * step;
+        }
+    }
+
+    ShadowMap::ShadowMapBuilder ShadowMap::create() {
+        return ShadowMapBuilder();
+    }
+
+    ShadowMap::ShadowMapBuilder &ShadowMap::ShadowMapBuilder::withSize(int size) {
+        this->size = size;
+        return *this;
+    }
+
+    ShadowMap::ShadowMapBuilder &ShadowMap::ShadowMapBuilder::withCascades(int cascades) {
+        this->cascades = cascades;
+        return *this;
+    }
+
+    ShadowMap::ShadowMapBuilder &ShadowMap::ShadowMapBuilder::withSplitLambda(float lambda) {
+        this->splitLambda = lambda;
+        return *this;
+    }
+
+    ShadowMap::ShadowMapBuilder &ShadowMap::ShadowMapBuilder::withShadowDistance(float distance) {
+        this->shadowDistance = distance;
+        return *this;
+    }
+
+    ShadowMap::ShadowMapBuilder &ShadowMap::ShadowMapBuilder::withCasterDistance(float distance) {
+        this->casterDistance = distance;
+        return *this;
+    }
+
+    ShadowMap::ShadowMapBuilder &ShadowMap::ShadowMapBuilder::withName(const std::string &name) {
+        this->name = name;
+        return *this;
+    }
+
+    std::shared_ptr<ShadowMap> ShadowMap::ShadowMapBuilder::build() {
+        auto& info = renderInfo();
+        if ((info.graphicsAPIVersionES && info.graphicsAPIVersionMajor <= 2) || !info.supportFBODepthAttachment){
+            LOG_ERROR("ShadowMap requires OpenGL 3.3 / OpenGL ES 3.0");
+            return nullptr;
+        }
+        if (cascades < 2 || cascades > 4){
+            LOG_WARNING("ShadowMap cascades must be between 2 and 4 (was %i)", cascades);
+            cascades = glm::clamp(cascades, 2, 4);
+        }
+        GLint maxTextureSize;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+        if (size * cascades > maxTextureSize){
+            LOG_WARNING("ShadowMap size %i exceeds max texture size for %i cascades", size, cascades);
+            size = maxTextureSize / cascades;
+        }
+        if (name.empty()){
+            name = "ShadowMap";
+        }
+        return std::shared_ptr<ShadowMap>(new ShadowMap(*this));
+    }
+
+    ShadowMap::ShadowMap(const ShadowMapBuilder& builder)
+    :name(builder.name), size(builder.size), splitLambda(builder.splitLambda),
+     shadowDistance(builder.shadowDistance), casterDistance(builder.casterDistance),
+     cascades(builder.cascades)
+    {
+        for (int i=0;i<2;i++){
+            auto tex = Texture::create()
+                    .withName(name + (i==0 ? " static" : " dynamic"))
+                    .withGenerateMipmaps(false)
+                    .withFilterSampling(true)
+                    .withWrapUV(Texture::Wrap::ClampToEdge)
+                    .withDepth(size * (int)cascades.size(), size, Texture::DepthPrecision::I24)
+                    .build();
+            auto framebuffer = Framebuffer::create()
+                    .withName(tex->getName())
+                    .withDepthTexture(tex)
+                    .build();
+            if (i==0){
+                staticTexture = tex;
+                staticFramebuffer = framebuffer;
+            } else {
+                dynamicTexture = tex;
+                dynamicFramebuffer = framebuffer;
+            }
+        }
+        casterMaterial = Shader::getShadow()->createMaterial();
+        casterMaterial->setName(name + " caster");
+        viewProjOffsets = std::make_shared<std::vector<glm::mat4>>(cascades.size(), glm::mat4(1));
+    }
+
+    ShadowMap::~ShadowMap() = default;
+
+    ShadowMap::Caster ShadowMap::createCaster(std::shared_ptr<Mesh> mesh, glm::mat4 modelTransform) {
+        Caster caster;
+        auto bounds = mesh->getBoundsMinMax();
+        transformBounds(modelTransform, bounds[0], bounds[1], caster.boundsMin, caster.boundsMax);
+        caster.mesh = std::move(mesh);
+        caster.modelTransform = modelTransform;
+        return caster;
+    }
+
+    int ShadowMap::addStaticCaster(std::shared_ptr<Mesh> mesh, glm::mat4 modelTransform) {
+        int id = nextCasterId++;
+        auto& caster = staticCasters[id];
+        caster = createCaster(std::move(mesh), modelTransform);
+        invalidate(caster);
+        return id;
+    }
+
+    void ShadowMap::setStaticCasterTransform(int id, glm::mat4 modelTransform) {
+        auto res = staticCasters.find(id);
+        if (res == staticCasters.end()){
+            LOG_WARNING("Cannot find static caster %i in %s", id, name.c_str());
+            return;
+        }
+        invalidate(res->second);                            // old position
+        res->second = createCaster(res->second.mesh, modelTransform);
+        invalidate(res->second);                            // new position
+    }
+
+    void ShadowMap::removeStaticCaster(int id) {
+        auto res = staticCasters.find(id);
+        if (res == staticCasters.end()){
+            LOG_WARNING("Cannot find static caster %i in %s", id, name.c_str());
+            return;
+        }
+        invalidate(res->second);
+        staticCasters.erase(res);
+    }
+
+    void ShadowMap::drawDynamic(std::shared_ptr<Mesh> mesh, glm::mat4 modelTransform) {
+        dynamicCasters.push_back(createCaster(std::move(mesh), modelTransform));
+    }
+
+    void ShadowMap::invalidate(const Caster& caster) {
+        for (auto& cascade : cascades){
+            if (cascade.valid && overlaps(cascade, caster)){
+                cascade.valid = false;
+            }
+        }
+    }
+
+    bool ShadowMap::overlaps(const Cascade& cascade, const Caster& caster) {
+        // compare bounds in clip space of the cascade
+        glm::vec3 clipMin, clipMax;
+        transformBounds(cascade.projection * cascade.view, caster.boundsMin, caster.boundsMax, clipMin, clipMax);
+        return clipMax.x >= -1 && clipMin.x <= 1 &&
+               clipMax.y >= -1 && clipMin.y <= 1 &&
+               clipMax.z >= -1 && clipMin.z <= 1;
+    }
+
+    void ShadowMap::update(Camera& camera, glm::vec3 lightDirection) {
+        glm::vec2 viewportSize = glm::vec2(Renderer::instance->getDrawableSize()) * camera.viewportSize;
+        glm::mat4 cameraProjection = camera.getProjectionTransform(glm::uvec2(glm::max(viewportSize, glm::vec2(1))));
+        glm::mat4 cameraView = camera.getViewTransform();
+        float near, far;
+        nearFar(cameraProjection, near, far);
+        float distance = shadowDistance > 0 ? std::min(shadowDistance, far) : far;
+
+        // world space corners of the near and far plane
+        glm::mat4 viewProjectionInv = glm::inverse(cameraProjection * cameraView);
+        glm::vec3 nearCorners[4];
+        glm::vec3 farCorners[4];
+        for (int i=0;i<4;i++){
+            glm::vec2 ndc((i&1) ? 1.0f : -1.0f, (i&2) ? 1.0f : -1.0f);
+            glm::vec4 n = viewProjectionInv * glm::vec4(ndc, -1, 1);
+            glm::vec4 f = viewProjectionInv * glm::vec4(ndc, 1, 1);
+            nearCorners[i] = glm::vec3(n) / n.w;
+            farCorners[i] = glm::vec3(f) / f.w;
+        }
+
+        lightDirection = glm::normalize(lightDirection);
+        glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0,0,1) : glm::vec3(0,1,0);
+        glm::mat4 lightView = glm::lookAt(glm::vec3(0), -lightDirection, up);
+
+        int count = (int)cascades.size();
+        float sliceNear = near;
+        float logNear = std::max(near, 0.001f);
+        for (int i=0;i<count;i++){
+            float p = (i+1) / (float)count;
+            float logSplit = logNear * std::pow(distance / logNear, p);
+            float uniformSplit = near + (distance - near) * p;
+            float split = glm::mix(uniformSplit, logSplit, splitLambda);
+
+            // bounding sphere of the frustum slice
+            glm::vec3 corners[8];
+            glm::vec3 center(0);
+            for (int j=0;j<4;j++){
+                corners[j] = glm::mix(nearCorners[j], farCorners[j], (sliceNear - near) / (far - near));
+                corners[j+4] = glm::mix(nearCorners[j], farCorners[j], (split - near) / (far - near));
+                center += corners[j] + corners[j+4];
+            }
+            center /= 8.0f;
+            float radius = 0;
+            for (auto& corner : corners){
+                radius = std::max(radius, glm::length(corner - center));
+            }
+            radius = std::ceil(radius * 16.0f) / 16.0f;     // keep the cascade size constant when the camera moves
+
+            // snap the cascade to a coarse grid of whole texels, so the cascade only moves (and is re-rendered)
+            // when the camera has moved a part of the cascade. The cascade is enlarged to contain the slice after snapping.
+            float halfSize = radius * 1.25f;
+            float texel = 2.0f * halfSize / size;
+            float step = std::max(1.0f, std::round(0.5f * radius / texel)) * texel;
+            glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1));
+            lightCenter = glm::vec3(snap(lightCenter.x, step), snap(lightCenter.y, step), snap(lightCenter.z, step));
+
+            glm::mat4 projection = glm::ortho(lightCenter.x - halfSize, lightCenter.x + halfSize,
+                                              lightCenter.y - halfSize, lightCenter.y + halfSize,
+                                              -(lightCenter.z + halfSize + casterDistance), -(lightCenter.z - halfSize));
+            auto& cascade = cascades[i];
+            if (cascade.view != lightView || cascade.projection != projection){
+                cascade.view = lightView;
+                cascade.projection = projection;
+                cascade.valid = false;
+            }
+            cascade.split = split;
+            sliceNear = split;
+        }
+
+        // render static casters of the invalid cascades
+        cascadesRendered = 0;
+        std::vector<Caster*> casters;
+        for (int i=0;i<count;i++){
+            if (cascades[i].valid){
+                continue;
+            }
+            casters.clear();
+            for (auto& caster : staticCasters){
+                casters.push_back(&caster.second);
+            }
+            render(i, casters, staticFramebuffer, true);
+            cascades[i].valid = true;
+            cascadesRendered++;
+        }
+
+        // render dynamic casters on top of a copy of the static casters
+        if (dynamicCasters.empty()){
+            texture = staticTexture;
+        } else {
+            glDisable(GL_SCISSOR_TEST);                     // the blit is clipped by the scissor of the last render pass
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFramebuffer->frameBufferObjectId);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, dynamicFramebuffer->frameBufferObjectId);
+            glBlitFramebuffer(0, 0, size * count, size, 0, 0, size * count, size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            casters.clear();
+            for (auto& caster : dynamicCasters){
+                casters.push_back(&caster);
+            }
+            for (int i=0;i<count;i++){
+                render(i, casters, dynamicFramebuffer, false);
+            }
+            dynamicCasters.clear();
+            texture = dynamicTexture;
+        }
+
+        static glm::mat4 offset = glm::translate(glm::mat4(1), glm::vec3(0.5f)) * glm::scale(glm::mat4(1), glm::vec3(0.5f));
+        for (int i=0;i<count;i++){
+            (*viewProjOffsets)[i] = offset * cascades[i].projection * cascades[i].view;
+        }
+    }
+
+    void ShadowMap::render(int cascade, std::vector<Caster*>& casters, std::shared_ptr<Framebuffer>& framebuffer, bool clear) {
+        int count = (int)cascades.size();
+        Camera camera;
+        camera.setViewTransform(cascades[cascade].view);
+        camera.setProjectionTransform(cascades[cascade].projection);
+        camera.setViewport({cascade / (float)count, 0}, {1.0f / count, 1});
+        auto renderPass = RenderPass::create()
+                .withName(name)
+                .withCamera(camera)
+                .withFramebuffer(framebuffer)
+                .withClearColor(false)
+                .withClearDepth(clear, 1)
+                .withLightSelection(false)
+                .withGUI(false)
+                .build();
+        for (auto caster : casters){
+            if (!overlaps(cascades[cascade], *caster)){
+                continue;
+            }
+            int indexSets = caster->mesh->getIndexSets();
+            if (indexSets <= 1){
+                renderPass.draw(caster->mesh, caster->modelTransform, casterMaterial);
+            } else {
+                renderPass.draw(caster->mesh, caster->modelTransform, std::vector<std::shared_ptr<Material>>(indexSets, casterMaterial));
+            }
+        }
+    }
+
+    void ShadowMap::setUniforms(const std::shared_ptr<Material>& material) {
+        if (texture){
+            material->set("shadowMap", texture);
+        }
+        material->set("shadowViewProjOffsets", viewProjOffsets);
+        glm::vec4 splits(0);
+        for (int i=0;i<4;i++){
+            splits[i] = cascades[std::min(i, (int)cascades.size()-1)].split;
+        }
+        material->set("shadowCascadeSplits", splits);
+    }
+
+    std::map<std::string, std::string> ShadowMap::getSpecializationConstants() {
+        return {{"S_SHADOW", "1"}, {"S_SHADOW_CASCADES", std::to_string(cascades.size())}};
+    }
+
+    std::shared_ptr<Texture> ShadowMap::getTexture() {
+        return texture;
+    }
+
+    int ShadowMap::getCascadeCount() {
+        return (int)cascades.size();
+    }
+
+    float ShadowMap::getCascadeSplit(int cascade) {
+        return cascades[cascade].split;
+    }
+
+    int ShadowMap::getCascadesRendered() {
+        return cascadesRendered;
+    }
+
+    const std::string &ShadowMap::getName() {
+        return name;
+    }
+}
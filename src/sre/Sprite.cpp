@@ -15,12 +15,12 @@
 
 
 sre::Sprite::Sprite(glm::ivec2 spritePos, glm::ivec2 spriteSize,glm::ivec2 spriteSourcePos,
-                    glm::ivec2 spriteSourceSize, glm::vec2  spriteAnchor, Texture* texture)
+                    glm::ivec2 spriteSourceSize, glm::vec2  spriteAnchor, Texture* texture, int layer)
 :spritePos(spritePos),spriteSize(spriteSize),spriteSourcePos(spriteSourcePos),spriteSourceSize(spriteSourceSize),
- spriteAnchor(spriteAnchor),texture(texture)
+ spriteAnchor(spriteAnchor),texture(texture),layer(layer)
 {
     order.globalOrder = 0;
-    order.details.texture = (uint32_t)texture->textureId;
+    order.details.texture = (uint16_t)texture->textureId;
 }
 
 float sre::Sprite::getRotation() const {
@@ -91,6 +91,10 @@ const glm::vec2 &sre::Sprite::getSpriteAnchor() const {
     return spriteAnchor;
 }
 
+int sre::Sprite::getLayer() const {
+    return layer;
+}
+
 sre::Sprite::Sprite()
 :spritePos{0,0},
  spriteSize{0,0},
@@ -112,7 +116,8 @@ sre::Sprite::Sprite(const Sprite &s)
          spriteSourcePos(s.spriteSourcePos),
          spriteSourceSize(s.spriteSourceSize),
          spriteAnchor(s.spriteAnchor),
-         texture(s.texture)
+         texture(s.texture),
+         layer(s.layer)
 {
     this->order.globalOrder = s.order.globalOrder;
 }
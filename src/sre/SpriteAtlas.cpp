@@ -10,8 +10,14 @@
 #include "sre/Sprite.hpp"
 #include "sre/Texture.hpp"
 #include "sre/Log.hpp"
+#include "sre/impl/GL.hpp"
+#include "sre/impl/RectPacker.hpp"
 #include "picojson.h"
 
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
 #include <fstream>
 #include <string>
 #include <cstring>
@@ -24,72 +30,186 @@
 using namespace std;
 
 namespace sre {
+namespace {
+    // The atlas json is parsed using picojson parse contexts, which receives the values while they are read from the
+    // stream (no picojson::value tree is built). Values not handled by a context are skipped by null_parse_context.
+
+    class ValueContext : public picojson::null_parse_context {          // reads a number, bool or string
+    public:
+        bool set_bool(bool b){
+            boolean = b;
+            return true;
+        }
+#ifdef PICOJSON_USE_INT64
+        bool set_int64(int64_t i){
+            number = (double)i;
+            return true;
+        }
+#endif
+        bool set_number(double f){
+            number = f;
+            return true;
+        }
+        template <typename Iter> bool parse_string(picojson::input<Iter>& in){
+            return picojson::_parse_string(string, in);
+        }
+        double number = 0;
+        bool boolean = false;
+        std::string string;
+    };
+
+    class RectContext : public picojson::null_parse_context {           // reads {"x":0,"y":0,"w":0,"h":0}
+    public:
+        bool parse_object_start(){
+            found = true;
+            return true;
+        }
+        template <typename Iter> bool parse_object_item(picojson::input<Iter>& in, const std::string& key){
+            ValueContext value;
+            if (!picojson::_parse(value, in)){
+                return false;
+            }
+            float v = (float)value.number;
+            if (key == "x"){
+                rect.x = v;
+            } else if (key == "y"){
+                rect.y = v;
+            } else if (key == "w"){
+                rect.z = v;
+            } else if (key == "h"){
+                rect.w = v;
+            }
+            return true;
+        }
+        glm::vec4 rect{0};                                              // x, y, w, h
+        bool found = false;
+    };
+
+    class FrameContext : public picojson::null_parse_context {          // reads a sprite element of the frames array
+    public:
+        template <typename Iter> bool parse_object_item(picojson::input<Iter>& in, const std::string& key){
+            if (key == "frame"){
+                return picojson::_parse(frame, in);
+            } else if (key == "spriteSourceSize"){
+                return picojson::_parse(spriteSourceSize, in);
+            } else if (key == "sourceSize"){
+                return picojson::_parse(sourceSize, in);
+            } else if (key == "pivot"){
+                return picojson::_parse(pivot, in);
+            } else if (key == "filename" || key == "rotated" || key == "trimmed"){
+                ValueContext value;
+                if (!picojson::_parse(value, in)){
+                    return false;
+                }
+                if (key == "filename"){
+                    filename = std::move(value.string);
+                } else if (key == "rotated"){
+                    rotated = value.boolean;
+                } else {
+                    trimmed = value.boolean;
+                }
+                return true;
+            }
+            return null_parse_context::parse_object_item(in, key);
+        }
+        std::string filename;
+        RectContext frame;
+        RectContext spriteSourceSize;
+        RectContext sourceSize;
+        RectContext pivot;
+        bool rotated = false;
+        bool trimmed = false;
+    };
+
+    class AtlasContext : public picojson::null_parse_context {          // reads {"frames": [...]}
+    public:
+        explicit AtlasContext(std::function<void(FrameContext&)> frameParsed)
+        :frameParsed(std::move(frameParsed))
+        {
+        }
+        template <typename Iter> bool parse_object_item(picojson::input<Iter>& in, const std::string& key){
+            if (key != "frames" || depth != 0){
+                return null_parse_context::parse_object_item(in, key);
+            }
+            depth++;
+            bool res = picojson::_parse(*this, in);
+            depth--;
+            return res;
+        }
+        template <typename Iter> bool parse_array_item(picojson::input<Iter>& in, size_t){
+            if (depth != 1){
+                return null_parse_context::parse_array_item(in, 0);
+            }
+            FrameContext frame;
+            if (!picojson::_parse(frame, in)){
+                return false;
+            }
+            frameParsed(frame);
+            return true;
+        }
+    private:
+        std::function<void(FrameContext&)> frameParsed;
+        int depth = 0;                                                  // 1 when parsing the frames array
+    };
+}
+
 SpriteAtlas::SpriteAtlas(std::map<std::string, Sprite>&& sprites, std::shared_ptr<Texture> texture, std::string atlasName)
         :atlasName{atlasName}
 {
+    // the map is sorted by name, so the handle of a sprite is its index in getNames()
     for (auto & s : sprites){
-        this->sprites.insert({s.first,s.second});
+        handles.insert({s.first,(int)this->sprites.size()});
+        names.push_back(s.first);
+        this->sprites.push_back(s.second);
     }
     this->texture = texture;
     sre::Renderer::instance->spriteAtlases.push_back(this);
 }
 
 std::shared_ptr<SpriteAtlas> SpriteAtlas::create(std::string jsonFile, std::shared_ptr<Texture> texture, bool flipAnchorY) {
-    picojson::value v;
-    std::ifstream t(jsonFile);
-    if (!t){
-        cerr << "SpriteAtlas json not found "<<jsonFile<< endl;
-        return std::shared_ptr<SpriteAtlas>(nullptr);
-    } else {
-        t >> v;
-    }
-    std::string err = picojson::get_last_error();
-    if (err != ""){
-        cerr << err << endl;
-        return std::shared_ptr<SpriteAtlas>(nullptr);
-    }
     std::map<std::string, Sprite> sprites;
-    picojson::array list = v.get("frames").get<picojson::array>();
-
-    for (picojson::value& spriteElement : list){
-        string name = spriteElement.get("filename").get<string>();
+    auto frameParsed = [&](FrameContext& frame){
         // "frame": {"x":154,"y":86,"w":92,"h":44},
         // "pivot": {"x":0.5,"y":0.5}
         // "trimmed": true,
         // "rotated": false, // rotated sprites not supported
         // "spriteSourceSize": {"x":121,"y":94,"w":117,"h":131},
         // "sourceSize": {"w":256,"h":257},
+        if (frame.filename.empty() || !frame.frame.found){
+            LOG_WARNING("Sprite without filename or frame ignored in %s", jsonFile.c_str());
+            return;
+        }
         glm::ivec2 pos;
         glm::ivec2 size;
         glm::ivec2 sourcePos;
         glm::ivec2 sourceSize;
 
         glm::vec2 pivot;
-        pos.x = (int)spriteElement.get("frame").get("x").get<double>();
-        pos.y = (int)spriteElement.get("frame").get("y").get<double>();
+        pos.x = (int)frame.frame.rect.x;
+        pos.y = (int)frame.frame.rect.y;
 
-        size.x = (int)spriteElement.get("frame").get("w").get<double>();
-        size.y = (int)spriteElement.get("frame").get("h").get<double>();
+        size.x = (int)frame.frame.rect.z;
+        size.y = (int)frame.frame.rect.w;
 
-        if (spriteElement.contains("rotated") && spriteElement.get("rotated").get<bool>()){
+        if (frame.rotated){
             LOG_ERROR("Rotated sprites not supported: %s", jsonFile.c_str());
         }
 
-        if (spriteElement.contains("trimmed") && spriteElement.get("trimmed").get<bool>()){
-            sourcePos.x = (int)spriteElement.get("spriteSourceSize").get("x").get<double>();
-            sourcePos.y = (int)spriteElement.get("spriteSourceSize").get("y").get<double>();
-            sourceSize.x = (int)spriteElement.get("sourceSize").get("w").get<double>();
-            sourceSize.y = (int)spriteElement.get("sourceSize").get("h").get<double>();
-            float spriteHeight = (int)spriteElement.get("spriteSourceSize").get("h").get<double>();
+        if (frame.trimmed){
+            sourcePos.x = (int)frame.spriteSourceSize.rect.x;
+            sourcePos.y = (int)frame.spriteSourceSize.rect.y;
+            sourceSize.x = (int)frame.sourceSize.rect.z;
+            sourceSize.y = (int)frame.sourceSize.rect.w;
+            float spriteHeight = (int)frame.spriteSourceSize.rect.w;
             sourcePos.y = sourceSize.y - sourcePos.y - spriteHeight;
         } else {
             sourcePos = {0,0};
             sourceSize = size;
         }
         pos.y = texture->getHeight()-pos.y-size.y;
-        if (spriteElement.contains("pivot")){
-            pivot.x = (float)spriteElement.get("pivot").get("x").get<double>();
-            pivot.y = (float)spriteElement.get("pivot").get("y").get<double>();
+        if (frame.pivot.found){
+            pivot.x = frame.pivot.rect.x;
+            pivot.y = frame.pivot.rect.y;
         } else {
             pivot.x = 0.5f;
             pivot.y = 0.5f;
@@ -98,7 +218,20 @@ std::shared_ptr<SpriteAtlas> SpriteAtlas::create(std::string jsonFile, std::shar
             pivot.y = 1.0f - pivot.y;
         }
         Sprite sprite(pos,size,sourcePos,sourceSize,pivot,texture.get());
-        sprites.emplace(std::pair<std::string, Sprite>(name, std::move(sprite)));
+        sprites.emplace(std::pair<std::string, Sprite>(std::move(frame.filename), std::move(sprite)));
+    };
+
+    std::ifstream t(jsonFile);
+    if (!t){
+        cerr << "SpriteAtlas json not found "<<jsonFile<< endl;
+        return std::shared_ptr<SpriteAtlas>(nullptr);
+    }
+    AtlasContext context(frameParsed);
+    std::string err;
+    picojson::_parse(context, std::istreambuf_iterator<char>(t), std::istreambuf_iterator<char>(), &err);
+    if (err != ""){
+        cerr << err << endl;
+        return std::shared_ptr<SpriteAtlas>(nullptr);
     }
     return std::shared_ptr<SpriteAtlas>(new SpriteAtlas(std::move(sprites), texture, jsonFile));
 }
@@ -108,20 +241,167 @@ std::shared_ptr<SpriteAtlas> SpriteAtlas::create(std::string jsonFile, std::stri
     return create(jsonFile, texture, flipAnchorY);
 }
 
-std::vector<std::string> SpriteAtlas::getNames() {
-    std::vector<std::string> res;
-    for (auto & e : sprites){
-        res.push_back(e.first);
+std::shared_ptr<SpriteAtlas> SpriteAtlas::createPacked(std::vector<std::string> imageFiles, std::string atlasName, int pageSize, int padding) {
+    std::map<std::string, Texture::DecodedImage> images;
+    for (auto & file : imageFiles){
+        auto image = Texture::decodeFile(file);
+        if (!image.valid()){
+            LOG_ERROR("Cannot load sprite image %s", file.c_str());
+            continue;
+        }
+        auto separator = file.find_last_of("/\\");
+        images[separator == std::string::npos ? file : file.substr(separator + 1)] = std::move(image);
     }
-    return std::move(res);
+    return createPacked(std::move(images), atlasName, pageSize, padding);
 }
 
-Sprite SpriteAtlas::get(std::string name) {
-    if (sprites.find(name) == sprites.end()){
+std::shared_ptr<SpriteAtlas> SpriteAtlas::createPacked(std::map<std::string, Texture::DecodedImage> images, std::string atlasName, int pageSize, int padding) {
+    struct Entry {
+        std::string name;
+        Texture::DecodedImage* image;
+        glm::ivec2 size;
+        glm::ivec2 pos;
+        int padding;
+        int layer;
+    };
+    std::vector<Entry> entries;
+    bool sameSize = true;
+    for (auto & i : images){
+        auto& image = i.second;
+        if (!image.valid() || image.compressed){
+            LOG_ERROR("Sprite %s in %s must be an uncompressed image", i.first.c_str(), atlasName.c_str());
+            continue;
+        }
+        glm::ivec2 size{image.width, image.height};
+        if (!entries.empty() && size != entries[0].size){
+            sameSize = false;
+        }
+        entries.push_back({i.first, &image, size, {0,0}, 0, -1});
+    }
+    if (entries.empty()){
+        LOG_ERROR("SpriteAtlas %s contains no images", atlasName.c_str());
+        return std::shared_ptr<SpriteAtlas>(nullptr);
+    }
+    GLint maxLayers = 256;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+    std::vector<Texture::DecodedImage> layers;
+    if (sameSize && (int)entries.size() <= maxLayers){
+        // same sized images are used as layers without packing
+        for (auto & e : entries){
+            e.layer = (int)layers.size();
+            layers.push_back(std::move(*e.image));
+        }
+    } else {
+        // pack the tallest images first
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b){
+            if (a.size.y != b.size.y){
+                return a.size.y > b.size.y;
+            }
+            return a.size.x > b.size.x;
+        });
+        std::vector<RectPacker> pages;
+        for (auto & e : entries){
+            if (e.size.x > pageSize || e.size.y > pageSize){
+                LOG_ERROR("Sprite %s (%i x %i) is larger than the page size %i", e.name.c_str(), e.size.x, e.size.y, pageSize);
+                continue;
+            }
+            // images filling the page are not padded
+            e.padding = e.size.x + 2*padding <= pageSize && e.size.y + 2*padding <= pageSize ? padding : 0;
+            glm::ivec2 paddedSize = e.size + 2*e.padding;
+            glm::ivec2 pos;
+            for (int p=0;p<(int)pages.size() && e.layer == -1;p++){
+                if (pages[p].insert(paddedSize, pos)){
+                    e.layer = p;
+                }
+            }
+            if (e.layer == -1){
+                pages.emplace_back(pageSize, pageSize);
+                pages.back().insert(paddedSize, pos);
+                e.layer = (int)pages.size() - 1;
+            }
+            e.pos = pos + e.padding;
+        }
+        if ((int)pages.size() > maxLayers){
+            LOG_ERROR("SpriteAtlas %s requires %i pages (maximum is %i). Increase page size", atlasName.c_str(), (int)pages.size(), maxLayers);
+            return std::shared_ptr<SpriteAtlas>(nullptr);
+        }
+        layers.resize(pages.size());
+        for (auto & layer : layers){
+            layer.filename = atlasName;
+            layer.width = pageSize;
+            layer.height = pageSize;
+            layer.bytesPerPixel = 4;
+            layer.format = GL_RGBA;
+            layer.data.resize((size_t)pageSize * pageSize * 4, 0);
+        }
+        for (auto & e : entries){
+            if (e.layer == -1){
+                continue;
+            }
+            auto& image = *e.image;
+            auto& layer = layers[e.layer];
+            layer.transparent |= image.transparent;
+            int bytesPerPixel = image.bytesPerPixel;
+            // edge pixels are repeated in the padding to avoid bleeding when sampling is filtered
+            for (int y = -e.padding; y < e.size.y + e.padding; y++){
+                const char* src = &image.data[(size_t)glm::clamp(y, 0, e.size.y - 1) * e.size.x * bytesPerPixel];
+                char* dst = &layer.data[((size_t)(e.pos.y + y) * pageSize + e.pos.x - e.padding) * 4];
+                for (int x = -e.padding; x < e.size.x + e.padding; x++){
+                    memcpy(dst, src + glm::clamp(x, 0, e.size.x - 1) * bytesPerPixel, (size_t)bytesPerPixel);
+                    if (bytesPerPixel == 3){
+                        dst[3] = (char)0xff;
+                    }
+                    dst += 4;
+                }
+            }
+        }
+    }
+
+    auto texture = Texture::create()
+            .withArrayLayers(std::move(layers))
+            .withWrapUV(Texture::Wrap::ClampToEdge)
+            .withName(atlasName)
+            .build();
+    std::map<std::string, Sprite> sprites;
+    for (auto & e : entries){
+        if (e.layer == -1){
+            continue;
+        }
+        Sprite sprite(e.pos, e.size, {0,0}, e.size, {0.5f,0.5f}, texture.get(), e.layer);
+        sprites.emplace(std::pair<std::string, Sprite>(e.name, std::move(sprite)));
+    }
+    return std::shared_ptr<SpriteAtlas>(new SpriteAtlas(std::move(sprites), texture, atlasName));
+}
+
+std::vector<std::string> SpriteAtlas::getNames() {
+    return names;
+}
+
+Sprite SpriteAtlas::get(const std::string& name) {
+    int handle = find(name);
+    if (handle == -1){
         LOG_WARNING("Cannot find sprite %s in spriteatlas",name.c_str());
         return {};
     }
-    return sprites[name];
+    return sprites[handle];
+}
+
+int SpriteAtlas::find(const std::string& name) {
+    auto res = handles.find(name);
+    if (res == handles.end()){
+        return -1;
+    }
+    return res->second;
+}
+
+const Sprite& SpriteAtlas::get(int handle) {
+    if (handle < 0 || handle >= (int)sprites.size()){
+        LOG_WARNING("Invalid sprite handle %i in spriteatlas %s",handle,atlasName.c_str());
+        static Sprite empty;
+        return empty;
+    }
+    return sprites[handle];
 }
 
     std::shared_ptr<SpriteAtlas> SpriteAtlas::createSingleSprite(std::shared_ptr<Texture> texture, std::string name, glm::vec2 pivot, glm::ivec2 pos, glm::ivec2 size ) {
@@ -7,75 +7,209 @@
 
 #include "sre/SpriteBatch.hpp"
 #include  <algorithm>
+#include <cassert>
+#include <limits>
 #include <sre/Sprite.hpp>
 #include <sre/Log.hpp>
 #include "sre/Texture.hpp"
 #include "sre/Material.hpp"
+#include "sre/Renderer.hpp"
 
 
 
 namespace sre{
+    namespace {
+        bool instancingSupported(){
+            auto& info = renderInfo();
+            if (info.graphicsAPIVersionES){
+                return info.graphicsAPIVersionMajor >= 3;
+            }
+            return info.graphicsAPIVersionMajor > 3 || (info.graphicsAPIVersionMajor == 3 && info.graphicsAPIVersionMinor >= 3);
+        }
+    }
 
     SpriteBatch::SpriteBatchBuilder SpriteBatch::create() {
         return {};
     }
 
-    SpriteBatch::SpriteBatch(std::shared_ptr<Shader> shader, std::vector<Sprite>& sprites)
+    SpriteBatch::SpriteBatch(std::shared_ptr<Shader> shader, std::vector<Sprite>& sprites, bool instanced, glm::vec2 chunkSize)
     {
-        std::sort(sprites.begin(), sprites.end(), [](const Sprite & a,const Sprite & b){
-            return a.order.globalOrder < b.order.globalOrder;
-        });
-        std::vector<glm::vec3> vertices;
-        std::vector<glm::vec4> colors;
-        std::vector<glm::vec4> uvs;
-        std::vector<uint32_t> indices;
-        sre::Texture* lastTexture = nullptr;
-
-        auto pushCurrentMesh = [&](){
+        updateMeshes(std::move(shader), sprites, instanced, chunkSize, false);
+    }
+
+    SpriteBatch::SpriteBatchBuilder SpriteBatch::update() {
+        SpriteBatchBuilder res;
+        res.shader = shader;
+        res.instancing = instanced;
+        res.chunkSize = chunkSize;
+        res.updateSpriteBatch = this;
+        res.sprites = std::move(spriteScratch);             // keeps the capacity from the last update
+        res.sprites.clear();
+        return res;
+    }
+
+    void SpriteBatch::updateMeshes(std::shared_ptr<Shader> shader, std::vector<Sprite>& sprites, bool instanced, glm::vec2 chunkSize, bool dynamic) {
+        if (this->shader != shader){
+            this->shader = std::move(shader);
+            materials.clear();
+        }
+        if (this->instanced != instanced){
+            // the vertex layout of the meshes differs
+            this->instanced = instanced;
+            spriteMeshes.clear();
+            indexCapacity.clear();
+        }
+        spriteCount = (int)sprites.size();
+
+        // sprites are bucketed by the chunk containing the sprite position (rows of chunks ordered by x)
+        this->chunkSize = chunkSize;
+        bool chunked = isChunked();
+        if (chunked){
+            chunkKeys.resize(sprites.size());
+            for (int i=0;i<spriteCount;i++){
+                glm::vec2 chunk = glm::clamp(glm::floor(sprites[i].position / chunkSize), glm::vec2(-32768), glm::vec2(32767));
+                chunkKeys[i] = (uint32_t)((int)chunk.y + 32768) << 16 | (uint32_t)((int)chunk.x + 32768);
+            }
+        }
+        SpriteVertices::sort(sprites, order, orderKeys, orderScratch, chunked ? &chunkKeys : nullptr);
+
+        // one mesh per texture. Without 32 bit indices (OpenGL ES 2.0) the mesh is split into chunks addressable with 16 bit indices
+        // Each mesh contains one or more runs (one run per chunk), which are rendered as separate index sets.
+        auto& info = renderInfo();
+        int maxSprites = !instanced && info.graphicsAPIVersionES && info.graphicsAPIVersionMajor <= 2 ?
+                         (std::numeric_limits<uint16_t>::max() + 1) / 4 : std::numeric_limits<int>::max();
+        runs.clear();
+        meshFirstRun.clear();
+        int meshFirst = 0;
+        int first = 0;
+        while (first < spriteCount){
+            auto texture = sprites[order[first]].texture;
+            if (runs.empty() || runs.back().texture != texture || first - meshFirst >= maxSprites){
+                meshFirstRun.push_back((int)runs.size());
+                meshFirst = first;
+            }
+            int last = first + 1;
+            while (last < spriteCount && sprites[order[last]].texture == texture && last - meshFirst < maxSprites &&
+                   (!chunked || chunkKeys[order[last]] == chunkKeys[order[first]])){
+                last++;
+            }
+            runs.push_back({first, last - first, texture});
+            first = last;
+        }
+        meshFirstRun.push_back((int)runs.size());
+
+        vertexScratch.resize((size_t)spriteCount * SpriteVertices::vec4PerSprite(instanced));
+        SpriteVertices::expand(sprites, order, runs, expandTasks, vertexScratch.data(), instanced);
+
+        meshCount = (int)meshFirstRun.size() - 1;
+        for (int i=0;i<meshCount;i++){
+            updateMesh(i, meshFirstRun[i], meshFirstRun[i+1], dynamic);
+        }
+    }
+
+    void SpriteBatch::updateMesh(int index, int firstRun, int lastRun, bool dynamic) {
+        auto texture = runs[firstRun].texture;
+        int first = runs[firstRun].first;
+        int count = runs[lastRun-1].first + runs[lastRun-1].count - first;
+        glm::vec2 boundsMin = runs[firstRun].boundsMin;
+        glm::vec2 boundsMax = runs[firstRun].boundsMax;
+        for (int r=firstRun+1;r<lastRun;r++){
+            boundsMin = glm::min(boundsMin, runs[r].boundsMin);
+            boundsMax = glm::max(boundsMax, runs[r].boundsMax);
+        }
+        if (index == spriteMeshes.size() && instanced){
+            auto mesh = Mesh::create()
+                    .withName(std::string("DynamicSpriteBatchInstances")+std::to_string(index))
+                    .withAttribute("instance_axes",std::vector<glm::vec4>())
+                    .withAttribute("instance_uv",std::vector<glm::vec4>())
+                    .withAttribute("instance_data",std::vector<glm::ivec4>())
+                    .withMeshTopology(MeshTopology::TriangleStrip)
+                    .build();
+            assert(mesh->totalBytesPerVertex == 48 && mesh->attributeByName["instance_data"].offset == 32);
+            mesh->instanced = true;
+            spriteMeshes.push_back(mesh);
+            indexCapacity.push_back(0);
+        } else if (index == spriteMeshes.size()){
             spriteMeshes.push_back(Mesh::create()
-                                           .withName(std::string("DynamicSpriteBatch")+std::to_string(spriteMeshes.size()))
-                                           .withPositions(vertices)
-                                           .withUVs(uvs)
-                                           .withIndices(indices)
-                                           .withAttribute("vertex_color",colors)
+                                           .withName(std::string("DynamicSpriteBatch")+std::to_string(index))
+                                           .withPositions(std::vector<glm::vec3>())
+                                           .withUVs(std::vector<glm::vec4>())
+                                           .withAttribute("vertex_color",std::vector<glm::vec4>())
+                                           .withIndices(std::vector<uint32_t>())
                                            .build());
-            auto mat = shader->createMaterial();
-            mat->setTexture(lastTexture->shared_from_this());
-            materials.push_back(mat);
-        };
-
-        // create meshes
-        for (auto & s : sprites){
-            if (lastTexture && lastTexture != s.texture){
-                pushCurrentMesh();
-                vertices.clear();
-                colors.clear();
-                uvs.clear();
-                indices.clear();
+            indexCapacity.push_back(0);
+        }
+        if (index >= materials.size()){
+            materials.resize(index + 1);
+        }
+        auto& mat = materials[index];
+        if (mat == nullptr || mat->getTexture()->isTextureArray() != texture->isTextureArray()){
+            // texture arrays are sampled with the layer stored in uv.z
+            mat = texture->isTextureArray() ? shader->createMaterial({{"S_TEXTURE_ARRAY","1"}}) : shader->createMaterial();
+        }
+        if (mat->getTexture().get() != texture){
+            mat->setTexture(texture->shared_from_this());
+        }
+
+        auto& mesh = spriteMeshes[index];
+        mesh->setBoundsMinMax({glm::vec3(boundsMin, 0), glm::vec3(boundsMax, 0)});
+        if (instanced){
+            // the instances match the interleaved layout of the mesh: instance_axes, instance_uv, instance_data (ivec4)
+            mesh->setVertexData(vertexScratch.data() + (size_t)first * 3, count, dynamic);
+            return;
+        }
+
+        // the vertices match the interleaved layout of the mesh: position (vec3 padded to vec4), uv, vertex_color
+        mesh->setVertexData(vertexScratch.data() + (size_t)first * 12, count * 4, dynamic);
+
+        // the indices only depend on the sprite count, so the index buffer is only written when it grows
+        if (count > indexCapacity[index] || !dynamic){
+            const int maxSprites16Bit = (std::numeric_limits<uint16_t>::max() + 1) / 4;
+            int capacity = dynamic ? std::max(count, indexCapacity[index] + indexCapacity[index]/2) : count;
+            if (count <= maxSprites16Bit){
+                capacity = std::min(capacity, maxSprites16Bit);     // keep 16 bit indices as long as possible
             }
-            lastTexture = s.texture;
-
-            auto corners = s.getTrimmedCorners();
-            auto cornerUvs = s.getUVs();
-
-            uint16_t idx = (uint16_t)vertices.size();
-            indices.push_back(idx);
-            indices.push_back(idx+1);
-            indices.push_back(idx+2);
-            indices.push_back(idx);
-            indices.push_back(idx+2);
-            indices.push_back(idx+3);
-
-            for (int i=0;i<4;i++){
-                vertices.push_back({corners[i],0});
-                uvs.push_back({cornerUvs[i],0,0});
-                colors.push_back(s.color);
+            bool indices32Bit = capacity > maxSprites16Bit;
+            std::vector<uint32_t> indices32;
+            std::vector<uint16_t> indices16;
+            for (int i=0;i<capacity;i++){
+                uint32_t idx = (uint32_t)i * 4;
+                for (uint32_t offset : {0,1,2,0,2,3}){
+                    if (indices32Bit){
+                        indices32.push_back(idx + offset);
+                    } else {
+                        indices16.push_back((uint16_t)(idx + offset));
+                    }
+                }
             }
+            mesh->setIndexData(indices32Bit ? (void*)indices32.data() : (void*)indices16.data(), capacity * 6, indices32Bit, dynamic);
+            indexCapacity[index] = capacity;
         }
-        if (vertices.size()>0){
-            pushCurrentMesh();
+        indexRanges.clear();
+        for (int r=firstRun;r<lastRun;r++){
+            indexRanges.emplace_back((runs[r].first - first) * 6, runs[r].count * 6);
         }
+        mesh->setIndexRanges(indexRanges);
+    }
+
+    int SpriteBatch::getSpriteCount() {
+        return spriteCount;
+    }
+
+    int SpriteBatch::getMeshCount() {
+        return meshCount;
+    }
+
+    bool SpriteBatch::isInstanced() {
+        return instanced;
+    }
 
+    bool SpriteBatch::isChunked() {
+        return chunkSize.x > 0 && chunkSize.y > 0 && !instanced;
+    }
+
+    int SpriteBatch::getChunkCount() {
+        return isChunked() ? (int)runs.size() : 0;
     }
 
     SpriteBatch::SpriteBatchBuilder::SpriteBatchBuilder() {
@@ -87,19 +221,39 @@ namespace sre{
         return *this;
     }
 
-    SpriteBatch::SpriteBatchBuilder &SpriteBatch::SpriteBatchBuilder::addSprite(Sprite sprite) {
-        size_t size = sprites.size();
-        if (size +1 >= std::numeric_limits<uint16_t>::max()){
-            LOG_ERROR("More than %i sprites in a batch ",std::numeric_limits<uint16_t>::max());
-            return *this;
+    SpriteBatch::SpriteBatchBuilder &SpriteBatch::SpriteBatchBuilder::withInstancing(bool enabled) {
+        if (enabled && !instancingSupported()){
+            LOG_WARNING("SpriteBatch instancing requires OpenGL 3.3 or OpenGL ES 3.0. Using vertices instead.");
+            enabled = false;
         }
-        sprite.order.details.drawOrder = static_cast<uint16_t>(size);
+        this->instancing = enabled;
+        return *this;
+    }
+
+    SpriteBatch::SpriteBatchBuilder &SpriteBatch::SpriteBatchBuilder::withChunks(glm::vec2 chunkSize) {
+        this->chunkSize = chunkSize;
+        return *this;
+    }
+
+    SpriteBatch::SpriteBatchBuilder &SpriteBatch::SpriteBatchBuilder::addSprite(Sprite sprite) {
+        sprite.order.details.drawOrder = static_cast<uint32_t>(sprites.size());
         sprites.push_back(std::move(sprite));
         return *this;
     }
 
     std::shared_ptr<SpriteBatch> SpriteBatch::SpriteBatchBuilder::build() {
-        return std::shared_ptr<SpriteBatch>{new SpriteBatch(shader, sprites)};
+        // the built-in sprite shader matching the vertex layout
+        if (instancing && shader == Shader::getUnlitSprite()){
+            shader = Shader::getUnlitSpriteInstanced();
+        } else if (!instancing && updateSpriteBatch != nullptr && updateSpriteBatch->instanced && shader == Shader::getUnlitSpriteInstanced()){
+            shader = Shader::getUnlitSprite();
+        }
+        if (updateSpriteBatch != nullptr){
+            updateSpriteBatch->updateMeshes(shader, sprites, instancing, chunkSize, true);
+            updateSpriteBatch->spriteScratch = std::move(sprites);
+            return updateSpriteBatch->shared_from_this();
+        }
+        return std::shared_ptr<SpriteBatch>{new SpriteBatch(shader, sprites, instancing, chunkSize)};
     }
 
 }
\ No newline at end of file
@@ -41,6 +41,12 @@
 #include <iomanip>
 
 #include "sre/Log.hpp"
+#include "sre/impl/TextureLoader.hpp"
+#include "sre/TextureCache.hpp"
+#include "sre/impl/CompressedTexture.hpp"
+#include "sre/impl/MipmapGenerator.hpp"
+#include "sre/impl/TextureStreamer.hpp"
+#include "sre/impl/PixelReadback.hpp"
 
 // anonymous (file local) namespace
 namespace {
@@ -85,38 +91,33 @@ namespace {
 
 
 
-    int invert_image(int width, int height, void *image_pixels) {
-        auto temp_row = std::unique_ptr<char>(new char[width]);
-        if (temp_row.get() == nullptr) {
-            LOG_ERROR("Not enough memory for image inversion");
-            return -1;
-        }
-        //if height is odd, don't need to swap middle row
-        int height_div_2 = height / 2;
-        for (int index = 0; index < height_div_2; index++) {
-            //uses string.h
-            memcpy((Uint8 *)temp_row.get(),
-                   (Uint8 *)(image_pixels)+
-                   width * index,
-                   width);
+    bool isPowerOfTwo(unsigned int x) {
+        return ((x != 0) && !(x & (x - 1)));
+    }
 
-            memcpy(
-                    (Uint8 *)(image_pixels)+
-                    width * index,
-                    (Uint8 *)(image_pixels)+
-                    width * (height - index - 1),
-                    width);
-            memcpy(
-                    (Uint8 *)(image_pixels)+
-                    width * (height - index - 1),
-                    temp_row.get(),
-                    width);
+    // GL_TEXTURE_BASE_LEVEL and GL_TEXTURE_MAX_LEVEL (not in OpenGL ES 2.0 / WebGL 1.0)
+    bool hasTextureBaseLevel(){
+        return !sre::renderInfo().graphicsAPIVersionES || sre::renderInfo().graphicsAPIVersionMajor >= 3;
+    }
+
+    sre::mipmap::Filter toMipmapGeneratorFilter(sre::Texture::MipmapFilter filter){
+        switch (filter){
+            case sre::Texture::MipmapFilter::Kaiser:
+                return sre::mipmap::Filter::Kaiser;
+            case sre::Texture::MipmapFilter::Lanczos:
+                return sre::mipmap::Filter::Lanczos;
+            default:
+                return sre::mipmap::Filter::Box;
         }
-        return 0;
     }
 
-    bool isPowerOfTwo(unsigned int x) {
-        return ((x != 0) && !(x & (x - 1)));
+    std::vector<char> expandToRGBA(const std::vector<char>& rgb){
+        size_t pixels = rgb.size() / 3;
+        std::vector<char> res(pixels * 4, (char)0xff);
+        for (size_t i=0;i<pixels;i++){
+            memcpy(&res[i*4], &rgb[i*3], 3);
+        }
+        return res;
     }
 
 
@@ -132,12 +133,9 @@ namespace sre {
         if (! Renderer::instance ){
             LOG_FATAL("Cannot instantiate sre::Texture before sre::Renderer is created.");
         }
-		// update stats
+		// update stats (bytes are counted in TextureBuilder::build() when all properties are known)
 		RenderStats& renderStats = Renderer::instance->renderStats;
 		renderStats.textureCount++;
-        auto datasize = getDataSize();
-		renderStats.textureBytes += datasize;
-		renderStats.textureBytesAllocated += datasize;
 
         Renderer::instance->textures.emplace_back(this);
 	}
@@ -153,6 +151,9 @@ namespace sre {
             renderStats.textureBytesDeallocated += datasize;
 
             r->textures.erase(std::remove(r->textures.begin(), r->textures.end(), this));
+            if (streamingSource && r->textureStreamer){
+                r->textureStreamer->remove(this);
+            }
 
             glDeleteTextures(1, &textureId);
         }
@@ -164,27 +165,9 @@ namespace sre {
         return *this;
     }
 
-    GLenum Texture::getFormat(SDL_Surface *image) {
-        SDL_PixelFormat *format = image->format;
-        auto pixelFormat = format->format;
-
-        const bool alpha = isAlpha(format);
-
-        if (alpha) {
-            return GL_RGBA;
-        }
-        else {
-            if (format->BytesPerPixel == 4) {
-                return GL_RGBA;
-            }
-            else if (format->BytesPerPixel == 3) {
-                return GL_RGB;
-            }
-            else {
-                LOG_ERROR("Unknown image format. Only PNG is supported.");
-                return 0;
-            }
-        }
+    Texture::TextureBuilder &Texture::TextureBuilder::withMipmapFilter(MipmapFilter filter) {
+        mipmapFilter = filter;
+        return *this;
     }
 
     Texture::TextureBuilder &Texture::TextureBuilder::withFilterSampling(bool enable) {
@@ -201,26 +184,109 @@ namespace sre {
         if (name.length()==0){
             name = filename;
         }
-        auto fileData = readAllBytes(filename.c_str());
-        GLenum format;
-        int width;
-        int height;
-        int bytesPerPixel;
-        fileData = loadFileFromMemory(fileData.data(), (int) fileData.size(), format, this->transparent, width, height,bytesPerPixel);
+        textureTypeData.erase(GL_TEXTURE_2D);
+        fileToLoad = filename;                  // decoded in build() if not found in the texture cache
+        return *this;
+    }
 
+    Texture::TextureBuilder &Texture::TextureBuilder::withDecodedImage(DecodedImage image) {
+        if (name.length()==0){
+            name = image.filename;
+        }
+        fileToLoad.clear();
+        transparent = image.transparent;
         textureTypeData[GL_TEXTURE_2D] = {
-                width,
-                height,
-                transparent,
-                bytesPerPixel,
-                format,
-                filename,
-                fileData
+                image.width,
+                image.height,
+                image.transparent,
+                image.bytesPerPixel,
+                image.format,
+                image.filename,
+                std::move(image.data),
+                image.compressed,
+                std::move(image.mipmaps)
         };
 
         return *this;
     }
 
+    Texture::TextureBuilder &Texture::TextureBuilder::withArrayLayers(std::vector<std::string> filenames) {
+        std::vector<DecodedImage> layers;
+        layers.reserve(filenames.size());
+        for (auto & filename : filenames){
+            layers.push_back(decodeFile(filename));
+        }
+        return withArrayLayers(std::move(layers));
+    }
+
+    Texture::TextureBuilder &Texture::TextureBuilder::withArrayLayers(std::vector<DecodedImage> layers) {
+        if (name.length()==0 && !layers.empty()){
+            name = layers[0].filename;
+        }
+        fileToLoad.clear();
+        arrayLayers = std::move(layers);
+        return *this;
+    }
+
+    Texture::TextureBuilder &Texture::TextureBuilder::withFileAsync(std::string filename, std::function<void(std::shared_ptr<Texture>)> onLoaded) {
+        if (name.length()==0){
+            name = filename;
+        }
+        asyncFilename = filename;
+        this->onLoaded = onLoaded;
+        return withWhiteData();
+    }
+
+    std::shared_ptr<Texture> Texture::createAsync(const std::string& filename, std::function<void(std::shared_ptr<Texture>)> onLoaded) {
+        return create()
+                .withFileAsync(filename, onLoaded)
+                .build();
+    }
+
+    Texture::DecodedImage Texture::decodeFile(const std::string& filename, bool invertY) {
+        DecodedImage res;
+        res.filename = filename;
+        auto fileData = readAllBytes(filename.c_str());
+        if (fileData.empty()){
+            return res;
+        }
+        if (compressed::isContainer(fileData.data(), fileData.size())){
+            compressed::Image image;
+            if (!compressed::parse(fileData.data(), fileData.size(), image)){
+                LOG_ERROR("Cannot load compressed texture %s", filename.c_str());
+                return res;
+            }
+            res.width = image.width;
+            res.height = image.height;
+            res.transparent = compressed::hasAlpha(image.format);
+            if (compressed::isSupportedByGPU(image.format)){
+                res.compressed = true;
+                res.format = compressed::glFormat(image.format, false);
+                res.data = std::move(image.levels[0]);
+                for (size_t i=1;i<image.levels.size();i++){
+                    res.mipmaps.push_back(std::move(image.levels[i]));
+                }
+            } else if (compressed::canDecode(image.format)){
+                // fallback: decode blocks to RGBA
+                res.format = GL_RGBA;
+                res.bytesPerPixel = 4;
+                res.data = compressed::decode(image.format, image.levels[0].data(), image.width, image.height);
+                for (size_t i=1;i<image.levels.size();i++){
+                    int w = std::max(1, image.width >> i);
+                    int h = std::max(1, image.height >> i);
+                    res.mipmaps.push_back(compressed::decode(image.format, image.levels[i].data(), w, h));
+                }
+            } else {
+                LOG_ERROR("Compressed texture format of %s not supported by GPU", filename.c_str());
+            }
+            return res;
+        }
+        GLenum format = 0;
+        res.data = loadFileFromMemory(fileData.data(), (int) fileData.size(), format, res.transparent, res.width, res.height, res.bytesPerPixel, invertY);
+        res.format = format;
+        return res;
+    }
+
     Texture::TextureBuilder &Texture::TextureBuilder::withFileCubemap(std::string filename, CubemapSide side){
         auto fileData = readAllBytes(filename.c_str());
         GLenum format;
@@ -243,6 +309,7 @@ namespace sre {
     }
 
     Texture::TextureBuilder &Texture::TextureBuilder::withRGBData(const char *data, int width, int height) {
+        fileToLoad.clear();
 
         int bytesPerPixel = 3;
         textureTypeData[GL_TEXTURE_2D] = {
@@ -263,6 +330,7 @@ namespace sre {
     }
 
     Texture::TextureBuilder &Texture::TextureBuilder::withRGBAData(const char *data, int width, int height) {
+        fileToLoad.clear();
         int bytesPerPixel = 4;
         textureTypeData[GL_TEXTURE_2D] = {
                 width,
@@ -282,6 +350,7 @@ namespace sre {
         return *this;
     }
     Texture::TextureBuilder &Texture::TextureBuilder::withDepth(int width, int height, DepthPrecision precision) {
+        fileToLoad.clear();
         depthPrecision = precision;
         textureTypeData[GL_TEXTURE_2D] = {
                 width,
@@ -301,8 +370,28 @@ namespace sre {
         if (name.length() == 0){
             name = "Unnamed Texture";
         }
+        std::string cacheFilename = fileToLoad.empty() ? asyncFilename : fileToLoad;
+        bool cacheable = useCache && !cacheFilename.empty() && depthPrecision == DepthPrecision::None;
+        TextureCache::Key cacheKey(cacheFilename, generateMipmaps, filterSampling, wrapUV, samplerColorspace, generateMipmaps ? mipmapFilter : MipmapFilter::GPU, streaming);
+        if (cacheable){
+            auto cached = TextureCache::find(cacheKey);
+            if (cached){
+                if (onLoaded){
+                    if (cached->isLoading()){
+                        Renderer::instance->getTextureLoader()->addCallback(cached, onLoaded);
+                    } else {
+                        onLoaded(cached);
+                    }
+                }
+                return cached;
+            }
+        }
+        if (!fileToLoad.empty()){
+            withDecodedImage(decodeFile(fileToLoad));
+        }
         std::map<uint32_t, TextureDefinition>::iterator val;
         TextureDefinition* textureDefPtr;
+        int streamingLevel = -1;                        // initial resident mip level of streaming textures
         if (depthPrecision != DepthPrecision::None){
             if (renderInfo().graphicsAPIVersionES && renderInfo().graphicsAPIVersionMajor <= 2){
                 LOG_FATAL("Depth texture not supported");
@@ -356,6 +445,64 @@ namespace sre {
                 glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, &ones.x);
 #endif
             }
+        } else if (!arrayLayers.empty()){
+            if (renderInfo().graphicsAPIVersionES && renderInfo().graphicsAPIVersionMajor <= 2){
+                LOG_FATAL("Texture arrays not supported");
+            }
+            this->target = GL_TEXTURE_2D_ARRAY;
+            auto& first = arrayLayers.front();
+            bool rgba = false;
+            transparent = false;
+            for (auto & layer : arrayLayers){
+                rgba |= layer.bytesPerPixel == 4;
+                transparent |= layer.transparent;
+            }
+            auto& textureDef = textureTypeData[GL_TEXTURE_2D_ARRAY];
+            textureDef = {
+                    first.width,
+                    first.height,
+                    transparent,
+                    rgba ? 4 : 3,
+                    (uint32_t)(rgba ? GL_RGBA : GL_RGB),
+                    name
+            };
+            textureDefPtr = &textureDef;
+            if (this->dumpDebug){
+                textureDef.dumpDebug();
+            }
+
+            bool isPOT = isPowerOfTwo(first.width) && isPowerOfTwo(first.height);
+            if (!isPOT && generateMipmaps){
+                LOG_WARNING("Texture %s is not power of two (was %i x %i ). mipmapping disabled ",name.c_str(), first.width, first.height);
+                generateMipmaps = false;
+            }
+            if (streaming){
+                LOG_WARNING("Texture %s: streaming not supported for texture arrays", name.c_str());
+                streaming = false;
+            }
+            mipmapFilter = MipmapFilter::GPU;           // all layers are mipmapped using glGenerateMipmap
+
+            GLint internalFormat;
+            if (samplerColorspace == SamplerColorspace::Linear){
+                internalFormat = rgba?GL_SRGB_ALPHA:GL_SRGB;
+            } else {
+                internalFormat = rgba?GL_RGBA:GL_RGB;
+            }
+            glBindTexture(target, textureId);
+            glTexImage3D(target, 0, internalFormat, first.width, first.height, (GLsizei)arrayLayers.size(), 0, textureDef.format, GL_UNSIGNED_BYTE, nullptr);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            for (size_t i=0;i<arrayLayers.size();i++){
+                auto& layer = arrayLayers[i];
+                if (!layer.valid() || layer.compressed || layer.width != first.width || layer.height != first.height){
+                    LOG_ERROR("Texture %s: layer %i (%s) must be an uncompressed image of %i x %i", name.c_str(), (int)i, layer.filename.c_str(), first.width, first.height);
+                    continue;
+                }
+                if (rgba && layer.bytesPerPixel == 3){
+                    layer.data = expandToRGBA(layer.data);
+                }
+                glTexSubImage3D(target, 0, 0, 0, (GLint)i, first.width, first.height, 1, textureDef.format, GL_UNSIGNED_BYTE, layer.data.data());
+            }
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
         } else if ((val = textureTypeData.find(GL_TEXTURE_2D)) != textureTypeData.end()){
             auto& textureDef = val->second;
             textureDefPtr = &textureDef;
@@ -364,13 +511,21 @@ namespace sre {
             GLint mipmapLevel = 0;
 
             GLint internalFormat;
-            if (samplerColorspace == SamplerColorspace::Linear){
+            if (textureDef.compressed){
+                internalFormat = samplerColorspace == SamplerColorspace::Linear ? compressed::glFormatSRGB(textureDef.format) : textureDef.format;
+            } else if (samplerColorspace == SamplerColorspace::Linear){
                 internalFormat = textureDef.bytesPerPixel==4?GL_SRGB_ALPHA:GL_SRGB;
             } else {
                 internalFormat = textureDef.bytesPerPixel==4?GL_RGBA:GL_RGB;
             }
 
             GLint border = 0;
+            if (!textureDef.mipmaps.empty()){
+                generateMipmaps = true;                 // use precomputed mipmaps
+            } else if (textureDef.compressed && generateMipmaps){
+                LOG_WARNING("Texture %s: mipmaps cannot be generated for compressed textures", textureDef.resourcename.c_str());
+                generateMipmaps = false;
+            }
 
             bool isPOT = isPowerOfTwo(textureDef.width) && isPowerOfTwo(textureDef.height);
             if (!isPOT && filterSampling){
@@ -381,6 +536,27 @@ namespace sre {
                 LOG_WARNING("Texture %s is not power of two (was %i x %i ). mipmapping disabled ",textureDef.resourcename.c_str(), textureDef.width, textureDef.height);
                 generateMipmaps = false;
             }
+            if (streaming && asyncFilename.empty()){
+                if (generateMipmaps && !textureDef.data.empty()){
+                    streamingLevel = 0;
+                    if (mipmapFilter == MipmapFilter::GPU){
+                        mipmapFilter = MipmapFilter::Box;   // streaming needs the mip chain in memory
+                    }
+                } else {
+                    LOG_WARNING("Texture %s: streaming requires mipmaps. Streaming disabled", textureDef.resourcename.c_str());
+                }
+            }
+            if (generateMipmaps && mipmapFilter != MipmapFilter::GPU && !textureDef.compressed && textureDef.mipmaps.empty() && !textureDef.data.empty()){
+                textureDef.mipmaps = mipmap::generate(textureDef.data.data(), textureDef.width, textureDef.height, textureDef.bytesPerPixel,
+                                                      toMipmapGeneratorFilter(mipmapFilter), samplerColorspace == SamplerColorspace::Linear, wrapUV == Wrap::Repeat);
+            }
+            if (streamingLevel == 0){
+                // start with the lowest levels resident. Higher levels are loaded when needed on screen
+                int lastLevel = (int)textureDef.mipmaps.size();
+                while (streamingLevel < lastLevel && std::max(textureDef.width >> streamingLevel, textureDef.height >> streamingLevel) > 64){
+                    streamingLevel++;
+                }
+            }
 
             GLenum type = GL_UNSIGNED_BYTE;
             glBindTexture(target, textureId);
@@ -388,7 +564,13 @@ namespace sre {
             if (this->dumpDebug){
                 textureDef.dumpDebug();
             }
-            glTexImage2D(target, mipmapLevel, internalFormat, textureDef.width, textureDef.height, border, textureDef.format, type, dataPtr);
+            if (textureDef.compressed || !textureDef.mipmaps.empty()){
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);     // small RGB levels are not four byte aligned
+                uploadLevels(target, internalFormat, textureDef.width, textureDef.height, textureDef.format, textureDef.compressed, textureDef.data, textureDef.mipmaps, std::max(0, streamingLevel));
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            } else {
+                glTexImage2D(target, mipmapLevel, internalFormat, textureDef.width, textureDef.height, border, textureDef.format, type, dataPtr);
+            }
         } else {
             for (int i=0;i<6;i++){
                 if ((val = textureTypeData.find(GL_TEXTURE_CUBE_MAP_POSITIVE_X+i)) != textureTypeData.end()) {
@@ -424,17 +606,51 @@ namespace sre {
         // build texture
         Texture * res = new Texture(textureId, textureDefPtr->width, textureDefPtr->height, target, name);
         res->generateMipmap = this->generateMipmaps;
+        res->layers = std::max(1, (int)arrayLayers.size());
 		res->transparent = this->transparent;
 		res->samplerColorspace = this->samplerColorspace;
 		res->depthPrecision = this->depthPrecision;
 		res->wrapUV = this->wrapUV;
-        if (this->generateMipmaps){
+        res->precomputedMipmaps = !textureDefPtr->mipmaps.empty();
+        res->mipmapFilter = this->generateMipmaps && !textureDefPtr->compressed ? mipmapFilter : MipmapFilter::GPU;
+        res->streamingRequested = this->streaming;
+        if (textureDefPtr->compressed){
+            res->compressedDataSize = compressedSize(textureDefPtr->data, textureDefPtr->mipmaps);
+        }
+        if (streamingLevel >= 0){
+            res->residentMipLevel = streamingLevel;
+            DecodedImage image;
+            image.filename = textureDefPtr->resourcename;
+            image.data = std::move(textureDefPtr->data);
+            image.width = textureDefPtr->width;
+            image.height = textureDefPtr->height;
+            image.bytesPerPixel = textureDefPtr->bytesPerPixel;
+            image.transparent = textureDefPtr->transparent;
+            image.format = textureDefPtr->format;
+            image.compressed = textureDefPtr->compressed;
+            image.mipmaps = std::move(textureDefPtr->mipmaps);
+            res->initStreaming(std::move(image));
+        }
+        if (this->generateMipmaps && !res->precomputedMipmaps){
             res->invokeGenerateMipmap();
         }
         res->updateTextureSampler(filterSampling, wrapUV);
+
+        RenderStats& renderStats = Renderer::instance->renderStats;
+        auto datasize = res->getDataSize();
+        renderStats.textureBytes += datasize;
+        renderStats.textureBytesAllocated += datasize;
 		
         textureId = 0;
-        return std::shared_ptr<Texture>(res);
+        auto texture = std::shared_ptr<Texture>(res);
+        if (!asyncFilename.empty()){
+            texture->loading = true;
+            Renderer::instance->getTextureLoader()->load(texture, asyncFilename, onLoaded);
+        }
+        if (cacheable){
+            TextureCache::insert(cacheKey, texture);
+        }
+        return texture;
     }
 
 	Texture::TextureBuilder &Texture::TextureBuilder::withWhiteData(int width, int height) {
@@ -498,6 +714,16 @@ namespace sre {
         return *this;
     }
 
+    Texture::TextureBuilder &Texture::TextureBuilder::withCache(bool enable) {
+        this->useCache = enable;
+        return *this;
+    }
+
+    Texture::TextureBuilder &Texture::TextureBuilder::withStreaming(bool enable) {
+        this->streaming = enable;
+        return *this;
+    }
+
 
     // returns true if texture sampling should be filtered (bi-linear or tri-linear sampling) otherwise use point sampling.
 	bool Texture::isFilterSampling() {
@@ -593,22 +819,186 @@ namespace sre {
         }
     }
 
-	int Texture::getDataSize() {
-		int res = width * height * 4;
+	int64_t Texture::getDataSize() {
+        if (streamingSource){
+            return getDataSize(residentMipLevel);
+        }
+        if (compressedDataSize > 0){
+            return compressedDataSize;
+        }
+		int64_t res = (int64_t)width * height * 4;
 		if (generateMipmap){
-			res += (int)((1.0f/3.0f) * res);
+			res += res / 3;
 		}
 		// six sides
 		if (target == GL_TEXTURE_CUBE_MAP){
 			res *= 6;
 		}
+		res *= layers;
 		return res;
 	}
 
+    bool Texture::isCompressed() {
+        return compressedDataSize > 0;
+    }
+
+    void Texture::uploadLevels(uint32_t target, int internalFormat, int width, int height, uint32_t format, bool compressed,
+                               const std::vector<char>& data, const std::vector<std::vector<char>>& mipmaps, int firstLevel) {
+        int levels = (int)mipmaps.size() + 1;
+        // levels before firstLevel are left unspecified and excluded using the base level. Without base level support
+        // firstLevel is uploaded as level 0
+        bool baseLevel = hasTextureBaseLevel();
+        int levelOffset = baseLevel ? 0 : firstLevel;
+        for (int level = firstLevel; level < levels; level++){
+            uploadLevel(target, internalFormat, width, height, format, compressed, level == 0 ? data : mipmaps[level-1], level, level - levelOffset);
+        }
+        if (baseLevel && (levels > 1 || firstLevel > 0)){
+            glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, firstLevel);
+            glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);                  // allow incomplete chains
+        }
+    }
+
+    void Texture::uploadLevel(uint32_t target, int internalFormat, int width, int height, uint32_t format, bool compressed,
+                              const std::vector<char>& levelData, int level, int glLevel) {
+        int w = std::max(1, width >> level);
+        int h = std::max(1, height >> level);
+        if (compressed){
+            glCompressedTexImage2D(target, glLevel, internalFormat, w, h, 0, (GLsizei)levelData.size(), levelData.data());
+        } else {
+            glTexImage2D(target, glLevel, internalFormat, w, h, 0, format, GL_UNSIGNED_BYTE, levelData.data());
+        }
+    }
+
+    int64_t Texture::compressedSize(const std::vector<char>& data, const std::vector<std::vector<char>>& mipmaps) {
+        int64_t res = data.size();
+        for (auto & m : mipmaps){
+            res += m.size();
+        }
+        return res;
+    }
+
+    int64_t Texture::getDataSize(int residentLevel) {
+        if (!streamingSource){
+            return getDataSize();
+        }
+        int64_t res = 0;
+        for (int level = residentLevel; level < getMipLevelCount(); level++){
+            if (streamingSource->compressed){
+                res += level == 0 ? streamingSource->data.size() : streamingSource->mipmaps[level-1].size();
+            } else {
+                res += (int64_t)std::max(1, width >> level) * std::max(1, height >> level) * 4;
+            }
+        }
+        return res;
+    }
+
+    bool Texture::isStreaming() {
+        return streamingSource != nullptr;
+    }
+
+    int Texture::getMipLevelCount() {
+        if (streamingSource){
+            return (int)streamingSource->mipmaps.size() + 1;
+        }
+        if (!generateMipmap){
+            return 1;
+        }
+        int levels = 1;
+        while ((std::max(width, height) >> levels) > 0){
+            levels++;
+        }
+        return levels;
+    }
+
+    int Texture::getResidentMipLevel() {
+        return residentMipLevel;
+    }
+
+    int Texture::getResidentGLLevel() {
+        return hasTextureBaseLevel() ? residentMipLevel : 0;
+    }
+
+    int Texture::getRequiredMipLevel() {
+        return requiredMipLevel;
+    }
+
+    int Texture::getInternalFormat(uint32_t format, int bytesPerPixel, bool compressed) {
+        if (compressed){
+            return samplerColorspace == SamplerColorspace::Linear ? compressed::glFormatSRGB(format) : format;
+        } else if (samplerColorspace == SamplerColorspace::Linear){
+            return bytesPerPixel==4?GL_SRGB_ALPHA:GL_SRGB;
+        }
+        return bytesPerPixel==4?GL_RGBA:GL_RGB;
+    }
+
+    void Texture::initStreaming(DecodedImage&& image) {
+        streamingSource = std::make_shared<DecodedImage>(std::move(image));
+        requiredMipLevel = residentMipLevel;
+        Renderer::instance->getTextureStreamer()->add(this);
+    }
+
+    void Texture::setResidentMipLevel(int level) {
+        auto& image = *streamingSource;
+        level = std::max(0, std::min(level, getMipLevelCount() - 1));
+        if (level == residentMipLevel){
+            return;
+        }
+        auto oldDatasize = getDataSize();
+        int internalFormat = getInternalFormat(image.format, image.bytesPerPixel, image.compressed);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if (hasTextureBaseLevel()){
+            // only the new levels are uploaded. Evicted levels are respecified as empty to release their memory
+            glBindTexture(target, textureId);
+            if (level > residentMipLevel){
+                glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, level);
+                for (int l = residentMipLevel; l < level; l++){
+                    if (image.compressed){
+                        glCompressedTexImage2D(target, l, internalFormat, 0, 0, 0, 0, nullptr);
+                    } else {
+                        glTexImage2D(target, l, internalFormat, 0, 0, 0, image.format, GL_UNSIGNED_BYTE, nullptr);
+                    }
+                }
+            } else {
+                for (int l = level; l < residentMipLevel; l++){
+                    uploadLevel(target, internalFormat, width, height, image.format, image.compressed, l == 0 ? image.data : image.mipmaps[l-1], l, l);
+                }
+                glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, level);
+            }
+        } else {
+            // allocate new storage, since the size of level 0 cannot change
+            GLuint newTextureId;
+            glGenTextures(1, &newTextureId);
+            glBindTexture(target, newTextureId);
+            uploadLevels(target, internalFormat, width, height, image.format, image.compressed, image.data, image.mipmaps, level);
+            glDeleteTextures(1, &textureId);
+            textureId = newTextureId;
+            updateTextureSampler(filterSampling, wrapUV);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        residentMipLevel = level;
+        if (image.compressed){
+            compressedDataSize = getDataSize(level);
+        }
+
+        RenderStats& renderStats = Renderer::instance->renderStats;
+        auto datasize = getDataSize();
+        renderStats.textureBytes += datasize - oldDatasize;
+        renderStats.textureBytesAllocated += datasize;
+        renderStats.textureBytesDeallocated += oldDatasize;
+    }
+
     bool Texture::isCubemap() {
         return target == GL_TEXTURE_CUBE_MAP;
     }
 
+    bool Texture::isTextureArray() {
+        return target == GL_TEXTURE_2D_ARRAY;
+    }
+
+    int Texture::getLayerCount() {
+        return layers;
+    }
+
     sre::Texture::Wrap Texture::getWrapUV() {
         return wrapUV;
     }
@@ -639,43 +1029,85 @@ namespace sre {
         return generateMipmap;
     }
 
+    Texture::MipmapFilter Texture::getMipmapFilter() {
+        return mipmapFilter;
+    }
+
+    void Texture::generateMipmaps(DecodedImage &image, MipmapFilter filter, bool srgb, bool wrap) {
+        if (filter == MipmapFilter::GPU || image.compressed || !image.mipmaps.empty() || !image.valid()){
+            return;
+        }
+        if (!isPowerOfTwo((unsigned int)image.width) || !isPowerOfTwo((unsigned int)image.height)){
+            return;
+        }
+        image.mipmaps = mipmap::generate(image.data.data(), image.width, image.height, image.bytesPerPixel,
+                                         toMipmapGeneratorFilter(filter), srgb, wrap);
+    }
+
     std::vector<char> Texture::loadFileFromMemory(const char* data, int dataSize, GLenum& format, bool & alpha,int& width, int& height, int& bytesPerPixel, bool invertY){
 #ifndef EMSCRIPTEN
-        static bool initialized = false;
-        if (!initialized) {
-            initialized = true;
+        // initialized exactly once, also when called concurrently from decode threads
+        static bool initialized = [](){
             int flags = IMG_INIT_PNG;
             int initted = IMG_Init(flags);
             if ((initted & flags) != flags) {
                 LOG_ERROR("IMG_Init: Failed to init required png support!\nIMG_Init() returned %s",IMG_GetError());
                 // handle error
             }
-        }
+            return true;
+        }();
+        (void)initialized;
 #endif
 
         SDL_RWops *source = SDL_RWFromConstMem(data, dataSize);
-        SDL_Surface *res_texture = IMG_Load_RW(source, 1);
-        if (res_texture == nullptr) {
+        SDL_Surface *surface = IMG_Load_RW(source, 1);
+        if (surface == nullptr) {
             LOG_ERROR("Cannot load texture. IMG_Load_RW returned %s", IMG_GetError());
             return {};
         }
-        alpha = isAlpha( res_texture->format );
-
-        SDL_Surface *formattedSurf = SDL_ConvertSurfaceFormat(res_texture,
-                                                              alpha ?SDL_PIXELFORMAT_RGBA32 : SDL_PIXELFORMAT_RGB24, 0);
-        width = formattedSurf->w;
-        height = formattedSurf->h;
-        format = getFormat(formattedSurf);
-
-        bytesPerPixel = format == GL_RGB ? 3 : 4;
-        auto pixels = static_cast<char *>(formattedSurf->pixels);
-        if (invertY){
-            invert_image(width*bytesPerPixel, height, pixels);
+        alpha = isAlpha( surface->format );
+        Uint32 targetFormat = alpha ? SDL_PIXELFORMAT_RGBA32 : SDL_PIXELFORMAT_RGB24;
+        if (SDL_ISPIXELFORMAT_INDEXED(surface->format->format)){
+            // SDL_ConvertPixels does not support palettes
+            SDL_Surface *converted = SDL_ConvertSurfaceFormat(surface, targetFormat, 0);
+            SDL_FreeSurface(surface);
+            if (converted == nullptr) {
+                LOG_ERROR("Cannot load texture. SDL_ConvertSurfaceFormat returned %s", SDL_GetError());
+                return {};
+            }
+            surface = converted;
+        }
+        width = surface->w;
+        height = surface->h;
+        format = alpha ? GL_RGBA : GL_RGB;
+        bytesPerPixel = alpha ? 4 : 3;
+
+        // convert, y-flip and copy in a single pass directly into the returned buffer
+        int rowSize = width*bytesPerPixel;
+        std::vector<char> res((size_t)rowSize*height);
+        SDL_LockSurface(surface);
+        auto pixels = static_cast<const char *>(surface->pixels);
+        Uint32 sourceFormat = surface->format->format;
+        int status = 0;
+        if (sourceFormat != targetFormat && !invertY){
+            status = SDL_ConvertPixels(width, height, sourceFormat, pixels, surface->pitch, targetFormat, res.data(), rowSize);
+        } else {
+            for (int y=0;y<height && status == 0;y++){
+                char* dest = res.data() + (size_t)(invertY ? height - 1 - y : y) * rowSize;
+                const char* src = pixels + (size_t)y * surface->pitch;
+                if (sourceFormat == targetFormat){
+                    memcpy(dest, src, (size_t)rowSize);
+                } else {
+                    status = SDL_ConvertPixels(width, 1, sourceFormat, src, surface->pitch, targetFormat, dest, rowSize);
+                }
+            }
+        }
+        SDL_UnlockSurface(surface);
+        SDL_FreeSurface(surface);
+        if (status < 0) {
+            LOG_ERROR("Cannot load texture. SDL_ConvertPixels returned %s", SDL_GetError());
+            return {};
         }
-
-        std::vector<char> res(pixels, pixels+width*bytesPerPixel*height);
-        SDL_FreeSurface(formattedSurf);
-        SDL_FreeSurface(res_texture);
 
         return res;
     }
@@ -718,6 +1150,56 @@ namespace sre {
         return depthPrecision != DepthPrecision::None;
     }
 
+    bool Texture::isLoading() {
+        return loading;
+    }
+
+    void Texture::replaceStorage(unsigned int newTextureId, DecodedImage& image) {
+        RenderStats& renderStats = Renderer::instance->renderStats;
+        auto oldDatasize = getDataSize();
+        glDeleteTextures(1, &textureId);
+        textureId = newTextureId;
+        width = image.width;
+        height = image.height;
+        transparent = image.transparent;
+        compressedDataSize = image.compressed ? compressedSize(image.data, image.mipmaps) : 0;
+        precomputedMipmaps = !image.mipmaps.empty();
+        if (precomputedMipmaps){
+            generateMipmap = true;
+        } else if (image.compressed && generateMipmap){
+            LOG_WARNING("Texture %s: mipmaps cannot be generated for compressed textures", name.c_str());
+            generateMipmap = false;
+        }
+
+        bool isPOT = isPowerOfTwo((unsigned int)width) && isPowerOfTwo((unsigned int)height);
+        if (!isPOT && filterSampling){
+            LOG_WARNING("Texture %s is not power of two (was %i x %i ). filter sampling ",name.c_str(), width, height);
+            filterSampling = false;
+        }
+        if (!isPOT && generateMipmap){
+            LOG_WARNING("Texture %s is not power of two (was %i x %i ). mipmapping disabled ",name.c_str(), width, height);
+            generateMipmap = false;
+        }
+        if (generateMipmap && !precomputedMipmaps){
+            invokeGenerateMipmap();
+        }
+        updateTextureSampler(filterSampling, wrapUV);
+        if (streamingRequested){
+            if (generateMipmap && precomputedMipmaps){
+                residentMipLevel = 0;                   // the streamer evicts unused levels
+                initStreaming(std::move(image));
+            } else {
+                LOG_WARNING("Texture %s: streaming requires mipmaps. Streaming disabled", name.c_str());
+            }
+        }
+
+        auto datasize = getDataSize();
+        renderStats.textureBytes += datasize - oldDatasize;
+        renderStats.textureBytesAllocated += datasize;
+        renderStats.textureBytesDeallocated += oldDatasize;
+        loading = false;
+    }
+
     Texture::DepthPrecision Texture::getDepthPrecision() {
         return depthPrecision;
     }
@@ -728,17 +1210,26 @@ namespace sre {
 #else
         assert(!isDepthTexture());
         assert(!isCubemap());
+        assert(!isTextureArray());
         int bytesPerPixel = 4;
-        std::vector<char> data(static_cast<unsigned long>(getWidth() * getHeight() * bytesPerPixel), 0);
-        glPixelStorei(GL_UNPACK_ROW_LENGTH, getWidth());
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        int w = std::max(1, getWidth() >> residentMipLevel);
+        int h = std::max(1, getHeight() >> residentMipLevel);
+        std::vector<char> data(static_cast<unsigned long>(w * h * bytesPerPixel), 0);
         glBindTexture(GL_TEXTURE_2D, textureId);
-        glGetTexImage( GL_TEXTURE_2D, 0,  GL_RGBA, GL_UNSIGNED_BYTE, data.data());
-        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glGetTexImage( GL_TEXTURE_2D, getResidentGLLevel(),  GL_RGBA, GL_UNSIGNED_BYTE, data.data());
         return data;
 #endif
     }
 
+    std::future<std::vector<char>> Texture::getRawImageAsync() {
+        assert(!isDepthTexture());
+        assert(!isCubemap());
+        assert(!isTextureArray());
+        int w = std::max(1, getWidth() >> residentMipLevel);
+        int h = std::max(1, getHeight() >> residentMipLevel);
+        return Renderer::instance->getPixelReadback()->readTexture(textureId, w, h, getResidentGLLevel());
+    }
+
     void* Texture::getNativeTexturePtr(){
         //https://stackoverflow.com/a/30106751/420250
 	    #define INT2VOIDP(i) (void*)(uintptr_t)(i)
@@ -0,0 +1,82 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/TextureCache.hpp"
+
+#include <tuple>
+#include "sre/Renderer.hpp"
+#include "sre/RenderStats.hpp"
+
+namespace sre {
+
+    TextureCache::Key::Key(std::string filename, bool generateMipmaps, bool filterSampling, Texture::Wrap wrapUV,
+                           Texture::SamplerColorspace samplerColorspace, Texture::MipmapFilter mipmapFilter, bool streaming)
+    : filename(std::move(filename)), generateMipmaps(generateMipmaps), filterSampling(filterSampling), wrapUV(wrapUV),
+      samplerColorspace(renderInfo().supportTextureSamplerSRGB ? samplerColorspace : Texture::SamplerColorspace::Gamma),
+      mipmapFilter(mipmapFilter), streaming(streaming)
+    {
+    }
+
+    bool TextureCache::Key::operator<(const TextureCache::Key &other) const {
+        return std::tie(filename, generateMipmaps, filterSampling, wrapUV, samplerColorspace, mipmapFilter, streaming) <
+               std::tie(other.filename, other.generateMipmaps, other.filterSampling, other.wrapUV, other.samplerColorspace, other.mipmapFilter, other.streaming);
+    }
+
+    std::map<TextureCache::Key, std::weak_ptr<Texture>>& TextureCache::entries() {
+        static std::map<Key, std::weak_ptr<Texture>> cache;
+        return cache;
+    }
+
+    std::shared_ptr<Texture> TextureCache::find(const Key &key) {
+        auto& cache = entries();
+        std::shared_ptr<Texture> res;
+        auto iter = cache.find(key);
+        if (iter != cache.end()){
+            res = iter->second.lock();
+            if (res == nullptr){
+                cache.erase(iter);
+            }
+        }
+        if (Renderer::instance){
+            RenderStats& renderStats = Renderer::instance->renderStats;
+            if (res){
+                renderStats.textureCacheHits++;
+                renderStats.textureCacheBytesSaved += res->getDataSize();
+            } else {
+                renderStats.textureCacheMisses++;
+            }
+        }
+        return res;
+    }
+
+    void TextureCache::insert(const Key &key, std::shared_ptr<Texture> texture) {
+        auto& cache = entries();
+        // prune expired entries
+        for (auto iter = cache.begin(); iter != cache.end();){
+            if (iter->second.expired()){
+                iter = cache.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+        cache[key] = texture;
+    }
+
+    void TextureCache::clear() {
+        entries().clear();
+    }
+
+    int TextureCache::size() {
+        int count = 0;
+        for (auto & e : entries()){
+            if (!e.second.expired()){
+                count++;
+            }
+        }
+        return count;
+    }
+}
@@ -0,0 +1,699 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/impl/CompressedTexture.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include "sre/Renderer.hpp"
+#include "sre/Log.hpp"
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT 0x8C4E
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#define GL_COMPRESSED_SRGB8_ETC2 0x9275
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#define GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC 0x9279
+#endif
+#ifndef GL_ETC1_RGB8_OES
+#define GL_ETC1_RGB8_OES 0x8D64
+#endif
+
+namespace sre {
+    namespace compressed {
+        namespace {
+            const uint8_t ktx1Identifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+            const uint8_t ktx2Identifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+            const uint32_t maxDimension = 16384;            // larger images are rejected before any size is computed
+            const uint32_t maxLevels = 32;
+
+            uint32_t readU32(const char* data){
+                uint32_t res;
+                memcpy(&res, data, sizeof(uint32_t));
+                return res;
+            }
+
+            uint64_t readU64(const char* data){
+                uint64_t res;
+                memcpy(&res, data, sizeof(uint64_t));
+                return res;
+            }
+
+            uint32_t swapU32(uint32_t v){
+                return ((v & 0xFF) << 24) | ((v & 0xFF00) << 8) | ((v >> 8) & 0xFF00) | (v >> 24);
+            }
+
+            uint32_t fourCC(const char* s){
+                return (uint32_t)(uint8_t)s[0] | ((uint32_t)(uint8_t)s[1] << 8) | ((uint32_t)(uint8_t)s[2] << 16) | ((uint32_t)(uint8_t)s[3] << 24);
+            }
+
+            BlockFormat fromGLFormat(uint32_t glInternalFormat){
+                switch (glInternalFormat){
+                    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+                    case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+                        return BlockFormat::BC1;
+                    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+                    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+                        return BlockFormat::BC1A;
+                    case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+                    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+                        return BlockFormat::BC2;
+                    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+                    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+                        return BlockFormat::BC3;
+                    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+                    case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+                        return BlockFormat::BC7;
+                    case GL_ETC1_RGB8_OES:
+                    case GL_COMPRESSED_RGB8_ETC2:
+                    case GL_COMPRESSED_SRGB8_ETC2:
+                        return BlockFormat::ETC2_RGB8;
+                    case GL_COMPRESSED_RGBA8_ETC2_EAC:
+                    case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+                        return BlockFormat::ETC2_RGBA8;
+                    default:
+                        return BlockFormat::None;
+                }
+            }
+
+            BlockFormat fromVkFormat(uint32_t vkFormat){
+                switch (vkFormat){
+                    case 131: // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+                    case 132: // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+                        return BlockFormat::BC1;
+                    case 133: // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+                    case 134: // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+                        return BlockFormat::BC1A;
+                    case 135: // VK_FORMAT_BC2_UNORM_BLOCK
+                    case 136: // VK_FORMAT_BC2_SRGB_BLOCK
+                        return BlockFormat::BC2;
+                    case 137: // VK_FORMAT_BC3_UNORM_BLOCK
+                    case 138: // VK_FORMAT_BC3_SRGB_BLOCK
+                        return BlockFormat::BC3;
+                    case 145: // VK_FORMAT_BC7_UNORM_BLOCK
+                    case 146: // VK_FORMAT_BC7_SRGB_BLOCK
+                        return BlockFormat::BC7;
+                    case 147: // VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK
+                    case 148: // VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK
+                        return BlockFormat::ETC2_RGB8;
+                    case 151: // VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK
+                    case 152: // VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK
+                        return BlockFormat::ETC2_RGBA8;
+                    default:
+                        return BlockFormat::None;
+                }
+            }
+
+            BlockFormat fromDXGIFormat(uint32_t dxgiFormat){
+                switch (dxgiFormat){
+                    case 71: // DXGI_FORMAT_BC1_UNORM
+                    case 72: // DXGI_FORMAT_BC1_UNORM_SRGB
+                        return BlockFormat::BC1A;
+                    case 74: // DXGI_FORMAT_BC2_UNORM
+                    case 75: // DXGI_FORMAT_BC2_UNORM_SRGB
+                        return BlockFormat::BC2;
+                    case 77: // DXGI_FORMAT_BC3_UNORM
+                    case 78: // DXGI_FORMAT_BC3_UNORM_SRGB
+                        return BlockFormat::BC3;
+                    case 98: // DXGI_FORMAT_BC7_UNORM
+                    case 99: // DXGI_FORMAT_BC7_UNORM_SRGB
+                        return BlockFormat::BC7;
+                    default:
+                        return BlockFormat::None;
+                }
+            }
+
+            // validates the untrusted header size before it is used
+            bool setDimensions(const char* container, uint32_t width, uint32_t height, Image& image){
+                if (width == 0 || height == 0 || width > maxDimension || height > maxDimension){
+                    LOG_ERROR("%s: invalid size %ux%u (max %u)", container, width, height, maxDimension);
+                    return false;
+                }
+                image.width = (int)width;
+                image.height = (int)height;
+                return true;
+            }
+
+            // read mip levels stored back to back (DDS)
+            bool readPackedLevels(const char* data, size_t size, size_t offset, int levelCount, Image& image){
+                int w = image.width;
+                int h = image.height;
+                for (int i=0;i<levelCount;i++){
+                    size_t bytes = levelSize(image.format, w, h);
+                    if (offset > size || bytes > size - offset){
+                        LOG_ERROR("Compressed texture data truncated (level %i)", i);
+                        return !image.levels.empty();
+                    }
+                    image.levels.emplace_back(data + offset, data + offset + bytes);
+                    offset += bytes;
+                    w = std::max(1, w/2);
+                    h = std::max(1, h/2);
+                }
+                return true;
+            }
+
+            bool parseKTX1(const char* data, size_t size, Image& image){
+                const size_t headerSize = 12 + 13*4;
+                if (size < headerSize){
+                    LOG_ERROR("Invalid KTX file (too small)");
+                    return false;
+                }
+                uint32_t header[13];
+                memcpy(header, data + 12, sizeof(header));
+                bool swap = header[0] == 0x01020304;
+                if (swap){
+                    for (auto & h : header){
+                        h = swapU32(h);
+                    }
+                }
+                uint32_t glInternalFormat = header[4];
+                uint32_t faces = header[10];
+                int levelCount = (int)std::min(std::max(1u, header[11]), maxLevels);
+                uint32_t bytesOfKeyValueData = header[12];
+                if (header[8] > 1 || header[9] > 0 || faces != 1){
+                    LOG_ERROR("KTX: only 2D textures supported");
+                    return false;
+                }
+                if (!setDimensions("KTX", header[6], std::max(1u, header[7]), image)){
+                    return false;
+                }
+                if (bytesOfKeyValueData > size - headerSize){
+                    LOG_ERROR("KTX: key/value data truncated");
+                    return false;
+                }
+                image.format = fromGLFormat(glInternalFormat);
+                if (image.format == BlockFormat::None){
+                    LOG_ERROR("KTX: unsupported internal format 0x%x", glInternalFormat);
+                    return false;
+                }
+                size_t offset = headerSize + bytesOfKeyValueData;
+                int w = image.width;
+                int h = image.height;
+                for (int i=0;i<levelCount;i++){
+                    if (offset > size || size - offset < 4){
+                        break;
+                    }
+                    uint32_t imageSize = readU32(data + offset);
+                    if (swap){
+                        imageSize = swapU32(imageSize);
+                    }
+                    offset += 4;
+                    if (imageSize > size - offset || imageSize != levelSize(image.format, w, h)){
+                        LOG_ERROR("KTX: invalid level %i", i);
+                        break;
+                    }
+                    image.levels.emplace_back(data + offset, data + offset + imageSize);
+                    offset += (imageSize + 3) & ~3u;                // mipPadding
+                    w = std::max(1, w/2);
+                    h = std::max(1, h/2);
+                }
+                return !image.levels.empty();
+            }
+
+            bool parseKTX2(const char* data, size_t size, Image& image){
+                const size_t headerSize = 12 + 9*4 + 4*4 + 2*8;
+                if (size < headerSize){
+                    LOG_ERROR("Invalid KTX2 file (too small)");
+                    return false;
+                }
+                const char* header = data + 12;
+                uint32_t vkFormat = readU32(header);
+                uint32_t width = readU32(header + 8);
+                uint32_t height = std::max(1u, readU32(header + 12));
+                uint32_t depth = readU32(header + 16);
+                uint32_t layers = readU32(header + 20);
+                uint32_t faces = readU32(header + 24);
+                int levelCount = (int)std::min(std::max(1u, readU32(header + 28)), maxLevels);
+                uint32_t supercompression = readU32(header + 32);
+                if (depth > 1 || layers > 0 || faces != 1){
+                    LOG_ERROR("KTX2: only 2D textures supported");
+                    return false;
+                }
+                if (supercompression != 0){
+                    LOG_ERROR("KTX2: supercompression scheme %u not supported", supercompression);
+                    return false;
+                }
+                if (!setDimensions("KTX2", width, height, image)){
+                    return false;
+                }
+                image.format = fromVkFormat(vkFormat);
+                if (image.format == BlockFormat::None){
+                    LOG_ERROR("KTX2: unsupported vkFormat %u", vkFormat);
+                    return false;
+                }
+                if (levelCount <= 0 || (size_t)levelCount > (size - headerSize) / 24){
+                    LOG_ERROR("KTX2: level index truncated");
+                    return false;
+                }
+                int w = image.width;
+                int h = image.height;
+                for (int i=0;i<levelCount;i++){
+                    const char* levelIndex = data + headerSize + i*24;
+                    uint64_t byteOffset = readU64(levelIndex);
+                    uint64_t byteLength = readU64(levelIndex + 8);
+                    if (byteOffset > size || byteLength > size - byteOffset || byteLength != levelSize(image.format, w, h)){
+                        LOG_ERROR("KTX2: invalid level %i", i);
+                        break;
+                    }
+                    image.levels.emplace_back(data + byteOffset, data + byteOffset + byteLength);
+                    w = std::max(1, w/2);
+                    h = std::max(1, h/2);
+                }
+                return !image.levels.empty();
+            }
+
+            bool parseDDS(const char* data, size_t size, Image& image){
+                const size_t headerSize = 4 + 124;
+                if (size < headerSize){
+                    LOG_ERROR("Invalid DDS file (too small)");
+                    return false;
+                }
+                if (!setDimensions("DDS", readU32(data + 16), readU32(data + 12), image)){
+                    return false;
+                }
+                int levelCount = (int)std::min(std::max(1u, readU32(data + 28)), maxLevels);
+                uint32_t pixelFormatFlags = readU32(data + 80);
+                uint32_t pixelFormatFourCC = readU32(data + 84);
+                const uint32_t DDPF_FOURCC = 0x4;
+                if ((pixelFormatFlags & DDPF_FOURCC) == 0){
+                    LOG_ERROR("DDS: only block compressed formats supported");
+                    return false;
+                }
+                size_t offset = headerSize;
+                if (pixelFormatFourCC == fourCC("DXT1")){
+                    image.format = BlockFormat::BC1A;
+                } else if (pixelFormatFourCC == fourCC("DXT3")){
+                    image.format = BlockFormat::BC2;
+                } else if (pixelFormatFourCC == fourCC("DXT5")){
+                    image.format = BlockFormat::BC3;
+                } else if (pixelFormatFourCC == fourCC("DX10")){
+                    if (size < headerSize + 20){
+                        LOG_ERROR("Invalid DDS file (missing DX10 header)");
+                        return false;
+                    }
+                    image.format = fromDXGIFormat(readU32(data + headerSize));
+                    offset += 20;
+                }
+                if (image.format == BlockFormat::None){
+                    LOG_ERROR("DDS: unsupported pixel format");
+                    return false;
+                }
+                return readPackedLevels(data, size, offset, levelCount, image);
+            }
+
+            // BC1-BC3 --------------------------------------------------------------
+
+            void rgb565(uint16_t c, uint8_t* out){
+                int r = (c >> 11) & 0x1F;
+                int g = (c >> 5) & 0x3F;
+                int b = c & 0x1F;
+                out[0] = (uint8_t)((r << 3) | (r >> 2));
+                out[1] = (uint8_t)((g << 2) | (g >> 4));
+                out[2] = (uint8_t)((b << 3) | (b >> 2));
+                out[3] = 255;
+            }
+
+            // decodes color block into 16 RGBA pixels (row-major). BC1 blocks with c0 <= c1 use 3-color mode (index 2 is the
+            // average, index 3 is black, transparent for BC1 with alpha); BC2 and BC3 color blocks always use 4-color mode
+            void decodeBC1Block(const uint8_t* block, uint8_t* pixels, bool threeColorMode, bool transparentBlack){
+                uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+                uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+                uint8_t palette[4][4];
+                rgb565(c0, palette[0]);
+                rgb565(c1, palette[1]);
+                if (c0 > c1 || !threeColorMode){
+                    for (int i=0;i<3;i++){
+                        palette[2][i] = (uint8_t)((2*palette[0][i] + palette[1][i]) / 3);
+                        palette[3][i] = (uint8_t)((palette[0][i] + 2*palette[1][i]) / 3);
+                    }
+                    palette[2][3] = palette[3][3] = 255;
+                } else {
+                    for (int i=0;i<3;i++){
+                        palette[2][i] = (uint8_t)((palette[0][i] + palette[1][i]) / 2);
+                        palette[3][i] = 0;
+                    }
+                    palette[2][3] = 255;
+                    palette[3][3] = transparentBlack ? 0 : 255;
+                }
+                uint32_t indices = readU32((const char*)block + 4);
+                for (int i=0;i<16;i++){
+                    memcpy(pixels + i*4, palette[(indices >> (2*i)) & 3], 4);
+                }
+            }
+
+            void decodeBC2Alpha(const uint8_t* block, uint8_t* pixels){
+                for (int i=0;i<16;i++){
+                    int a = (block[i/2] >> ((i%2)*4)) & 0xF;
+                    pixels[i*4+3] = (uint8_t)(a | (a << 4));
+                }
+            }
+
+            void decodeBC3Alpha(const uint8_t* block, uint8_t* pixels){
+                int a0 = block[0];
+                int a1 = block[1];
+                uint8_t palette[8];
+                palette[0] = (uint8_t)a0;
+                palette[1] = (uint8_t)a1;
+                if (a0 > a1){
+                    for (int i=1;i<7;i++){
+                        palette[i+1] = (uint8_t)(((7-i)*a0 + i*a1) / 7);
+                    }
+                } else {
+                    for (int i=1;i<5;i++){
+                        palette[i+1] = (uint8_t)(((5-i)*a0 + i*a1) / 5);
+                    }
+                    palette[6] = 0;
+                    palette[7] = 255;
+                }
+                uint64_t indices = 0;
+                for (int i=0;i<6;i++){
+                    indices |= (uint64_t)block[2+i] << (8*i);
+                }
+                for (int i=0;i<16;i++){
+                    pixels[i*4+3] = palette[(indices >> (3*i)) & 7];
+                }
+            }
+
+            // ETC1 / ETC2 / EAC ----------------------------------------------------
+
+            const int etcModifierTable[8][2] = {{2,8},{5,17},{9,29},{13,42},{18,60},{24,80},{33,106},{47,183}};
+            const int etcDistanceTable[8] = {3,6,11,16,23,32,41,64};
+            const int eacModifierTable[16][8] = {
+                    {-3,-6,-9,-15,2,5,8,14},
+                    {-3,-7,-10,-13,2,6,9,12},
+                    {-2,-5,-8,-13,1,4,7,12},
+                    {-2,-4,-6,-13,1,3,5,12},
+                    {-3,-6,-8,-12,2,5,7,11},
+                    {-3,-7,-9,-11,2,6,8,10},
+                    {-4,-7,-8,-11,3,6,7,10},
+                    {-3,-5,-8,-11,2,4,7,10},
+                    {-2,-6,-8,-10,1,5,7,9},
+                    {-2,-5,-8,-10,1,4,7,9},
+                    {-2,-4,-8,-10,1,3,7,9},
+                    {-2,-5,-7,-10,1,4,6,9},
+                    {-3,-4,-7,-10,2,3,6,9},
+                    {-1,-2,-3,-10,0,1,2,9},
+                    {-4,-6,-8,-9,3,5,7,8},
+                    {-3,-5,-7,-9,2,4,6,8}
+            };
+
+            uint8_t clamp255(int v){
+                return (uint8_t)std::min(255, std::max(0, v));
+            }
+
+            uint64_t readBigEndian64(const uint8_t* block){
+                uint64_t res = 0;
+                for (int i=0;i<8;i++){
+                    res = (res << 8) | block[i];
+                }
+                return res;
+            }
+
+            int bits(uint64_t v, int high, int low){
+                return (int)((v >> low) & ((1ull << (high - low + 1)) - 1));
+            }
+
+            int extend4(int v){ return (v << 4) | v; }
+            int extend5(int v){ return (v << 3) | (v >> 2); }
+            int extend6(int v){ return (v << 2) | (v >> 4); }
+            int extend7(int v){ return (v << 1) | (v >> 6); }
+
+            // ETC pixel indices are stored column-major: p = x*4 + y
+            int etcPixelIndex(uint64_t block, int x, int y){
+                int p = x*4 + y;
+                int msb = (int)((block >> (16 + p)) & 1);
+                int lsb = (int)((block >> p) & 1);
+                return msb*2 + lsb;
+            }
+
+            void writePixel(uint8_t* pixels, int x, int y, int r, int g, int b){
+                uint8_t* p = pixels + (y*4 + x)*4;
+                p[0] = clamp255(r);
+                p[1] = clamp255(g);
+                p[2] = clamp255(b);
+                p[3] = 255;
+            }
+
+            void decodeETC2Block(const uint8_t* data, uint8_t* pixels){
+                uint64_t block = readBigEndian64(data);
+                bool diff = bits(block, 33, 33) == 1;
+                bool flip = bits(block, 32, 32) == 1;
+                int base[2][3];
+                if (diff){
+                    int r = bits(block, 63, 59), g = bits(block, 55, 51), b = bits(block, 47, 43);
+                    int dr = bits(block, 58, 56), dg = bits(block, 50, 48), db = bits(block, 42, 40);
+                    dr = dr >= 4 ? dr - 8 : dr;
+                    dg = dg >= 4 ? dg - 8 : dg;
+                    db = db >= 4 ? db - 8 : db;
+                    int r2 = r + dr, g2 = g + dg, b2 = b + db;
+                    if (r2 < 0 || r2 > 31){
+                        // T mode
+                        int c[2][3] = {
+                                {extend4((bits(block, 60, 59) << 2) | bits(block, 57, 56)), extend4(bits(block, 55, 52)), extend4(bits(block, 51, 48))},
+                                {extend4(bits(block, 47, 44)), extend4(bits(block, 43, 40)), extend4(bits(block, 39, 36))}
+                        };
+                        int d = etcDistanceTable[(bits(block, 35, 34) << 1) | bits(block, 32, 32)];
+                        int paint[4][3];
+                        for (int i=0;i<3;i++){
+                            paint[0][i] = c[0][i];
+                            paint[1][i] = c[1][i] + d;
+                            paint[2][i] = c[1][i];
+                            paint[3][i] = c[1][i] - d;
+                        }
+                        for (int y=0;y<4;y++) for (int x=0;x<4;x++){
+                            int* p = paint[etcPixelIndex(block, x, y)];
+                            writePixel(pixels, x, y, p[0], p[1], p[2]);
+                        }
+                        return;
+                    }
+                    if (g2 < 0 || g2 > 31){
+                        // H mode
+                        int c4[2][3] = {
+                                {bits(block, 62, 59), (bits(block, 58, 56) << 1) | bits(block, 52, 52), (bits(block, 51, 51) << 3) | bits(block, 49, 47)},
+                                {bits(block, 46, 43), bits(block, 42, 39), bits(block, 38, 35)}
+                        };
+                        int v0 = (c4[0][0] << 8) | (c4[0][1] << 4) | c4[0][2];
+                        int v1 = (c4[1][0] << 8) | (c4[1][1] << 4) | c4[1][2];
+                        int d = etcDistanceTable[(bits(block, 34, 34) << 2) | (bits(block, 32, 32) << 1) | (v0 >= v1 ? 1 : 0)];
+                        int paint[4][3];
+                        for (int i=0;i<3;i++){
+                            paint[0][i] = extend4(c4[0][i]) + d;
+                            paint[1][i] = extend4(c4[0][i]) - d;
+                            paint[2][i] = extend4(c4[1][i]) + d;
+                            paint[3][i] = extend4(c4[1][i]) - d;
+                        }
+                        for (int y=0;y<4;y++) for (int x=0;x<4;x++){
+                            int* p = paint[etcPixelIndex(block, x, y)];
+                            writePixel(pixels, x, y, p[0], p[1], p[2]);
+                        }
+                        return;
+                    }
+                    if (b2 < 0 || b2 > 31){
+                        // planar mode
+                        int ro = extend6(bits(block, 62, 57));
+                        int go = extend7((bits(block, 56, 56) << 6) | bits(block, 54, 49));
+                        int bo = extend6((bits(block, 48, 48) << 5) | (bits(block, 44, 43) << 3) | bits(block, 41, 39));
+                        int rh = extend6((bits(block, 38, 34) << 1) | bits(block, 32, 32));
+                        int gh = extend7(bits(block, 31, 25));
+                        int bh = extend6(bits(block, 24, 19));
+                        int rv = extend6(bits(block, 18, 13));
+                        int gv = extend7(bits(block, 12, 6));
+                        int bv = extend6(bits(block, 5, 0));
+                        for (int y=0;y<4;y++) for (int x=0;x<4;x++){
+                            writePixel(pixels, x, y,
+                                       (x*(rh-ro) + y*(rv-ro) + 4*ro + 2) >> 2,
+                                       (x*(gh-go) + y*(gv-go) + 4*go + 2) >> 2,
+                                       (x*(bh-bo) + y*(bv-bo) + 4*bo + 2) >> 2);
+                        }
+                        return;
+                    }
+                    base[0][0] = extend5(r);  base[0][1] = extend5(g);  base[0][2] = extend5(b);
+                    base[1][0] = extend5(r2); base[1][1] = extend5(g2); base[1][2] = extend5(b2);
+                } else {
+                    base[0][0] = extend4(bits(block, 63, 60)); base[1][0] = extend4(bits(block, 59, 56));
+                    base[0][1] = extend4(bits(block, 55, 52)); base[1][1] = extend4(bits(block, 51, 48));
+                    base[0][2] = extend4(bits(block, 47, 44)); base[1][2] = extend4(bits(block, 43, 40));
+                }
+                int table[2] = {bits(block, 39, 37), bits(block, 36, 34)};
+                for (int y=0;y<4;y++) for (int x=0;x<4;x++){
+                    int sub = flip ? (y >= 2) : (x >= 2);
+                    int idx = etcPixelIndex(block, x, y);
+                    int modifier = etcModifierTable[table[sub]][idx & 1];
+                    if (idx >= 2){
+                        modifier = -modifier;
+                    }
+                    writePixel(pixels, x, y, base[sub][0] + modifier, base[sub][1] + modifier, base[sub][2] + modifier);
+                }
+            }
+
+            void decodeEACAlpha(const uint8_t* data, uint8_t* pixels){
+                int base = data[0];
+                int multiplier = data[1] >> 4;
+                const int* modifiers = eacModifierTable[data[1] & 0xF];
+                uint64_t indices = 0;
+                for (int i=2;i<8;i++){
+                    indices = (indices << 8) | data[i];
+                }
+                for (int x=0;x<4;x++) for (int y=0;y<4;y++){
+                    int p = x*4 + y;
+                    int idx = (int)((indices >> (45 - 3*p)) & 7);
+                    pixels[(y*4 + x)*4 + 3] = clamp255(base + modifiers[idx] * multiplier);
+                }
+            }
+        }
+
+        bool isContainer(const char *data, size_t size) {
+            if (size >= 12 && (memcmp(data, ktx1Identifier, 12) == 0 || memcmp(data, ktx2Identifier, 12) == 0)){
+                return true;
+            }
+            return size >= 4 && memcmp(data, "DDS ", 4) == 0;
+        }
+
+        bool parse(const char *data, size_t size, Image &image) {
+            if (size >= 12 && memcmp(data, ktx1Identifier, 12) == 0){
+                return parseKTX1(data, size, image);
+            }
+            if (size >= 12 && memcmp(data, ktx2Identifier, 12) == 0){
+                return parseKTX2(data, size, image);
+            }
+            if (size >= 4 && memcmp(data, "DDS ", 4) == 0){
+                return parseDDS(data, size, image);
+            }
+            return false;
+        }
+
+        int blockSize(BlockFormat format) {
+            switch (format){
+                case BlockFormat::BC1:
+                case BlockFormat::BC1A:
+                case BlockFormat::ETC2_RGB8:
+                    return 8;
+                case BlockFormat::BC2:
+                case BlockFormat::BC3:
+                case BlockFormat::BC7:
+                case BlockFormat::ETC2_RGBA8:
+                    return 16;
+                default:
+                    return 0;
+            }
+        }
+
+        size_t levelSize(BlockFormat format, int width, int height) {
+            return (size_t)std::max(1, (width+3)/4) * (size_t)std::max(1, (height+3)/4) * (size_t)blockSize(format);
+        }
+
+        bool hasAlpha(BlockFormat format) {
+            return format != BlockFormat::BC1 && format != BlockFormat::ETC2_RGB8;
+        }
+
+        uint32_t glFormat(BlockFormat format, bool srgb) {
+            switch (format){
+                case BlockFormat::BC1:
+                    return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+                case BlockFormat::BC1A:
+                    return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+                case BlockFormat::BC2:
+                    return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT : GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+                case BlockFormat::BC3:
+                    return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+                case BlockFormat::BC7:
+                    return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+                case BlockFormat::ETC2_RGB8:
+                    return srgb ? GL_COMPRESSED_SRGB8_ETC2 : GL_COMPRESSED_RGB8_ETC2;
+                case BlockFormat::ETC2_RGBA8:
+                    return srgb ? GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC : GL_COMPRESSED_RGBA8_ETC2_EAC;
+                default:
+                    return 0;
+            }
+        }
+
+        uint32_t glFormatSRGB(uint32_t format) {
+            return glFormat(fromGLFormat(format), true);
+        }
+
+        bool isSupportedByGPU(BlockFormat format) {
+            switch (format){
+                case BlockFormat::BC1:
+                case BlockFormat::BC1A:
+                case BlockFormat::BC2:
+                case BlockFormat::BC3:
+                    return renderInfo().supportTextureCompressionS3TC;
+                case BlockFormat::BC7:
+                    return renderInfo().supportTextureCompressionBPTC;
+                case BlockFormat::ETC2_RGB8:
+                case BlockFormat::ETC2_RGBA8:
+                    return renderInfo().supportTextureCompressionETC2;
+                default:
+                    return false;
+            }
+        }
+
+        bool canDecode(BlockFormat format) {
+            return format != BlockFormat::None && format != BlockFormat::BC7;
+        }
+
+        std::vector<char> decode(BlockFormat format, const char *data, int width, int height) {
+            std::vector<char> res((size_t)width*height*4);
+            int blocksX = std::max(1, (width+3)/4);
+            int blocksY = std::max(1, (height+3)/4);
+            int bytesPerBlock = blockSize(format);
+            uint8_t pixels[16*4];
+            for (int by=0;by<blocksY;by++){
+                for (int bx=0;bx<blocksX;bx++){
+                    auto block = (const uint8_t*)data + ((size_t)by*blocksX + bx)*bytesPerBlock;
+                    switch (format){
+                        case BlockFormat::BC1:
+                            decodeBC1Block(block, pixels, true, false);
+                            break;
+                        case BlockFormat::BC1A:
+                            decodeBC1Block(block, pixels, true, true);
+                            break;
+                        case BlockFormat::BC2:
+                            decodeBC1Block(block + 8, pixels, false, false);
+                            decodeBC2Alpha(block, pixels);
+                            break;
+                        case BlockFormat::BC3:
+                            decodeBC1Block(block + 8, pixels, false, false);
+                            decodeBC3Alpha(block, pixels);
+                            break;
+                        case BlockFormat::ETC2_RGB8:
+                            decodeETC2Block(block, pixels);
+                            break;
+                        case BlockFormat::ETC2_RGBA8:
+                            decodeETC2Block(block + 8, pixels);
+                            decodeEACAlpha(block, pixels);
+                            break;
+                        default:
+                            LOG_ERROR("No CPU decoder for compressed format");
+                            return {};
+                    }
+                    // copy block (clipped to image size)
+                    for (int y=0;y<4 && by*4+y < height;y++){
+                        int w = std::min(4, width - bx*4);
+                        memcpy(&res[((size_t)(by*4+y)*width + bx*4)*4], pixels + y*16, (size_t)w*4);
+                    }
+                }
+            }
+            return res;
+        }
+    }
+}
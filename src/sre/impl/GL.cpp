@@ -8,6 +8,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 #include <SDL_video.h>
 #include <SDL.h>
 
@@ -86,24 +87,26 @@ bool getMaximumOpenGLSupport(int * major_, int * minor_){
 }
 
 bool hasExtension(const std::string& extensionName){
-    std::string exts = (char*)glGetString(GL_EXTENSIONS);
-    std::stringstream ss(exts);
-    std::string item;
-    std::vector<std::string> elems;
-    while (std::getline(ss, item, ' ')) {
-        if (item == extensionName){
-            return true;
-        }
-    }
-
-    return false;
+    auto exts = listExtension();
+    return std::find(exts.begin(), exts.end(), extensionName) != exts.end();
 }
 
 std::vector<std::string> listExtension(){
-    std::string exts = (char*)glGetString(GL_EXTENSIONS);
+    std::vector<std::string> elems;
+    auto extsPtr = (const char*)glGetString(GL_EXTENSIONS);
+    if (extsPtr == nullptr){
+        // core profile: GL_EXTENSIONS is only available using glGetStringi
+        GLint count = 0;
+        glGetError();
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i=0;i<count;i++){
+            elems.emplace_back((const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i));
+        }
+        return elems;
+    }
+    std::string exts = extsPtr;
     std::stringstream ss(exts);
     std::string item;
-    std::vector<std::string> elems;
     while (std::getline(ss, item, ' ')) {
         elems.push_back(std::move(item));
     }
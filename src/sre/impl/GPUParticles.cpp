@@ -0,0 +1,242 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/impl/GPUParticles.hpp"
+
+#include <algorithm>
+#include <string>
+#include "sre/impl/GL.hpp"
+#include "sre/Mesh.hpp"
+#include "sre/Renderer.hpp"
+#include "sre/Resource.hpp"
+#include "sre/Log.hpp"
+
+namespace sre {
+#ifdef GL_COMPUTE_SHADER
+    namespace {
+        const int groupSize = 256;                      // local_size_x of the particle compute shaders
+        const int bytesPerParticle = 48;                // Particle struct of the compute shaders (3 x vec4)
+        const int bytesPerSortEntry = 8;
+
+        int groups(int count){
+            return (count + groupSize - 1) / groupSize;
+        }
+
+        int nextPowerOfTwo(int value){
+            int res = 1;
+            while (res < value){
+                res *= 2;
+            }
+            return res;
+        }
+    }
+
+    bool GPUParticles::isSupported() {
+        return renderInfo().supportComputeShader;
+    }
+
+    GPUParticles::GPUParticles(ParticleSystem& particleSystem)
+    :particleSystem(particleSystem)
+    {
+        emitProgram = compile("particles_emit_comp.glsl");
+        simulateProgram = compile("particles_simulate_comp.glsl");
+        sortProgram = compile("particles_sort_comp.glsl");
+        indicesProgram = compile("particles_indices_comp.glsl");
+        if (!isValid()){
+            return;
+        }
+        sortK = glGetUniformLocation(sortProgram, "k");
+        sortJ = glGetUniformLocation(sortProgram, "j");
+
+        int maxParticles = particleSystem.maxParticles;
+        sortSize = particleSystem.depthSort ? nextPowerOfTwo(maxParticles) : maxParticles;
+        glGenBuffers(1, &particleBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)maxParticles * bytesPerParticle, nullptr, GL_DYNAMIC_COPY);
+        glGenBuffers(1, &sortBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sortBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)sortSize * bytesPerSortEntry, nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        // the vertices and indices are only written by the compute shaders
+        auto& mesh = particleSystem.mesh;
+        mesh->setVertexData(nullptr, maxParticles, false);
+        mesh->setIndexData(nullptr, maxParticles, true, false);
+        mesh->meshTopology[0] = MeshTopology::Points;
+        clear();
+    }
+
+    GPUParticles::~GPUParticles() {
+        for (auto program : {emitProgram, simulateProgram, sortProgram, indicesProgram}){
+            if (program != 0){
+                glDeleteProgram(program);
+            }
+        }
+        if (particleBuffer != 0){
+            glDeleteBuffers(1, &particleBuffer);
+        }
+        if (sortBuffer != 0){
+            glDeleteBuffers(1, &sortBuffer);
+        }
+    }
+
+    bool GPUParticles::isValid() {
+        return emitProgram != 0 && simulateProgram != 0 && sortProgram != 0 && indicesProgram != 0;
+    }
+
+    unsigned int GPUParticles::compile(const char* sourceName) {
+        std::string source = Resource::loadText(sourceName);
+        const char* sourcePtr = source.c_str();
+        GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(shader, 1, &sourcePtr, nullptr);
+        glCompileShader(shader);
+        GLint success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success){
+            GLint logSize = 0;
+            glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logSize);
+            std::vector<char> errorLog((size_t)std::max(logSize, 1));
+            glGetShaderInfoLog(shader, logSize, &logSize, errorLog.data());
+            LOG_ERROR("Cannot compile %s: %s", sourceName, errorLog.data());
+            glDeleteShader(shader);
+            return 0;
+        }
+        GLuint program = glCreateProgram();
+        glAttachShader(program, shader);
+        glLinkProgram(program);
+        glDeleteShader(shader);
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success){
+            GLint logSize = 0;
+            glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logSize);
+            std::vector<char> errorLog((size_t)std::max(logSize, 1));
+            glGetProgramInfoLog(program, logSize, &logSize, errorLog.data());
+            LOG_ERROR("Cannot link %s: %s", sourceName, errorLog.data());
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+
+    void GPUParticles::update(float deltaTime, const std::vector<std::pair<const ParticleSystem::Emitter*, int>>& emissions,
+                              const glm::mat4& modelView, int drawCount) {
+        auto& ps = particleSystem;
+        int maxParticles = ps.maxParticles;
+        frame++;
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, ps.mesh->vertexBufferId);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, sortBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, ps.mesh->elementBufferId);
+
+        // emit new particles into the next slots of the ring
+        bool emitted = false;
+        glUseProgram(emitProgram);
+        for (size_t e=0;e<emissions.size();e++){
+            int count = std::min(emissions[e].second, maxParticles);
+            if (count <= 0){
+                continue;
+            }
+            auto& emitter = *emissions[e].first;
+            glUniform1i(glGetUniformLocation(emitProgram, "ringStart"), ringStart);
+            glUniform1i(glGetUniformLocation(emitProgram, "count"), count);
+            glUniform1i(glGetUniformLocation(emitProgram, "maxParticles"), maxParticles);
+            glUniform1ui(glGetUniformLocation(emitProgram, "seed"), frame * 0x9E3779B9u ^ (uint32_t)(e + 1) * 0x85EBCA6Bu);
+            glUniform3fv(glGetUniformLocation(emitProgram, "position"), 1, &emitter.position.x);
+            glUniform3fv(glGetUniformLocation(emitProgram, "positionSpread"), 1, &emitter.positionSpread.x);
+            glUniform3fv(glGetUniformLocation(emitProgram, "velocity"), 1, &emitter.velocity.x);
+            glUniform3fv(glGetUniformLocation(emitProgram, "velocitySpread"), 1, &emitter.velocitySpread.x);
+            glUniform2fv(glGetUniformLocation(emitProgram, "lifetime"), 1, &emitter.lifetime.x);
+            glUniform2fv(glGetUniformLocation(emitProgram, "rotation"), 1, &emitter.rotation.x);
+            glUniform2fv(glGetUniformLocation(emitProgram, "angularVelocity"), 1, &emitter.angularVelocity.x);
+            glDispatchCompute(groups(count), 1, 1);
+            ringStart = (ringStart + count) % maxParticles;
+            emitted = true;
+        }
+        if (emitted){
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+
+        // integrate all slots and write the vertices and sort keys
+        glm::vec3 deltaVelocity = ps.gravity * deltaTime;
+        glm::vec4 colorDelta = ps.colorEnd - ps.colorStart;
+        glUseProgram(simulateProgram);
+        glUniform1i(glGetUniformLocation(simulateProgram, "maxParticles"), maxParticles);
+        glUniform1i(glGetUniformLocation(simulateProgram, "sortSize"), sortSize);
+        glUniform1f(glGetUniformLocation(simulateProgram, "deltaTime"), deltaTime);
+        glUniform3fv(glGetUniformLocation(simulateProgram, "deltaVelocity"), 1, &deltaVelocity.x);
+        glUniform1f(glGetUniformLocation(simulateProgram, "damping"), std::max(0.0f, 1.0f - ps.drag * deltaTime));
+        glUniform4fv(glGetUniformLocation(simulateProgram, "colorStart"), 1, &ps.colorStart.x);
+        glUniform4fv(glGetUniformLocation(simulateProgram, "colorDelta"), 1, &colorDelta.x);
+        glUniform1f(glGetUniformLocation(simulateProgram, "sizeStart"), ps.sizeStart);
+        glUniform1f(glGetUniformLocation(simulateProgram, "sizeDelta"), ps.sizeEnd - ps.sizeStart);
+        glUniform4fv(glGetUniformLocation(simulateProgram, "uv"), 1, &ps.uv.x);
+        glUniformMatrix4fv(glGetUniformLocation(simulateProgram, "modelView"), 1, GL_FALSE, &modelView[0][0]);
+        glDispatchCompute(groups(sortSize), 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        // bitonic sort of the keys (one dispatch per compare distance)
+        if (ps.depthSort){
+            glUseProgram(sortProgram);
+            for (int k=2;k<=sortSize;k*=2){
+                for (int j=k/2;j>0;j/=2){
+                    glUniform1i(sortK, k);
+                    glUniform1i(sortJ, j);
+                    glDispatchCompute(groups(sortSize), 1, 1);
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+                }
+            }
+        }
+
+        glUseProgram(indicesProgram);
+        glUniform1i(glGetUniformLocation(indicesProgram, "maxParticles"), maxParticles);
+        glDispatchCompute(groups(maxParticles), 1, 1);
+        glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT);
+
+        glUseProgram(0);
+        for (GLuint binding=0;binding<4;binding++){
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+        }
+        ps.mesh->setIndexRanges({{0, std::min(drawCount, maxParticles)}});
+    }
+
+    void GPUParticles::clear() {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleBuffer);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32F, GL_RED, GL_FLOAT, nullptr);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        ringStart = 0;
+        particleSystem.mesh->setIndexRanges({{0, 0}});
+    }
+#else
+    // compute shaders are not available in the OpenGL headers of this platform (OpenGL ES / macOS)
+    bool GPUParticles::isSupported() {
+        return false;
+    }
+
+    GPUParticles::GPUParticles(ParticleSystem& particleSystem)
+    :particleSystem(particleSystem)
+    {
+    }
+
+    GPUParticles::~GPUParticles() {
+    }
+
+    bool GPUParticles::isValid() {
+        return false;
+    }
+
+    unsigned int GPUParticles::compile(const char* sourceName) {
+        return 0;
+    }
+
+    void GPUParticles::update(float deltaTime, const std::vector<std::pair<const ParticleSystem::Emitter*, int>>& emissions,
+                              const glm::mat4& modelView, int drawCount) {
+    }
+
+    void GPUParticles::clear() {
+    }
+#endif
+}
@@ -0,0 +1,272 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/impl/LightClusters.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include "sre/impl/GL.hpp"
+#include "sre/impl/WorkerPool.hpp"
+#include "sre/Shader.hpp"
+#include "sre/WorldLights.hpp"
+
+namespace sre {
+    namespace {
+        const int tilesX = 16;
+        const int tilesY = 9;
+        const int slices = 24;
+        const int textureWidth = 1024;              // must match clusterTexel() in light_incl.glsl
+        const int firstTextureUnit = 13;            // light, grid and index textures use the last of the 16 guaranteed units
+
+        using Clock = std::chrono::high_resolution_clock;
+        using Milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>;
+
+        // Execute func(slice) for all slices. Each slice is a task of the worker pool, so threads pick up new slices
+        // as they finish (the lights are not evenly distributed in depth)
+        template<typename F>
+        void parallelForSlices(int work, F func){
+            if (work < 4096){
+                for (int i=0;i<slices;i++){
+                    func(i);
+                }
+                return;
+            }
+            WorkerPool::instance().parallelFor(slices, func);
+        }
+    }
+
+    LightClusters::LightClusters() {
+        GLuint textures[3];
+        glGenTextures(3, textures);
+        lightTexture = textures[0];
+        gridTexture = textures[1];
+        indexTexture = textures[2];
+        for (auto texture : textures){
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        clusterLights.resize(tilesX * tilesY * slices);
+        grid.resize(tilesX * tilesY * slices);
+    }
+
+    LightClusters::~LightClusters() {
+        GLuint textures[3] = {lightTexture, gridTexture, indexTexture};
+        glDeleteTextures(3, textures);
+    }
+
+    void LightClusters::update(WorldLights *worldLights, const glm::mat4 &view, const glm::mat4 &projection) {
+        auto start = Clock::now();
+        if (projection != this->projection){
+            updateClusterBounds(projection);
+        }
+
+        // unclustered lights first, followed by the clustered lights
+        lightData.clear();
+        clusteredLights.clear();
+        int lightCount = worldLights ? worldLights->lightCount() : 0;
+        for (int i=0;i<lightCount;i++){
+            auto light = worldLights->getLight(i);
+            if (light->lightType == LightType::Directional){
+                lightData.emplace_back(glm::normalize(light->direction), 0.0f);
+                lightData.emplace_back(light->color, light->range);
+            } else if (light->lightType == LightType::Point && light->range <= 0){
+                lightData.emplace_back(light->position, 1.0f);
+                lightData.emplace_back(light->color, light->range);
+            }
+        }
+        unclusteredLights = (int)lightData.size()/2;
+        for (int i=0;i<lightCount;i++){
+            auto light = worldLights->getLight(i);
+            if (light->lightType == LightType::Point && light->range > 0){
+                lightData.emplace_back(light->position, 1.0f);
+                lightData.emplace_back(light->color, light->range);
+                clusteredLights.push_back({glm::vec3(view * glm::vec4(light->position, 1.0f)), light->range});
+            }
+        }
+
+        parallelForSlices((int)clusteredLights.size() * slices, [&](int slice){
+            assignLights(slice);
+        });
+
+        // flatten the cluster lists
+        lightIndices.clear();
+        for (size_t i=0;i<clusterLights.size();i++){
+            grid[i] = glm::uvec2(lightIndices.size(), clusterLights[i].size());
+            lightIndices.insert(lightIndices.end(), clusterLights[i].begin(), clusterLights[i].end());
+        }
+
+        upload(lightTexture, lightTextureRows, GL_RGBA32F, GL_RGBA, GL_FLOAT, lightData.data(), (int)lightData.size(), sizeof(glm::vec4));
+        upload(gridTexture, gridTextureRows, GL_RG32UI, GL_RG_INTEGER, GL_UNSIGNED_INT, grid.data(), (int)grid.size(), sizeof(glm::uvec2));
+        upload(indexTexture, indexTextureRows, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, lightIndices.data(), (int)lightIndices.size(), sizeof(uint32_t));
+
+        updateTime = std::chrono::duration_cast<Milliseconds>(Clock::now() - start).count();
+    }
+
+    void LightClusters::updateClusterBounds(const glm::mat4 &projection) {
+        this->projection = projection;
+        orthographic = projection[3][3] == 1.0f;
+        float nearPlane, farPlane;
+        if (orthographic){
+            nearPlane = (projection[3][2] + 1) / projection[2][2];
+            farPlane = (projection[3][2] - 1) / projection[2][2];
+        } else {
+            nearPlane = projection[3][2] / (projection[2][2] - 1);
+            farPlane = projection[3][2] / (projection[2][2] + 1);
+            if (!std::isfinite(farPlane) || farPlane <= nearPlane){
+                farPlane = nearPlane * 10000;                 // infinite projection
+            }
+        }
+        sliceDepth.resize(slices + 1);
+        for (int i=0;i<=slices;i++){
+            float t = i / (float)slices;
+            sliceDepth[i] = orthographic ? nearPlane + (farPlane - nearPlane) * t : nearPlane * std::pow(farPlane / nearPlane, t);
+        }
+        // slice = depth * scale + bias (orthographic) or log(depth) * scale + bias (perspective)
+        if (orthographic){
+            float scale = slices / (farPlane - nearPlane);
+            sliceScaleBias = glm::vec2(scale, -nearPlane * scale);
+        } else {
+            float scale = slices / std::log(farPlane / nearPlane);
+            sliceScaleBias = glm::vec2(scale, -std::log(nearPlane) * scale);
+        }
+
+        // cluster corners are found by moving the points on the near plane along the view rays
+        auto inverseProjection = glm::inverse(projection);
+        auto corner = [&](int x, int y, float depth){
+            glm::vec4 ndc(x * 2.0f / tilesX - 1.0f, y * 2.0f / tilesY - 1.0f, -1.0f, 1.0f);
+            glm::vec4 p = inverseProjection * ndc;
+            glm::vec3 nearPoint = glm::vec3(p) / p.w;
+            if (orthographic){
+                return glm::vec3(nearPoint.x, nearPoint.y, -depth);
+            }
+            return nearPoint * (depth / -nearPoint.z);
+        };
+        clusterBounds.resize(tilesX * tilesY * slices);
+        for (int z=0;z<slices;z++){
+            for (int y=0;y<tilesY;y++){
+                for (int x=0;x<tilesX;x++){
+                    Bounds bounds{glm::vec3(std::numeric_limits<float>::max()), glm::vec3(-std::numeric_limits<float>::max())};
+                    for (int i=0;i<8;i++){
+                        glm::vec3 p = corner(x + (i & 1), y + ((i >> 1) & 1), sliceDepth[z + (i >> 2)]);
+                        bounds.min = glm::min(bounds.min, p);
+                        bounds.max = glm::max(bounds.max, p);
+                    }
+                    clusterBounds[x + (y + z * tilesY) * tilesX] = bounds;
+                }
+            }
+        }
+    }
+
+    void LightClusters::assignLights(int slice) {
+        for (int i=0;i<tilesX * tilesY;i++){
+            clusterLights[slice * tilesX * tilesY + i].clear();
+        }
+        float sliceNear = sliceDepth[slice];
+        float sliceFar = sliceDepth[slice + 1];
+        for (size_t l=0;l<clusteredLights.size();l++){
+            auto& light = clusteredLights[l];
+            float depth = -light.center.z;
+            if (depth + light.range < sliceNear || depth - light.range > sliceFar){
+                continue;
+            }
+            // project the bounds of the light (clipped to the slice) to find the tiles it may overlap
+            float minDepth = std::max(sliceNear, depth - light.range);
+            float maxDepth = std::min(sliceFar, depth + light.range);
+            glm::vec2 ndcMin(std::numeric_limits<float>::max());
+            glm::vec2 ndcMax(-std::numeric_limits<float>::max());
+            for (int i=0;i<8;i++){
+                glm::vec4 p(light.center.x + ((i & 1) ? light.range : -light.range),
+                            light.center.y + ((i & 2) ? light.range : -light.range),
+                            -((i & 4) ? maxDepth : minDepth),
+                            1.0f);
+                glm::vec4 clip = projection * p;
+                glm::vec2 ndc = glm::vec2(clip) / clip.w;
+                ndcMin = glm::min(ndcMin, ndc);
+                ndcMax = glm::max(ndcMax, ndc);
+            }
+            if (ndcMax.x < -1 || ndcMax.y < -1 || ndcMin.x > 1 || ndcMin.y > 1){
+                continue;
+            }
+            int x0 = glm::clamp((int)std::floor((ndcMin.x * 0.5f + 0.5f) * tilesX), 0, tilesX - 1);
+            int x1 = glm::clamp((int)std::floor((ndcMax.x * 0.5f + 0.5f) * tilesX), 0, tilesX - 1);
+            int y0 = glm::clamp((int)std::floor((ndcMin.y * 0.5f + 0.5f) * tilesY), 0, tilesY - 1);
+            int y1 = glm::clamp((int)std::floor((ndcMax.y * 0.5f + 0.5f) * tilesY), 0, tilesY - 1);
+            float rangeSqr = light.range * light.range;
+            for (int y=y0;y<=y1;y++){
+                for (int x=x0;x<=x1;x++){
+                    int index = x + (y + slice * tilesY) * tilesX;
+                    auto& bounds = clusterBounds[index];
+                    glm::vec3 d = glm::clamp(light.center, bounds.min, bounds.max) - light.center;
+                    if (glm::dot(d, d) <= rangeSqr){
+                        clusterLights[index].push_back((uint32_t)(unclusteredLights + l));
+                    }
+                }
+            }
+        }
+    }
+
+    void LightClusters::upload(unsigned int texture, int &allocatedRows, uint32_t internalFormat, uint32_t format, uint32_t type,
+                               const void *data, int texels, int texelSize) {
+        int rows = std::max(1, (texels + textureWidth - 1) / textureWidth);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        if (rows > allocatedRows){
+            allocatedRows = std::max(rows, allocatedRows * 2);
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, textureWidth, allocatedRows, 0, format, type, nullptr);
+        }
+        int fullRows = texels / textureWidth;
+        if (fullRows > 0){
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureWidth, fullRows, format, type, data);
+        }
+        int remaining = texels - fullRows * textureWidth;
+        if (remaining > 0){
+            auto rowData = static_cast<const char*>(data) + (size_t)fullRows * textureWidth * texelSize;
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, fullRows, remaining, 1, format, type, rowData);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void LightClusters::bind(Shader *shader) {
+        unsigned int textures[3] = {lightTexture, gridTexture, indexTexture};
+        int locations[3] = {shader->uniformLocationClusterLights, shader->uniformLocationClusterGrid, shader->uniformLocationClusterLightIndices};
+        for (int i=0;i<3;i++){
+            glActiveTexture(GL_TEXTURE0 + firstTextureUnit + i);
+            glBindTexture(GL_TEXTURE_2D, textures[i]);
+            if (locations[i] != -1){
+                glUniform1i(locations[i], firstTextureUnit + i);
+            }
+        }
+        glActiveTexture(GL_TEXTURE0);
+        if (shader->uniformLocationClusterSize != -1){
+            glUniform4f(shader->uniformLocationClusterSize, (float)tilesX, (float)tilesY, (float)slices, (float)unclusteredLights);
+        }
+        if (shader->uniformLocationClusterDepth != -1){
+            glUniform4f(shader->uniformLocationClusterDepth, sliceScaleBias.x, sliceScaleBias.y, 0.0f, orthographic ? 1.0f : 0.0f);
+        }
+    }
+
+    int LightClusters::getLightCount() {
+        return (int)lightData.size()/2;
+    }
+
+    int LightClusters::getLightIndexCount() {
+        return (int)lightIndices.size();
+    }
+
+    glm::ivec3 LightClusters::getClusterSize() {
+        return {tilesX, tilesY, slices};
+    }
+
+    float LightClusters::getUpdateTime() {
+        return updateTime;
+    }
+}
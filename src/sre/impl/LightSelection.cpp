@@ -0,0 +1,137 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/impl/LightSelection.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include "sre/WorldLights.hpp"
+
+namespace sre {
+    namespace {
+        const int maxCellsPerQuery = 4096;          // larger lights and queries fall back to testing all lights
+
+        float luminance(const glm::vec3& color){
+            return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+        }
+
+        bool isSmall(const glm::vec3& size, float cellSize){
+            glm::vec3 cells = size / cellSize + 1.0f;
+            return cells.x * cells.y * cells.z <= maxCellsPerQuery;  // false for infinite or NaN bounds
+        }
+    }
+
+    void LightSelection::build(WorldLights *worldLights) {
+        this->worldLights = worldLights;
+        grid.clear();
+        unbounded.clear();
+        boundedLights.clear();
+        int lightCount = worldLights->lightCount();
+        queryStamp.assign(lightCount, -1);
+        query = 0;
+
+        float rangeSum = 0;
+        for (int i=0;i<lightCount;i++){
+            auto light = worldLights->getLight(i);
+            if (light->lightType == LightType::Point && light->range > 0){
+                boundedLights.push_back(i);
+                rangeSum += light->range;
+            } else if (light->lightType != LightType::Unused){
+                unbounded.push_back(i);
+            }
+        }
+        if (boundedLights.empty()){
+            return;
+        }
+        cellSize = std::max(0.001f, 2 * rangeSum / boundedLights.size());
+        for (auto i : boundedLights){
+            auto light = worldLights->getLight(i);
+            if (!isSmall(glm::vec3(light->range * 2), cellSize)){
+                unbounded.push_back(i);
+                continue;
+            }
+            glm::ivec3 from = cell(light->position - glm::vec3(light->range));
+            glm::ivec3 to = cell(light->position + glm::vec3(light->range));
+            for (int z=from.z;z<=to.z;z++){
+                for (int y=from.y;y<=to.y;y++){
+                    for (int x=from.x;x<=to.x;x++){
+                        grid[key({x,y,z})].push_back(i);
+                    }
+                }
+            }
+        }
+    }
+
+    void LightSelection::select(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, int maxLights, std::vector<int> &res) {
+        res.clear();
+        candidates.clear();
+        query++;
+        for (auto i : unbounded){
+            score(i, boundsMin, boundsMax);
+        }
+        if (!boundedLights.empty()){
+            if (!isSmall(boundsMax - boundsMin, cellSize)){
+                for (auto i : boundedLights){
+                    score(i, boundsMin, boundsMax);
+                }
+            } else {
+                glm::ivec3 from = cell(boundsMin);
+                glm::ivec3 to = cell(boundsMax);
+                for (int z=from.z;z<=to.z;z++){
+                    for (int y=from.y;y<=to.y;y++){
+                        for (int x=from.x;x<=to.x;x++){
+                            auto iter = grid.find(key({x,y,z}));
+                            if (iter == grid.end()){
+                                continue;
+                            }
+                            for (auto i : iter->second){
+                                score(i, boundsMin, boundsMax);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        int count = std::min(maxLights, (int)candidates.size());
+        std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), [](const Candidate& a, const Candidate& b){
+            return a.score > b.score;
+        });
+        for (int i=0;i<count;i++){
+            res.push_back(candidates[i].index);
+        }
+        std::sort(res.begin(), res.end());              // keeps the first light (which may cast shadows) in the first slot
+    }
+
+    void LightSelection::score(int index, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) {
+        if (queryStamp[index] == query){
+            return;
+        }
+        queryStamp[index] = query;
+        auto light = worldLights->getLight(index);
+        float intensity = luminance(light->color);
+        if (light->lightType != LightType::Point || light->range <= 0){
+            candidates.push_back({intensity + 1e10f, index});   // not attenuated
+            return;
+        }
+        glm::vec3 closest = glm::clamp(light->position, boundsMin, boundsMax);
+        float distance = glm::length(closest - light->position);
+        if (distance >= light->range){
+            return;
+        }
+        float attenuation = std::pow(1.0f - distance / light->range, 1.5f);     // matches light_incl.glsl
+        candidates.push_back({intensity * attenuation, index});
+    }
+
+    glm::ivec3 LightSelection::cell(const glm::vec3 &position) {
+        return glm::ivec3(glm::floor(position / cellSize));
+    }
+
+    int64_t LightSelection::key(const glm::ivec3 &cell) {
+        const int64_t mask = (1 << 21) - 1;
+        return ((cell.x & mask) << 42) | ((cell.y & mask) << 21) | (cell.z & mask);
+    }
+}
@@ -0,0 +1,247 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/impl/MipmapGenerator.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "sre/impl/WorkerPool.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SRE_MIPMAP_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace sre {
+    namespace mipmap {
+        namespace {
+            struct alignas(16) Float4 {         // std::vector does not honor the alignment before C++17 (unaligned SSE loads are used)
+                float v[4];
+            };
+
+            const float pi = 3.14159265358979f;
+
+            const float* srgbToLinearTable(){
+                static float table[256];
+                static bool initialized = [](){
+                    for (int i=0;i<256;i++){
+                        float c = i / 255.0f;
+                        table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                    }
+                    return true;
+                }();
+                (void)initialized;
+                return table;
+            }
+
+            const int linearToSrgbTableSize = 4096;
+            const uint8_t* linearToSrgbTable(){
+                static uint8_t table[linearToSrgbTableSize];
+                static bool initialized = [](){
+                    for (int i=0;i<linearToSrgbTableSize;i++){
+                        float c = i / (float)(linearToSrgbTableSize-1);
+                        float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1/2.4f) - 0.055f;
+                        table[i] = (uint8_t)std::min(255.0f, s * 255.0f + 0.5f);
+                    }
+                    return true;
+                }();
+                (void)initialized;
+                return table;
+            }
+
+            float sinc(float x){
+                if (std::fabs(x) < 1e-5f){
+                    return 1;
+                }
+                x *= pi;
+                return std::sin(x) / x;
+            }
+
+            // modified Bessel function of the first kind (order 0)
+            float besselI0(float x){
+                float sum = 1;
+                float term = 1;
+                for (int k=1;k<20;k++){
+                    term *= (x / (2*k)) * (x / (2*k));
+                    sum += term;
+                }
+                return sum;
+            }
+
+            // weights for a 2:1 reduction. Tap k samples source pixel 2*i - radius + 1 + k
+            std::vector<float> createKernel(Filter filter){
+                std::vector<float> weights;
+                if (filter == Filter::Box){
+                    return {0.5f, 0.5f};
+                }
+                const float lobes = 3;
+                const float alpha = 4;
+                int radius = (int)lobes*2;                   // in source pixels
+                for (int k=0;k<2*radius;k++){
+                    float d = (k - radius + 0.5f) / 2.0f;   // distance from destination pixel center in destination pixels
+                    float w;
+                    if (filter == Filter::Lanczos){
+                        w = sinc(d) * sinc(d / lobes);
+                    } else {
+                        float t = d / lobes;
+                        w = sinc(d) * besselI0(alpha * std::sqrt(std::max(0.0f, 1 - t*t))) / besselI0(alpha);
+                    }
+                    weights.push_back(w);
+                }
+                float sum = 0;
+                for (auto w : weights){
+                    sum += w;
+                }
+                for (auto & w : weights){
+                    w /= sum;
+                }
+                return weights;
+            }
+
+            int sampleIndex(int i, int size, bool wrap){
+                if (wrap){
+                    return ((i % size) + size) % size;
+                }
+                return std::min(size-1, std::max(0, i));
+            }
+
+            inline void accumulate(Float4& acc, const Float4& src, float w){
+#ifdef SRE_MIPMAP_SSE
+                _mm_storeu_ps(acc.v, _mm_add_ps(_mm_loadu_ps(acc.v), _mm_mul_ps(_mm_loadu_ps(src.v), _mm_set1_ps(w))));
+#else
+                for (int c=0;c<4;c++){
+                    acc.v[c] += src.v[c] * w;
+                }
+#endif
+            }
+
+            inline void saturate(Float4& v){
+#ifdef SRE_MIPMAP_SSE
+                _mm_storeu_ps(v.v, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(v.v), _mm_setzero_ps()), _mm_set1_ps(1.0f)));
+#else
+                for (int c=0;c<4;c++){
+                    v.v[c] = std::min(1.0f, std::max(0.0f, v.v[c]));
+                }
+#endif
+            }
+
+            // Split rows [0;count) in ranges executed by the worker pool. When the pool is busy (e.g. generating mipmaps
+            // on several texture loader threads) the ranges are executed on the calling thread
+            template<typename F>
+            void parallelFor(int count, int workPerItem, F func){
+                auto& pool = WorkerPool::instance();
+                int threadCount = pool.getThreadCount();
+                if (count * workPerItem < 64*1024 || threadCount == 1){
+                    func(0, count);
+                    return;
+                }
+                int chunk = std::max(1, count / (threadCount * 4));
+                pool.parallelFor((count + chunk - 1) / chunk, [&](int t){
+                    func(t * chunk, std::min(count, (t + 1) * chunk));
+                });
+            }
+
+            void downsample(const std::vector<Float4>& src, int width, int height, std::vector<Float4>& dst, int& dstWidth, int& dstHeight,
+                            const std::vector<float>& kernel, bool wrap){
+                dstWidth = std::max(1, width/2);
+                dstHeight = std::max(1, height/2);
+                int radius = (int)kernel.size()/2;
+                int taps = (int)kernel.size();
+
+                // horizontal pass
+                std::vector<Float4> tmp((size_t)dstWidth*height);
+                parallelFor(height, dstWidth*taps, [&](int begin, int end){
+                    for (int y=begin;y<end;y++){
+                        const Float4* srcRow = &src[(size_t)y*width];
+                        Float4* tmpRow = &tmp[(size_t)y*dstWidth];
+                        for (int x=0;x<dstWidth;x++){
+                            Float4 acc = {{0,0,0,0}};
+                            if (width == 1){
+                                acc = srcRow[0];
+                            } else {
+                                for (int k=0;k<taps;k++){
+                                    accumulate(acc, srcRow[sampleIndex(2*x - radius + 1 + k, width, wrap)], kernel[k]);
+                                }
+                            }
+                            tmpRow[x] = acc;
+                        }
+                    }
+                });
+
+                // vertical pass (row wise to stay cache friendly)
+                dst.assign((size_t)dstWidth*dstHeight, Float4{{0,0,0,0}});
+                parallelFor(dstHeight, dstWidth*taps, [&](int begin, int end){
+                    for (int y=begin;y<end;y++){
+                        Float4* dstRow = &dst[(size_t)y*dstWidth];
+                        if (height == 1){
+                            std::copy(tmp.begin(), tmp.begin() + dstWidth, dstRow);
+                        } else {
+                            for (int k=0;k<taps;k++){
+                                const Float4* tmpRow = &tmp[(size_t)sampleIndex(2*y - radius + 1 + k, height, wrap)*dstWidth];
+                                for (int x=0;x<dstWidth;x++){
+                                    accumulate(dstRow[x], tmpRow[x], kernel[k]);
+                                }
+                            }
+                        }
+                        for (int x=0;x<dstWidth;x++){
+                            saturate(dstRow[x]);
+                        }
+                    }
+                });
+            }
+        }
+
+        std::vector<std::vector<char>> generate(const char *data, int width, int height, int channels, Filter filter, bool srgb, bool wrap) {
+            std::vector<std::vector<char>> levels;
+            if (width <= 1 && height <= 1){
+                return levels;
+            }
+            const float* toLinear = srgbToLinearTable();
+            const uint8_t* toSrgb = linearToSrgbTable();
+            auto kernel = createKernel(filter);
+
+            // convert to linear floats
+            std::vector<Float4> current((size_t)width*height);
+            auto src = reinterpret_cast<const uint8_t*>(data);
+            for (size_t i=0;i<current.size();i++){
+                for (int c=0;c<4;c++){
+                    if (c >= channels){
+                        current[i].v[c] = 1;
+                    } else if (c < 3 && srgb){
+                        current[i].v[c] = toLinear[src[i*channels+c]];
+                    } else {
+                        current[i].v[c] = src[i*channels+c] / 255.0f;
+                    }
+                }
+            }
+
+            std::vector<Float4> next;
+            while (width > 1 || height > 1){
+                int nextWidth, nextHeight;
+                downsample(current, width, height, next, nextWidth, nextHeight, kernel, wrap);
+                std::vector<char> level((size_t)nextWidth*nextHeight*channels);
+                auto dst = reinterpret_cast<uint8_t*>(level.data());
+                for (size_t i=0;i<next.size();i++){
+                    for (int c=0;c<channels;c++){
+                        float v = next[i].v[c];
+                        if (c < 3 && srgb){
+                            dst[i*channels+c] = toSrgb[(int)(v * (linearToSrgbTableSize-1) + 0.5f)];
+                        } else {
+                            dst[i*channels+c] = (uint8_t)(v * 255.0f + 0.5f);
+                        }
+                    }
+                }
+                levels.push_back(std::move(level));
+                std::swap(current, next);
+                width = nextWidth;
+                height = nextHeight;
+            }
+            return levels;
+        }
+    }
+}
@@ -0,0 +1,161 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/impl/PixelReadback.hpp"
+
+#include "sre/impl/GL.hpp"
+#include "sre/Renderer.hpp"
+#include "sre/Log.hpp"
+
+namespace sre {
+    namespace {
+        const int maxBuffers = 8;
+    }
+
+    PixelReadback::PixelReadback() {
+#ifndef EMSCRIPTEN
+        auto& info = renderInfo();
+        if (info.graphicsAPIVersionES){
+            asyncSupported = info.graphicsAPIVersionMajor >= 3;
+        } else {
+            asyncSupported = info.graphicsAPIVersionMajor > 3 || (info.graphicsAPIVersionMajor == 3 && info.graphicsAPIVersionMinor >= 2);
+        }
+#endif
+    }
+
+    PixelReadback::~PixelReadback() {
+        update(true);
+        for (auto & b : buffers){
+            glDeleteBuffers(1, &b.id);
+        }
+    }
+
+    void PixelReadback::read(int x, int y, int width, int height, uint32_t format, uint32_t type, int size, Complete complete) {
+        update();
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        if (!asyncSupported){
+            std::vector<char> data(size);
+            glReadPixels(x, y, width, height, format, type, data.data());
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            complete(data.data());
+            return;
+        }
+        int buffer = acquireBuffer(size);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[buffer].id);
+        glReadPixels(x, y, width, height, format, type, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        pending.push_back({buffer, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), std::move(complete)});
+    }
+
+    std::future<std::vector<char>> PixelReadback::readTexture(unsigned int textureId, int width, int height, int level) {
+        auto promise = std::make_shared<std::promise<std::vector<char>>>();
+        auto future = promise->get_future();
+        int size = width * height * 4;
+        Complete complete = [promise, size](const char* data){
+            std::vector<char> res;
+            if (data){
+                res.assign(data, data + size);
+            }
+            promise->set_value(std::move(res));
+        };
+#ifdef GL_ES_VERSION_2_0
+        LOG_WARNING("Reading texture data is not supported on OpenGL ES");
+        complete(nullptr);
+#else
+        update();
+        glBindTexture(GL_TEXTURE_2D, textureId);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        if (!asyncSupported){
+            std::vector<char> data(size);
+            glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            complete(data.data());
+            return future;
+        }
+        int buffer = acquireBuffer(size);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[buffer].id);
+        glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        pending.push_back({buffer, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), std::move(complete)});
+#endif
+        return future;
+    }
+
+    int PixelReadback::acquireBuffer(int size) {
+        int index = -1;
+        for (int i=0;i<(int)buffers.size();i++){
+            int candidate = (nextBuffer + i) % (int)buffers.size();
+            if (!buffers[candidate].busy){
+                index = candidate;
+                break;
+            }
+        }
+        if (index == -1){
+            if (buffers.size() < maxBuffers){
+                buffers.emplace_back();
+                glGenBuffers(1, &buffers.back().id);
+                index = (int)buffers.size() - 1;
+            } else {
+                // ring is full: complete the oldest read
+                index = pending.front().buffer;
+                resolve(pending.front(), true);
+                pending.pop_front();
+            }
+        }
+        auto& buffer = buffers[index];
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.id);
+        if (buffer.size < size){
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+            buffer.size = size;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        buffer.busy = true;
+        nextBuffer = (index + 1) % maxBuffers;
+        return index;
+    }
+
+    void PixelReadback::update(bool wait) {
+        while (!pending.empty()){
+            auto& request = pending.front();
+            if (!wait){
+                auto status = glClientWaitSync((GLsync)request.fence, 0, 0);
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED){
+                    return;                             // requests complete in order
+                }
+            }
+            resolve(request, wait);
+            pending.pop_front();
+        }
+    }
+
+    void PixelReadback::resolve(Request &request, bool wait) {
+        auto fence = (GLsync)request.fence;
+        if (wait){
+            const GLuint64 timeout = 1000000000;        // 1 second
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        }
+        glDeleteSync(fence);
+        auto& buffer = buffers[request.buffer];
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.id);
+        auto data = static_cast<const char*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, buffer.size, GL_MAP_READ_BIT));
+        if (data == nullptr){
+            LOG_ERROR("Cannot map pixel pack buffer");
+        }
+        request.complete(data);
+        if (data){
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        buffer.busy = false;
+    }
+
+    int PixelReadback::getPendingCount() {
+        return (int)pending.size();
+    }
+}
@@ -0,0 +1,173 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/impl/ProgramBinaryCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "sre/impl/GL.hpp"
+#include "sre/Renderer.hpp"
+#include "sre/Log.hpp"
+
+namespace sre {
+    namespace {
+        const char magic[4] = {'S','R','E','P'};
+        const uint32_t fileVersion = 1;
+
+        struct FileHeader {
+            char magic[4];
+            uint32_t version;
+            uint64_t key;
+            uint32_t format;                    // binary format returned by glGetProgramBinary
+            uint32_t length;
+        };
+
+        // 64 bit FNV-1a
+        void hash(uint64_t& h, const char* data, size_t size){
+            for (size_t i=0;i<size;i++){
+                h ^= (uint8_t)data[i];
+                h *= 1099511628211ull;
+            }
+        }
+
+        void hash(uint64_t& h, const std::string& s){
+            hash(h, s.data(), s.size() + 1);    // include terminator to separate strings
+        }
+    }
+
+    ProgramBinaryCache::ProgramBinaryCache(std::string directory)
+    :directory(std::move(directory))
+    {
+#ifndef EMSCRIPTEN
+        auto& info = renderInfo();
+        if (info.graphicsAPIVersionES){
+            supported = info.graphicsAPIVersionMajor >= 3;
+        } else {
+            supported = info.graphicsAPIVersionMajor > 4 || (info.graphicsAPIVersionMajor == 4 && info.graphicsAPIVersionMinor >= 1) ||
+                    hasExtension("GL_ARB_get_program_binary");
+        }
+        if (supported){
+            GLint formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            supported = formats > 0;
+        }
+        auto renderer = (const char*)glGetString(GL_RENDERER);
+        driver = info.graphicsAPIVendor + "|" + (renderer ? renderer : "") + "|" + info.graphicsAPIVersion;
+#endif
+        if (!supported){
+            LOG_INFO("Program binaries not supported. Shader cache disabled");
+        }
+        if (!this->directory.empty() && this->directory.back() != '/' && this->directory.back() != '\\'){
+            this->directory += '/';
+        }
+    }
+
+    bool ProgramBinaryCache::isSupported() {
+        return supported;
+    }
+
+    uint64_t ProgramBinaryCache::computeKey(const std::map<uint32_t, std::string>& preprocessedSources,
+                                            const std::map<std::string, std::string>& specializationConstants) {
+        uint64_t h = 14695981039346656037ull;
+        hash(h, driver);
+        for (auto & s : preprocessedSources){
+            hash(h, (const char*)&s.first, sizeof(s.first));
+            hash(h, s.second);
+        }
+        for (auto & sc : specializationConstants){
+            hash(h, sc.first);
+            hash(h, sc.second);
+        }
+        return h;
+    }
+
+    unsigned int ProgramBinaryCache::load(uint64_t key) {
+        if (!supported){
+            return 0;
+        }
+        auto filename = getFilename(key);
+        std::ifstream file(filename, std::ios::binary);
+        if (!file){
+            return 0;
+        }
+        FileHeader header;
+        std::vector<char> binary;
+        if (file.read((char*)&header, sizeof(header)) &&
+                memcmp(header.magic, magic, sizeof(magic)) == 0 && header.version == fileVersion && header.key == key){
+            binary.resize(header.length);
+            if (!file.read(binary.data(), binary.size())){
+                binary.clear();
+            }
+        }
+        file.close();
+        if (binary.empty()){
+            LOG_WARNING("Invalid shader cache file %s", filename.c_str());
+            std::remove(filename.c_str());
+            return 0;
+        }
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked == GL_FALSE){
+            // rejected by the driver: compile from source instead
+            glDeleteProgram(program);
+            std::remove(filename.c_str());
+            return 0;
+        }
+        return program;
+    }
+
+    void ProgramBinaryCache::prepare(unsigned int program) {
+        if (supported){
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+    }
+
+    void ProgramBinaryCache::store(uint64_t key, unsigned int program) {
+        if (!supported){
+            return;
+        }
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0){
+            return;
+        }
+        std::vector<char> binary((size_t)length);
+        GLenum format = 0;
+        glGetProgramBinary(program, length, &length, &format, binary.data());
+
+        FileHeader header;
+        memcpy(header.magic, magic, sizeof(magic));
+        header.version = fileVersion;
+        header.key = key;
+        header.format = format;
+        header.length = (uint32_t)length;
+
+        auto filename = getFilename(key);
+        std::ofstream file(filename, std::ios::binary);
+        file.write((const char*)&header, sizeof(header));
+        file.write(binary.data(), length);
+        file.close();
+        if (!file){
+            LOG_WARNING("Cannot write shader cache file %s", filename.c_str());
+            std::remove(filename.c_str());
+        }
+    }
+
+    const std::string &ProgramBinaryCache::getDirectory() {
+        return directory;
+    }
+
+    std::string ProgramBinaryCache::getFilename(uint64_t key) {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+        return directory + name;
+    }
+}
@@ -0,0 +1,92 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/impl/RectPacker.hpp"
+
+#include <algorithm>
+
+namespace sre {
+    RectPacker::RectPacker(int width, int height)
+    :width(width), height(height)
+    {
+        skyline.push_back({0, 0, width});
+    }
+
+    int RectPacker::fit(int index, glm::ivec2 size) {
+        int x = skyline[index].x;
+        if (x + size.x > width){
+            return -1;
+        }
+        int y = skyline[index].y;
+        int widthLeft = size.x;
+        for (int i = index; widthLeft > 0; i++){
+            y = std::max(y, skyline[i].y);
+            if (y + size.y > height){
+                return -1;
+            }
+            widthLeft -= skyline[i].width;
+        }
+        return y;
+    }
+
+    bool RectPacker::insert(glm::ivec2 size, glm::ivec2 &pos) {
+        if (size.x <= 0 || size.y <= 0){
+            return false;
+        }
+        int bestIndex = -1;
+        int bestTop = height + 1;
+        int bestWidth = width + 1;
+        for (int i=0;i<(int)skyline.size();i++){
+            int y = fit(i, size);
+            if (y < 0){
+                continue;
+            }
+            int top = y + size.y;
+            if (top < bestTop || (top == bestTop && skyline[i].width < bestWidth)){
+                bestIndex = i;
+                bestTop = top;
+                bestWidth = skyline[i].width;
+            }
+        }
+        if (bestIndex == -1){
+            return false;
+        }
+        pos = {skyline[bestIndex].x, bestTop - size.y};
+
+        // raise the skyline below the rectangle
+        skyline.insert(skyline.begin() + bestIndex, {pos.x, bestTop, size.x});
+        int right = pos.x + size.x;
+        for (int i = bestIndex + 1; i < (int)skyline.size(); ){
+            auto& segment = skyline[i];
+            if (segment.x >= right){
+                break;
+            }
+            int shrink = right - segment.x;
+            segment.x += shrink;
+            segment.width -= shrink;
+            if (segment.width > 0){
+                break;
+            }
+            skyline.erase(skyline.begin() + i);
+        }
+        // merge neighbour segments with same height
+        for (int i = 0; i + 1 < (int)skyline.size(); ){
+            if (skyline[i].y == skyline[i+1].y){
+                skyline[i].width += skyline[i+1].width;
+                skyline.erase(skyline.begin() + i + 1);
+            } else {
+                i++;
+            }
+        }
+        usedArea += (int64_t)size.x * size.y;
+        return true;
+    }
+
+    float RectPacker::getOccupancy() {
+        return (float)((double)usedArea / ((double)width * height));
+    }
+}
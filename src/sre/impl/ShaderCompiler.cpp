@@ -0,0 +1,90 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/impl/ShaderCompiler.hpp"
+
+#include <chrono>
+#include "sre/Shader.hpp"
+#include "sre/Material.hpp"
+#include "sre/Renderer.hpp"
+#include "sre/Log.hpp"
+
+namespace sre {
+    namespace {
+        using Clock = std::chrono::high_resolution_clock;
+        using Milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>;
+
+        const int blockingDelayFrames = 2;              // frames before a job is finished without parallel compile
+        const float blockingBudgetMs = 4;               // time spent finishing jobs per frame without parallel compile
+    }
+
+    void ShaderCompiler::add(std::shared_ptr<Shader> shader) {
+        jobs.push_back({std::move(shader), {}, Renderer::instance->getRenderStats().frame});
+    }
+
+    void ShaderCompiler::addMaterial(Shader *shader, std::shared_ptr<Material> material) {
+        for (auto & job : jobs){
+            if (job.shader.get() == shader){
+                job.materials.push_back(material);
+                return;
+            }
+        }
+    }
+
+    bool ShaderCompiler::finish(Shader *shader) {
+        for (auto iter = jobs.begin();iter != jobs.end();iter++){
+            if (iter->shader.get() == shader){
+                Job job = std::move(*iter);
+                jobs.erase(iter);
+                return complete(job);
+            }
+        }
+        return !shader->compiling;
+    }
+
+    void ShaderCompiler::update() {
+        bool parallel = renderInfo().supportParallelShaderCompile;
+        int frame = Renderer::instance->getRenderStats().frame;
+        auto start = Clock::now();
+        for (size_t i = 0; i < jobs.size(); ){
+            // without GL_KHR_parallel_shader_compile finishing blocks until compiled, so the jobs are given a few
+            // frames (the driver may compile on its own threads) and are finished within a time budget per frame
+            bool ready = parallel ? jobs[i].shader->isBuildComplete() : jobs[i].frame + blockingDelayFrames <= frame;
+            if (!ready){
+                i++;
+                continue;
+            }
+            Job job = std::move(jobs[i]);
+            jobs.erase(jobs.begin() + i);
+            complete(job);
+            if (!parallel && Milliseconds(Clock::now() - start).count() >= blockingBudgetMs){
+                break;
+            }
+        }
+    }
+
+    bool ShaderCompiler::complete(Job &job) {
+        auto& shader = job.shader;
+        std::vector<std::string> errors;
+        if (!shader->endBuild(errors)){
+            LOG_WARNING("Cannot create specialized shader. Using shader without specialization.");
+            shader->parent->removeSpecialization(shader.get());
+            return false;
+        }
+        for (auto & m : job.materials){
+            auto material = m.lock();
+            if (material && material->getShader() == shader->parent){
+                material->setShader(shader);
+            }
+        }
+        return true;
+    }
+
+    int ShaderCompiler::getCompilingCount() {
+        return (int)jobs.size();
+    }
+}
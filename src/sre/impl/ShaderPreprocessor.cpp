@@ -0,0 +1,147 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/impl/ShaderPreprocessor.hpp"
+
+#include "sre/Resource.hpp"
+
+namespace sre {
+    namespace {
+        bool isSpace(char c){
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        // matches #pragma\s+include\s+"([^"]*)" within [begin, end). Sets include to the matched filename.
+        bool scanPragmaInclude(const std::string& source, size_t begin, size_t end, std::string& include){
+            const std::string pragma = "#pragma";
+            const std::string includeToken = "include";
+            size_t pos = source.find(pragma, begin);
+            while (pos != std::string::npos && pos < end){
+                size_t i = pos + pragma.size();
+                size_t whitespace = i;
+                while (i < end && isSpace(source[i])) i++;
+                if (i > whitespace && source.compare(i, includeToken.size(), includeToken) == 0 && i + includeToken.size() <= end){
+                    i += includeToken.size();
+                    whitespace = i;
+                    while (i < end && isSpace(source[i])) i++;
+                    if (i > whitespace && i < end && source[i] == '"'){
+                        auto quoteEnd = source.find('"', i+1);
+                        if (quoteEnd != std::string::npos && quoteEnd < end){
+                            include = source.substr(i+1, quoteEnd - i - 1);
+                            return true;
+                        }
+                    }
+                }
+                pos = source.find(pragma, pos + 1);
+            }
+            return false;
+        }
+    }
+
+    std::string ShaderPreprocessor::getKey(const std::string &resource, uint32_t shaderType,
+                                           const std::string &specializationKey, int glslVersion) {
+        // the resource is length prefixed and the specialization key is the canonical (length prefixed) key of Shader
+        std::string key = std::to_string(resource.size());
+        key += ':';
+        key += resource;
+        key += std::to_string(shaderType);
+        key += ':';
+        key += std::to_string(glslVersion);
+        key += ':';
+        key += specializationKey;
+        return key;
+    }
+
+    const ShaderPreprocessor::Entry* ShaderPreprocessor::find(const std::string &key) {
+        auto iter = sources.find(key);
+        if (iter == sources.end()){
+            misses++;
+            return nullptr;
+        }
+        hits++;
+        return &iter->second;
+    }
+
+    const ShaderPreprocessor::Entry& ShaderPreprocessor::store(const std::string &key, Entry entry) {
+        if (sources.size() >= maxSources){
+            sources.clear();
+        }
+        return sources[key] = std::move(entry);
+    }
+
+    const ShaderPreprocessor::Entry& ShaderPreprocessor::expandIncludes(const std::string &resource, uint32_t shaderType) {
+        std::string key = resource + '\n' + std::to_string(shaderType);
+        auto iter = expanded.find(key);
+        if (iter != expanded.end()){
+            return iter->second;
+        }
+        auto& entry = expanded[key];
+        const std::string& source = loadText(resource);
+        if (source.find("#pragma include") == std::string::npos) {
+            entry.source = source;
+            return entry;
+        }
+        std::string& res = entry.source;
+        res.reserve(source.size());
+        int lineNumber = 0;
+        int includes = 0;
+        size_t lineBegin = 0;
+        while (lineBegin < source.size()){
+            size_t lineEnd = source.find('\n', lineBegin);
+            if (lineEnd == std::string::npos){
+                lineEnd = source.size();
+            }
+            lineNumber++;
+            std::string include;
+            bool included = false;
+            if (scanPragmaInclude(source, lineBegin, lineEnd, include)){
+                const std::string& includeSource = loadText(include);
+                if (includeSource.empty()){
+                    entry.errors.push_back(std::string("0:")+std::to_string(lineNumber)+" cannot find include file "+include+"##"+std::to_string(shaderType));
+                } else {
+                    includes++;
+                    res += "#line "+std::to_string(includes*10000+1)+"\n";
+                    res += includeSource;
+                    res += "\n#line "+std::to_string(lineNumber)+"\n";
+                    included = true;
+                }
+            }
+            if (!included){
+                res.append(source, lineBegin, lineEnd - lineBegin);
+                res += '\n';
+            }
+            lineBegin = lineEnd + 1;
+        }
+        return entry;
+    }
+
+    const std::string& ShaderPreprocessor::loadText(const std::string &resource) {
+        auto iter = texts.find(resource);
+        if (iter == texts.end()){
+            iter = texts.emplace(resource, Resource::loadText(resource)).first;
+        }
+        return iter->second;
+    }
+
+    void ShaderPreprocessor::clear() {
+        texts.clear();
+        expanded.clear();
+        sources.clear();
+    }
+
+    int ShaderPreprocessor::getHits() {
+        return hits;
+    }
+
+    int ShaderPreprocessor::getMisses() {
+        return misses;
+    }
+
+    size_t ShaderPreprocessor::getCacheSize() {
+        return sources.size();
+    }
+}
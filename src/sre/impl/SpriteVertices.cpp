@@ -0,0 +1,265 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/impl/SpriteVertices.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "sre/Sprite.hpp"
+#include "sre/Texture.hpp"
+#include "sre/impl/WorkerPool.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SRE_SPRITE_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace sre {
+    namespace {
+        const int minSpritesPerThread = 8192;
+    }
+
+    SpriteVertices::Quad SpriteVertices::quad(const Sprite& s, glm::vec2 invTextureSize) {
+        Quad q;
+        q.x0 = s.spriteSourcePos.x - s.spriteAnchor.x * s.spriteSourceSize.x;
+        q.x1 = q.x0 + s.spriteSize.x;
+        q.y0 = s.spriteSourcePos.y - s.spriteAnchor.y * s.spriteSourceSize.y;
+        q.y1 = q.y0 + s.spriteSize.y;
+        float cosR = 1, sinR = 0;
+        if (s.rotation != 0){
+            float radians = glm::radians(s.rotation);
+            cosR = std::cos(radians);
+            sinR = std::sin(radians);
+        }
+        q.a = cosR * s.scale.x;
+        q.b = sinR * s.scale.x;
+        q.c = -sinR * s.scale.y;
+        q.d = cosR * s.scale.y;
+        q.tx = s.position.x;
+        q.ty = s.position.y;
+        q.u0 = s.spritePos.x * invTextureSize.x;
+        q.u1 = (s.spritePos.x + s.spriteSize.x) * invTextureSize.x;
+        q.v0 = s.spritePos.y * invTextureSize.y;
+        q.v1 = (s.spritePos.y + s.spriteSize.y) * invTextureSize.y;
+        if (s.flip.x){
+            std::swap(q.u0, q.u1);
+        }
+        if (s.flip.y){
+            std::swap(q.v0, q.v1);
+        }
+        q.layer = (float)s.layer;
+        return q;
+    }
+
+    void SpriteVertices::radixSort(const uint32_t* keys, std::vector<uint32_t>& order, std::vector<uint32_t>& tmp) {
+        size_t count = order.size();
+        if (count == 0){
+            return;
+        }
+        uint32_t histogram[4][256] = {};
+        for (size_t i=0;i<count;i++){
+            for (int b=0;b<4;b++){
+                histogram[b][(keys[i] >> (8*b)) & 0xFF]++;
+            }
+        }
+        // least significant digit first. The sort is stable, so sprites with equal keys keep their order
+        for (int b=0;b<4;b++){
+            int shift = 8*b;
+            auto& h = histogram[b];
+            if (h[(keys[0] >> shift) & 0xFF] == count){
+                continue;                               // all keys have the same digit
+            }
+            uint32_t offset = 0;
+            for (int i=0;i<256;i++){
+                uint32_t c = h[i];
+                h[i] = offset;
+                offset += c;
+            }
+            for (size_t i=0;i<count;i++){
+                uint32_t index = order[i];
+                tmp[h[(keys[index] >> shift) & 0xFF]++] = index;
+            }
+            std::swap(order, tmp);
+        }
+    }
+
+    void SpriteVertices::sort(const std::vector<Sprite>& sprites, std::vector<uint32_t>& order,
+                              std::vector<uint32_t>& keys, std::vector<uint32_t>& tmp,
+                              const std::vector<uint32_t>* secondaryKeys) {
+        size_t count = sprites.size();
+        order.resize(count);
+        keys.resize(count);
+        tmp.resize(count);
+        for (size_t i=0;i<count;i++){
+            keys[i] = (uint32_t)sprites[i].order.details.orderInBatch << 16 | sprites[i].order.details.texture;
+            order[i] = (uint32_t)i;
+        }
+        // sorting by the secondary keys first keeps them in order within equal primary keys
+        if (secondaryKeys != nullptr){
+            radixSort(secondaryKeys->data(), order, tmp);
+        }
+        radixSort(keys.data(), order, tmp);
+    }
+
+    void SpriteVertices::expandRange(const std::vector<Sprite>& sprites, const uint32_t* order, int count,
+                                     glm::vec2 invTextureSize, glm::vec4* dst, glm::vec2& boundsMin, glm::vec2& boundsMax) {
+        int i = 0;
+#ifdef SRE_SPRITE_SSE
+        __m128 minX = _mm_set1_ps(std::numeric_limits<float>::max());
+        __m128 minY = minX;
+        __m128 maxX = _mm_set1_ps(-std::numeric_limits<float>::max());
+        __m128 maxY = maxX;
+        const __m128 zero = _mm_setzero_ps();
+        // four sprites at a time: lanes contain the same value of four sprites
+        for (;i+4<=count;i+=4){
+            Quad q[4];
+            for (int k=0;k<4;k++){
+                q[k] = quad(sprites[order[i+k]], invTextureSize);
+            }
+#define SRE_LANES(field) _mm_set_ps(q[3].field, q[2].field, q[1].field, q[0].field)
+            __m128 x0 = SRE_LANES(x0), x1 = SRE_LANES(x1), y0 = SRE_LANES(y0), y1 = SRE_LANES(y1);
+            __m128 a = SRE_LANES(a), b = SRE_LANES(b), c = SRE_LANES(c), d = SRE_LANES(d);
+            __m128 tx = SRE_LANES(tx), ty = SRE_LANES(ty);
+            __m128 u0 = SRE_LANES(u0), u1 = SRE_LANES(u1), v0 = SRE_LANES(v0), v1 = SRE_LANES(v1);
+            __m128 layer = SRE_LANES(layer);
+#undef SRE_LANES
+            __m128 layerLo = _mm_unpacklo_ps(layer, zero);              // l0, 0, l1, 0
+            __m128 layerHi = _mm_unpackhi_ps(layer, zero);              // l2, 0, l3, 0
+            const __m128 cornerX[4] = {x1, x1, x0, x0};
+            const __m128 cornerY[4] = {y0, y1, y1, y0};
+            const __m128 cornerU[4] = {u1, u1, u0, u0};
+            const __m128 cornerV[4] = {v0, v1, v1, v0};
+            float* out = (float*)(dst + (size_t)i * 12);
+            for (int j=0;j<4;j++){
+                __m128 px = _mm_add_ps(tx, _mm_add_ps(_mm_mul_ps(a, cornerX[j]), _mm_mul_ps(c, cornerY[j])));
+                __m128 py = _mm_add_ps(ty, _mm_add_ps(_mm_mul_ps(b, cornerX[j]), _mm_mul_ps(d, cornerY[j])));
+                minX = _mm_min_ps(minX, px);
+                minY = _mm_min_ps(minY, py);
+                maxX = _mm_max_ps(maxX, px);
+                maxY = _mm_max_ps(maxY, py);
+
+                // transpose to (x, y, 0, 0) and (u, v, layer, 0) per sprite
+                __m128 posLo = _mm_unpacklo_ps(px, py);                 // x0, y0, x1, y1
+                __m128 posHi = _mm_unpackhi_ps(px, py);
+                __m128 uvLo = _mm_unpacklo_ps(cornerU[j], cornerV[j]);
+                __m128 uvHi = _mm_unpackhi_ps(cornerU[j], cornerV[j]);
+                __m128 pos[4] = {_mm_movelh_ps(posLo, zero), _mm_movehl_ps(zero, posLo),
+                                 _mm_movelh_ps(posHi, zero), _mm_movehl_ps(zero, posHi)};
+                __m128 uv[4] = {_mm_movelh_ps(uvLo, layerLo), _mm_movehl_ps(layerLo, uvLo),
+                                _mm_movelh_ps(uvHi, layerHi), _mm_movehl_ps(layerHi, uvHi)};
+                for (int k=0;k<4;k++){
+                    float* vertex = out + (k*4 + j) * 12;
+                    _mm_storeu_ps(vertex, pos[k]);
+                    _mm_storeu_ps(vertex + 4, uv[k]);
+                    _mm_storeu_ps(vertex + 8, _mm_loadu_ps(&sprites[order[i+k]].color.x));
+                }
+            }
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, minX);
+        boundsMin.x = std::min(boundsMin.x, std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3])));
+        _mm_storeu_ps(lanes, minY);
+        boundsMin.y = std::min(boundsMin.y, std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3])));
+        _mm_storeu_ps(lanes, maxX);
+        boundsMax.x = std::max(boundsMax.x, std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3])));
+        _mm_storeu_ps(lanes, maxY);
+        boundsMax.y = std::max(boundsMax.y, std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3])));
+#endif
+        for (;i<count;i++){
+            auto& sprite = sprites[order[i]];
+            Quad q = quad(sprite, invTextureSize);
+            const float cornerX[4] = {q.x1, q.x1, q.x0, q.x0};
+            const float cornerY[4] = {q.y0, q.y1, q.y1, q.y0};
+            const float cornerU[4] = {q.u1, q.u1, q.u0, q.u0};
+            const float cornerV[4] = {q.v0, q.v1, q.v1, q.v0};
+            glm::vec4* vertex = dst + (size_t)i * 12;
+            for (int j=0;j<4;j++){
+                glm::vec2 p(q.tx + q.a * cornerX[j] + q.c * cornerY[j],
+                            q.ty + q.b * cornerX[j] + q.d * cornerY[j]);
+                boundsMin = glm::min(boundsMin, p);
+                boundsMax = glm::max(boundsMax, p);
+                *vertex++ = {p, 0, 0};
+                *vertex++ = {cornerU[j], cornerV[j], q.layer, 0};
+                *vertex++ = sprite.color;
+            }
+        }
+    }
+
+    void SpriteVertices::expandInstanceRange(const std::vector<Sprite>& sprites, const uint32_t* order, int count,
+                                             glm::vec2 invTextureSize, glm::vec4* dst, glm::vec2& boundsMin, glm::vec2& boundsMax) {
+        // the quad is transformed on the GPU: only the transformed first corner and the transformed edges are stored
+        for (int i=0;i<count;i++){
+            auto& sprite = sprites[order[i]];
+            Quad q = quad(sprite, invTextureSize);
+            glm::vec2 origin(q.tx + q.a * q.x0 + q.c * q.y0,
+                             q.ty + q.b * q.x0 + q.d * q.y0);
+            glm::vec2 axisX = glm::vec2(q.a, q.b) * (q.x1 - q.x0);
+            glm::vec2 axisY = glm::vec2(q.c, q.d) * (q.y1 - q.y0);
+            for (auto p : {origin, origin + axisX, origin + axisY, origin + axisX + axisY}){
+                boundsMin = glm::min(boundsMin, p);
+                boundsMax = glm::max(boundsMax, p);
+            }
+            glm::vec4* instance = dst + (size_t)i * 3;
+            instance[0] = {axisX, axisY};
+            instance[1] = {q.u0, q.v0, q.u1, q.v1};
+            // the origin is stored as float bits to keep full precision, the color as RGBA8 (red in the low byte)
+            glm::uvec4 color = glm::uvec4(glm::clamp(sprite.color, 0.0f, 1.0f) * 255.0f + 0.5f);
+            glm::ivec4 data;
+            std::memcpy(&data.x, &origin.x, sizeof(float));
+            std::memcpy(&data.y, &origin.y, sizeof(float));
+            data.z = (int)(color.r | color.g << 8 | color.b << 16 | color.a << 24);
+            data.w = (int)q.layer;
+            std::memcpy(&instance[2], &data, sizeof(data));
+        }
+    }
+
+    int SpriteVertices::vec4PerSprite(bool instances) {
+        return instances ? 3 : 12;
+    }
+
+    void SpriteVertices::expand(const std::vector<Sprite>& sprites, const std::vector<uint32_t>& order,
+                                std::vector<Run>& runs, std::vector<Task>& tasks, glm::vec4* dst, bool instances) {
+        auto expandSprites = instances ? expandInstanceRange : expandRange;
+        size_t stride = (size_t)vec4PerSprite(instances);
+        auto invTextureSize = [](Texture* texture){
+            return glm::vec2(1.0f / texture->getWidth(), 1.0f / texture->getHeight());
+        };
+        for (auto& run : runs){
+            run.boundsMin = glm::vec2(std::numeric_limits<float>::max());
+            run.boundsMax = glm::vec2(-std::numeric_limits<float>::max());
+        }
+        auto& pool = WorkerPool::instance();
+        if (sprites.size() < 4 * minSpritesPerThread || pool.getThreadCount() == 1){
+            for (auto& run : runs){
+                expandSprites(sprites, order.data() + run.first, run.count, invTextureSize(run.texture),
+                              dst + run.first * stride, run.boundsMin, run.boundsMax);
+            }
+            return;
+        }
+
+        // split the runs in tasks, which are processed by the threads in order
+        tasks.clear();
+        for (int r=0;r<(int)runs.size();r++){
+            for (int first = runs[r].first; first < runs[r].first + runs[r].count; first += minSpritesPerThread){
+                int count = std::min(minSpritesPerThread, runs[r].first + runs[r].count - first);
+                tasks.push_back({r, first, count, runs[r].boundsMin, runs[r].boundsMax});
+            }
+        }
+        pool.parallelFor((int)tasks.size(), [&](int t){
+            auto& task = tasks[t];
+            expandSprites(sprites, order.data() + task.first, task.count, invTextureSize(runs[task.run].texture),
+                          dst + task.first * stride, task.boundsMin, task.boundsMax);
+        });
+        for (auto& task : tasks){
+            auto& r = runs[task.run];
+            r.boundsMin = glm::min(r.boundsMin, task.boundsMin);
+            r.boundsMax = glm::max(r.boundsMax, task.boundsMax);
+        }
+    }
+}
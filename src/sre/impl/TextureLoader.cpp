@@ -0,0 +1,231 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/impl/TextureLoader.hpp"
+
+#include <algorithm>
+#include "sre/impl/GL.hpp"
+#include "sre/Renderer.hpp"
+#include "sre/Log.hpp"
+#include "sre/impl/CompressedTexture.hpp"
+
+#ifndef GL_SRGB_ALPHA
+#define GL_SRGB_ALPHA 0x8C42
+#endif
+#ifndef GL_SRGB
+#define GL_SRGB 0x8C40
+#endif
+
+namespace sre {
+
+    TextureLoader::TextureLoader() {
+        if (renderInfo().graphicsAPIVersionMajor >= 3){
+            glGenBuffers(1, &pixelUnpackBuffer);
+        }
+#ifndef EMSCRIPTEN
+        unsigned int threadCount = std::max(1u, std::min(4u, std::thread::hardware_concurrency() - 1));
+        for (unsigned int i=0;i<threadCount;i++){
+            workers.emplace_back(&TextureLoader::workerLoop, this);
+        }
+#endif
+    }
+
+    TextureLoader::~TextureLoader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopWorkers = true;
+        }
+        decodeCondition.notify_all();
+        for (auto & w : workers){
+            w.join();
+        }
+        for (auto & job : uploadQueue){
+            if (job->textureId != 0){
+                glDeleteTextures(1, &job->textureId);
+            }
+        }
+        if (pixelUnpackBuffer != 0){
+            glDeleteBuffers(1, &pixelUnpackBuffer);
+        }
+    }
+
+    void TextureLoader::load(std::shared_ptr<Texture> texture, const std::string &filename, std::function<void(std::shared_ptr<Texture>)> onLoaded) {
+        auto job = std::make_shared<Job>();
+        job->texture = texture;
+        job->filename = filename;
+        if (texture->generateMipmap){
+            job->mipmapFilter = texture->mipmapFilter;
+            if (texture->streamingRequested && job->mipmapFilter == Texture::MipmapFilter::GPU){
+                job->mipmapFilter = Texture::MipmapFilter::Box;     // streaming needs the mip chain in memory
+                texture->mipmapFilter = job->mipmapFilter;
+            }
+        }
+        job->srgb = texture->samplerColorspace == Texture::SamplerColorspace::Linear;
+        job->wrap = texture->wrapUV == Texture::Wrap::Repeat;
+        if (onLoaded){
+            job->onLoaded.push_back(onLoaded);
+        }
+        pendingCount++;
+#ifdef EMSCRIPTEN
+        // no worker threads - decode on the calling thread, but still spread the upload over frames
+        decode(*job);
+        std::lock_guard<std::mutex> lock(mutex);
+        decodedQueue.push_back(job);
+#else
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            decodeQueue.push_back(job);
+        }
+        decodeCondition.notify_one();
+#endif
+    }
+
+    void TextureLoader::workerLoop() {
+        while (true){
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                decodeCondition.wait(lock, [&](){ return stopWorkers || !decodeQueue.empty(); });
+                if (stopWorkers){
+                    return;
+                }
+                job = decodeQueue.front();
+                decodeQueue.pop_front();
+            }
+            if (!job->texture.expired()){
+                decode(*job);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            decodedQueue.push_back(job);
+        }
+    }
+
+    void TextureLoader::decode(Job &job) {
+        job.image = Texture::decodeFile(job.filename);
+        Texture::generateMipmaps(job.image, job.mipmapFilter, job.srgb, job.wrap);
+    }
+
+    void TextureLoader::update(int byteBudget) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (!decodedQueue.empty()){
+                uploadQueue.push_back(decodedQueue.front());
+                decodedQueue.pop_front();
+            }
+        }
+        while (!uploadQueue.empty() && byteBudget > 0){
+            auto job = uploadQueue.front();
+            auto texture = job->texture.lock();
+            if (texture == nullptr || !job->image.valid()){
+                if (texture != nullptr){
+                    texture->loading = false;               // keep placeholder (error already logged by decode)
+                    notify(*job, texture);
+                }
+                if (job->textureId != 0){
+                    glDeleteTextures(1, &job->textureId);
+                }
+                uploadQueue.pop_front();
+                pendingCount--;
+                continue;
+            }
+            if (job->textureId == 0){
+                startUpload(*job, texture.get());
+            }
+            if (job->uploadedRows < job->image.height){
+                byteBudget -= uploadRows(*job, byteBudget);
+            } else {
+                byteBudget -= (int)Texture::compressedSize(job->image.data, job->image.mipmaps);
+            }
+            if (job->uploadedRows == job->image.height){
+                uploadQueue.pop_front();
+                pendingCount--;
+                finish(*job);
+            }
+        }
+    }
+
+    void TextureLoader::startUpload(Job &job, Texture* texture) {
+        bool linear = texture->samplerColorspace == Texture::SamplerColorspace::Linear;
+        GLint internalFormat;
+        if (job.image.compressed){
+            internalFormat = linear ? compressed::glFormatSRGB(job.image.format) : job.image.format;
+        } else if (linear){
+            internalFormat = job.image.bytesPerPixel==4?GL_SRGB_ALPHA:GL_SRGB;
+        } else {
+            internalFormat = job.image.bytesPerPixel==4?GL_RGBA:GL_RGB;
+        }
+        glGenTextures(1, &job.textureId);
+        glBindTexture(GL_TEXTURE_2D, job.textureId);
+        if (job.image.compressed || !job.image.mipmaps.empty()){
+            // images with precomputed levels are uploaded in a single step
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            Texture::uploadLevels(GL_TEXTURE_2D, internalFormat, job.image.width, job.image.height, job.image.format, job.image.compressed, job.image.data, job.image.mipmaps);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            job.uploadedRows = job.image.height;
+            return;
+        }
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, job.image.width, job.image.height, 0, job.image.format, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    int TextureLoader::uploadRows(Job &job, int byteBudget) {
+        int rowSize = job.image.width * job.image.bytesPerPixel;
+        int rows = std::max(1, std::min(byteBudget / rowSize, job.image.height - job.uploadedRows));
+        int bytes = rows * rowSize;
+        const char* src = job.image.data.data() + job.uploadedRows * rowSize;
+
+        glBindTexture(GL_TEXTURE_2D, job.textureId);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if (pixelUnpackBuffer != 0){
+            // orphan and refill the buffer, so the driver can transfer asynchronously
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelUnpackBuffer);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, src, GL_STREAM_DRAW);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, job.uploadedRows, job.image.width, rows, job.image.format, GL_UNSIGNED_BYTE, nullptr);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        } else {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, job.uploadedRows, job.image.width, rows, job.image.format, GL_UNSIGNED_BYTE, src);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        job.uploadedRows += rows;
+        return bytes;
+    }
+
+    void TextureLoader::finish(Job &job) {
+        auto texture = job.texture.lock();
+        if (texture == nullptr){
+            glDeleteTextures(1, &job.textureId);
+            return;
+        }
+        texture->replaceStorage(job.textureId, job.image);
+        job.textureId = 0;
+        job.image = {};
+        notify(job, texture);
+    }
+
+    void TextureLoader::notify(Job &job, std::shared_ptr<Texture> texture) {
+        for (auto & callback : job.onLoaded){
+            callback(texture);
+        }
+        job.onLoaded.clear();
+    }
+
+    void TextureLoader::addCallback(std::shared_ptr<Texture> texture, std::function<void(std::shared_ptr<Texture>)> onLoaded) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto queue : {&decodeQueue, &decodedQueue, &uploadQueue}){
+            for (auto & job : *queue){
+                if (job->texture.lock() == texture){
+                    job->onLoaded.push_back(onLoaded);
+                    return;
+                }
+            }
+        }
+        onLoaded(texture);                              // not pending
+    }
+
+    int TextureLoader::getPendingCount() {
+        return pendingCount;
+    }
+}
@@ -0,0 +1,133 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/impl/TextureStreamer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include "sre/Texture.hpp"
+#include "sre/Renderer.hpp"
+
+namespace sre {
+    namespace {
+        const int unusedFrames = 120;           // frames before an unused texture is reduced to its lowest levels
+        const int minimumResidentSize = 64;     // levels smaller than or equal to this size are always resident
+    }
+
+    void TextureStreamer::add(Texture *texture) {
+        textures.push_back(texture);
+    }
+
+    void TextureStreamer::remove(Texture *texture) {
+        textures.erase(std::remove(textures.begin(), textures.end(), texture), textures.end());
+    }
+
+    bool TextureStreamer::empty() {
+        return textures.empty();
+    }
+
+    void TextureStreamer::recordUsage(Texture *texture, float screenSize) {
+        int level = 0;
+        int textureSize = std::max(texture->width, texture->height);
+        if (std::isfinite(screenSize) && screenSize < textureSize){
+            level = (int)std::floor(std::log2(textureSize / std::max(1.0f, screenSize)));
+        }
+        level = std::min(level, getMinimumResidentLevel(texture));
+        int frame = Renderer::instance->renderStats.frame;
+        if (texture->lastUsedFrame != frame){
+            texture->lastUsedFrame = frame;
+            texture->requiredMipLevel = level;
+        } else {
+            texture->requiredMipLevel = std::min(texture->requiredMipLevel, level);
+        }
+    }
+
+    void TextureStreamer::update(int64_t memoryBudget, int uploadBudget) {
+        int frame = Renderer::instance->renderStats.frame;
+        struct Residency {
+            Texture* texture;
+            int wanted;
+            int minimumLevel;
+        };
+        std::vector<Residency> residency;
+        residency.reserve(textures.size());
+        int64_t total = 0;
+        for (auto texture : textures){
+            int minimumLevel = getMinimumResidentLevel(texture);
+            bool used = texture->lastUsedFrame >= 0 && frame - texture->lastUsedFrame <= unusedFrames;
+            int wanted = used ? texture->requiredMipLevel : minimumLevel;
+            residency.push_back({texture, wanted, minimumLevel});
+            total += texture->getDataSize(wanted);
+        }
+
+        // reduce resolution of the least recently used (then the largest) textures until the budget is met
+        if (memoryBudget > 0){
+            std::sort(residency.begin(), residency.end(), [](const Residency& a, const Residency& b){
+                if (a.texture->lastUsedFrame != b.texture->lastUsedFrame){
+                    return a.texture->lastUsedFrame < b.texture->lastUsedFrame;
+                }
+                return a.texture->getDataSize(a.wanted) > b.texture->getDataSize(b.wanted);
+            });
+            bool reduced = true;
+            while (total > memoryBudget && reduced){
+                reduced = false;
+                for (auto & r : residency){
+                    if (r.wanted < r.minimumLevel){
+                        total -= r.texture->getDataSize(r.wanted) - r.texture->getDataSize(r.wanted + 1);
+                        r.wanted++;
+                        reduced = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        RenderStats& renderStats = Renderer::instance->renderStats;
+        // evict first to release memory before uploading new levels
+        for (auto & r : residency){
+            if (r.wanted > r.texture->residentMipLevel){
+                r.texture->setResidentMipLevel(r.wanted);
+                renderStats.textureMipEvictions++;
+            }
+        }
+        // load one level at a time; the most recently used textures first
+        std::stable_sort(residency.begin(), residency.end(), [](const Residency& a, const Residency& b){
+            return a.texture->lastUsedFrame > b.texture->lastUsedFrame;
+        });
+        bool uploaded = false;
+        for (auto & r : residency){
+            if (r.wanted < r.texture->residentMipLevel){
+                int level = r.texture->residentMipLevel - 1;
+                auto bytes = r.texture->getDataSize(level) - r.texture->getDataSize(level + 1);  // only the new level is uploaded
+                if (uploaded && bytes > uploadBudget){
+                    break;
+                }
+                r.texture->setResidentMipLevel(level);
+                renderStats.textureMipLoads++;
+                uploadBudget -= (int)std::min<int64_t>(bytes, uploadBudget);
+                uploaded = true;
+            }
+        }
+    }
+
+    int64_t TextureStreamer::getStreamingBytes() {
+        int64_t res = 0;
+        for (auto texture : textures){
+            res += texture->getDataSize();
+        }
+        return res;
+    }
+
+    int TextureStreamer::getMinimumResidentLevel(Texture *texture) {
+        int level = 0;
+        int lastLevel = texture->getMipLevelCount() - 1;
+        while (level < lastLevel && std::max(texture->width >> level, texture->height >> level) > minimumResidentSize){
+            level++;
+        }
+        return level;
+    }
+}
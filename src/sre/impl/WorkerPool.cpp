@@ -0,0 +1,100 @@
+/*
+ *  SimpleRenderEngine (https://github.com/mortennobel/SimpleRenderEngine)
+ *
+ *  Created by Morten Nobel-Jørgensen ( http://www.nobel-joergensen.com/ )
+ *  License: MIT
+ */
+
+#include "sre/impl/WorkerPool.hpp"
+
+#include <algorithm>
+
+namespace sre {
+    namespace {
+        thread_local bool inParallelFor = false;        // set on the worker threads and on the thread running a loop
+    }
+
+    WorkerPool& WorkerPool::instance() {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    WorkerPool::WorkerPool()
+    :nextTask(0)
+    {
+        unsigned int threadCount = std::min(std::max(1u, std::thread::hardware_concurrency()), 8u);
+        for (unsigned int t=1;t<threadCount;t++){
+            threads.emplace_back(&WorkerPool::work, this);
+        }
+    }
+
+    WorkerPool::~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (auto & t : threads){
+            t.join();
+        }
+    }
+
+    int WorkerPool::getThreadCount() {
+        return (int)threads.size() + 1;
+    }
+
+    void WorkerPool::run(int taskCount, Invoke invoke, void* context) {
+        if (taskCount <= 0){
+            return;
+        }
+        if (taskCount == 1 || threads.empty() || inParallelFor || !runMutex.try_lock()){
+            for (int t=0;t<taskCount;t++){
+                invoke(context, t);
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            this->invoke = invoke;
+            this->context = context;
+            this->taskCount = taskCount;
+            nextTask = 0;
+            pending = (int)threads.size();
+            generation++;
+        }
+        wake.notify_all();
+        inParallelFor = true;
+        execute();
+        inParallelFor = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&](){ return pending == 0; });
+        }
+        runMutex.unlock();
+    }
+
+    void WorkerPool::execute() {
+        for (int t = nextTask++; t < taskCount; t = nextTask++){
+            invoke(context, t);
+        }
+    }
+
+    void WorkerPool::work() {
+        inParallelFor = true;
+        uint64_t lastGeneration = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;){
+            wake.wait(lock, [&](){ return quit || generation != lastGeneration; });
+            if (quit){
+                return;
+            }
+            lastGeneration = generation;
+            lock.unlock();
+            execute();
+            lock.lock();
+            if (--pending == 0){
+                done.notify_one();
+            }
+        }
+    }
+}
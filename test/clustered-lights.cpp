@@ -0,0 +1,132 @@
+//
+// Renders a field of objects lit by many animated point lights using the S_CLUSTERED_LIGHTS specialization of
+// the standard shaders. Toggle clustering to compare with the default (limited by maxSceneLights) lighting, where
+// each object uses the most influential lights when light selection is enabled.
+//
+
+#include <iostream>
+#include <vector>
+#include <random>
+
+#include "sre/Renderer.hpp"
+#include "sre/Camera.hpp"
+#include "sre/Material.hpp"
+#include "sre/Mesh.hpp"
+#include "sre/Shader.hpp"
+#include "sre/SDLRenderer.hpp"
+#include "sre/Inspector.hpp"
+#include <imgui.h>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/transform.hpp>
+
+using namespace sre;
+
+class ClusteredLightsExample {
+public:
+    ClusteredLightsExample(){
+        r.init();
+
+        camera.setPerspectiveProjection(60,0.1f,200);
+
+        sphere = Mesh::create().withSphere(16,32,0.5f).build();
+        plane = Mesh::create().withQuad(50).build();
+
+        for (int i=0;i<2;i++){
+            std::map<std::string,std::string> specialization;
+            if (i == 1){
+                specialization["S_CLUSTERED_LIGHTS"] = "1";
+            }
+            materials[i][0] = Shader::getStandardPBR()->createMaterial(specialization);
+            materials[i][0]->setMetallicRoughness({0.0f,0.5f});
+            materials[i][1] = Shader::getStandardBlinnPhong()->createMaterial(specialization);
+            materials[i][1]->setSpecularity({1,1,1,50});
+        }
+
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> position(-40,40);
+        std::uniform_real_distribution<float> unit(0,1);
+        for (int i=0;i<maxLights;i++){
+            lightStart.push_back({position(random), 0.5f + unit(random) * 2, position(random)});
+            lightPhase.push_back(unit(random) * 6.28f);
+            lightColor.push_back(Color(unit(random), unit(random), unit(random)));
+        }
+        updateLights();
+
+        r.frameUpdate = [&](float deltaTime){
+            time += deltaTime;
+            updateLights();
+        };
+        r.frameRender = [&](){
+            render();
+        };
+        r.startEventLoop();
+    }
+
+    void updateLights(){
+        worldLights.clear();
+        worldLights.setAmbientLight({0.02f,0.02f,0.02f});
+        for (int i=0;i<lightCount;i++){
+            glm::vec3 offset(std::sin(time + lightPhase[i]) * 2, 0, std::cos(time * 0.7f + lightPhase[i]) * 2);
+            worldLights.addLight(Light::create()
+                                         .withPointLight(lightStart[i] + offset)
+                                         .withColor(lightColor[i])
+                                         .withRange(lightRange)
+                                         .build());
+        }
+    }
+
+    void render(){
+        camera.lookAt({0,25,45},{0,0,0},{0,1,0});
+        auto renderPass = RenderPass::create()
+                .withCamera(camera)
+                .withWorldLights(&worldLights)
+                .withClearColor(true, {0,0,0,1})
+                .withLightSelection(lightSelection)
+                .build();
+
+        auto& material = materials[clustered ? 1 : 0][shader];
+        renderPass.draw(plane, glm::rotate(glm::radians(-90.0f), glm::vec3(1,0,0)), material);
+        for (int x=-20;x<=20;x++){
+            for (int z=-20;z<=20;z++){
+                renderPass.draw(sphere, glm::translate(glm::vec3(x*2,0.5f,z*2)), material);
+            }
+        }
+
+        ImGui::Checkbox("Clustered lights", &clustered);
+        if (!clustered){
+            ImGui::Checkbox("Light selection", &lightSelection);
+        }
+        ImGui::Combo("Shader", &shader, "PBR\0Blinn-Phong\0");
+        ImGui::SliderInt("Light count", &lightCount, 1, maxLights);
+        ImGui::DragFloat("Light range", &lightRange, 0.1f, 0.5f, 20);
+        ImGui::LabelText("Lights per object", "%i", clustered ? lightCount : std::min(lightCount, Renderer::instance->getMaxSceneLights()));
+        ImGui::LabelText("Frame time", "%.2f ms", ImGui::GetIO().DeltaTime * 1000);
+
+        static Inspector inspector;
+        inspector.update();
+        inspector.gui();
+    }
+private:
+    SDLRenderer r;
+    Camera camera;
+    WorldLights worldLights;
+    std::shared_ptr<Mesh> sphere;
+    std::shared_ptr<Mesh> plane;
+    std::shared_ptr<Material> materials[2][2];
+    static constexpr int maxLights = 4096;
+    std::vector<glm::vec3> lightStart;
+    std::vector<float> lightPhase;
+    std::vector<Color> lightColor;
+    int lightCount = 1024;
+    float lightRange = 4;
+    float time = 0;
+    bool clustered = true;
+    bool lightSelection = true;
+    int shader = 0;
+};
+
+int main() {
+    std::make_unique<ClusteredLightsExample>();
+    return 0;
+}
@@ -0,0 +1,239 @@
+//
+// Compares load time and GPU memory of a PNG texture with the same image stored as BC1 compressed DDS
+// (uploaded compressed if supported by the GPU, otherwise decoded on the CPU).
+// The test files are generated on startup.
+//
+
+#include <iostream>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+#include "sre/Texture.hpp"
+#include "sre/Renderer.hpp"
+#include "sre/Material.hpp"
+#include "sre/SDLRenderer.hpp"
+#include "sre/Inspector.hpp"
+#include "sre/impl/CompressedTexture.hpp"
+#include <SDL_image.h>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/transform.hpp>
+
+using namespace sre;
+using Clock = std::chrono::high_resolution_clock;
+using Milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>;
+
+constexpr int IMAGE_SIZE = 1024;
+constexpr int LOAD_COUNT = 10;
+
+namespace {
+    std::vector<uint8_t> createImage(int size){
+        std::vector<uint8_t> rgba(size*size*4);
+        for (int y=0;y<size;y++){
+            for (int x=0;x<size;x++){
+                uint8_t* p = &rgba[(y*size+x)*4];
+                bool checker = ((x/64) + (y/64)) % 2 == 0;
+                p[0] = (uint8_t)(x*255/size);
+                p[1] = (uint8_t)(y*255/size);
+                p[2] = checker ? 255 : 64;
+                p[3] = 255;
+            }
+        }
+        return rgba;
+    }
+
+    std::vector<uint8_t> downsample(const std::vector<uint8_t>& src, int size){
+        int half = size/2;
+        std::vector<uint8_t> res(half*half*4);
+        for (int y=0;y<half;y++) for (int x=0;x<half;x++) for (int c=0;c<4;c++){
+            int sum = src[((2*y)*size+2*x)*4+c] + src[((2*y)*size+2*x+1)*4+c] +
+                      src[((2*y+1)*size+2*x)*4+c] + src[((2*y+1)*size+2*x+1)*4+c];
+            res[(y*half+x)*4+c] = (uint8_t)(sum/4);
+        }
+        return res;
+    }
+
+    uint16_t to565(const uint8_t* c){
+        return (uint16_t)(((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3));
+    }
+
+    // Simple bounding box BC1 encoder (sufficient for benchmarking)
+    void encodeBC1(const std::vector<uint8_t>& rgba, int size, std::vector<char>& out){
+        int blocks = std::max(1, size/4);
+        for (int by=0;by<blocks;by++){
+            for (int bx=0;bx<blocks;bx++){
+                uint8_t minC[3] = {255,255,255};
+                uint8_t maxC[3] = {0,0,0};
+                for (int i=0;i<16;i++){
+                    int x = std::min(size-1, bx*4 + i%4);
+                    int y = std::min(size-1, by*4 + i/4);
+                    const uint8_t* p = &rgba[(y*size+x)*4];
+                    for (int c=0;c<3;c++){
+                        minC[c] = std::min(minC[c], p[c]);
+                        maxC[c] = std::max(maxC[c], p[c]);
+                    }
+                }
+                uint16_t c0 = to565(maxC);
+                uint16_t c1 = to565(minC);
+                if (c0 == c1){
+                    c1 = c0 > 0 ? (uint16_t)(c0-1) : c1;
+                    if (c0 == 0) c0 = 1;
+                }
+                float palette[4][3];
+                for (int c=0;c<3;c++){
+                    palette[0][c] = maxC[c];
+                    palette[1][c] = minC[c];
+                    palette[2][c] = (2*maxC[c] + minC[c])/3.0f;
+                    palette[3][c] = (maxC[c] + 2*minC[c])/3.0f;
+                }
+                uint32_t indices = 0;
+                for (int i=0;i<16;i++){
+                    int x = std::min(size-1, bx*4 + i%4);
+                    int y = std::min(size-1, by*4 + i/4);
+                    const uint8_t* p = &rgba[(y*size+x)*4];
+                    int best = 0;
+                    float bestDist = 1e10f;
+                    for (int j=0;j<4;j++){
+                        float d = 0;
+                        for (int c=0;c<3;c++){
+                            d += (palette[j][c]-p[c])*(palette[j][c]-p[c]);
+                        }
+                        if (d < bestDist){
+                            bestDist = d;
+                            best = j;
+                        }
+                    }
+                    indices |= (uint32_t)best << (2*i);
+                }
+                char block[8];
+                memcpy(block, &c0, 2);
+                memcpy(block+2, &c1, 2);
+                memcpy(block+4, &indices, 4);
+                out.insert(out.end(), block, block+8);
+            }
+        }
+    }
+
+    void writeDDS(const std::string& filename, std::vector<uint8_t> rgba, int size){
+        int levels = 0;
+        std::vector<char> data;
+        for (int s = size; s >= 1; s /= 2){
+            encodeBC1(rgba, s, data);
+            levels++;
+            if (s > 1){
+                rgba = downsample(rgba, s);
+            }
+        }
+        uint32_t header[32] = {0};
+        memcpy(header, "DDS ", 4);
+        header[1] = 124;                            // dwSize
+        header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // caps, height, width, pixelformat, mipmapcount, linearsize
+        header[3] = (uint32_t)size;                 // dwHeight
+        header[4] = (uint32_t)size;                 // dwWidth
+        header[5] = (uint32_t)(size/4)*(size/4)*8;  // dwPitchOrLinearSize
+        header[7] = (uint32_t)levels;               // dwMipMapCount
+        header[19] = 32;                            // ddspf.dwSize
+        header[20] = 0x4;                           // ddspf.dwFlags = DDPF_FOURCC
+        memcpy(&header[21], "DXT1", 4);             // ddspf.dwFourCC
+        header[27] = 0x1000 | 0x400000 | 0x8;       // dwCaps = texture, mipmap, complex
+        std::ofstream out(filename, std::ios::binary);
+        out.write((const char*)header, sizeof(header));
+        out.write(data.data(), data.size());
+    }
+
+    void writePNG(const std::string& filename, std::vector<uint8_t>& rgba, int size){
+        SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(rgba.data(), size, size, 32, size*4, SDL_PIXELFORMAT_ABGR8888);
+        IMG_SavePNG(surface, filename.c_str());
+        SDL_FreeSurface(surface);
+    }
+}
+
+class CompressedTextureBenchmark {
+public:
+    CompressedTextureBenchmark(){
+        r.init();
+        camera.setOrthographicProjection(1.2f,-2,2);
+
+        auto image = createImage(IMAGE_SIZE);
+        writePNG("compressed-benchmark.png", image, IMAGE_SIZE);
+        writeDDS("compressed-benchmark.dds", image, IMAGE_SIZE);
+
+        pngTexture = load("compressed-benchmark.png", pngLoadMs);
+        ddsTexture = load("compressed-benchmark.dds", ddsLoadMs);
+
+        // measure CPU fallback decoder
+        std::ifstream in("compressed-benchmark.dds", std::ios::binary);
+        std::vector<char> fileData((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        compressed::Image compressedImage;
+        compressed::parse(fileData.data(), fileData.size(), compressedImage);
+        auto start = Clock::now();
+        for (int i=0;i<LOAD_COUNT;i++){
+            compressed::decode(compressedImage.format, compressedImage.levels[0].data(), compressedImage.width, compressedImage.height);
+        }
+        cpuDecodeMs = Milliseconds(Clock::now() - start).count() / LOAD_COUNT;
+
+        mesh = Mesh::create().withQuad(0.5f).build();
+        material = Shader::getUnlit()->createMaterial();
+
+        r.frameRender = [&](){
+            render();
+        };
+        r.startEventLoop();
+    }
+
+    std::shared_ptr<Texture> load(const std::string& filename, float& ms){
+        std::shared_ptr<Texture> res;
+        auto start = Clock::now();
+        for (int i=0;i<LOAD_COUNT;i++){
+            res = Texture::create()
+                    .withFile(filename)
+                    .withGenerateMipmaps(true)
+                    .withCache(false)
+                    .build();
+        }
+        ms = Milliseconds(Clock::now() - start).count() / LOAD_COUNT;
+        std::cout << filename << " load "<< ms << " ms, "<<res->getDataSize()/(1000*1000.0f)<<" MB"<<std::endl;
+        return res;
+    }
+
+    void render(){
+        auto renderPass = RenderPass::create()
+                .withCamera(camera)
+                .withClearColor(true, {.3f, .3f, 1, 1})
+                .build();
+
+        ImGui::Begin("Compressed textures");
+        ImGui::LabelText("Image size", "%i x %i", IMAGE_SIZE, IMAGE_SIZE);
+        ImGui::LabelText("PNG load", "%.2f ms", pngLoadMs);
+        ImGui::LabelText("PNG memory", "%.2f MB", pngTexture->getDataSize()/(1000*1000.0f));
+        ImGui::LabelText("DDS (BC1) load", "%.2f ms", ddsLoadMs);
+        ImGui::LabelText("DDS (BC1) memory", "%.2f MB", ddsTexture->getDataSize()/(1000*1000.0f));
+        ImGui::LabelText("DDS uploaded compressed", "%s", ddsTexture->isCompressed()?"true":"false");
+        ImGui::LabelText("BC1 CPU decode", "%.2f ms", cpuDecodeMs);
+        ImGui::End();
+
+        material->setTexture(pngTexture);
+        renderPass.draw(mesh, glm::translate(glm::vec3(-0.55f,0,0)), material);
+        auto ddsMaterial = Shader::getUnlit()->createMaterial();
+        ddsMaterial->setTexture(ddsTexture);
+        renderPass.draw(mesh, glm::translate(glm::vec3(0.55f,0,0)), ddsMaterial);
+    }
+private:
+    SDLRenderer r;
+    Camera camera;
+    std::shared_ptr<Mesh> mesh;
+    std::shared_ptr<Material> material;
+    std::shared_ptr<Texture> pngTexture;
+    std::shared_ptr<Texture> ddsTexture;
+    float pngLoadMs = 0;
+    float ddsLoadMs = 0;
+    float cpuDecodeMs = 0;
+};
+
+int main() {
+    std::make_unique<CompressedTextureBenchmark>();
+    return 0;
+}
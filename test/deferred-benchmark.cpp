@@ -0,0 +1,144 @@
+//
+// Compares forward rendering (maxSceneLights per object), clustered forward rendering and deferred shading
+// with up to 1024 point lights. The technique and the number of lights are chosen in the GUI. The render time
+// (including waiting for the GPU) is shown as a moving average.
+//
+
+#include <vector>
+#include <random>
+#include <chrono>
+
+#include "sre/Renderer.hpp"
+#include "sre/Camera.hpp"
+#include "sre/Material.hpp"
+#include "sre/Mesh.hpp"
+#include "sre/Shader.hpp"
+#include "sre/SDLRenderer.hpp"
+#include "sre/DeferredRenderer.hpp"
+#include "sre/Inspector.hpp"
+#include <imgui.h>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/transform.hpp>
+
+using namespace sre;
+using Clock = std::chrono::high_resolution_clock;
+using Milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>;
+
+constexpr int MAX_LIGHTS = 1024;
+
+class DeferredBenchmark {
+public:
+    DeferredBenchmark(){
+        r.init();
+
+        camera.setPerspectiveProjection(60,0.1f,200);
+        camera.lookAt({0,25,45},{0,0,0},{0,1,0});
+
+        sphere = Mesh::create().withSphere(16,32,0.5f).build();
+        plane = Mesh::create().withQuad(50).build();
+
+        forwardMaterial = Shader::getStandardPBR()->createMaterial();
+        clusteredMaterial = Shader::getStandardPBR()->createMaterial({{"S_CLUSTERED_LIGHTS","1"}});
+        gbufferMaterial = Shader::getStandardPBR()->createMaterial({{"S_GBUFFER","1"}});
+        for (auto & material : {forwardMaterial, clusteredMaterial, gbufferMaterial}){
+            material->setMetallicRoughness({0.0f,0.5f});
+        }
+        deferredRenderer = DeferredRenderer::create().build();
+
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> position(-40,40);
+        std::uniform_real_distribution<float> unit(0,1);
+        for (int i=0;i<MAX_LIGHTS;i++){
+            lights.push_back(Light::create()
+                                     .withPointLight({position(random), 0.5f + unit(random) * 2, position(random)})
+                                     .withColor(Color(unit(random), unit(random), unit(random)))
+                                     .withRange(4)
+                                     .build());
+        }
+        setupLights();
+
+        r.frameRender = [&](){
+            render();
+        };
+        r.startEventLoop();
+    }
+
+    void setupLights(){
+        worldLights.clear();
+        worldLights.setAmbientLight({0.02f,0.02f,0.02f});
+        for (int i=0;i<lightCount;i++){
+            worldLights.addLight(lights[i]);
+        }
+    }
+
+    void drawScene(RenderPass& renderPass, std::shared_ptr<Material>& material){
+        renderPass.draw(plane, glm::rotate(glm::radians(-90.0f), glm::vec3(1,0,0)), material);
+        for (int x=-20;x<=20;x++){
+            for (int z=-20;z<=20;z++){
+                renderPass.draw(sphere, glm::translate(glm::vec3(x*2,0.5f,z*2)), material);
+            }
+        }
+    }
+
+    void render(){
+        auto start = Clock::now();
+        if (technique == 2 && deferredRenderer){
+            auto geometryPass = deferredRenderer->geometryPass(RenderPass::create().withCamera(camera));
+            drawScene(geometryPass, gbufferMaterial);
+            geometryPass.finish();
+            auto lightPass = deferredRenderer->lightPass(RenderPass::create()
+                    .withCamera(camera)
+                    .withWorldLights(&worldLights)
+                    .withClearColor(true, {0,0,0,1})
+                    .withGUI(false));
+            lightPass.finish();
+            lightPass.finishGPUCommandBuffer();
+        } else {
+            auto renderPass = RenderPass::create()
+                    .withCamera(camera)
+                    .withWorldLights(&worldLights)
+                    .withClearColor(true, {0,0,0,1})
+                    .withGUI(false)
+                    .build();
+            drawScene(renderPass, technique == 0 ? forwardMaterial : clusteredMaterial);
+            renderPass.finish();
+            renderPass.finishGPUCommandBuffer();
+        }
+        renderTime = glm::mix(renderTime, Milliseconds(Clock::now() - start).count(), 0.05f);
+
+        auto guiPass = RenderPass::create()
+                .withClearColor(false)
+                .withClearDepth(false)
+                .build();
+        ImGui::RadioButton("Forward", &technique, 0); ImGui::SameLine();
+        ImGui::RadioButton("Forward clustered", &technique, 1); ImGui::SameLine();
+        ImGui::RadioButton("Deferred", &technique, 2);
+        if (ImGui::SliderInt("Lights", &lightCount, 1, MAX_LIGHTS)){
+            setupLights();
+        }
+        ImGui::LabelText("Render time", "%.2f ms", renderTime);
+        static Inspector inspector;
+        inspector.update();
+        inspector.gui();
+    }
+private:
+    SDLRenderer r;
+    Camera camera;
+    WorldLights worldLights;
+    std::vector<Light> lights;
+    std::shared_ptr<Mesh> sphere;
+    std::shared_ptr<Mesh> plane;
+    std::shared_ptr<Material> forwardMaterial;
+    std::shared_ptr<Material> clusteredMaterial;
+    std::shared_ptr<Material> gbufferMaterial;
+    std::shared_ptr<DeferredRenderer> deferredRenderer;
+    int technique = 1;                                          // 0: forward, 1: forward clustered, 2: deferred
+    int lightCount = 64;
+    float renderTime = 0;                                       // moving average in milliseconds
+};
+
+int main() {
+    std::make_unique<DeferredBenchmark>();
+    return 0;
+}
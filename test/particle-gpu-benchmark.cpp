@@ -0,0 +1,118 @@
+//
+// Compares the CPU and the compute shader simulation of ParticleSystem with up to 4M live particles. The simulation
+// (CPU, GPU or GPU with depth sorting) and the number of particles are chosen in the GUI; when either changes, the
+// particle system is recreated filled with live particles. The update time (CPU time of update()) and the frame time
+// (including waiting for the GPU) are shown as moving averages. Requires OpenGL 4.3 for the GPU simulation (otherwise
+// the GPU simulation falls back to the CPU simulation).
+//
+
+#include <chrono>
+
+#include "sre/Renderer.hpp"
+#include "sre/Camera.hpp"
+#include "sre/Material.hpp"
+#include "sre/Shader.hpp"
+#include "sre/Texture.hpp"
+#include "sre/ParticleSystem.hpp"
+#include "sre/SDLRenderer.hpp"
+#include "sre/Inspector.hpp"
+#include <imgui.h>
+
+using namespace sre;
+using Clock = std::chrono::high_resolution_clock;
+using Milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>;
+
+namespace {
+    const float lifetime = 2;
+    const float deltaTime = 1.0f / 60;
+}
+
+class ParticleGPUBenchmark {
+public:
+    ParticleGPUBenchmark(){
+        r.init().withGLVersion(4,3);
+
+        camera.lookAt({0,4,14},{0,3,0},{0,1,0});
+        camera.setPerspectiveProjection(60,0.1,100);
+
+        material = Shader::getStandardParticles()->createMaterial();
+        material->setTexture(Texture::getSphereTexture());
+
+        r.frameRender = [&](){
+            render();
+        };
+        r.startEventLoop();
+    }
+
+    void createParticleSystem(){
+        int count = particleCount * 100000;
+        particleSystem = ParticleSystem::create()
+                .withMaxParticles(count)
+                .withGravity({0,-9.8f,0})
+                .withColor({1.0f,0.8f,0.3f,1.0f},{0.2f,0.3f,1.0f,0.0f})
+                .withSize(4, 1)
+                .withGPUSimulation(simulation != 0)
+                .withDepthSort(simulation == 2)
+                .build();
+        ParticleSystem::Emitter emitter;
+        emitter.positionSpread = {0.2f,0,0.2f};
+        emitter.velocity = {0,12,0};
+        emitter.velocitySpread = {3,2,3};
+        emitter.lifetime = {lifetime, lifetime};
+        emitter.rate = count / lifetime;
+        particleSystem->addEmitter(emitter);
+        // start with a full particle system
+        emitter.lifetime = {0, lifetime};
+        particleSystem->emit(emitter, count);
+    }
+
+    void render(){
+        if (particleSystem == nullptr){
+            createParticleSystem();
+        }
+
+        auto start = Clock::now();
+        particleSystem->update(deltaTime, camera.getViewTransform());
+        updateTime = glm::mix(updateTime, Milliseconds(Clock::now() - start).count(), 0.05f);
+
+        auto renderPass = RenderPass::create()
+                .withCamera(camera)
+                .withClearColor(true, {0,0,0,1})
+                .withGUI(false)
+                .build();
+        renderPass.draw(particleSystem->getMesh(), glm::mat4(1), material);
+        renderPass.finish();
+        renderPass.finishGPUCommandBuffer();
+        frameTime = glm::mix(frameTime, Milliseconds(Clock::now() - start).count(), 0.05f);
+
+        auto guiPass = RenderPass::create()
+                .withClearColor(false)
+                .withClearDepth(false)
+                .build();
+        bool changed = ImGui::Combo("Simulation", &simulation, "CPU\0GPU\0GPU sorted\0");
+        changed |= ImGui::SliderInt("Particles (100k)", &particleCount, 1, 40);
+        if (changed){
+            particleSystem.reset();
+        }
+        ImGui::LabelText("Compute shaders", "%s", renderInfo().supportComputeShader ? "supported" : "not supported (CPU fallback)");
+        ImGui::LabelText("Update time", "%.2f ms", updateTime);
+        ImGui::LabelText("Frame time", "%.2f ms", frameTime);
+        static Inspector inspector;
+        inspector.update();
+        inspector.gui();
+    }
+private:
+    SDLRenderer r;
+    Camera camera;
+    std::shared_ptr<ParticleSystem> particleSystem;
+    std::shared_ptr<Material> material;
+    int simulation = 1;                                         // 0: CPU, 1: GPU, 2: GPU sorted
+    int particleCount = 10;                                     // in units of 100k particles
+    float updateTime = 0;                                       // moving averages in milliseconds
+    float frameTime = 0;
+};
+
+int main() {
+    std::make_unique<ParticleGPUBenchmark>();
+    return 0;
+}
@@ -0,0 +1,105 @@
+//
+// Fountain of up to 2M particles simulated by ParticleSystem. The emission rate, lifetime and drag can be changed using
+// the GUI. The update time (simulation, emission and vertex upload) and the frame time are shown.
+//
+
+#include <iostream>
+#include <chrono>
+
+#include "sre/Renderer.hpp"
+#include "sre/Camera.hpp"
+#include "sre/Material.hpp"
+#include "sre/Shader.hpp"
+#include "sre/Texture.hpp"
+#include "sre/ParticleSystem.hpp"
+#include "sre/SDLRenderer.hpp"
+#include "sre/Inspector.hpp"
+#include <imgui.h>
+
+using namespace sre;
+using Clock = std::chrono::high_resolution_clock;
+using Milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>;
+
+class ParticleSystemExample {
+public:
+    ParticleSystemExample(){
+        r.init();
+
+        camera.lookAt({0,4,14},{0,3,0},{0,1,0});
+        camera.setPerspectiveProjection(60,0.1,100);
+
+        particleSystem = ParticleSystem::create()
+                .withMaxParticles(2000000)
+                .withGravity({0,-9.8f,0})
+                .withDrag(0.1f)
+                .withColor({1.0f,0.8f,0.3f,1.0f},{0.2f,0.3f,1.0f,0.0f})
+                .withSize(8, 2)
+                .withName("Fountain")
+                .build();
+
+        ParticleSystem::Emitter emitter;
+        emitter.positionSpread = {0.2f,0,0.2f};
+        emitter.velocity = {0,12,0};
+        emitter.velocitySpread = {3,2,3};
+        emitter.lifetime = {2,3};
+        emitter.angularVelocity = {-3,3};
+        emitter.rate = rate;
+        fountain = particleSystem->addEmitter(emitter);
+
+        material = Shader::getStandardParticles()->createMaterial();
+        material->setTexture(Texture::getSphereTexture());
+
+        r.frameUpdate = [&](float deltaTime){
+            auto& emitter = particleSystem->getEmitter(fountain);
+            emitter.rate = rate;
+            emitter.lifetime = {lifetime, lifetime * 1.5f};
+            particleSystem->update(deltaTime);
+        };
+        r.frameRender = [&](){
+            render();
+        };
+        r.startEventLoop();
+    }
+
+    void render(){
+        auto start = Clock::now();
+        auto renderPass = RenderPass::create()
+                .withCamera(camera)
+                .withClearColor(true, {0,0,0,1})
+                .build();
+        renderPass.draw(particleSystem->getMesh(), glm::mat4(1), material);
+
+        ImGui::DragFloat("Rate (particles/s)", &rate, 1000, 0, 2000000);
+        ImGui::DragFloat("Lifetime", &lifetime, 0.1f, 0.1f, 10);
+        if (ImGui::Button("Burst")){
+            ParticleSystem::Emitter burst;
+            burst.position = {0,6,0};
+            burst.velocitySpread = {8,8,8};
+            burst.lifetime = {1,2};
+            particleSystem->emit(burst, 100000);
+        }
+        ImGui::LabelText("Particles", "%i / %i", particleSystem->getParticleCount(), particleSystem->getMaxParticles());
+        ImGui::LabelText("Update", "%.2f ms", particleSystem->getUpdateTime());
+        ImGui::LabelText("Frame", "%.2f ms", frameTime);
+        static Inspector inspector;
+        inspector.update();
+        inspector.gui();
+
+        renderPass.finish();
+        frameTime = Milliseconds(Clock::now() - start).count();
+    }
+private:
+    SDLRenderer r;
+    Camera camera;
+    std::shared_ptr<ParticleSystem> particleSystem;
+    std::shared_ptr<Material> material;
+    int fountain;
+    float rate = 200000;
+    float lifetime = 2;
+    float frameTime = 0;
+};
+
+int main() {
+    std::make_unique<ParticleSystemExample>();
+    return 0;
+}
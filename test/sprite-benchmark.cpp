@@ -0,0 +1,105 @@
+//
+// Measures building a SpriteBatch of animated sprites every frame. The sprite batch is either created from scratch,
+// updated in place or updated in place as an instanced sprite batch. The build time (sorting, vertex expansion and
+// upload) of the last frames is plotted; the frame time is shown in the inspector.
+//
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <numeric>
+#include <cstdio>
+#include <cfloat>
+
+#include "sre/Renderer.hpp"
+#include "sre/Camera.hpp"
+#include "sre/SpriteAtlas.hpp"
+#include "sre/SpriteBatch.hpp"
+#include "sre/SDLRenderer.hpp"
+#include "sre/Inspector.hpp"
+#include <imgui.h>
+
+using namespace sre;
+using Clock = std::chrono::high_resolution_clock;
+using Milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>;
+
+constexpr int MAX_SPRITES = 1000000;
+constexpr int HISTORY_FRAMES = 100;
+
+class SpriteBenchmark {
+public:
+    SpriteBenchmark(){
+        r.init();
+
+        camera.setWindowCoordinates();
+
+        atlas = SpriteAtlas::create("test_data/sprite_test.json","test_data/sprite_test.png");
+        auto names = atlas->getNames();
+
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> unit(0,1);
+        auto windowSize = Renderer::instance->getWindowSize();
+        for (int i=0;i<MAX_SPRITES;i++){
+            auto sprite = atlas->get(names[i % names.size()]);
+            sprite.setPosition({unit(random) * windowSize.x, unit(random) * windowSize.y});
+            sprite.setScale({0.25f, 0.25f});
+            sprite.setColor({unit(random), unit(random), unit(random), 1});
+            sprite.setOrderInBatch((uint16_t)(unit(random) * 4));
+            sprites.push_back(sprite);
+        }
+
+        r.frameRender = [&](){
+            render();
+        };
+        r.startEventLoop();
+    }
+
+    void render(){
+        auto start = Clock::now();
+        float rotation = frame * 2.0f;
+        for (int i=0;i<spriteCount;i++){
+            sprites[i].setRotation(rotation + i);
+        }
+        if (method == 0 || spriteBatch == nullptr){
+            spriteBatch = SpriteBatch::create().withInstancing(method == 2).addSprites(sprites.begin(), sprites.begin() + spriteCount).build();
+        } else {
+            spriteBatch->update().addSprites(sprites.begin(), sprites.begin() + spriteCount).build();
+        }
+        buildTime[frame % HISTORY_FRAMES] = Milliseconds(Clock::now() - start).count();
+        frame++;
+
+        auto renderPass = RenderPass::create()
+                .withCamera(camera)
+                .withClearColor(true, {0,0,0,1})
+                .build();
+        renderPass.draw(spriteBatch);
+
+        bool changed = ImGui::Combo("Method", &method, "Create\0Update\0Update instanced\0");
+        changed |= ImGui::SliderInt("Sprites", &spriteCount, 1000, MAX_SPRITES);
+        if (changed){
+            spriteBatch.reset();                            // the update methods start from a new sprite batch
+        }
+        char average[32];
+        snprintf(average, sizeof(average), "%.2f ms", std::accumulate(buildTime, buildTime + HISTORY_FRAMES, 0.0f) / HISTORY_FRAMES);
+        ImGui::PlotLines("Build time", buildTime, HISTORY_FRAMES, frame % HISTORY_FRAMES, average,
+                         0, FLT_MAX, ImVec2(ImGui::CalcItemWidth(), 150));
+        static Inspector inspector;
+        inspector.update();
+        inspector.gui();
+    }
+private:
+    SDLRenderer r;
+    Camera camera;
+    std::shared_ptr<SpriteAtlas> atlas;
+    std::vector<Sprite> sprites;
+    std::shared_ptr<SpriteBatch> spriteBatch;
+    int method = 1;
+    int spriteCount = 100000;
+    int frame = 0;
+    float buildTime[HISTORY_FRAMES] = {0};          // milliseconds
+};
+
+int main() {
+    std::make_unique<SpriteBenchmark>();
+    return 0;
+}